@@ -44,6 +44,8 @@
         'crashpad_client_win.cc',
         'crashpad_info.cc',
         'crashpad_info.h',
+        'pending_report_watcher_linux.cc',
+        'pending_report_watcher_linux.h',
         'prune_crash_reports.cc',
         'prune_crash_reports.h',
         'settings.cc',
@@ -70,6 +72,8 @@
             'client_argv_handling.h',
             'crashpad_info_note.S',
             'crash_report_database_generic.cc',
+            'crash_report_database_index.cc',
+            'crash_report_database_index.h',
           ],
         }],
       ],
@@ -77,6 +81,7 @@
         ['OS=="android"', {
           'sources/': [
             ['include', '^crashpad_client_linux\\.cc$'],
+            ['include', '^pending_report_watcher_linux\\.(cc|h)$'],
             ['include', '^simulate_crash_linux\\.h$'],
           ],
         }],
@@ -41,6 +41,7 @@
         'crash_report_database_test.cc',
         'crashpad_client_win_test.cc',
         'crashpad_client_linux_test.cc',
+        'pending_report_watcher_linux_test.cc',
         'prune_crash_reports_test.cc',
         'settings_test.cc',
         'simple_address_range_bag_test.cc',
@@ -53,11 +54,17 @@
             '../handler/handler.gyp:crashpad_handler_console',
           ],
         }],
+        ['OS=="linux" or OS=="android"', {
+          'sources': [
+            'crash_report_database_index_test.cc',
+          ],
+        }],
       ],
       'target_conditions': [
         ['OS=="android"', {
           'sources/': [
             ['include', '^crashpad_client_linux_test\\.cc$'],
+            ['include', '^pending_report_watcher_linux_test\\.cc$'],
           ],
         }],
       ],
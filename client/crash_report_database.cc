@@ -80,6 +80,7 @@ CrashReportDatabase::UploadReport::UploadReport()
       database_(nullptr),
       attachment_readers_(),
       attachment_map_(),
+      precompressed_reader_(),
       report_metrics_(false) {}
 
 CrashReportDatabase::UploadReport::~UploadReport() {
@@ -104,4 +105,35 @@ CrashReportDatabase::OperationStatus CrashReportDatabase::RecordUploadComplete(
   return RecordUploadAttempt(report, true, id);
 }
 
+std::unique_ptr<CrashReportDatabase::PendingReportWatcher>
+CrashReportDatabase::WatchPendingReports() {
+  return nullptr;
+}
+
+CrashReportDatabase::OperationStatus
+CrashReportDatabase::CheckOutReportForUploading(
+    const UUID& uuid,
+    std::unique_ptr<const UploadReport>* report,
+    bool report_metrics) {
+  return GetReportForUploading(uuid, report, report_metrics);
+}
+
+CrashReportDatabase::OperationStatus
+CrashReportDatabase::PrepareReportForUploading(const UploadReport* report) {
+  return kNoError;
+}
+
+CrashReportDatabase::OperationStatus CrashReportDatabase::CompressReport(
+    const UUID& uuid) {
+  return kNoError;
+}
+
+bool CrashReportDatabase::EnablePrecompression(int level, int window_bits) {
+  return false;
+}
+
+bool CrashReportDatabase::EnableCompressedStorage(int level, int window_bits) {
+  return false;
+}
+
 }  // namespace crashpad
@@ -71,6 +71,10 @@ class CrashReportDatabase {
     //! The current location of the crash report on the client’s filesystem.
     //! The location of a crash report may change over time, so the UUID should
     //! be used as the canonical identifier.
+    //!
+    //! If the report was compressed while EnableCompressedStorage() was in
+    //! effect, the file holds the report as compressed by GzipPrecompress().
+    //! UploadReport::Reader() always reads the uncompressed report.
     base::FilePath file_path;
 
     //! An identifier issued to this crash report by a collection server.
@@ -165,6 +169,8 @@ class CrashReportDatabase {
     virtual ~UploadReport();
 
     //! \brief An open FileReader with which to read the report.
+    //!
+    //! The report is decompressed first if it is stored compressed.
     FileReader* Reader() const { return reader_.get(); }
 
     //! \brief Obtains a mapping of names to file readers for any attachments
@@ -175,6 +181,16 @@ class CrashReportDatabase {
       return attachment_map_;
     }
 
+    //! \brief An open FileReader with which to read the report as compressed
+    //!     by GzipPrecompress(), or `nullptr` if there is no such copy.
+    //!
+    //! A copy is only kept while precompression is enabled by
+    //! EnablePrecompression(). For a report that is stored compressed, this
+    //! reads the stored report.
+    FileReader* PrecompressedReader() const {
+      return precompressed_reader_.get();
+    }
+
    private:
     friend class CrashReportDatabase;
     friend class CrashReportDatabaseGeneric;
@@ -188,6 +204,7 @@ class CrashReportDatabase {
     CrashReportDatabase* database_;
     std::vector<std::unique_ptr<FileReader>> attachment_readers_;
     std::map<std::string, FileReader*> attachment_map_;
+    std::unique_ptr<FileReader> precompressed_reader_;
     bool report_metrics_;
 
     DISALLOW_COPY_AND_ASSIGN(UploadReport);
@@ -233,6 +250,65 @@ class CrashReportDatabase {
     kCannotRequestUpload,
   };
 
+  //! \brief A source of notifications about reports that have entered the
+  //!     pending state, obtained from WatchPendingReports().
+  //!
+  //! Reports become pending when FinishedWritingCrashReport() or
+  //! RequestUpload() is called on any CrashReportDatabase object referring to
+  //! the same database, including those in other processes.
+  class PendingReportWatcher {
+   public:
+    //! \brief An interface to be notified when pending reports may be
+    //!     available from TakePendingReports().
+    class Delegate {
+     public:
+      //! \brief Called on an unspecified thread when reports have become
+      //!     pending or when TakePendingReports() would return `false`.
+      virtual void PendingReportsAvailable() = 0;
+
+     protected:
+      ~Delegate() {}
+    };
+
+    virtual ~PendingReportWatcher() {}
+
+    //! \brief Begins calling \a delegate when reports become pending.
+    //!
+    //! Reports that became pending after the watcher was obtained and before
+    //! this method is called are also reported to \a delegate.
+    //!
+    //! \param[in] delegate The delegate to notify. It must remain valid until
+    //!     Stop() is called or this object is destroyed.
+    virtual void Start(Delegate* delegate) = 0;
+
+    //! \brief Returns the reports that have become pending since the previous
+    //!     call.
+    //!
+    //! A returned report may already have left the pending state, and a report
+    //! may be returned more than once.
+    //!
+    //! \param[out] uuids The unique identifiers of the reports that have become
+    //!     pending. This must be empty on entry.
+    //!
+    //! \return `true` on success. `false` if notifications may have been lost,
+    //!     in which case the caller should look for pending reports with
+    //!     GetPendingReports().
+    virtual bool TakePendingReports(std::vector<UUID>* uuids) = 0;
+
+    //! \brief Stops calling the Delegate.
+    //!
+    //! When this method returns, the Delegate will not be called again.
+    //! TakePendingReports() may still be called. This method does nothing if
+    //! Start() has not been called.
+    virtual void Stop() = 0;
+
+   protected:
+    PendingReportWatcher() {}
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(PendingReportWatcher);
+  };
+
   virtual ~CrashReportDatabase() {}
 
   //! \brief Opens a database of crash reports, possibly creating it.
@@ -348,6 +424,57 @@ class CrashReportDatabase {
       std::unique_ptr<const UploadReport>* report,
       bool report_metrics = true) = 0;
 
+  //! \brief Obtains and locks a report object for uploading, without the
+  //!     compression or decompression that GetReportForUploading() may do.
+  //!
+  //! Together with PrepareReportForUploading(), this does the same as
+  //! GetReportForUploading(), but allows a caller that obtains reports under a
+  //! lock of its own to release it before the slower work of preparing the
+  //! report is done. The report must not be read until
+  //! PrepareReportForUploading() has succeeded.
+  //!
+  //! The default implementation calls GetReportForUploading().
+  //!
+  //! \param[in] uuid The unique identifier for the crash report record.
+  //! \param[out] report A crash report record for the report to be uploaded.
+  //!     Only valid if this returns #kNoError.
+  //! \param[in] report_metrics As for GetReportForUploading().
+  //!
+  //! \return The operation status code.
+  virtual OperationStatus CheckOutReportForUploading(
+      const UUID& uuid,
+      std::unique_ptr<const UploadReport>* report,
+      bool report_metrics = true);
+
+  //! \brief Prepares a report obtained from CheckOutReportForUploading() to be
+  //!     read, compressing it as enabled by EnablePrecompression() or
+  //!     EnableCompressedStorage(), or decompressing it if it’s stored
+  //!     compressed.
+  //!
+  //! The default implementation does nothing.
+  //!
+  //! \param[in] report A report obtained from CheckOutReportForUploading(). If
+  //!     this fails, \a report should be released.
+  //!
+  //! \return The operation status code.
+  virtual OperationStatus PrepareReportForUploading(const UploadReport* report);
+
+  //! \brief Replaces a report that is stored uncompressed with its compressed
+  //!     form, if EnableCompressedStorage() is in effect.
+  //!
+  //! This is intended to be called away from the crash path, soon after
+  //! FinishedWritingCrashReport(), so that reports are stored compressed
+  //! whether or not they are uploaded. The report may be pending or completed.
+  //!
+  //! The default implementation does nothing.
+  //!
+  //! \param[in] uuid The unique identifier for the crash report record.
+  //!
+  //! \return The operation status code. #kNoError if the report was
+  //!     compressed or didn’t need to be. #kBusyError if the report was in use,
+  //!     in which case this may be tried again later.
+  virtual OperationStatus CompressReport(const UUID& uuid);
+
   //! \brief Records a successful upload for a report and updates the last
   //!     upload attempt time as returned by
   //!     Settings::GetLastUploadAttemptTime().
@@ -404,6 +531,61 @@ class CrashReportDatabase {
   //! \return The number of reports cleaned.
   virtual int CleanDatabase(time_t lockfile_ttl) { return 0; }
 
+  //! \brief Begins watching for reports entering the pending state.
+  //!
+  //! This allows a caller to learn of new pending reports, including those
+  //! added by other processes, without calling GetPendingReports() repeatedly.
+  //! Reports that are already pending when this method is called are not
+  //! reported by the returned object.
+  //!
+  //! This method is only implemented on Linux and Android.
+  //!
+  //! \return A PendingReportWatcher on success. `nullptr` if watching is not
+  //!     supported or fails, with an error logged in the latter case.
+  virtual std::unique_ptr<PendingReportWatcher> WatchPendingReports();
+
+  //! \brief Enables keeping a `gzip`-ready copy of each pending report.
+  //!
+  //! When enabled, GetReportForUploading() or PrepareReportForUploading()
+  //! compresses a report that has no copy with GzipPrecompress(), and the copy
+  //! is available from UploadReport::PrecompressedReader() until the report is
+  //! uploaded or skipped, so that a `gzip`-encoded upload need not compress the
+  //! report again on each attempt. The copy is counted in Report::total_size.
+  //!
+  //! Compression happens on the thread that uploads reports, so it doesn’t
+  //! delay FinishedWritingCrashReport() or the crashed process waiting on it.
+  //!
+  //! This method is only implemented on Linux, Android, and Fuchsia.
+  //!
+  //! \param[in] level The `zlib` compression level, from `0` to `9`, or
+  //!     GzipHTTPBodyStream::kDefaultLevel.
+  //! \param[in] window_bits The base-2 logarithm of the `zlib` window size,
+  //!     from `9` to `15`.
+  //!
+  //! \return `true` if precompression is supported and was enabled.
+  virtual bool EnablePrecompression(int level, int window_bits);
+
+  //! \brief Enables storing reports in compressed form.
+  //!
+  //! When enabled, CompressReport() replaces a report that is stored
+  //! uncompressed with its compressed form as written by GzipPrecompress().
+  //! GetReportForUploading() or PrepareReportForUploading() does the same for
+  //! a report that CompressReport() hasn’t been called for yet.
+  //! UploadReport::PrecompressedReader() provides the compressed form for a
+  //! `gzip`-encoded upload, and UploadReport::Reader() reads a temporary
+  //! decompressed copy, which is removed when the UploadReport is released and
+  //! isn’t counted in Report::total_size.
+  //!
+  //! This method is only implemented on Linux, Android, and Fuchsia.
+  //!
+  //! \param[in] level The `zlib` compression level, from `0` to `9`, or
+  //!     GzipHTTPBodyStream::kDefaultLevel.
+  //! \param[in] window_bits The base-2 logarithm of the `zlib` window size,
+  //!     from `9` to `15`.
+  //!
+  //! \return `true` if compressed storage is supported and was enabled.
+  virtual bool EnableCompressedStorage(int level, int window_bits);
+
  protected:
   CrashReportDatabase() {}
 
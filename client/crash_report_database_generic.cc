@@ -17,16 +17,24 @@
 #include <stdint.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 
+#include <map>
 #include <utility>
 
 #include "base/logging.h"
 #include "build/build_config.h"
+#include "client/crash_report_database_index.h"
 #include "client/settings.h"
 #include "util/file/directory_reader.h"
 #include "util/file/filesystem.h"
 #include "util/misc/initialization_state_dcheck.h"
 #include "util/misc/memory_sanitizer.h"
+#include "util/net/http_body_gzip.h"
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include "client/pending_report_watcher_linux.h"
+#endif  // OS_LINUX || OS_ANDROID
 
 namespace crashpad {
 
@@ -63,6 +71,10 @@ constexpr base::FilePath::CharType kMetadataExtension[] =
     FILE_PATH_LITERAL(".meta");
 constexpr base::FilePath::CharType kLockExtension[] =
     FILE_PATH_LITERAL(".lock");
+constexpr base::FilePath::CharType kPrecompressedExtension[] =
+    FILE_PATH_LITERAL(".dmpz");
+constexpr base::FilePath::CharType kInflatedExtension[] =
+    FILE_PATH_LITERAL(".inflated");
 
 constexpr base::FilePath::CharType kNewDirectory[] = FILE_PATH_LITERAL("new");
 constexpr base::FilePath::CharType kPendingDirectory[] =
@@ -71,6 +83,8 @@ constexpr base::FilePath::CharType kCompletedDirectory[] =
     FILE_PATH_LITERAL("completed");
 constexpr base::FilePath::CharType kAttachmentsDirectory[] =
     FILE_PATH_LITERAL("attachments");
+constexpr base::FilePath::CharType kPrecompressedDirectory[] =
+    FILE_PATH_LITERAL("precompressed");
 
 constexpr const base::FilePath::CharType* kReportDirectories[] = {
     kNewDirectory,
@@ -78,6 +92,20 @@ constexpr const base::FilePath::CharType* kReportDirectories[] = {
     kCompletedDirectory,
 };
 
+// Returns whether the report at path or its metadata was modified after time,
+// in nanoseconds since the epoch, or if that can’t be determined.
+bool ReportModifiedAfter(const base::FilePath& path, int64_t time) {
+  for (const base::FilePath& file_path :
+       {path, ReplaceFinalExtension(path, kMetadataExtension)}) {
+    timespec mtime;
+    if (!FileModificationTime(file_path, &mtime) ||
+        int64_t{mtime.tv_sec} * 1000000000 + mtime.tv_nsec > time) {
+      return true;
+    }
+  }
+  return false;
+}
+
 enum {
   //! \brief Corresponds to uploaded bit of the report state.
   kAttributeUploaded = 1 << 0,
@@ -112,8 +140,7 @@ class ScopedLockFile {
   bool ResetAcquire(const base::FilePath& report_path) {
     lock_file_.reset();
 
-    base::FilePath lock_path(report_path.RemoveFinalExtension().value() +
-                             kLockExtension);
+    base::FilePath lock_path(LockPath(report_path));
     ScopedFileHandle lock_fd(LoggingOpenFileForWrite(
         lock_path, FileWriteMode::kCreateOrFail, FilePermissions::kOwnerOnly));
     if (!lock_fd.is_valid()) {
@@ -132,6 +159,11 @@ class ScopedLockFile {
   // Returns `true` if the lock is held.
   bool is_valid() const { return lock_file_.is_valid(); }
 
+  // Returns `true` if a lock for the report at report_path is held.
+  static bool IsLocked(const base::FilePath& report_path) {
+    return IsRegularFile(LockPath(report_path));
+  }
+
   // Returns `true` if the lockfile at lock_path has expired.
   static bool IsExpired(const base::FilePath& lock_path, time_t lockfile_ttl) {
     time_t now = time(nullptr);
@@ -157,6 +189,11 @@ class ScopedLockFile {
   }
 
  private:
+  static base::FilePath LockPath(const base::FilePath& report_path) {
+    return base::FilePath(report_path.RemoveFinalExtension().value() +
+                          kLockExtension);
+  }
+
   ScopedRemoveFile lock_file_;
 
   DISALLOW_COPY_AND_ASSIGN(ScopedLockFile);
@@ -192,7 +229,8 @@ void AddAttachmentSize(const base::FilePath& attachments_dir, uint64_t* size) {
 
 }  // namespace
 
-class CrashReportDatabaseGeneric : public CrashReportDatabase {
+class CrashReportDatabaseGeneric : public CrashReportDatabase,
+                                   public CrashReportDatabaseIndex::Delegate {
  public:
   CrashReportDatabaseGeneric();
   ~CrashReportDatabaseGeneric() override;
@@ -212,11 +250,21 @@ class CrashReportDatabaseGeneric : public CrashReportDatabase {
       const UUID& uuid,
       std::unique_ptr<const UploadReport>* report,
       bool report_metrics) override;
+  OperationStatus CheckOutReportForUploading(
+      const UUID& uuid,
+      std::unique_ptr<const UploadReport>* report,
+      bool report_metrics) override;
+  OperationStatus PrepareReportForUploading(
+      const UploadReport* report) override;
+  OperationStatus CompressReport(const UUID& uuid) override;
   OperationStatus SkipReportUpload(const UUID& uuid,
                                    Metrics::CrashSkippedReason reason) override;
   OperationStatus DeleteReport(const UUID& uuid) override;
   OperationStatus RequestUpload(const UUID& uuid) override;
   int CleanDatabase(time_t lockfile_ttl) override;
+  std::unique_ptr<PendingReportWatcher> WatchPendingReports() override;
+  bool EnablePrecompression(int level, int window_bits) override;
+  bool EnableCompressedStorage(int level, int window_bits) override;
 
   // Build a filepath for the directory for the report to hold attachments.
   base::FilePath AttachmentsPath(const UUID& uuid);
@@ -247,6 +295,15 @@ class CrashReportDatabaseGeneric : public CrashReportDatabase {
                                       bool successful,
                                       const std::string& id) override;
 
+  // CrashReportDatabaseIndex::Delegate:
+  bool CrashReportDatabaseIndexUpdate(
+      bool valid,
+      std::vector<CrashReportDatabaseIndex::Entry>* entries) override;
+
+  // Records report in the index as being in state. Failures are logged, and
+  // the index is corrected when it is next synchronized with the report files.
+  void IndexReport(const Report& report, ReportState state);
+
   // Builds a filepath for the report with the specified uuid and state.
   base::FilePath ReportPath(const UUID& uuid, ReportState state);
 
@@ -268,7 +325,8 @@ class CrashReportDatabaseGeneric : public CrashReportDatabase {
                                  ScopedLockFile* lock_file,
                                  Report* report);
 
-  // Reads metadata for all reports in state and returns it in reports.
+  // Reads metadata for all reports in state from the index and returns it in
+  // reports.
   OperationStatus ReportsInState(ReportState state,
                                  std::vector<Report>* reports);
 
@@ -278,10 +336,40 @@ class CrashReportDatabaseGeneric : public CrashReportDatabase {
   // Cleans any attachments that have no associated report in any state.
   void CleanOrphanedAttachments();
 
-  // Attempt to remove any attachments associated with the given report UUID.
-  // There may not be any, so failing is not an error.
+  // Cleans any precompressed copies that have no associated pending report.
+  void CleanOrphanedPrecompressedReports();
+
+  // Attempt to remove any attachments and precompressed copy associated with
+  // the given report UUID. There may not be any, so failing is not an error.
   void RemoveAttachmentsByUUID(const UUID& uuid);
 
+  // Builds a filepath for the precompressed copy of the report with uuid.
+  base::FilePath PrecompressedPath(const UUID& uuid);
+
+  // Builds a filepath in "new" for a temporary file derived from the report
+  // with uuid, with the given extension.
+  base::FilePath TemporaryPath(const UUID& uuid,
+                               const base::FilePath::StringType& extension);
+
+  // Writes the report at path compressed by GzipPrecompress() to
+  // compressed_path. On failure, nothing is left at compressed_path.
+  bool WriteCompressedReport(const base::FilePath& path,
+                             const base::FilePath& compressed_path);
+
+  // Replaces the report at path, which has id uuid and is stored uncompressed,
+  // with its compressed form. The caller must hold the report’s lock. An open
+  // reader of the report continues to read it uncompressed.
+  bool CompressReportInPlace(const base::FilePath& path, const UUID& uuid);
+
+  // Removes the precompressed copy of the report with uuid, if there is one,
+  // returning its size.
+  uint64_t RemovePrecompressedReport(const UUID& uuid);
+
+  // Replaces report->reader_, which reads a report stored compressed, with a
+  // reader of a temporary decompressed copy, and moves the reader of the
+  // stored report to precompressed_reader_.
+  bool InflateReport(UploadReport* report);
+
   // Reads the metadata for a report from path and returns it in report.
   bool ReadMetadata(const base::FilePath& path, Report* report);
 
@@ -296,6 +384,11 @@ class CrashReportDatabaseGeneric : public CrashReportDatabase {
 
   base::FilePath base_dir_;
   Settings settings_;
+  CrashReportDatabaseIndex index_;
+  int precompression_level_;
+  int precompression_window_bits_;
+  bool precompression_enabled_;
+  bool compressed_storage_enabled_;
   InitializationStateDcheck initialized_;
 
   DISALLOW_COPY_AND_ASSIGN(CrashReportDatabaseGeneric);
@@ -357,7 +450,15 @@ void CrashReportDatabase::UploadReport::InitializeAttachments() {
   }
 }
 
-CrashReportDatabaseGeneric::CrashReportDatabaseGeneric() = default;
+CrashReportDatabaseGeneric::CrashReportDatabaseGeneric()
+    : base_dir_(),
+      settings_(),
+      index_(),
+      precompression_level_(0),
+      precompression_window_bits_(0),
+      precompression_enabled_(false),
+      compressed_storage_enabled_(false),
+      initialized_() {}
 
 CrashReportDatabaseGeneric::~CrashReportDatabaseGeneric() = default;
 
@@ -385,10 +486,22 @@ bool CrashReportDatabaseGeneric::Initialize(const base::FilePath& path,
     return false;
   }
 
+  if (!LoggingCreateDirectory(base_dir_.Append(kPrecompressedDirectory),
+                              FilePermissions::kOwnerOnly,
+                              true)) {
+    return false;
+  }
+
   if (!settings_.Initialize(base_dir_.Append(kSettings))) {
     return false;
   }
 
+  // Bring the index up to date with any changes made to the report files
+  // without it, such as by a process that crashed before updating it, and
+  // create it if it doesn’t exist yet. The database is usable without it.
+  index_.Initialize(base_dir_);
+  index_.Update(this);
+
   INITIALIZATION_STATE_SET_VALID(initialized_);
   return true;
 }
@@ -458,6 +571,11 @@ OperationStatus CrashReportDatabaseGeneric::FinishedWritingCrashReport(
     ignore_result(remover.release());
   }
 
+  Report indexed_report;
+  if (ReadMetadata(path, &indexed_report)) {
+    IndexReport(indexed_report, kPending);
+  }
+
   *uuid = report->ReportID();
 
   Metrics::CrashReportPending(Metrics::PendingReportReason::kNewlyCreated);
@@ -493,6 +611,28 @@ OperationStatus CrashReportDatabaseGeneric::GetReportForUploading(
     bool report_metrics) {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
 
+  std::unique_ptr<const UploadReport> upload_report;
+  OperationStatus os =
+      CheckOutReportForUploading(uuid, &upload_report, report_metrics);
+  if (os != kNoError) {
+    return os;
+  }
+
+  os = PrepareReportForUploading(upload_report.get());
+  if (os != kNoError) {
+    return os;
+  }
+
+  report->reset(upload_report.release());
+  return kNoError;
+}
+
+OperationStatus CrashReportDatabaseGeneric::CheckOutReportForUploading(
+    const UUID& uuid,
+    std::unique_ptr<const UploadReport>* report,
+    bool report_metrics) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
   auto upload_report = std::make_unique<LockfileUploadReport>();
 
   base::FilePath path;
@@ -511,6 +651,134 @@ OperationStatus CrashReportDatabaseGeneric::GetReportForUploading(
   return kNoError;
 }
 
+OperationStatus CrashReportDatabaseGeneric::PrepareReportForUploading(
+    const UploadReport* report_in) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  UploadReport* upload_report = const_cast<UploadReport*>(report_in);
+  const UUID& uuid = upload_report->uuid;
+  const base::FilePath& path = upload_report->file_path;
+
+  if (IsGzipPrecompressed(upload_report->Reader())) {
+    return InflateReport(upload_report) ? kNoError : kFileSystemError;
+  }
+
+  // When reports are stored compressed, one that CompressReport() hasn’t
+  // gotten to yet is compressed now. The uncompressed report, which is still
+  // open for reading, is read for the upload. If it couldn’t be compressed,
+  // the report stays uncompressed.
+  if (compressed_storage_enabled_) {
+    const uint64_t uncompressed_size = GetFileSize(path);
+    if (CompressReportInPlace(path, uuid)) {
+      upload_report->total_size -= RemovePrecompressedReport(uuid);
+      upload_report->total_size =
+          upload_report->total_size - uncompressed_size + GetFileSize(path);
+      auto precompressed_reader = std::make_unique<FileReader>();
+      if (!precompressed_reader->Open(path)) {
+        return kFileSystemError;
+      }
+      upload_report->precompressed_reader_ = std::move(precompressed_reader);
+    }
+    return kNoError;
+  }
+
+  // A copy for upload is written by the first attempt to upload the report,
+  // on the upload thread, rather than by FinishedWritingCrashReport(), which
+  // would delay the crashed process. It is kept for later attempts.
+  const base::FilePath precompressed_path(PrecompressedPath(uuid));
+  if (precompression_enabled_ && !IsRegularFile(precompressed_path) &&
+      WriteCompressedReport(path, precompressed_path)) {
+    upload_report->total_size += GetFileSize(precompressed_path);
+  }
+
+  if (IsRegularFile(precompressed_path)) {
+    auto precompressed_reader = std::make_unique<FileReader>();
+    if (precompressed_reader->Open(precompressed_path)) {
+      upload_report->precompressed_reader_ = std::move(precompressed_reader);
+    }
+  }
+
+  return kNoError;
+}
+
+OperationStatus CrashReportDatabaseGeneric::CompressReport(const UUID& uuid) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  if (!compressed_storage_enabled_) {
+    return kNoError;
+  }
+
+  // The report is compressed without holding its lock, so that it can still be
+  // uploaded or looked up in the meantime. A report’s contents never change,
+  // so the compressed form remains correct as long as the report is still
+  // stored uncompressed once it’s locked to be replaced.
+  base::FilePath path(ReportPath(uuid, kPending));
+  if (!IsRegularFile(path)) {
+    path = ReportPath(uuid, kCompleted);
+    if (!IsRegularFile(path)) {
+      return kReportNotFound;
+    }
+  }
+
+  {
+    FileReader reader;
+    if (!reader.Open(path)) {
+      // The report may have moved between states.
+      return kBusyError;
+    }
+    if (IsGzipPrecompressed(&reader)) {
+      return kNoError;
+    }
+  }
+
+  // A report that’s already locked, such as one still being finished, is left
+  // for later rather than compressed only to find that it can’t be replaced.
+  if (ScopedLockFile::IsLocked(path)) {
+    return kBusyError;
+  }
+
+  const base::FilePath compressed_path(
+      TemporaryPath(uuid, kPrecompressedExtension));
+  if (!WriteCompressedReport(path, compressed_path)) {
+    return kFileSystemError;
+  }
+  ScopedRemoveFile compressed_remover(compressed_path);
+
+  ScopedLockFile lock_file;
+  Report report;
+  OperationStatus os =
+      CheckoutReport(uuid, kSearchable, &path, &lock_file, &report);
+  if (os != kNoError) {
+    return os;
+  }
+
+  {
+    FileReader reader;
+    if (!reader.Open(path)) {
+      return kFileSystemError;
+    }
+    if (IsGzipPrecompressed(&reader)) {
+      return kNoError;
+    }
+  }
+
+  if (!MoveFileOrDirectory(compressed_path, path)) {
+    return kFileSystemError;
+  }
+  ignore_result(compressed_remover.release());
+
+  // A copy kept for upload is no longer needed.
+  RemovePrecompressedReport(uuid);
+
+  if (ReadMetadata(path, &report)) {
+    IndexReport(report,
+                path.DirName() == base_dir_.Append(kPendingDirectory)
+                    ? kPending
+                    : kCompleted);
+  }
+  return kNoError;
+}
+
 OperationStatus CrashReportDatabaseGeneric::SkipReportUpload(
     const UUID& uuid,
     Metrics::CrashSkippedReason reason) {
@@ -546,6 +814,8 @@ OperationStatus CrashReportDatabaseGeneric::SkipReportUpload(
     return kDatabaseError;
   }
 
+  report.total_size -= RemovePrecompressedReport(uuid);
+  IndexReport(report, kCompleted);
   return kNoError;
 }
 
@@ -569,6 +839,7 @@ OperationStatus CrashReportDatabaseGeneric::DeleteReport(const UUID& uuid) {
   }
 
   RemoveAttachmentsByUUID(uuid);
+  index_.Remove(uuid);
 
   return kNoError;
 }
@@ -605,6 +876,8 @@ OperationStatus CrashReportDatabaseGeneric::RequestUpload(const UUID& uuid) {
     }
   }
 
+  IndexReport(report, kPending);
+
   Metrics::CrashReportPending(Metrics::PendingReportReason::kUserInitiated);
   return kNoError;
 }
@@ -636,9 +909,48 @@ int CrashReportDatabaseGeneric::CleanDatabase(time_t lockfile_ttl) {
   removed += CleanReportsInState(kPending, lockfile_ttl);
   removed += CleanReportsInState(kCompleted, lockfile_ttl);
   CleanOrphanedAttachments();
+  CleanOrphanedPrecompressedReports();
+
+  // Drop the reports that were removed from the index, and pick up any other
+  // changes that it missed.
+  index_.Update(this);
   return removed;
 }
 
+std::unique_ptr<CrashReportDatabase::PendingReportWatcher>
+CrashReportDatabaseGeneric::WatchPendingReports() {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  auto watcher = std::make_unique<PendingReportWatcherLinux>();
+  if (!watcher->Initialize(base_dir_.Append(kPendingDirectory),
+                           kCrashReportExtension)) {
+    return nullptr;
+  }
+  return watcher;
+#else
+  return CrashReportDatabase::WatchPendingReports();
+#endif  // OS_LINUX || OS_ANDROID
+}
+
+bool CrashReportDatabaseGeneric::EnablePrecompression(int level,
+                                                      int window_bits) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  precompression_level_ = level;
+  precompression_window_bits_ = window_bits;
+  precompression_enabled_ = true;
+  return true;
+}
+
+bool CrashReportDatabaseGeneric::EnableCompressedStorage(int level,
+                                                         int window_bits) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  precompression_level_ = level;
+  precompression_window_bits_ = window_bits;
+  compressed_storage_enabled_ = true;
+  return true;
+}
+
 OperationStatus CrashReportDatabaseGeneric::RecordUploadAttempt(
     UploadReport* report,
     bool successful,
@@ -674,12 +986,20 @@ OperationStatus CrashReportDatabaseGeneric::RecordUploadAttempt(
 
     LoggingRemoveFile(ReplaceFinalExtension(report_path, kMetadataExtension));
     report_path = completed_report_path;
+
+    if (report->precompressed_reader_) {
+      report->precompressed_reader_->Close();
+      report->precompressed_reader_.reset();
+    }
+    report->total_size -= RemovePrecompressedReport(report->uuid);
   }
 
   if (!WriteMetadata(report_path, *report)) {
     return kDatabaseError;
   }
 
+  IndexReport(*report, successful ? kCompleted : kPending);
+
   if (!settings_.SetLastUploadAttemptTime(now)) {
     return kDatabaseError;
   }
@@ -687,6 +1007,69 @@ OperationStatus CrashReportDatabaseGeneric::RecordUploadAttempt(
   return kNoError;
 }
 
+bool CrashReportDatabaseGeneric::CrashReportDatabaseIndexUpdate(
+    bool valid,
+    std::vector<CrashReportDatabaseIndex::Entry>* entries) {
+  std::map<std::string, CrashReportDatabaseIndex::Entry> indexed;
+  for (const CrashReportDatabaseIndex::Entry& entry : *entries) {
+    indexed[entry.report.uuid.ToString()] = entry;
+  }
+
+  // Reports are listed from the directories, and only reports missing from the
+  // index, indexed in the wrong state, or whose files changed after they were
+  // indexed have their metadata read. A file may have changed without the
+  // index being updated if a process died in between.
+  bool changed = false;
+  std::vector<CrashReportDatabaseIndex::Entry> synchronized;
+  for (const ReportState state : {kPending, kCompleted}) {
+    const base::FilePath dir_path(base_dir_.Append(kReportDirectories[state]));
+    DirectoryReader reader;
+    if (!reader.Open(dir_path)) {
+      continue;
+    }
+
+    base::FilePath filename;
+    DirectoryReader::Result result;
+    while ((result = reader.NextFile(&filename)) ==
+           DirectoryReader::Result::kSuccess) {
+      if (filename.FinalExtension().compare(kCrashReportExtension) != 0) {
+        continue;
+      }
+
+      const base::FilePath path(dir_path.Append(filename));
+      auto iterator = indexed.find(UUIDFromReportPath(filename).ToString());
+      if (iterator != indexed.end() && iterator->second.state == state &&
+          !ReportModifiedAfter(path, iterator->second.update_time)) {
+        synchronized.push_back(iterator->second);
+        indexed.erase(iterator);
+        continue;
+      }
+
+      // Reports whose metadata can’t be read are left for CleanDatabase().
+      CrashReportDatabaseIndex::Entry entry;
+      if (!ReadMetadata(path, &entry.report)) {
+        continue;
+      }
+      entry.state = state;
+      synchronized.push_back(entry);
+      changed = true;
+    }
+  }
+
+  // Anything left in indexed is for a report that no longer exists.
+  changed |= !indexed.empty();
+  entries->swap(synchronized);
+  return changed;
+}
+
+void CrashReportDatabaseGeneric::IndexReport(const Report& report,
+                                             ReportState state) {
+  CrashReportDatabaseIndex::Entry entry;
+  entry.report = report;
+  entry.state = state;
+  index_.Put(entry);
+}
+
 base::FilePath CrashReportDatabaseGeneric::ReportPath(const UUID& uuid,
                                                       ReportState state) {
   DCHECK_NE(state, kUninitialized);
@@ -760,6 +1143,7 @@ OperationStatus CrashReportDatabaseGeneric::CheckoutReport(
   }
 
   if (!CleaningReadMetadata(local_path, report)) {
+    index_.Remove(uuid);
     return kDatabaseError;
   }
 
@@ -776,33 +1160,24 @@ OperationStatus CrashReportDatabaseGeneric::ReportsInState(
   DCHECK_NE(state, kSearchable);
   DCHECK_NE(state, kNew);
 
-  const base::FilePath dir_path(base_dir_.Append(kReportDirectories[state]));
-  DirectoryReader reader;
-  if (!reader.Open(dir_path)) {
+  std::vector<CrashReportDatabaseIndex::Entry> entries;
+  if (!index_.Read(&entries) &&
+      !(index_.Update(this) && index_.Read(&entries))) {
     return kDatabaseError;
   }
 
-  base::FilePath filename;
-  DirectoryReader::Result result;
-  while ((result = reader.NextFile(&filename)) ==
-         DirectoryReader::Result::kSuccess) {
-    const base::FilePath::StringType extension(filename.FinalExtension());
-    if (extension.compare(kCrashReportExtension) != 0) {
-      continue;
-    }
-
-    const base::FilePath filepath(dir_path.Append(filename));
-    ScopedLockFile lock_file;
-    if (!lock_file.ResetAcquire(filepath)) {
+  for (const CrashReportDatabaseIndex::Entry& entry : entries) {
+    if (entry.state != state) {
       continue;
     }
 
-    Report report;
-    if (!CleaningReadMetadata(filepath, &report)) {
+    // Reports that are locked, such as those being uploaded, aren’t listed.
+    const base::FilePath path(ReportPath(entry.report.uuid, state));
+    if (ScopedLockFile::IsLocked(path)) {
       continue;
     }
-    reports->push_back(report);
-    reports->back().file_path = filepath;
+    reports->push_back(entry.report);
+    reports->back().file_path = path;
   }
   return kNoError;
 }
@@ -913,7 +1288,49 @@ void CrashReportDatabaseGeneric::CleanOrphanedAttachments() {
   }
 }
 
+void CrashReportDatabaseGeneric::CleanOrphanedPrecompressedReports() {
+  const base::FilePath precompressed_dir(
+      base_dir_.Append(kPrecompressedDirectory));
+  DirectoryReader reader;
+  if (!reader.Open(precompressed_dir)) {
+    return;
+  }
+
+  base::FilePath filename;
+  DirectoryReader::Result result;
+  while ((result = reader.NextFile(&filename)) ==
+         DirectoryReader::Result::kSuccess) {
+    const base::FilePath filepath(precompressed_dir.Append(filename));
+    UUID uuid;
+    if (filename.FinalExtension().compare(kPrecompressedExtension) != 0 ||
+        !uuid.InitializeFromString(filename.RemoveFinalExtension().value())) {
+      LOG(ERROR) << "unexpected precompressed file " << filepath.value();
+      continue;
+    }
+
+    // Check to see if the report is being created in "new".
+    if (IsRegularFile(base_dir_.Append(kNewDirectory)
+                          .Append(uuid.ToString() + kCrashReportExtension))) {
+      continue;
+    }
+
+    // Only pending reports keep their copies. A report that is locked may be
+    // in use, so it’s left alone.
+    ScopedLockFile local_lock;
+    base::FilePath local_path;
+    OperationStatus os =
+        LocateAndLockReport(uuid, kPending, &local_path, &local_lock);
+    if (os != kReportNotFound) {
+      continue;
+    }
+
+    LoggingRemoveFile(filepath);
+  }
+}
+
 void CrashReportDatabaseGeneric::RemoveAttachmentsByUUID(const UUID& uuid) {
+  RemovePrecompressedReport(uuid);
+
   base::FilePath attachments_dir = AttachmentsPath(uuid);
   if (!IsDirectory(attachments_dir, /*allow_symlinks=*/false)) {
     return;
@@ -934,6 +1351,102 @@ void CrashReportDatabaseGeneric::RemoveAttachmentsByUUID(const UUID& uuid) {
   LoggingRemoveDirectory(attachments_dir);
 }
 
+base::FilePath CrashReportDatabaseGeneric::PrecompressedPath(const UUID& uuid) {
+  return base_dir_.Append(kPrecompressedDirectory)
+      .Append(uuid.ToString() + kPrecompressedExtension);
+}
+
+base::FilePath CrashReportDatabaseGeneric::TemporaryPath(
+    const UUID& uuid,
+    const base::FilePath::StringType& extension) {
+  return base_dir_.Append(kNewDirectory).Append(uuid.ToString() + extension);
+}
+
+bool CrashReportDatabaseGeneric::WriteCompressedReport(
+    const base::FilePath& path,
+    const base::FilePath& compressed_path) {
+  FileReader reader;
+  if (!reader.Open(path)) {
+    return false;
+  }
+
+  FileWriter writer;
+  if (!writer.Open(compressed_path,
+                   FileWriteMode::kTruncateOrCreate,
+                   FilePermissions::kOwnerOnly)) {
+    return false;
+  }
+
+  if (!GzipPrecompress(&reader,
+                       &writer,
+                       precompression_level_,
+                       precompression_window_bits_)) {
+    LOG(ERROR) << "couldn't compress " << path.value();
+    writer.Close();
+    LoggingRemoveFile(compressed_path);
+    return false;
+  }
+  return true;
+}
+
+bool CrashReportDatabaseGeneric::CompressReportInPlace(
+    const base::FilePath& path,
+    const UUID& uuid) {
+  // The compressed form is written in "new" and moved into place once it’s
+  // complete, so that a partial report is never stored. One left behind in
+  // "new" is removed by CleanDatabase().
+  const base::FilePath compressed_path(
+      TemporaryPath(uuid, kPrecompressedExtension));
+  if (!WriteCompressedReport(path, compressed_path)) {
+    return false;
+  }
+  if (!MoveFileOrDirectory(compressed_path, path)) {
+    LoggingRemoveFile(compressed_path);
+    return false;
+  }
+  return true;
+}
+
+uint64_t CrashReportDatabaseGeneric::RemovePrecompressedReport(
+    const UUID& uuid) {
+  const base::FilePath path(PrecompressedPath(uuid));
+  if (!IsRegularFile(path)) {
+    return 0;
+  }
+  const uint64_t size = GetFileSize(path);
+  return LoggingRemoveFile(path) ? size : 0;
+}
+
+bool CrashReportDatabaseGeneric::InflateReport(UploadReport* report) {
+  // The decompressed copy is a temporary file in "new", removed as soon as
+  // it’s open, so that it takes no space once the report is released and
+  // doesn’t count towards the size of the database. One left behind in "new"
+  // is removed by CleanDatabase().
+  const base::FilePath inflated_path(
+      TemporaryPath(report->uuid, kInflatedExtension));
+  ScopedRemoveFile inflated_remover(inflated_path);
+  {
+    FileWriter writer;
+    if (!writer.Open(inflated_path,
+                     FileWriteMode::kTruncateOrCreate,
+                     FilePermissions::kOwnerOnly)) {
+      return false;
+    }
+    if (!GzipPrecompressedInflate(report->reader_.get(), &writer)) {
+      LOG(ERROR) << "couldn't decompress " << report->file_path.value();
+      return false;
+    }
+  }
+
+  auto reader = std::make_unique<FileReader>();
+  if (!reader->Open(inflated_path) || !report->reader_->SeekSet(0)) {
+    return false;
+  }
+  report->precompressed_reader_ = std::move(report->reader_);
+  report->reader_ = std::move(reader);
+  return true;
+}
+
 bool CrashReportDatabaseGeneric::ReadMetadata(const base::FilePath& path,
                                               Report* report) {
   const base::FilePath metadata_path(
@@ -969,6 +1482,10 @@ bool CrashReportDatabaseGeneric::ReadMetadata(const base::FilePath& path,
   // potential attachments.
   uint64_t total_size = GetFileSize(path);
   AddAttachmentSize(AttachmentsPath(uuid), &total_size);
+  const base::FilePath precompressed_path(PrecompressedPath(uuid));
+  if (IsRegularFile(precompressed_path)) {
+    total_size += GetFileSize(precompressed_path);
+  }
 
   report->uuid = uuid;
   report->upload_attempts = metadata.upload_attempts;
@@ -0,0 +1,587 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "client/crash_report_database_index.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <map>
+
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "build/build_config.h"
+#include "util/file/filesystem.h"
+
+namespace crashpad {
+
+namespace {
+
+constexpr base::FilePath::CharType kLogFile[] = FILE_PATH_LITERAL("index.log");
+constexpr base::FilePath::CharType kSnapshotFile[] =
+    FILE_PATH_LITERAL("index.snapshot");
+constexpr base::FilePath::CharType kNewSnapshotExtension[] =
+    FILE_PATH_LITERAL(".new");
+
+// The log is compacted into the snapshot once it is larger than this, or
+// larger than the snapshot, whichever is more. Compacting only once the log has
+// grown in proportion to the snapshot keeps the cost of compaction, which
+// rewrites the snapshot, proportional to the number of changes appended.
+constexpr FileOffset kMinLogSizeToCompact = 16 * 1024;
+
+struct FileHeader {
+  static constexpr uint32_t kLogMagic = 'CPil';
+  static constexpr uint32_t kSnapshotMagic = 'CPis';
+  static constexpr uint32_t kVersion = 2;
+
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct RecordHeader {
+  // The size of the RecordData and the report ID that follow.
+  uint32_t size;
+
+  // The Checksum() of the RecordData and the report ID that follow.
+  uint32_t checksum;
+};
+
+// Follows the RecordData and the report ID, so that the last record in the log
+// can be found from the end of the file.
+struct RecordTrailer {
+  // The same as RecordHeader::size.
+  uint32_t size;
+};
+
+struct RecordData {
+  enum Type : uint8_t {
+    kPut = 1,
+    kRemove,
+  };
+
+  enum Attributes : uint8_t {
+    kUploaded = 1 << 0,
+    kUploadExplicitlyRequested = 1 << 1,
+  };
+
+  uint8_t type;
+  uint8_t attributes;
+  uint16_t padding_0;
+  int32_t state;
+  UUID uuid;
+  int32_t upload_attempts;
+  uint32_t padding_1;
+  int64_t creation_time;  // time_t
+  int64_t last_upload_attempt_time;  // time_t
+  uint64_t total_size;
+  int64_t update_time;  // nanoseconds since the epoch
+
+  // Followed by the report ID, which is not NUL-terminated.
+};
+
+static_assert(sizeof(RecordData) == 64, "RecordData must not have padding");
+
+struct UUIDLess {
+  bool operator()(const UUID& a, const UUID& b) const {
+    return memcmp(&a, &b, sizeof(a)) < 0;
+  }
+};
+
+using EntryMap = std::map<UUID, CrashReportDatabaseIndex::Entry, UUIDLess>;
+
+// Returns the current time in nanoseconds since the epoch, for
+// Entry::update_time. File modification times come from a coarser clock that
+// never runs ahead of this one, so a file written before an entry is never
+// newer than the entry.
+int64_t CurrentTime() {
+  timespec now;
+  if (clock_gettime(CLOCK_REALTIME, &now) != 0) {
+    PLOG(ERROR) << "clock_gettime";
+    return 0;
+  }
+  return int64_t{now.tv_sec} * 1000000000 + now.tv_nsec;
+}
+
+// A 32-bit FNV-1a hash, to detect records that weren’t completely written.
+uint32_t Checksum(const char* data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t index = 0; index < size; ++index) {
+    hash = (hash ^ static_cast<uint8_t>(data[index])) * 16777619u;
+  }
+  return hash;
+}
+
+std::string FileHeaderData(uint32_t magic) {
+  FileHeader header;
+  header.magic = magic;
+  header.version = FileHeader::kVersion;
+  return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void AppendRecord(const CrashReportDatabaseIndex::Entry& entry,
+                  bool remove,
+                  std::string* records) {
+  RecordData data = {};
+  data.type = remove ? RecordData::kRemove : RecordData::kPut;
+  data.uuid = entry.report.uuid;
+  if (!remove) {
+    data.attributes =
+        (entry.report.uploaded ? RecordData::kUploaded : 0) |
+        (entry.report.upload_explicitly_requested
+             ? RecordData::kUploadExplicitlyRequested
+             : 0);
+    data.state = entry.state;
+    data.upload_attempts = entry.report.upload_attempts;
+    data.creation_time = entry.report.creation_time;
+    data.last_upload_attempt_time = entry.report.last_upload_attempt_time;
+    data.total_size = entry.report.total_size;
+    data.update_time = entry.update_time;
+  }
+  const std::string id = remove ? std::string() : entry.report.id;
+
+  std::string payload(reinterpret_cast<const char*>(&data), sizeof(data));
+  payload.append(id);
+
+  RecordHeader header;
+  header.size = static_cast<uint32_t>(payload.size());
+  header.checksum = Checksum(payload.data(), payload.size());
+  records->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  records->append(payload);
+
+  RecordTrailer trailer;
+  trailer.size = header.size;
+  records->append(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+}
+
+// Returns whether the record at the start of data, which is size bytes long,
+// is complete.
+bool IsCompleteRecord(const char* data, size_t size) {
+  RecordHeader header;
+  RecordTrailer trailer;
+  if (size < sizeof(header) + sizeof(RecordData) + sizeof(trailer)) {
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+  return header.size == size - sizeof(header) - sizeof(trailer) &&
+         trailer.size == header.size &&
+         Checksum(data + sizeof(header), header.size) == header.checksum;
+}
+
+enum class ParseResult {
+  // Every record was valid.
+  kSuccess,
+
+  // Every record was valid except for the last, which was incomplete.
+  kTorn,
+
+  // The file is not an index file, or a record other than the last is
+  // invalid.
+  kCorrupt,
+};
+
+// Parses the records in contents, which must start with a FileHeader with
+// magic, applying them to entries. Sets record_count to the number of valid
+// records, and valid_size to the size of the FileHeader and the valid records.
+ParseResult ParseRecords(const std::string& contents,
+                         uint32_t magic,
+                         EntryMap* entries,
+                         size_t* record_count,
+                         size_t* valid_size) {
+  *record_count = 0;
+  *valid_size = 0;
+
+  FileHeader header;
+  if (contents.size() < sizeof(header)) {
+    return ParseResult::kCorrupt;
+  }
+  memcpy(&header, contents.data(), sizeof(header));
+  if (header.magic != magic || header.version != FileHeader::kVersion) {
+    return ParseResult::kCorrupt;
+  }
+
+  size_t offset = sizeof(header);
+  *valid_size = offset;
+  while (offset < contents.size()) {
+    RecordHeader record_header;
+    if (contents.size() - offset < sizeof(record_header)) {
+      return ParseResult::kTorn;
+    }
+    memcpy(&record_header, &contents[offset], sizeof(record_header));
+
+    // Appending removes an incomplete record from the end of the log first,
+    // so only the last record can be incomplete.
+    const size_t record_size =
+        sizeof(record_header) + size_t{record_header.size} +
+        sizeof(RecordTrailer);
+    if (record_size > contents.size() - offset) {
+      return ParseResult::kTorn;
+    }
+    if (!IsCompleteRecord(&contents[offset], record_size)) {
+      return offset + record_size == contents.size() ? ParseResult::kTorn
+                                                     : ParseResult::kCorrupt;
+    }
+    const char* payload = &contents[offset + sizeof(record_header)];
+    offset += record_size;
+
+    RecordData data;
+    memcpy(&data, payload, sizeof(data));
+    switch (data.type) {
+      case RecordData::kPut: {
+        CrashReportDatabaseIndex::Entry& entry = (*entries)[data.uuid];
+        entry.report.uuid = data.uuid;
+        entry.report.id.assign(payload + sizeof(data),
+                               record_header.size - sizeof(data));
+        entry.report.creation_time = data.creation_time;
+        entry.report.uploaded = (data.attributes & RecordData::kUploaded) != 0;
+        entry.report.last_upload_attempt_time = data.last_upload_attempt_time;
+        entry.report.upload_attempts = data.upload_attempts;
+        entry.report.upload_explicitly_requested =
+            (data.attributes & RecordData::kUploadExplicitlyRequested) != 0;
+        entry.report.total_size = data.total_size;
+        entry.state = data.state;
+        entry.update_time = data.update_time;
+        break;
+      }
+
+      case RecordData::kRemove:
+        entries->erase(data.uuid);
+        break;
+
+      default:
+        return ParseResult::kCorrupt;
+    }
+    ++*record_count;
+    *valid_size = offset;
+  }
+
+  return ParseResult::kSuccess;
+}
+
+// Flushes the file to disk.
+bool LoggingSyncFile(FileHandle file, const base::FilePath& path) {
+  if (HANDLE_EINTR(fsync(file)) != 0) {
+    PLOG(ERROR) << "fsync " << path.value();
+    return false;
+  }
+  return true;
+}
+
+// Flushes the directory at path, including the names of the files in it, to
+// disk.
+bool LoggingSyncDirectory(const base::FilePath& path) {
+  ScopedFileHandle directory(HANDLE_EINTR(
+      open(path.value().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+  if (!directory.is_valid()) {
+    PLOG(ERROR) << "open " << path.value();
+    return false;
+  }
+  return LoggingSyncFile(directory.get(), path);
+}
+
+}  // namespace
+
+CrashReportDatabaseIndex::Entry::Entry()
+    : report(), state(0), update_time(0) {}
+
+CrashReportDatabaseIndex::CrashReportDatabaseIndex()
+    : log_path_(), snapshot_path_(), initialized_() {}
+
+CrashReportDatabaseIndex::~CrashReportDatabaseIndex() {}
+
+void CrashReportDatabaseIndex::Initialize(const base::FilePath& directory) {
+  INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
+  log_path_ = directory.Append(kLogFile);
+  snapshot_path_ = directory.Append(kSnapshotFile);
+  INITIALIZATION_STATE_SET_VALID(initialized_);
+}
+
+bool CrashReportDatabaseIndex::Read(std::vector<Entry>* entries) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  ScopedFileHandle log(OpenLog(FileLocking::kShared));
+  if (!log.is_valid()) {
+    return false;
+  }
+
+  size_t log_records;
+  bool log_torn;
+  return ReadLocked(log.get(), entries, &log_records, &log_torn);
+}
+
+bool CrashReportDatabaseIndex::Put(const Entry& entry) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  return Append(entry, false);
+}
+
+bool CrashReportDatabaseIndex::Remove(const UUID& uuid) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  Entry entry;
+  entry.report.uuid = uuid;
+  return Append(entry, true);
+}
+
+bool CrashReportDatabaseIndex::Update(Delegate* delegate) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  ScopedFileHandle log(OpenLog(FileLocking::kExclusive));
+  if (!log.is_valid()) {
+    return false;
+  }
+
+  std::vector<Entry> entries;
+  size_t log_records;
+  bool log_torn;
+  const bool valid = ReadLocked(log.get(), &entries, &log_records, &log_torn);
+  if (!valid) {
+    entries.clear();
+  }
+
+  const bool changed =
+      delegate->CrashReportDatabaseIndexUpdate(valid, &entries);
+  if (valid && !changed && !log_torn) {
+    return true;
+  }
+
+  return Compact(log.get(), entries);
+}
+
+ScopedFileHandle CrashReportDatabaseIndex::OpenLog(FileLocking locking) {
+  ScopedFileHandle log(LoggingOpenFileForReadAndWrite(
+      log_path_, FileWriteMode::kReuseOrCreate, FilePermissions::kOwnerOnly));
+#if !defined(OS_FUCHSIA)
+  // Fuchsia doesn’t support file locking. As with Settings, the database is
+  // only expected to be used by one process at a time there.
+  if (log.is_valid() && !LoggingLockFile(log.get(), locking)) {
+    log.reset();
+  }
+#endif  // !OS_FUCHSIA
+  return log;
+}
+
+bool CrashReportDatabaseIndex::ReadLocked(FileHandle log,
+                                          std::vector<Entry>* entries,
+                                          size_t* log_records,
+                                          bool* log_torn) {
+  entries->clear();
+  *log_records = 0;
+  *log_torn = false;
+
+  // A missing snapshot means that the index was never written.
+  if (!IsRegularFile(snapshot_path_)) {
+    return false;
+  }
+
+  EntryMap entry_map;
+  std::string contents;
+  size_t snapshot_records;
+  size_t valid_size;
+  if (!LoggingReadEntireFile(snapshot_path_, &contents)) {
+    return false;
+  }
+  if (ParseRecords(contents,
+                   FileHeader::kSnapshotMagic,
+                   &entry_map,
+                   &snapshot_records,
+                   &valid_size) != ParseResult::kSuccess) {
+    LOG(ERROR) << "corrupt index snapshot " << snapshot_path_.value();
+    return false;
+  }
+
+  if (LoggingSeekFile(log, 0, SEEK_SET) != 0 ||
+      !LoggingReadToEOF(log, &contents)) {
+    return false;
+  }
+
+  // Compact() leaves a header in the log, so an empty log, including one that
+  // was just created, was lost after the snapshot was written. It’s treated as
+  // corrupt, because changes may have been lost with it.
+  const ParseResult result = ParseRecords(contents,
+                                          FileHeader::kLogMagic,
+                                          &entry_map,
+                                          log_records,
+                                          &valid_size);
+  if (result == ParseResult::kCorrupt) {
+    LOG(ERROR) << "corrupt index log " << log_path_.value();
+    return false;
+  }
+  *log_torn = result == ParseResult::kTorn;
+
+  entries->reserve(entry_map.size());
+  for (const auto& uuid_and_entry : entry_map) {
+    entries->push_back(uuid_and_entry.second);
+  }
+  return true;
+}
+
+bool CrashReportDatabaseIndex::Append(const Entry& entry, bool remove) {
+  ScopedFileHandle log(OpenLog(FileLocking::kExclusive));
+  if (!log.is_valid()) {
+    return false;
+  }
+
+  FileOffset log_size = LoggingSeekFile(log.get(), 0, SEEK_END);
+  if (log_size < 0) {
+    return false;
+  }
+
+  // Compact() leaves a header in the log, so a shorter log means that the
+  // index is missing or corrupt. The owner will rebuild it when it notices
+  // that it can’t be read, which will include this change.
+  if (log_size < static_cast<FileOffset>(sizeof(FileHeader))) {
+    return true;
+  }
+
+  // A process that died while appending may have left an incomplete record at
+  // the end of the log. It’s removed, so that this record isn’t read as part
+  // of it.
+  if (!LogEndsWithCompleteRecord(log.get(), log_size)) {
+    std::string contents;
+    EntryMap entry_map;
+    size_t log_records;
+    size_t valid_size;
+    if (LoggingSeekFile(log.get(), 0, SEEK_SET) != 0 ||
+        !LoggingReadToEOF(log.get(), &contents)) {
+      return false;
+    }
+    if (ParseRecords(contents,
+                     FileHeader::kLogMagic,
+                     &entry_map,
+                     &log_records,
+                     &valid_size) == ParseResult::kCorrupt) {
+      // As above, the owner will rebuild the index.
+      return true;
+    }
+    if (HANDLE_EINTR(ftruncate(log.get(), valid_size)) != 0) {
+      PLOG(ERROR) << "ftruncate " << log_path_.value();
+      return false;
+    }
+    log_size = LoggingSeekFile(log.get(), 0, SEEK_END);
+    if (log_size < 0) {
+      return false;
+    }
+  }
+
+  Entry stamped_entry(entry);
+  stamped_entry.update_time = CurrentTime();
+  std::string record;
+  AppendRecord(stamped_entry, remove, &record);
+  if (!LoggingWriteFile(log.get(), record.data(), record.size())) {
+    // Remove any part of the record that was written, so that later records
+    // don’t follow an incomplete one.
+    if (HANDLE_EINTR(ftruncate(log.get(), log_size)) != 0) {
+      PLOG(ERROR) << "ftruncate " << log_path_.value();
+    }
+    return false;
+  }
+
+  const FileOffset new_log_size =
+      log_size + static_cast<FileOffset>(record.size());
+  if (new_log_size < kMinLogSizeToCompact) {
+    return true;
+  }
+
+  ScopedFileHandle snapshot(LoggingOpenFileForRead(snapshot_path_));
+  if (!snapshot.is_valid()) {
+    return true;
+  }
+  const FileOffset snapshot_size = LoggingFileSizeByHandle(snapshot.get());
+  if (snapshot_size < 0 || new_log_size < snapshot_size) {
+    return true;
+  }
+
+  std::vector<Entry> entries;
+  size_t log_records;
+  bool log_torn;
+  if (!ReadLocked(log.get(), &entries, &log_records, &log_torn)) {
+    return true;
+  }
+  return Compact(log.get(), entries);
+}
+
+bool CrashReportDatabaseIndex::LogEndsWithCompleteRecord(FileHandle log,
+                                                          FileOffset log_size) {
+  if (log_size == static_cast<FileOffset>(sizeof(FileHeader))) {
+    return true;
+  }
+
+  RecordTrailer trailer;
+  const FileOffset min_size =
+      static_cast<FileOffset>(sizeof(FileHeader) + sizeof(trailer));
+  if (log_size < min_size ||
+      LoggingSeekFile(log, log_size - sizeof(trailer), SEEK_SET) < 0 ||
+      !LoggingReadFileExactly(log, &trailer, sizeof(trailer))) {
+    return false;
+  }
+
+  const FileOffset record_size = static_cast<FileOffset>(
+      sizeof(RecordHeader) + size_t{trailer.size} + sizeof(trailer));
+  if (record_size > log_size - static_cast<FileOffset>(sizeof(FileHeader))) {
+    return false;
+  }
+  std::string record(static_cast<size_t>(record_size), '\0');
+  return LoggingSeekFile(log, log_size - record_size, SEEK_SET) >= 0 &&
+         LoggingReadFileExactly(log, &record[0], record.size()) &&
+         IsCompleteRecord(record.data(), record.size());
+}
+
+bool CrashReportDatabaseIndex::Compact(FileHandle log,
+                                       const std::vector<Entry>& entries) {
+  const int64_t now = CurrentTime();
+  std::string snapshot = FileHeaderData(FileHeader::kSnapshotMagic);
+  for (const Entry& entry : entries) {
+    if (entry.update_time == 0) {
+      Entry stamped_entry(entry);
+      stamped_entry.update_time = now;
+      AppendRecord(stamped_entry, false, &snapshot);
+    } else {
+      AppendRecord(entry, false, &snapshot);
+    }
+  }
+
+  // The new snapshot replaces the old one atomically. Until the log is
+  // emptied, it is replayed over the new snapshot, which is harmless. The
+  // snapshot and its name are flushed to disk before the log is emptied, so
+  // that a system crash can’t lose the changes in the log.
+  const base::FilePath new_snapshot_path(snapshot_path_.value() +
+                                         kNewSnapshotExtension);
+  {
+    ScopedFileHandle new_snapshot(
+        LoggingOpenFileForWrite(new_snapshot_path,
+                                FileWriteMode::kTruncateOrCreate,
+                                FilePermissions::kOwnerOnly));
+    if (!new_snapshot.is_valid() ||
+        !LoggingWriteFile(
+            new_snapshot.get(), snapshot.data(), snapshot.size()) ||
+        !LoggingSyncFile(new_snapshot.get(), new_snapshot_path)) {
+      return false;
+    }
+  }
+  if (!MoveFileOrDirectory(new_snapshot_path, snapshot_path_) ||
+      !LoggingSyncDirectory(snapshot_path_.DirName())) {
+    return false;
+  }
+
+  // The emptied log is flushed too, because a log without a header is treated
+  // as corrupt.
+  const std::string log_header = FileHeaderData(FileHeader::kLogMagic);
+  return LoggingTruncateFile(log) && LoggingSeekFile(log, 0, SEEK_SET) == 0 &&
+         LoggingWriteFile(log, log_header.data(), log_header.size()) &&
+         LoggingSyncFile(log, log_path_);
+}
+
+}  // namespace crashpad
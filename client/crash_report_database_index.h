@@ -0,0 +1,169 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_CLIENT_CRASH_REPORT_DATABASE_INDEX_H_
+#define CRASHPAD_CLIENT_CRASH_REPORT_DATABASE_INDEX_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "client/crash_report_database.h"
+#include "util/file/file_io.h"
+#include "util/misc/initialization_state_dcheck.h"
+#include "util/misc/uuid.h"
+
+namespace crashpad {
+
+//! \brief A cache of the state and metadata of the reports in a
+//!     CrashReportDatabase that stores each report as files in a directory per
+//!     state.
+//!
+//! The index lets reports be listed by reading two files, instead of reading
+//! the metadata and determining the size of every report. It consists of an
+//! append-only log of changes and a snapshot that the log is compacted into
+//! once the log grows larger than the snapshot. Each change is a complete
+//! record of a report, so replaying the log over a snapshot that already
+//! includes some of it is harmless. Changes are appended after reading only
+//! the last record in the log, so that their cost doesn’t depend on the number
+//! of reports.
+//!
+//! Appended changes are not flushed to disk, and a process may die between
+//! changing a report’s files and recording the change. The index may then be
+//! stale, or the log may end with an incomplete record. An incomplete record is
+//! ignored by Read(), and removed before another is appended. Compaction
+//! flushes the new snapshot to disk before emptying the log, so it never loses
+//! changes that were in the log.
+//!
+//! The report files remain authoritative. Each entry records when it was
+//! written, so the owner can tell which reports’ files changed after their
+//! entries and should call Update() when it starts to bring those entries up to
+//! date. If the index is missing or corrupt, Read() fails and the owner is
+//! expected to rebuild it with Update().
+//!
+//! Access is synchronized between processes and threads by locking the log
+//! file, which is opened anew for each operation.
+class CrashReportDatabaseIndex {
+ public:
+  //! \brief A report as recorded in the index.
+  struct Entry {
+    Entry();
+
+    //! \brief The report. Its `file_path` is not recorded.
+    CrashReportDatabase::Report report;
+
+    //! \brief The state of the report, as defined by the owner of the index.
+    int32_t state;
+
+    //! \brief When the entry was last written to the index, in nanoseconds
+    //!     since the epoch.
+    //!
+    //! This is set by Put(), and by Update() for entries where it is `0`. Files
+    //! written before the entry are never newer than this.
+    int64_t update_time;
+  };
+
+  //! \brief An interface to rewrite the index, used by Update().
+  class Delegate {
+   public:
+    virtual ~Delegate() {}
+
+    //! \brief Called by Update() with the index locked for writing.
+    //!
+    //! \param[in] valid `true` if \a entries were read from the index, or
+    //!     `false` if the index was missing or corrupt, in which case \a
+    //!     entries is empty and the index will be written regardless of the
+    //!     return value.
+    //! \param[in,out] entries The entries in the index, which may be modified.
+    //!
+    //! \return `true` if \a entries was modified and should be written.
+    virtual bool CrashReportDatabaseIndexUpdate(
+        bool valid,
+        std::vector<Entry>* entries) = 0;
+  };
+
+  CrashReportDatabaseIndex();
+  ~CrashReportDatabaseIndex();
+
+  //! \brief Initializes this object to use the index files in \a directory.
+  //!
+  //! No files are accessed until another method is called.
+  //!
+  //! \param[in] directory The directory to store the index in.
+  void Initialize(const base::FilePath& directory);
+
+  //! \brief Reads all of the entries in the index.
+  //!
+  //! \param[out] entries The entries, in an unspecified order.
+  //!
+  //! \return `true` on success. `false` if the index is missing or corrupt,
+  //!     with a message logged if it was corrupt.
+  bool Read(std::vector<Entry>* entries);
+
+  //! \brief Adds or replaces the entry for `entry.report.uuid`.
+  //!
+  //! \return `true` on success, or `false` with a message logged.
+  bool Put(const Entry& entry);
+
+  //! \brief Removes the entry for \a uuid, if there is one.
+  //!
+  //! \return `true` on success, or `false` with a message logged.
+  bool Remove(const UUID& uuid);
+
+  //! \brief Reads the index and lets \a delegate modify its entries, with no
+  //!     other changes possible in the meantime.
+  //!
+  //! If the entries are modified, or the index couldn’t be read, the index is
+  //! replaced by a compacted one holding the resulting entries.
+  //!
+  //! \return `true` on success, or `false` with a message logged.
+  bool Update(Delegate* delegate);
+
+ private:
+  // Opens and locks the log file.
+  ScopedFileHandle OpenLog(FileLocking locking);
+
+  // Reads the snapshot and the log, which must be locked, into entries. Sets
+  // log_records to the number of records in the log and log_torn to whether
+  // the log ends with an incomplete record.
+  bool ReadLocked(FileHandle log,
+                  std::vector<Entry>* entries,
+                  size_t* log_records,
+                  bool* log_torn);
+
+  // Appends the record for entry, removing it if remove is true, to the log,
+  // compacting the log if it has grown larger than the snapshot.
+  bool Append(const Entry& entry, bool remove);
+
+  // Returns whether the log, which must be locked and is log_size bytes long,
+  // is empty or ends with a complete record, reading only that record.
+  bool LogEndsWithCompleteRecord(FileHandle log, FileOffset log_size);
+
+  // Writes entries as the new snapshot and empties the log, which must be
+  // locked for writing.
+  bool Compact(FileHandle log, const std::vector<Entry>& entries);
+
+  base::FilePath log_path_;
+  base::FilePath snapshot_path_;
+  InitializationStateDcheck initialized_;
+
+  DISALLOW_COPY_AND_ASSIGN(CrashReportDatabaseIndex);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_CLIENT_CRASH_REPORT_DATABASE_INDEX_H_
@@ -0,0 +1,357 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "client/crash_report_database_index.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "test/scoped_temp_dir.h"
+#include "util/file/file_io.h"
+#include "util/file/filesystem.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+CrashReportDatabaseIndex::Entry MakeEntry(int32_t state,
+                                          const std::string& id) {
+  CrashReportDatabaseIndex::Entry entry;
+  EXPECT_TRUE(entry.report.uuid.InitializeWithNew());
+  entry.report.id = id;
+  entry.report.creation_time = 1234;
+  entry.report.uploaded = !id.empty();
+  entry.report.last_upload_attempt_time = 5678;
+  entry.report.upload_attempts = 3;
+  entry.report.upload_explicitly_requested = true;
+  entry.report.total_size = 0x123456789;
+  entry.state = state;
+  return entry;
+}
+
+void ExpectEntriesEqual(std::vector<CrashReportDatabaseIndex::Entry> actual,
+                        std::vector<CrashReportDatabaseIndex::Entry> expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  auto uuid_less = [](const CrashReportDatabaseIndex::Entry& a,
+                      const CrashReportDatabaseIndex::Entry& b) {
+    return a.report.uuid.ToString() < b.report.uuid.ToString();
+  };
+  std::sort(actual.begin(), actual.end(), uuid_less);
+  std::sort(expected.begin(), expected.end(), uuid_less);
+  for (size_t index = 0; index < actual.size(); ++index) {
+    const CrashReportDatabase::Report& a = actual[index].report;
+    const CrashReportDatabase::Report& e = expected[index].report;
+    EXPECT_EQ(a.uuid, e.uuid);
+    EXPECT_EQ(a.id, e.id);
+    EXPECT_EQ(a.creation_time, e.creation_time);
+    EXPECT_EQ(a.uploaded, e.uploaded);
+    EXPECT_EQ(a.last_upload_attempt_time, e.last_upload_attempt_time);
+    EXPECT_EQ(a.upload_attempts, e.upload_attempts);
+    EXPECT_EQ(a.upload_explicitly_requested, e.upload_explicitly_requested);
+    EXPECT_EQ(a.total_size, e.total_size);
+    EXPECT_EQ(actual[index].state, expected[index].state);
+  }
+}
+
+// Replaces the entries in the index with its own.
+class ReplacingDelegate : public CrashReportDatabaseIndex::Delegate {
+ public:
+  explicit ReplacingDelegate(
+      const std::vector<CrashReportDatabaseIndex::Entry>& entries)
+      : entries_(entries), calls_(0), last_valid_(false) {}
+
+  ~ReplacingDelegate() override {}
+
+  size_t calls() const { return calls_; }
+  bool last_valid() const { return last_valid_; }
+
+  // CrashReportDatabaseIndex::Delegate:
+  bool CrashReportDatabaseIndexUpdate(
+      bool valid,
+      std::vector<CrashReportDatabaseIndex::Entry>* entries) override {
+    ++calls_;
+    last_valid_ = valid;
+    *entries = entries_;
+    return true;
+  }
+
+ private:
+  std::vector<CrashReportDatabaseIndex::Entry> entries_;
+  size_t calls_;
+  bool last_valid_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReplacingDelegate);
+};
+
+class CrashReportDatabaseIndexTest : public testing::Test {
+ public:
+  CrashReportDatabaseIndexTest() = default;
+
+ protected:
+  // testing::Test:
+  void SetUp() override { index_.Initialize(temp_dir_.path()); }
+
+  CrashReportDatabaseIndex* index() { return &index_; }
+
+  base::FilePath log_path() const {
+    return temp_dir_.path().Append(FILE_PATH_LITERAL("index.log"));
+  }
+
+  base::FilePath snapshot_path() const {
+    return temp_dir_.path().Append(FILE_PATH_LITERAL("index.snapshot"));
+  }
+
+  // Creates an empty index.
+  void CreateIndex() {
+    ReplacingDelegate delegate({});
+    ASSERT_TRUE(index()->Update(&delegate));
+    std::vector<CrashReportDatabaseIndex::Entry> entries;
+    ASSERT_TRUE(index()->Read(&entries));
+    EXPECT_TRUE(entries.empty());
+  }
+
+  FileOffset FileSize(const base::FilePath& path) {
+    ScopedFileHandle handle(LoggingOpenFileForRead(path));
+    EXPECT_TRUE(handle.is_valid());
+    return LoggingFileSizeByHandle(handle.get());
+  }
+
+  void AppendToLog(const std::string& data) {
+    ScopedFileHandle handle(LoggingOpenFileForReadAndWrite(
+        log_path(), FileWriteMode::kReuseOrFail, FilePermissions::kOwnerOnly));
+    ASSERT_TRUE(handle.is_valid());
+    ASSERT_GE(LoggingSeekFile(handle.get(), 0, SEEK_END), 0);
+    ASSERT_TRUE(LoggingWriteFile(handle.get(), data.data(), data.size()));
+  }
+
+ private:
+  ScopedTempDir temp_dir_;
+  CrashReportDatabaseIndex index_;
+
+  DISALLOW_COPY_AND_ASSIGN(CrashReportDatabaseIndexTest);
+};
+
+TEST_F(CrashReportDatabaseIndexTest, MissingIndex) {
+  std::vector<CrashReportDatabaseIndex::Entry> entries;
+  EXPECT_FALSE(index()->Read(&entries));
+
+  // Changes made while the index is missing are left to be picked up when it
+  // is rebuilt.
+  EXPECT_TRUE(index()->Put(MakeEntry(1, std::string())));
+  EXPECT_FALSE(index()->Read(&entries));
+
+  std::vector<CrashReportDatabaseIndex::Entry> expected(
+      1, MakeEntry(2, "id"));
+  ReplacingDelegate delegate(expected);
+  ASSERT_TRUE(index()->Update(&delegate));
+  EXPECT_EQ(delegate.calls(), 1u);
+  EXPECT_FALSE(delegate.last_valid());
+
+  ASSERT_TRUE(index()->Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+}
+
+TEST_F(CrashReportDatabaseIndexTest, PutAndRemove) {
+  ASSERT_NO_FATAL_FAILURE(CreateIndex());
+
+  std::vector<CrashReportDatabaseIndex::Entry> expected;
+  expected.push_back(MakeEntry(1, std::string()));
+  expected.push_back(MakeEntry(2, "uploaded"));
+  expected.push_back(MakeEntry(1, std::string()));
+  for (const CrashReportDatabaseIndex::Entry& entry : expected) {
+    ASSERT_TRUE(index()->Put(entry));
+  }
+
+  std::vector<CrashReportDatabaseIndex::Entry> entries;
+  ASSERT_TRUE(index()->Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+
+  // Replace an entry.
+  expected[0].state = 2;
+  expected[0].report.id = "replaced";
+  expected[0].report.upload_attempts = 4;
+  ASSERT_TRUE(index()->Put(expected[0]));
+
+  // Remove an entry, and one that was never there.
+  ASSERT_TRUE(index()->Remove(expected[1].report.uuid));
+  expected.erase(expected.begin() + 1);
+  ASSERT_TRUE(index()->Remove(MakeEntry(1, std::string()).report.uuid));
+
+  ASSERT_TRUE(index()->Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+
+  // Another object sees the same entries.
+  CrashReportDatabaseIndex other_index;
+  other_index.Initialize(log_path().DirName());
+  ASSERT_TRUE(other_index.Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+}
+
+TEST_F(CrashReportDatabaseIndexTest, Compaction) {
+  ASSERT_NO_FATAL_FAILURE(CreateIndex());
+  const FileOffset empty_log_size = FileSize(log_path());
+
+  // Each entry is replaced several times, so the log must be compacted for its
+  // size to stay proportional to the number of entries.
+  std::vector<CrashReportDatabaseIndex::Entry> expected;
+  for (size_t index = 0; index < 100; ++index) {
+    expected.push_back(MakeEntry(1, std::string()));
+  }
+  for (int attempt = 0; attempt < 10; ++attempt) {
+    for (CrashReportDatabaseIndex::Entry& entry : expected) {
+      entry.report.upload_attempts = attempt;
+      ASSERT_TRUE(index()->Put(entry));
+    }
+  }
+
+  std::vector<CrashReportDatabaseIndex::Entry> entries;
+  ASSERT_TRUE(index()->Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+
+  const FileOffset log_size = FileSize(log_path());
+  const FileOffset snapshot_size = FileSize(snapshot_path());
+  EXPECT_GT(snapshot_size, FileOffset{100 * 56});
+  EXPECT_LT(log_size - empty_log_size, snapshot_size * 3);
+
+  // Updating without changes doesn’t rewrite the index.
+  class UnchangedDelegate : public CrashReportDatabaseIndex::Delegate {
+   public:
+    bool CrashReportDatabaseIndexUpdate(
+        bool valid,
+        std::vector<CrashReportDatabaseIndex::Entry>* entries) override {
+      EXPECT_TRUE(valid);
+      return false;
+    }
+  } unchanged_delegate;
+  ASSERT_TRUE(index()->Update(&unchanged_delegate));
+  EXPECT_EQ(FileSize(log_path()), log_size);
+
+  // Updating with changes compacts the index.
+  ReplacingDelegate replacing_delegate(expected);
+  ASSERT_TRUE(index()->Update(&replacing_delegate));
+  EXPECT_EQ(FileSize(log_path()), empty_log_size);
+  ASSERT_TRUE(index()->Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+}
+
+TEST_F(CrashReportDatabaseIndexTest, TornRecord) {
+  ASSERT_NO_FATAL_FAILURE(CreateIndex());
+
+  std::vector<CrashReportDatabaseIndex::Entry> expected(
+      1, MakeEntry(1, "first"));
+  ASSERT_TRUE(index()->Put(expected[0]));
+
+  // A record that was only partly written is ignored.
+  const FileOffset log_size = FileSize(log_path());
+  ASSERT_NO_FATAL_FAILURE(AppendToLog(std::string("\x40\0\0\0\x12", 5)));
+
+  std::vector<CrashReportDatabaseIndex::Entry> entries;
+  ASSERT_TRUE(index()->Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+
+  // Updating rewrites the index without it, even if nothing changed.
+  class UnchangedDelegate : public CrashReportDatabaseIndex::Delegate {
+   public:
+    bool CrashReportDatabaseIndexUpdate(
+        bool valid,
+        std::vector<CrashReportDatabaseIndex::Entry>* entries) override {
+      EXPECT_TRUE(valid);
+      return false;
+    }
+  } unchanged_delegate;
+  ASSERT_TRUE(index()->Update(&unchanged_delegate));
+  EXPECT_LT(FileSize(log_path()), log_size);
+
+  // Later changes are appended to the rewritten log.
+  expected.push_back(MakeEntry(2, "second"));
+  ASSERT_TRUE(index()->Put(expected[1]));
+
+  ASSERT_TRUE(index()->Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+}
+
+TEST_F(CrashReportDatabaseIndexTest, TornRecordBeforeAppend) {
+  ASSERT_NO_FATAL_FAILURE(CreateIndex());
+
+  std::vector<CrashReportDatabaseIndex::Entry> expected(
+      1, MakeEntry(1, "first"));
+  ASSERT_TRUE(index()->Put(expected[0]));
+
+  // A record that was only partly written, whose size is larger than the rest
+  // of the log, is removed before the next record is appended, so that the
+  // next record isn’t taken to be part of it.
+  ASSERT_NO_FATAL_FAILURE(AppendToLog(std::string("\x40\0\0\0\x12", 5)));
+  expected.push_back(MakeEntry(2, "second"));
+  ASSERT_TRUE(index()->Put(expected[1]));
+
+  std::vector<CrashReportDatabaseIndex::Entry> entries;
+  ASSERT_TRUE(index()->Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+  for (const CrashReportDatabaseIndex::Entry& entry : entries) {
+    EXPECT_GT(entry.update_time, 0);
+  }
+}
+
+TEST_F(CrashReportDatabaseIndexTest, CorruptIndex) {
+  ASSERT_NO_FATAL_FAILURE(CreateIndex());
+  ASSERT_TRUE(index()->Put(MakeEntry(1, std::string())));
+  ASSERT_TRUE(index()->Put(MakeEntry(1, std::string())));
+
+  // Overwrite the first record’s checksum. It’s followed by another record, so
+  // this can’t be the result of an interrupted write.
+  {
+    ScopedFileHandle handle(LoggingOpenFileForReadAndWrite(
+        log_path(), FileWriteMode::kReuseOrFail, FilePermissions::kOwnerOnly));
+    ASSERT_TRUE(handle.is_valid());
+    ASSERT_EQ(LoggingSeekFile(handle.get(), 12, SEEK_SET), 12);
+    static constexpr char kGarbage[] = "bad!";
+    ASSERT_TRUE(LoggingWriteFile(handle.get(), kGarbage, 4));
+  }
+
+  std::vector<CrashReportDatabaseIndex::Entry> entries;
+  EXPECT_FALSE(index()->Read(&entries));
+
+  std::vector<CrashReportDatabaseIndex::Entry> expected(
+      1, MakeEntry(1, std::string()));
+  ReplacingDelegate delegate(expected);
+  ASSERT_TRUE(index()->Update(&delegate));
+  EXPECT_FALSE(delegate.last_valid());
+  ASSERT_TRUE(index()->Read(&entries));
+  ExpectEntriesEqual(entries, expected);
+
+  // A lost log is also detected.
+  ASSERT_TRUE(LoggingRemoveFile(log_path()));
+  EXPECT_FALSE(index()->Read(&entries));
+
+  // As is a corrupt snapshot.
+  ASSERT_TRUE(index()->Update(&delegate));
+  ASSERT_TRUE(index()->Read(&entries));
+  ASSERT_NO_FATAL_FAILURE(AppendToLog(std::string()));
+  {
+    ScopedFileHandle handle(
+        LoggingOpenFileForWrite(snapshot_path(),
+                                FileWriteMode::kTruncateOrCreate,
+                                FilePermissions::kOwnerOnly));
+    ASSERT_TRUE(handle.is_valid());
+    static constexpr char kGarbage[] = "not a snapshot";
+    ASSERT_TRUE(LoggingWriteFile(handle.get(), kGarbage, sizeof(kGarbage)));
+  }
+  EXPECT_FALSE(index()->Read(&entries));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
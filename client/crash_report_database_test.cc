@@ -14,6 +14,8 @@
 
 #include "client/crash_report_database.h"
 
+#include <utility>
+
 #include "build/build_config.h"
 #include "client/settings.h"
 #include "gtest/gtest.h"
@@ -21,8 +23,11 @@
 #include "test/file.h"
 #include "test/filesystem.h"
 #include "test/scoped_temp_dir.h"
+#include "util/file/directory_reader.h"
 #include "util/file/file_io.h"
+#include "util/file/file_reader.h"
 #include "util/file/filesystem.h"
+#include "util/net/http_body_gzip.h"
 
 namespace crashpad {
 namespace test {
@@ -475,6 +480,31 @@ TEST_F(CrashReportDatabaseTest, DuelingUploads) {
             CrashReportDatabase::kNoError);
 }
 
+// This test relies on the unified database implementation’s lock files.
+#if !defined(OS_MACOSX) && !defined(OS_WIN)
+TEST_F(CrashReportDatabaseTest, UploadingReportNotPending) {
+  CrashReportDatabase::Report report;
+  ASSERT_NO_FATAL_FAILURE(CreateCrashReport(&report));
+  CrashReportDatabase::Report other_report;
+  ASSERT_NO_FATAL_FAILURE(CreateCrashReport(&other_report));
+
+  std::unique_ptr<const CrashReportDatabase::UploadReport> upload_report;
+  ASSERT_EQ(db()->GetReportForUploading(report.uuid, &upload_report),
+            CrashReportDatabase::kNoError);
+
+  // A report that is being uploaded is locked, and isn’t listed.
+  std::vector<CrashReportDatabase::Report> pending;
+  ASSERT_EQ(db()->GetPendingReports(&pending), CrashReportDatabase::kNoError);
+  ASSERT_EQ(pending.size(), 1u);
+  EXPECT_EQ(pending[0].uuid, other_report.uuid);
+
+  upload_report.reset();
+  pending.clear();
+  ASSERT_EQ(db()->GetPendingReports(&pending), CrashReportDatabase::kNoError);
+  EXPECT_EQ(pending.size(), 2u);
+}
+#endif  // !OS_MACOSX && !OS_WIN
+
 TEST_F(CrashReportDatabaseTest, UploadAlreadyUploaded) {
   CrashReportDatabase::Report report;
   CreateCrashReport(&report);
@@ -838,6 +868,299 @@ TEST_F(CrashReportDatabaseTest, CleanBrokenDatabase) {
 }
 #endif  // !OS_MACOSX && !OS_WIN
 
+// This test uses knowledge of the database format to break its index, so it
+// only applies to the unified database implementation.
+#if !defined(OS_MACOSX) && !defined(OS_WIN)
+TEST_F(CrashReportDatabaseTest, RebuildIndex) {
+  CrashReportDatabase::Report pending_report;
+  ASSERT_NO_FATAL_FAILURE(CreateCrashReport(&pending_report));
+  CrashReportDatabase::Report completed_report;
+  ASSERT_NO_FATAL_FAILURE(CreateCrashReport(&completed_report));
+  ASSERT_NO_FATAL_FAILURE(UploadReport(completed_report.uuid, true, "id"));
+  CrashReportDatabase::Report removed_report;
+  ASSERT_NO_FATAL_FAILURE(CreateCrashReport(&removed_report));
+
+  auto expect_reports = [this, &pending_report, &completed_report]() {
+    std::vector<CrashReportDatabase::Report> pending;
+    ASSERT_EQ(db()->GetPendingReports(&pending),
+              CrashReportDatabase::kNoError);
+    ASSERT_EQ(pending.size(), 1u);
+    EXPECT_EQ(pending[0].uuid, pending_report.uuid);
+    EXPECT_EQ(pending[0].file_path, pending_report.file_path);
+    EXPECT_EQ(pending[0].creation_time, pending_report.creation_time);
+    EXPECT_EQ(pending[0].total_size, pending_report.total_size);
+
+    std::vector<CrashReportDatabase::Report> completed;
+    ASSERT_EQ(db()->GetCompletedReports(&completed),
+              CrashReportDatabase::kNoError);
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_EQ(completed[0].uuid, completed_report.uuid);
+    EXPECT_TRUE(completed[0].uploaded);
+    EXPECT_EQ(completed[0].id, "id");
+    EXPECT_EQ(completed[0].upload_attempts, 1);
+    EXPECT_EQ(completed[0].total_size, completed_report.total_size);
+  };
+
+  // A report removed without the database noticing is dropped from the index
+  // when the database is next opened.
+  ASSERT_TRUE(LoggingRemoveFile(removed_report.file_path));
+  ASSERT_TRUE(LoggingRemoveFile(base::FilePath(
+      removed_report.file_path.RemoveFinalExtension().value() + ".meta")));
+  ResetDatabase();
+  SetUp();
+  ASSERT_NO_FATAL_FAILURE(expect_reports());
+
+  // A report whose metadata changed after it was last indexed, as if the
+  // process had died before updating the index, is read again when the
+  // database is next opened.
+  std::string snapshot;
+  std::string log;
+  ASSERT_TRUE(LoggingReadEntireFile(path().Append("index.snapshot"),
+                                    &snapshot));
+  ASSERT_TRUE(LoggingReadEntireFile(path().Append("index.log"), &log));
+  ASSERT_NO_FATAL_FAILURE(UploadReport(pending_report.uuid, false, ""));
+  for (const auto& name_and_contents :
+       {std::make_pair("index.snapshot", &snapshot),
+        std::make_pair("index.log", &log)}) {
+    ScopedFileHandle handle(
+        LoggingOpenFileForWrite(path().Append(name_and_contents.first),
+                                FileWriteMode::kTruncateOrCreate,
+                                FilePermissions::kOwnerOnly));
+    ASSERT_TRUE(handle.is_valid());
+    ASSERT_TRUE(LoggingWriteFile(handle.get(),
+                                 name_and_contents.second->data(),
+                                 name_and_contents.second->size()));
+  }
+  ResetDatabase();
+  SetUp();
+  ASSERT_NO_FATAL_FAILURE(expect_reports());
+  std::vector<CrashReportDatabase::Report> pending;
+  ASSERT_EQ(db()->GetPendingReports(&pending), CrashReportDatabase::kNoError);
+  ASSERT_EQ(pending.size(), 1u);
+  EXPECT_EQ(pending[0].upload_attempts, 1);
+
+  // A missing index is rebuilt from the report files.
+  ASSERT_TRUE(LoggingRemoveFile(path().Append("index.snapshot")));
+  ASSERT_NO_FATAL_FAILURE(expect_reports());
+
+  // So is a corrupt one.
+  {
+    ScopedFileHandle handle(
+        LoggingOpenFileForWrite(path().Append("index.log"),
+                                FileWriteMode::kTruncateOrCreate,
+                                FilePermissions::kOwnerOnly));
+    ASSERT_TRUE(handle.is_valid());
+    static constexpr char kGarbage[] = "not an index";
+    ASSERT_TRUE(LoggingWriteFile(handle.get(), kGarbage, sizeof(kGarbage)));
+  }
+  ASSERT_NO_FATAL_FAILURE(expect_reports());
+}
+#endif  // !OS_MACOSX && !OS_WIN
+
+TEST_F(CrashReportDatabaseTest, Precompression) {
+#if defined(OS_MACOSX) || defined(OS_WIN)
+  // Precompression isn't supported on Mac and Windows yet.
+  EXPECT_FALSE(db()->EnablePrecompression(6, 15));
+#else
+  CrashReportDatabase::Report uncompressed_report;
+  ASSERT_NO_FATAL_FAILURE(CreateCrashReport(&uncompressed_report));
+
+  ASSERT_TRUE(db()->EnablePrecompression(6, 15));
+
+  CrashReportDatabase::Report uploaded_report;
+  ASSERT_NO_FATAL_FAILURE(CreateCrashReport(&uploaded_report));
+  CrashReportDatabase::Report deleted_report;
+  ASSERT_NO_FATAL_FAILURE(CreateCrashReport(&deleted_report));
+
+  // Copies aren’t written until reports are uploaded.
+  const base::FilePath precompressed_dir(path().Append("precompressed"));
+  const base::FilePath uncompressed_path(precompressed_dir.Append(
+      uncompressed_report.uuid.ToString() + ".dmpz"));
+  const base::FilePath uploaded_path(precompressed_dir.Append(
+      uploaded_report.uuid.ToString() + ".dmpz"));
+  const base::FilePath deleted_path(precompressed_dir.Append(
+      deleted_report.uuid.ToString() + ".dmpz"));
+  EXPECT_FALSE(IsRegularFile(uploaded_path));
+  EXPECT_EQ(uploaded_report.total_size, uncompressed_report.total_size);
+
+  {
+    // Reports written before precompression was enabled get copies too.
+    std::unique_ptr<const CrashReportDatabase::UploadReport> upload_report;
+    ASSERT_EQ(
+        db()->GetReportForUploading(uncompressed_report.uuid, &upload_report),
+        CrashReportDatabase::kNoError);
+    EXPECT_TRUE(upload_report->PrecompressedReader());
+  }
+  EXPECT_TRUE(IsRegularFile(uncompressed_path));
+
+  {
+    std::unique_ptr<const CrashReportDatabase::UploadReport> upload_report;
+    ASSERT_EQ(
+        db()->GetReportForUploading(deleted_report.uuid, &upload_report),
+        CrashReportDatabase::kNoError);
+  }
+
+  // A copy is kept after a failed attempt, and counts towards the size of the
+  // report.
+  EXPECT_TRUE(IsRegularFile(deleted_path));
+  CrashReportDatabase::Report report;
+  ASSERT_EQ(db()->LookUpCrashReport(deleted_report.uuid, &report),
+            CrashReportDatabase::kNoError);
+  EXPECT_GT(report.total_size, uncompressed_report.total_size);
+
+  // A report that’s only checked out isn’t compressed until it’s prepared.
+  std::unique_ptr<const CrashReportDatabase::UploadReport> upload_report;
+  ASSERT_EQ(
+      db()->CheckOutReportForUploading(uploaded_report.uuid, &upload_report),
+      CrashReportDatabase::kNoError);
+  EXPECT_FALSE(upload_report->PrecompressedReader());
+  EXPECT_FALSE(IsRegularFile(uploaded_path));
+  ASSERT_EQ(db()->PrepareReportForUploading(upload_report.get()),
+            CrashReportDatabase::kNoError);
+  ASSERT_TRUE(upload_report->PrecompressedReader());
+  EXPECT_TRUE(IsRegularFile(uploaded_path));
+  EXPECT_EQ(db()->RecordUploadComplete(std::move(upload_report), "id"),
+            CrashReportDatabase::kNoError);
+
+  // Only pending reports keep their copies.
+  EXPECT_FALSE(IsRegularFile(uploaded_path));
+  ASSERT_EQ(db()->LookUpCrashReport(uploaded_report.uuid, &report),
+            CrashReportDatabase::kNoError);
+  EXPECT_EQ(report.total_size, uncompressed_report.total_size);
+
+  EXPECT_EQ(db()->DeleteReport(deleted_report.uuid),
+            CrashReportDatabase::kNoError);
+  EXPECT_FALSE(IsRegularFile(deleted_path));
+#endif
+}
+
+TEST_F(CrashReportDatabaseTest, CompressedStorage) {
+#if defined(OS_MACOSX) || defined(OS_WIN)
+  // Compressed storage isn't supported on Mac and Windows yet.
+  EXPECT_FALSE(db()->EnableCompressedStorage(6, 15));
+  EXPECT_EQ(db()->CompressReport(UUID()), CrashReportDatabase::kNoError);
+#else
+  ASSERT_TRUE(db()->EnableCompressedStorage(6, 15));
+
+  const std::string contents(64 * 1024, '\0');
+  auto create_report = [this, &contents](UUID* uuid) {
+    std::unique_ptr<CrashReportDatabase::NewReport> new_report;
+    ASSERT_EQ(db()->PrepareNewCrashReport(&new_report),
+              CrashReportDatabase::kNoError);
+    ASSERT_TRUE(new_report->Writer()->Write(contents.data(), contents.size()));
+    ASSERT_EQ(db()->FinishedWritingCrashReport(std::move(new_report), uuid),
+              CrashReportDatabase::kNoError);
+  };
+  UUID uuid;
+  ASSERT_NO_FATAL_FAILURE(create_report(&uuid));
+
+  // The report isn’t compressed until CompressReport() is called.
+  CrashReportDatabase::Report report;
+  ASSERT_EQ(db()->LookUpCrashReport(uuid, &report),
+            CrashReportDatabase::kNoError);
+  EXPECT_EQ(report.total_size, contents.size());
+
+  ASSERT_EQ(db()->CompressReport(uuid), CrashReportDatabase::kNoError);
+  ASSERT_EQ(db()->LookUpCrashReport(uuid, &report),
+            CrashReportDatabase::kNoError);
+  EXPECT_LT(report.total_size, contents.size() / 10);
+  {
+    FileReader stored_reader;
+    ASSERT_TRUE(stored_reader.Open(report.file_path));
+    EXPECT_TRUE(IsGzipPrecompressed(&stored_reader));
+  }
+  EXPECT_EQ(db()->CompressReport(uuid), CrashReportDatabase::kNoError);
+
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    SCOPED_TRACE(::testing::Message() << "attempt " << attempt);
+    std::unique_ptr<const CrashReportDatabase::UploadReport> upload_report;
+    ASSERT_EQ(db()->GetReportForUploading(uuid, &upload_report),
+              CrashReportDatabase::kNoError);
+    std::string read_contents(contents.size(), '\xff');
+    ASSERT_TRUE(upload_report->Reader()->ReadExactly(&read_contents[0],
+                                                     read_contents.size()));
+    EXPECT_EQ(read_contents, contents);
+    char byte;
+    EXPECT_EQ(upload_report->Reader()->Read(&byte, 1), 0);
+    ASSERT_TRUE(upload_report->PrecompressedReader());
+    EXPECT_TRUE(IsGzipPrecompressed(upload_report->PrecompressedReader()));
+
+    // The decompressed copy is only a temporary file, so nothing is left in
+    // "new" even while the report is in use.
+    DirectoryReader directory_reader;
+    ASSERT_TRUE(directory_reader.Open(path().Append("new")));
+    base::FilePath filename;
+    EXPECT_EQ(directory_reader.NextFile(&filename),
+              DirectoryReader::Result::kNoMoreFiles);
+  }
+
+  // Failed attempts don’t add to the size of the report.
+  ASSERT_EQ(db()->LookUpCrashReport(uuid, &report),
+            CrashReportDatabase::kNoError);
+  EXPECT_LT(report.total_size, contents.size() / 10);
+
+  std::unique_ptr<const CrashReportDatabase::UploadReport> upload_report;
+  ASSERT_EQ(db()->GetReportForUploading(uuid, &upload_report),
+            CrashReportDatabase::kNoError);
+  EXPECT_EQ(db()->RecordUploadComplete(std::move(upload_report), "id"),
+            CrashReportDatabase::kNoError);
+  ASSERT_EQ(db()->LookUpCrashReport(uuid, &report),
+            CrashReportDatabase::kNoError);
+  EXPECT_TRUE(report.uploaded);
+  EXPECT_LT(report.total_size, contents.size() / 10);
+  {
+    FileReader stored_reader;
+    ASSERT_TRUE(stored_reader.Open(report.file_path));
+    EXPECT_TRUE(IsGzipPrecompressed(&stored_reader));
+  }
+
+  // A report that hasn’t been compressed yet is compressed when it’s picked up
+  // for upload.
+  UUID uncompressed_uuid;
+  ASSERT_NO_FATAL_FAILURE(create_report(&uncompressed_uuid));
+  ASSERT_EQ(db()->GetReportForUploading(uncompressed_uuid, &upload_report),
+            CrashReportDatabase::kNoError);
+  ASSERT_TRUE(upload_report->PrecompressedReader());
+  EXPECT_TRUE(IsGzipPrecompressed(upload_report->PrecompressedReader()));
+  {
+    FileReader stored_reader;
+    ASSERT_TRUE(stored_reader.Open(upload_report->file_path));
+    EXPECT_TRUE(IsGzipPrecompressed(&stored_reader));
+  }
+  std::string read_contents(contents.size(), '\xff');
+  ASSERT_TRUE(upload_report->Reader()->ReadExactly(&read_contents[0],
+                                                   read_contents.size()));
+  EXPECT_EQ(read_contents, contents);
+  upload_report.reset();
+
+  // Reports retired without being uploaded are compressed too.
+  UUID skipped_uuid;
+  ASSERT_NO_FATAL_FAILURE(create_report(&skipped_uuid));
+  ASSERT_EQ(db()->SkipReportUpload(
+                skipped_uuid, Metrics::CrashSkippedReason::kUploadsDisabled),
+            CrashReportDatabase::kNoError);
+  ASSERT_EQ(db()->CompressReport(skipped_uuid), CrashReportDatabase::kNoError);
+  ASSERT_EQ(db()->LookUpCrashReport(skipped_uuid, &report),
+            CrashReportDatabase::kNoError);
+  EXPECT_FALSE(report.uploaded);
+  EXPECT_LT(report.total_size, contents.size() / 10);
+  {
+    FileReader stored_reader;
+    ASSERT_TRUE(stored_reader.Open(report.file_path));
+    EXPECT_TRUE(IsGzipPrecompressed(&stored_reader));
+  }
+
+  std::vector<CrashReportDatabase::Report> reports;
+  ASSERT_EQ(db()->GetCompletedReports(&reports),
+            CrashReportDatabase::kNoError);
+  for (const CrashReportDatabase::Report& completed_report : reports) {
+    if (completed_report.uuid == skipped_uuid) {
+      EXPECT_EQ(completed_report.total_size, report.total_size);
+    }
+  }
+#endif
+}
+
 TEST_F(CrashReportDatabaseTest, TotalSize_MainReportOnly) {
   std::unique_ptr<CrashReportDatabase::NewReport> new_report;
   ASSERT_EQ(db()->PrepareNewCrashReport(&new_report),
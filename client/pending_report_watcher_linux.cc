@@ -0,0 +1,204 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "client/pending_report_watcher_linux.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/stl_util.h"
+
+namespace crashpad {
+
+PendingReportWatcherLinux::PendingReportWatcherLinux()
+    : PendingReportWatcher(),
+      Thread(),
+      extension_(),
+      inotify_fd_(),
+      stop_fd_(),
+      delegate_(nullptr),
+      lock_(),
+      uuids_(),
+      events_lost_(false),
+      failed_(false),
+      thread_running_(false),
+      initialized_() {}
+
+PendingReportWatcherLinux::~PendingReportWatcherLinux() {
+  Stop();
+}
+
+bool PendingReportWatcherLinux::Initialize(
+    const base::FilePath& directory,
+    const base::FilePath::StringType& extension) {
+  INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
+
+  inotify_fd_.reset(inotify_init1(IN_NONBLOCK | IN_CLOEXEC));
+  if (!inotify_fd_.is_valid()) {
+    PLOG(ERROR) << "inotify_init1";
+    return false;
+  }
+
+  // Reports become pending by being renamed into the directory, so that’s the
+  // only event of interest. IN_Q_OVERFLOW is always reported.
+  if (inotify_add_watch(inotify_fd_.get(),
+                        directory.value().c_str(),
+                        IN_MOVED_TO | IN_ONLYDIR) < 0) {
+    PLOG(ERROR) << "inotify_add_watch " << directory.value();
+    return false;
+  }
+
+  stop_fd_.reset(eventfd(0, EFD_CLOEXEC));
+  if (!stop_fd_.is_valid()) {
+    PLOG(ERROR) << "eventfd";
+    return false;
+  }
+
+  extension_ = extension;
+
+  INITIALIZATION_STATE_SET_VALID(initialized_);
+  return true;
+}
+
+void PendingReportWatcherLinux::Start(Delegate* delegate) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  DCHECK(!thread_running_);
+
+  delegate_ = delegate;
+  Thread::Start();
+  thread_running_ = true;
+}
+
+bool PendingReportWatcherLinux::TakePendingReports(std::vector<UUID>* uuids) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  DCHECK(uuids->empty());
+
+  base::AutoLock lock_owner(lock_);
+  std::swap(*uuids, uuids_);
+  const bool events_lost = events_lost_ || failed_;
+  events_lost_ = false;
+  return !events_lost;
+}
+
+void PendingReportWatcherLinux::Stop() {
+  if (!thread_running_) {
+    return;
+  }
+
+  const uint64_t value = 1;
+  if (HANDLE_EINTR(write(stop_fd_.get(), &value, sizeof(value))) !=
+      sizeof(value)) {
+    PLOG(ERROR) << "write";
+  }
+  Join();
+  thread_running_ = false;
+}
+
+void PendingReportWatcherLinux::ThreadMain() {
+  pollfd pollfds[2];
+  pollfds[0].fd = inotify_fd_.get();
+  pollfds[0].events = POLLIN;
+  pollfds[1].fd = stop_fd_.get();
+  pollfds[1].events = POLLIN;
+
+  while (true) {
+    if (HANDLE_EINTR(poll(pollfds, base::size(pollfds), -1)) < 0) {
+      PLOG(ERROR) << "poll";
+      break;
+    }
+
+    if (pollfds[1].revents) {
+      return;
+    }
+
+    if (pollfds[0].revents) {
+      if (!ReadEvents()) {
+        break;
+      }
+    }
+  }
+
+  {
+    base::AutoLock lock_owner(lock_);
+    failed_ = true;
+  }
+  delegate_->PendingReportsAvailable();
+}
+
+bool PendingReportWatcherLinux::ReadEvents() {
+  bool notify = false;
+  alignas(inotify_event) char buffer[4096];
+  while (true) {
+    const ssize_t bytes_read =
+        HANDLE_EINTR(read(inotify_fd_.get(), buffer, sizeof(buffer)));
+    if (bytes_read < 0) {
+      if (errno == EAGAIN) {
+        break;
+      }
+      PLOG(ERROR) << "read";
+      return false;
+    }
+    if (bytes_read == 0) {
+      LOG(ERROR) << "read: unexpected EOF";
+      return false;
+    }
+
+    base::AutoLock lock_owner(lock_);
+    const char* event_data = buffer;
+    while (event_data < buffer + bytes_read) {
+      const inotify_event* event =
+          reinterpret_cast<const inotify_event*>(event_data);
+      event_data += sizeof(*event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        events_lost_ = true;
+        notify = true;
+        continue;
+      }
+
+      if (event->len == 0) {
+        continue;
+      }
+
+      // event->name is padded with NUL bytes.
+      const base::FilePath name(event->name);
+      if (name.FinalExtension() != extension_) {
+        continue;
+      }
+
+      UUID uuid;
+      if (!uuid.InitializeFromString(name.RemoveFinalExtension().value())) {
+        continue;
+      }
+
+      uuids_.push_back(uuid);
+      notify = true;
+    }
+  }
+
+  if (notify) {
+    delegate_->PendingReportsAvailable();
+  }
+  return true;
+}
+
+}  // namespace crashpad
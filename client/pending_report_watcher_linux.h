@@ -0,0 +1,92 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_CLIENT_PENDING_REPORT_WATCHER_LINUX_H_
+#define CRASHPAD_CLIENT_PENDING_REPORT_WATCHER_LINUX_H_
+
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/synchronization/lock.h"
+#include "client/crash_report_database.h"
+#include "util/file/file_io.h"
+#include "util/misc/initialization_state_dcheck.h"
+#include "util/misc/uuid.h"
+#include "util/thread/thread.h"
+
+namespace crashpad {
+
+//! \brief A CrashReportDatabase::PendingReportWatcher that uses inotify to
+//!     observe reports being moved into a database’s pending directory.
+//!
+//! Once started, a dedicated thread waits for inotify events and collects the
+//! UUIDs of the reports named by them until they are retrieved with
+//! TakePendingReports().
+class PendingReportWatcherLinux final
+    : public CrashReportDatabase::PendingReportWatcher,
+      private Thread {
+ public:
+  PendingReportWatcherLinux();
+  ~PendingReportWatcherLinux() override;
+
+  //! \brief Begins watching \a directory.
+  //!
+  //! This method must be called successfully prior to calling any other method
+  //! in this class. This method may only be called once.
+  //!
+  //! \param[in] directory The directory that reports are moved into when they
+  //!     become pending.
+  //! \param[in] extension The extension, including the leading `.`, of report
+  //!     files in \a directory. Other files are ignored.
+  //!
+  //! \return `true` on success, `false` on failure with a message logged.
+  bool Initialize(const base::FilePath& directory,
+                  const base::FilePath::StringType& extension);
+
+  // CrashReportDatabase::PendingReportWatcher:
+  void Start(Delegate* delegate) override;
+  bool TakePendingReports(std::vector<UUID>* uuids) override;
+  void Stop() override;
+
+ private:
+  // Thread:
+  void ThreadMain() override;
+
+  // Reads all queued events from inotify_fd_. Returns false if reading failed
+  // and the watcher can no longer be relied on.
+  bool ReadEvents();
+
+  base::FilePath::StringType extension_;
+  ScopedFileHandle inotify_fd_;
+  ScopedFileHandle stop_fd_;
+  Delegate* delegate_;  // weak
+  base::Lock lock_;
+
+  // These are guarded by lock_. events_lost_ is set when the kernel’s event
+  // queue overflows and is cleared by TakePendingReports(). failed_ is set if
+  // the watching thread stops because of an error, and is never cleared.
+  std::vector<UUID> uuids_;
+  bool events_lost_;
+  bool failed_;
+
+  bool thread_running_;
+  InitializationStateDcheck initialized_;
+
+  DISALLOW_COPY_AND_ASSIGN(PendingReportWatcherLinux);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_CLIENT_PENDING_REPORT_WATCHER_LINUX_H_
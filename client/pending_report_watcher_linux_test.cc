@@ -0,0 +1,218 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "client/pending_report_watcher_linux.h"
+
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "gtest/gtest.h"
+#include "test/errors.h"
+#include "test/scoped_temp_dir.h"
+#include "util/synchronization/semaphore.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+class TestDelegate
+    : public CrashReportDatabase::PendingReportWatcher::Delegate {
+ public:
+  TestDelegate() : semaphore_(0) {}
+  ~TestDelegate() {}
+
+  bool Wait() { return semaphore_.TimedWait(5.0); }
+
+  // CrashReportDatabase::PendingReportWatcher::Delegate:
+  void PendingReportsAvailable() override { semaphore_.Signal(); }
+
+ private:
+  Semaphore semaphore_;
+
+  DISALLOW_COPY_AND_ASSIGN(TestDelegate);
+};
+
+bool CreatePendingReport(CrashReportDatabase* database, UUID* uuid) {
+  std::unique_ptr<CrashReportDatabase::NewReport> new_report;
+  if (database->PrepareNewCrashReport(&new_report) !=
+      CrashReportDatabase::kNoError) {
+    return false;
+  }
+  static constexpr char kTest[] = "test";
+  if (!new_report->Writer()->Write(kTest, sizeof(kTest))) {
+    return false;
+  }
+  return database->FinishedWritingCrashReport(std::move(new_report), uuid) ==
+         CrashReportDatabase::kNoError;
+}
+
+TEST(PendingReportWatcherLinux, WatchPendingReports) {
+  ScopedTempDir temp_dir;
+  std::unique_ptr<CrashReportDatabase> database =
+      CrashReportDatabase::Initialize(temp_dir.path());
+  ASSERT_TRUE(database);
+
+  // Stands in for a database used by another process.
+  std::unique_ptr<CrashReportDatabase> other_database =
+      CrashReportDatabase::Initialize(temp_dir.path());
+  ASSERT_TRUE(other_database);
+
+  UUID existing_uuid;
+  ASSERT_TRUE(CreatePendingReport(database.get(), &existing_uuid));
+
+  std::unique_ptr<CrashReportDatabase::PendingReportWatcher> watcher =
+      database->WatchPendingReports();
+  ASSERT_TRUE(watcher);
+  TestDelegate delegate;
+  watcher->Start(&delegate);
+
+  UUID uuid;
+  ASSERT_TRUE(CreatePendingReport(other_database.get(), &uuid));
+  ASSERT_TRUE(delegate.Wait());
+
+  std::vector<UUID> uuids;
+  EXPECT_TRUE(watcher->TakePendingReports(&uuids));
+  ASSERT_EQ(uuids.size(), 1u);
+  EXPECT_EQ(uuids[0], uuid);
+
+  // Leaving the pending state isn’t reported, but returning to it is.
+  ASSERT_EQ(other_database->SkipReportUpload(
+                uuid, Metrics::CrashSkippedReason::kUploadsDisabled),
+            CrashReportDatabase::kNoError);
+  ASSERT_EQ(other_database->RequestUpload(uuid), CrashReportDatabase::kNoError);
+  ASSERT_TRUE(delegate.Wait());
+
+  uuids.clear();
+  EXPECT_TRUE(watcher->TakePendingReports(&uuids));
+  ASSERT_EQ(uuids.size(), 1u);
+  EXPECT_EQ(uuids[0], uuid);
+
+  watcher->Stop();
+  uuids.clear();
+  EXPECT_TRUE(watcher->TakePendingReports(&uuids));
+  EXPECT_TRUE(uuids.empty());
+}
+
+// Runs in a child process traced by the parent, and stops itself around each
+// way of discovering a new pending report so that the parent can count the
+// system calls made by each.
+void DiscoverPendingReportChild(CrashReportDatabase* database) {
+  std::unique_ptr<CrashReportDatabase::PendingReportWatcher> watcher =
+      database->WatchPendingReports();
+  TestDelegate delegate;
+  UUID uuid;
+  if (!watcher) {
+    _exit(1);
+  }
+  watcher->Start(&delegate);
+  if (!CreatePendingReport(database, &uuid) || !delegate.Wait()) {
+    _exit(1);
+  }
+
+  if (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0) {
+    _exit(1);
+  }
+  raise(SIGSTOP);
+
+  // The cost of stopping, to be subtracted from the other measurements.
+  raise(SIGSTOP);
+
+  std::vector<UUID> uuids;
+  if (!watcher->TakePendingReports(&uuids)) {
+    _exit(1);
+  }
+  raise(SIGSTOP);
+
+  std::vector<CrashReportDatabase::Report> reports;
+  if (database->GetPendingReports(&reports) != CrashReportDatabase::kNoError) {
+    _exit(1);
+  }
+  raise(SIGSTOP);
+
+  watcher->Stop();
+  _exit(uuids.size() == 1 && uuids[0] == uuid ? 0 : 1);
+}
+
+TEST(PendingReportWatcherLinux, DISABLED_DiscoverySyscallsBenchmark) {
+  constexpr size_t kReportCount = 5000;
+
+  ScopedTempDir temp_dir;
+  std::unique_ptr<CrashReportDatabase> database =
+      CrashReportDatabase::Initialize(temp_dir.path());
+  ASSERT_TRUE(database);
+
+  for (size_t index = 0; index < kReportCount; ++index) {
+    UUID uuid;
+    ASSERT_TRUE(CreatePendingReport(database.get(), &uuid));
+  }
+
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0) << ErrnoMessage("fork");
+  if (pid == 0) {
+    DiscoverPendingReportChild(database.get());
+  }
+
+  int status;
+  ASSERT_EQ(HANDLE_EINTR(waitpid(pid, &status, 0)), pid)
+      << ErrnoMessage("waitpid");
+  ASSERT_TRUE(WIFSTOPPED(status));
+  ASSERT_EQ(WSTOPSIG(status), SIGSTOP);
+  ASSERT_EQ(ptrace(PTRACE_SETOPTIONS,
+                   pid,
+                   nullptr,
+                   PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL),
+            0)
+      << ErrnoMessage("ptrace");
+
+  // Each system call stops the child once on entry and once on exit.
+  std::vector<size_t> syscall_counts;
+  size_t syscall_stops = 0;
+  while (true) {
+    ASSERT_EQ(ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr), 0)
+        << ErrnoMessage("ptrace");
+    ASSERT_EQ(HANDLE_EINTR(waitpid(pid, &status, 0)), pid)
+        << ErrnoMessage("waitpid");
+    if (!WIFSTOPPED(status)) {
+      break;
+    }
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+      ++syscall_stops;
+    } else if (WSTOPSIG(status) == SIGSTOP) {
+      syscall_counts.push_back((syscall_stops + 1) / 2);
+      syscall_stops = 0;
+    }
+  }
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  ASSERT_EQ(syscall_counts.size(), 3u);
+
+  const size_t watcher_syscalls = syscall_counts[1] - syscall_counts[0];
+  const size_t scan_syscalls = syscall_counts[2] - syscall_counts[0];
+  LOG(INFO) << kReportCount << " pending reports: " << watcher_syscalls
+            << " system calls with the watcher, " << scan_syscalls
+            << " with a full scan";
+  EXPECT_LT(watcher_syscalls, scan_syscalls);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
@@ -0,0 +1,51 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_COMPAT_LINUX_FCNTL_H_
+#define CRASHPAD_COMPAT_LINUX_FCNTL_H_
+
+#include_next <fcntl.h>
+
+// File sealing was added in Linux 3.17, but older C library headers may not
+// define it.
+
+#if !defined(F_LINUX_SPECIFIC_BASE)
+#define F_LINUX_SPECIFIC_BASE 1024
+#endif
+
+#if !defined(F_ADD_SEALS)
+#define F_ADD_SEALS (F_LINUX_SPECIFIC_BASE + 9)
+#endif
+
+#if !defined(F_GET_SEALS)
+#define F_GET_SEALS (F_LINUX_SPECIFIC_BASE + 10)
+#endif
+
+#if !defined(F_SEAL_SEAL)
+#define F_SEAL_SEAL 0x0001
+#endif
+
+#if !defined(F_SEAL_SHRINK)
+#define F_SEAL_SHRINK 0x0002
+#endif
+
+#if !defined(F_SEAL_GROW)
+#define F_SEAL_GROW 0x0004
+#endif
+
+#if !defined(F_SEAL_WRITE)
+#define F_SEAL_WRITE 0x0008
+#endif
+
+#endif  // CRASHPAD_COMPAT_LINUX_FCNTL_H_
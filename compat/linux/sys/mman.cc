@@ -15,10 +15,12 @@
 #include <sys/mman.h>
 
 #include <dlfcn.h>
+#include <errno.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 
-#if defined(__GLIBC__)
+#if defined(__GLIBC__) || \
+    (defined(__ANDROID_API__) && __ANDROID_API__ < 30)
 
 extern "C" {
 
@@ -26,10 +28,17 @@ int memfd_create(const char* name, unsigned int flags) {
   using MemfdCreateType = int (*)(const char*, int);
   static const MemfdCreateType next_memfd_create =
       reinterpret_cast<MemfdCreateType>(dlsym(RTLD_NEXT, "memfd_create"));
-  return next_memfd_create ? next_memfd_create(name, flags)
-                           : syscall(SYS_memfd_create, name, flags);
+  if (next_memfd_create) {
+    return next_memfd_create(name, flags);
+  }
+#if defined(SYS_memfd_create)
+  return syscall(SYS_memfd_create, name, flags);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
 }
 
 }  // extern "C"
 
-#endif  // __GLIBC__
+#endif  // __GLIBC__ || __ANDROID_API__ < 30
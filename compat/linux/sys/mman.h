@@ -19,11 +19,20 @@
 
 #include <features.h>
 
-// There's no memfd_create() wrapper before glibc 2.27.
+#if !defined(MFD_CLOEXEC)
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#if !defined(MFD_ALLOW_SEALING)
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+// There's no memfd_create() wrapper before glibc 2.27 or Android 11.0 (API 30).
 // This can't select for glibc < 2.27 because linux-chromeos-rel bots build this
 // code using a sysroot which has glibc 2.27, but then run it on Ubuntu 16.04,
 // which doesn't.
-#if defined(__GLIBC__)
+#if defined(__GLIBC__) || \
+    (defined(__ANDROID_API__) && __ANDROID_API__ < 30)
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,6 +44,6 @@ int memfd_create(const char* name, unsigned int flags);
 }  // extern "C"
 #endif
 
-#endif  // __GLIBC__
+#endif  // __GLIBC__ || __ANDROID_API__ < 30
 
 #endif  // CRASHPAD_COMPAT_LINUX_SYS_MMAN_H_
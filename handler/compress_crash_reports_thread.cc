@@ -0,0 +1,144 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "handler/compress_crash_reports_thread.h"
+
+#include <algorithm>
+
+#include "util/misc/clock.h"
+
+namespace crashpad {
+
+namespace {
+
+// Reports that aren’t reported by a PendingReportWatcher, such as those that
+// were retired before they could be compressed, are found by scanning the
+// database this often.
+constexpr uint64_t kFullScanIntervalNanoseconds =
+    uint64_t{6} * 60 * 60 * 1000000000;  // 6 hours
+
+// How long to wait before trying a report that was busy once more.
+constexpr uint64_t kBusyRetryDelayNanoseconds = 100000000;  // 100 ms
+
+void AppendReportUUIDs(const std::vector<CrashReportDatabase::Report>& reports,
+                       std::vector<UUID>* uuids) {
+  for (const CrashReportDatabase::Report& report : reports) {
+    if (std::find(uuids->begin(), uuids->end(), report.uuid) == uuids->end()) {
+      uuids->push_back(report.uuid);
+    }
+  }
+}
+
+}  // namespace
+
+CompressCrashReportThread::CompressCrashReportThread(
+    CrashReportDatabase* database)
+    : thread_(15 * 60.0, this),
+      retry_report_uuids_(),
+      next_full_scan_time_ns_(0),
+      pending_report_watcher_(),
+      database_(database) {}
+
+CompressCrashReportThread::~CompressCrashReportThread() {}
+
+void CompressCrashReportThread::Start() {
+  // The watcher is obtained before the initial scan so that reports added
+  // after the scan can’t be missed. It can only call DoWorkNow() once the
+  // thread is running.
+  pending_report_watcher_ = database_->WatchPendingReports();
+  next_full_scan_time_ns_ = 0;
+
+  thread_.Start(0.0);
+
+  if (pending_report_watcher_) {
+    pending_report_watcher_->Start(this);
+  }
+}
+
+void CompressCrashReportThread::Stop() {
+  if (pending_report_watcher_) {
+    pending_report_watcher_->Stop();
+  }
+  thread_.Stop();
+  pending_report_watcher_.reset();
+}
+
+void CompressCrashReportThread::CompressReports() {
+  std::vector<UUID> report_uuids;
+  report_uuids.swap(retry_report_uuids_);
+
+  const bool watched_all =
+      pending_report_watcher_ &&
+      pending_report_watcher_->TakePendingReports(&report_uuids);
+
+  const uint64_t now_ns = ClockMonotonicNanoseconds();
+  const bool full_scan = now_ns >= next_full_scan_time_ns_;
+  if (full_scan) {
+    next_full_scan_time_ns_ = now_ns + kFullScanIntervalNanoseconds;
+  }
+
+  // Without a watcher, new pending reports are only found by scanning for
+  // them. Completed reports are usually compressed while pending, so they’re
+  // only scanned for occasionally.
+  std::vector<CrashReportDatabase::Report> reports;
+  if ((full_scan || !watched_all) &&
+      database_->GetPendingReports(&reports) == CrashReportDatabase::kNoError) {
+    AppendReportUUIDs(reports, &report_uuids);
+  }
+  reports.clear();
+  if (full_scan && database_->GetCompletedReports(&reports) ==
+                       CrashReportDatabase::kNoError) {
+    AppendReportUUIDs(reports, &report_uuids);
+  }
+
+  // A report that’s in use may still need to be compressed once it’s released.
+  // A report that was only just written is usually still locked while it’s
+  // being finished, so it’s tried again shortly. One still in use after that,
+  // such as by an upload, waits for a later pass.
+  std::vector<UUID> busy_report_uuids;
+  for (const UUID& report_uuid : report_uuids) {
+    if (!thread_.is_running()) {
+      return;
+    }
+    if (database_->CompressReport(report_uuid) ==
+        CrashReportDatabase::kBusyError) {
+      busy_report_uuids.push_back(report_uuid);
+    }
+  }
+
+  if (busy_report_uuids.empty()) {
+    return;
+  }
+  SleepNanoseconds(kBusyRetryDelayNanoseconds);
+  for (const UUID& report_uuid : busy_report_uuids) {
+    if (!thread_.is_running()) {
+      return;
+    }
+    if (database_->CompressReport(report_uuid) ==
+        CrashReportDatabase::kBusyError) {
+      retry_report_uuids_.push_back(report_uuid);
+    }
+  }
+}
+
+void CompressCrashReportThread::DoWork(const WorkerThread* thread) {
+  CompressReports();
+}
+
+void CompressCrashReportThread::PendingReportsAvailable() {
+  thread_.DoWorkNow();
+}
+
+}  // namespace crashpad
@@ -0,0 +1,104 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef CRASHPAD_HANDLER_COMPRESS_CRASH_REPORTS_THREAD_H_
+#define CRASHPAD_HANDLER_COMPRESS_CRASH_REPORTS_THREAD_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/macros.h"
+#include "client/crash_report_database.h"
+#include "util/misc/uuid.h"
+#include "util/thread/stoppable.h"
+#include "util/thread/worker_thread.h"
+
+namespace crashpad {
+
+//! \brief A thread that compresses crash reports stored in the database.
+//!
+//! Reports are compressed with CrashReportDatabase::CompressReport() soon
+//! after they become pending, whether or not they are to be uploaded, so that
+//! compression happens away from the crash path. The database must have had
+//! compressed storage enabled by
+//! CrashReportDatabase::EnableCompressedStorage().
+//!
+//! Pending and completed reports that haven’t been compressed, such as those
+//! written while compressed storage wasn’t enabled, are found by scanning the
+//! database when the thread is started and every 6 hours thereafter.
+class CompressCrashReportThread
+    : public WorkerThread::Delegate,
+      public CrashReportDatabase::PendingReportWatcher::Delegate,
+      public Stoppable {
+ public:
+  //! \brief Constructs a new object.
+  //!
+  //! \param[in] database The database to compress crash reports in.
+  explicit CompressCrashReportThread(CrashReportDatabase* database);
+  ~CompressCrashReportThread();
+
+  // Stoppable:
+
+  //! \brief Starts a dedicated compression thread.
+  //!
+  //! This method may only be be called on a newly-constructed object or after
+  //! a call to Stop().
+  void Start() override;
+
+  //! \brief Stops the compression thread.
+  //!
+  //! The thread will terminate after compressing the report that it is working
+  //! on, if any. This method blocks while waiting for the thread to terminate.
+  //!
+  //! This method must only be called after Start(). If Start() has been called,
+  //! this method must be called before destroying an object of this class.
+  //!
+  //! This method may be called from any thread other than the compression
+  //! thread. It is expected to only be called from the same thread that called
+  //! Start().
+  void Stop() override;
+
+ private:
+  // Compresses the reports reported by pending_report_watcher_ and those that
+  // were in use on an earlier pass, and scans the database for others when
+  // it’s time to.
+  void CompressReports();
+
+  // WorkerThread::Delegate:
+  void DoWork(const WorkerThread* thread) override;
+
+  // CrashReportDatabase::PendingReportWatcher::Delegate:
+  void PendingReportsAvailable() override;
+
+  // Runs CompressReports() when reports become pending, and every 15 minutes
+  // otherwise, so that reports that were in use are tried again.
+  WorkerThread thread_;
+
+  // These are only used on the compression thread, or while it isn’t running.
+  std::vector<UUID> retry_report_uuids_;
+  uint64_t next_full_scan_time_ns_;
+
+  std::unique_ptr<CrashReportDatabase::PendingReportWatcher>
+      pending_report_watcher_;
+  CrashReportDatabase* database_;  // weak
+
+  DISALLOW_COPY_AND_ASSIGN(CompressCrashReportThread);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_HANDLER_COMPRESS_CRASH_REPORTS_THREAD_H_
@@ -0,0 +1,143 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "handler/compress_crash_reports_thread.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "client/crash_report_database.h"
+#include "gtest/gtest.h"
+#include "test/scoped_temp_dir.h"
+#include "util/file/file_reader.h"
+#include "util/misc/clock.h"
+#include "util/misc/metrics.h"
+#include "util/net/http_body_gzip.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+constexpr uint64_t kNanosecondsPerSecond = static_cast<uint64_t>(1E9);
+
+class CompressCrashReportThreadTest : public testing::Test {
+ public:
+  CompressCrashReportThreadTest() : temp_dir_(), database_() {}
+
+ protected:
+  // testing::Test:
+  void SetUp() override {
+    database_ = CrashReportDatabase::Initialize(temp_dir_.path());
+    ASSERT_TRUE(database_);
+  }
+
+  CrashReportDatabase* database() { return database_.get(); }
+
+  void CreateReport(UUID* uuid) {
+    std::unique_ptr<CrashReportDatabase::NewReport> new_report;
+    ASSERT_EQ(database_->PrepareNewCrashReport(&new_report),
+              CrashReportDatabase::kNoError);
+    const std::string contents(64 * 1024, '\0');
+    ASSERT_TRUE(new_report->Writer()->Write(contents.data(), contents.size()));
+    ASSERT_EQ(
+        database_->FinishedWritingCrashReport(std::move(new_report), uuid),
+        CrashReportDatabase::kNoError);
+  }
+
+  // Returns whether the report with uuid is stored compressed. The report is
+  // found without locking it, which would make the thread under test retry it
+  // much later.
+  bool IsCompressed(const UUID& uuid) {
+    std::vector<CrashReportDatabase::Report> reports;
+    std::vector<CrashReportDatabase::Report> completed_reports;
+    if (database_->GetPendingReports(&reports) !=
+            CrashReportDatabase::kNoError ||
+        database_->GetCompletedReports(&completed_reports) !=
+            CrashReportDatabase::kNoError) {
+      return false;
+    }
+    reports.insert(
+        reports.end(), completed_reports.begin(), completed_reports.end());
+    for (const CrashReportDatabase::Report& report : reports) {
+      if (report.uuid == uuid) {
+        FileReader reader;
+        return reader.Open(report.file_path) && IsGzipPrecompressed(&reader);
+      }
+    }
+    return false;
+  }
+
+  // Waits for the report with uuid to be stored compressed.
+  bool WaitForCompressed(const UUID& uuid) {
+    const uint64_t deadline_ns =
+        ClockMonotonicNanoseconds() + 10 * kNanosecondsPerSecond;
+    do {
+      if (IsCompressed(uuid)) {
+        return true;
+      }
+      SleepNanoseconds(kNanosecondsPerSecond / 100);
+    } while (ClockMonotonicNanoseconds() < deadline_ns);
+    return false;
+  }
+
+ private:
+  ScopedTempDir temp_dir_;
+  std::unique_ptr<CrashReportDatabase> database_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompressCrashReportThreadTest);
+};
+
+TEST_F(CompressCrashReportThreadTest, CompressesReports) {
+  if (!database()->EnableCompressedStorage(6, 15)) {
+    GTEST_SKIP();
+  }
+
+  // Reports that exist when the thread starts are compressed, whether pending
+  // or completed.
+  UUID pending_uuid;
+  ASSERT_NO_FATAL_FAILURE(CreateReport(&pending_uuid));
+  UUID completed_uuid;
+  ASSERT_NO_FATAL_FAILURE(CreateReport(&completed_uuid));
+  ASSERT_EQ(database()->SkipReportUpload(
+                completed_uuid, Metrics::CrashSkippedReason::kUploadsDisabled),
+            CrashReportDatabase::kNoError);
+  EXPECT_FALSE(IsCompressed(pending_uuid));
+  EXPECT_FALSE(IsCompressed(completed_uuid));
+
+  CompressCrashReportThread thread(database());
+  thread.Start();
+  EXPECT_TRUE(WaitForCompressed(pending_uuid));
+  EXPECT_TRUE(WaitForCompressed(completed_uuid));
+
+  // So are reports that become pending while it’s running.
+  UUID new_uuid;
+  ASSERT_NO_FATAL_FAILURE(CreateReport(&new_uuid));
+  EXPECT_TRUE(WaitForCompressed(new_uuid));
+  thread.Stop();
+
+  std::vector<CrashReportDatabase::Report> reports;
+  ASSERT_EQ(database()->GetPendingReports(&reports),
+            CrashReportDatabase::kNoError);
+  EXPECT_EQ(reports.size(), 2u);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
@@ -18,8 +18,11 @@
 #include <time.h>
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "base/logging.h"
@@ -32,13 +35,16 @@
 #include "snapshot/minidump/process_snapshot_minidump.h"
 #include "snapshot/module_snapshot.h"
 #include "util/file/file_reader.h"
+#include "util/misc/clock.h"
 #include "util/misc/metrics.h"
 #include "util/misc/uuid.h"
 #include "util/net/http_body.h"
+#include "util/net/http_body_bandwidth_limited.h"
 #include "util/net/http_multipart_builder.h"
 #include "util/net/http_transport.h"
 #include "util/net/url.h"
 #include "util/stdlib/map_insert.h"
+#include "util/thread/thread.h"
 
 #if defined(OS_MACOSX)
 #include "handler/mac/file_limit_annotation.h"
@@ -46,6 +52,45 @@
 
 namespace crashpad {
 
+namespace {
+
+// When new pending reports are reported by a PendingReportWatcher, the database
+// only needs to be scanned in full to retry reports that couldn’t be processed
+// earlier, and in case the watcher misses a report without noticing.
+constexpr uint64_t kFullScanIntervalNanoseconds =
+    uint64_t{6} * 60 * 60 * 1000000000;  // 6 hours
+
+// The number of times an upload may be attempted for a report before it’s
+// given up on.
+constexpr int kMaxUploadAttempts = 3;
+
+// Returns the time to wait after a report’s most recent failed upload attempt
+// before trying again. The delay doubles with each attempt. upload_attempts
+// must be at least 1.
+time_t RetryDelaySeconds(int upload_attempts) {
+  constexpr time_t kFirstRetryDelaySeconds = 60 * 60;  // 1 hour
+  return kFirstRetryDelaySeconds
+         << (std::min(upload_attempts, kMaxUploadAttempts) - 1);
+}
+
+// Calls a function on a new thread.
+class ReportProcessorThread final : public Thread {
+ public:
+  explicit ReportProcessorThread(const std::function<void()>& function)
+      : Thread(), function_(function) {}
+  ~ReportProcessorThread() override {}
+
+ private:
+  // Thread:
+  void ThreadMain() override { function_(); }
+
+  std::function<void()> function_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReportProcessorThread);
+};
+
+}  // namespace
+
 CrashReportUploadThread::CrashReportUploadThread(CrashReportDatabase* database,
                                                  const std::string& url,
                                                  const Options& options)
@@ -59,6 +104,14 @@ CrashReportUploadThread::CrashReportUploadThread(CrashReportDatabase* database,
                                             : WorkerThread::kIndefiniteWait,
               this),
       known_pending_report_uuids_(),
+      retry_report_uuids_(),
+      pending_report_watcher_(),
+      next_full_scan_time_ns_(0),
+      bandwidth_limiter_(options.upload_bandwidth_limit
+                             ? std::make_unique<BandwidthLimiter>(
+                                   options.upload_bandwidth_limit)
+                             : nullptr),
+      upload_start_lock_(),
       database_(database) {
   DCHECK(!url_.empty());
 }
@@ -72,36 +125,85 @@ void CrashReportUploadThread::ReportPending(const UUID& report_uuid) {
 }
 
 void CrashReportUploadThread::Start() {
+  if (options_.watch_pending_reports) {
+    // The watcher is obtained before the initial scan so that reports added
+    // after the scan can’t be missed. It can only call DoWorkNow() once the
+    // thread is running.
+    pending_report_watcher_ = database_->WatchPendingReports();
+    next_full_scan_time_ns_ = 0;
+  }
+
   thread_.Start(
       options_.watch_pending_reports ? 0.0 : WorkerThread::kIndefiniteWait);
+
+  if (pending_report_watcher_) {
+    pending_report_watcher_->Start(this);
+  }
 }
 
 void CrashReportUploadThread::Stop() {
+  if (pending_report_watcher_) {
+    pending_report_watcher_->Stop();
+  }
   thread_.Stop();
+  pending_report_watcher_.reset();
 }
 
 void CrashReportUploadThread::ProcessPendingReports() {
   std::vector<UUID> known_report_uuids = known_pending_report_uuids_.Drain();
-  for (const UUID& report_uuid : known_report_uuids) {
-    CrashReportDatabase::Report report;
-    if (database_->LookUpCrashReport(report_uuid, &report) !=
-        CrashReportDatabase::kNoError) {
-      continue;
+
+  bool full_scan = options_.watch_pending_reports;
+  if (pending_report_watcher_) {
+    // Every report added by ReportPending() is also reported by the watcher,
+    // so only the watcher’s reports are used, to avoid processing reports
+    // twice.
+    known_report_uuids.clear();
+    const bool watched_all =
+        pending_report_watcher_->TakePendingReports(&known_report_uuids);
+
+    const uint64_t now_ns = ClockMonotonicNanoseconds();
+    full_scan = !watched_all || now_ns >= next_full_scan_time_ns_;
+    if (full_scan) {
+      next_full_scan_time_ns_ = now_ns + kFullScanIntervalNanoseconds;
     }
+  }
 
-    ProcessPendingReport(report);
+  for (const UUID& report_uuid : retry_report_uuids_.Drain()) {
+    if (std::find(known_report_uuids.begin(),
+                  known_report_uuids.end(),
+                  report_uuid) == known_report_uuids.end()) {
+      known_report_uuids.push_back(report_uuid);
+    }
+  }
 
-    // Respect Stop() being called after at least one attempt to process a
-    // report.
-    if (!thread_.is_running()) {
-      return;
+  std::vector<CrashReportDatabase::Report> known_reports;
+  for (const UUID& report_uuid : known_report_uuids) {
+    CrashReportDatabase::Report report;
+    switch (database_->LookUpCrashReport(report_uuid, &report)) {
+      case CrashReportDatabase::kNoError:
+        known_reports.push_back(report);
+        break;
+
+      case CrashReportDatabase::kBusyError:
+        // The report may be briefly locked while it’s compressed in the
+        // background. Look at it again on the next pass.
+        retry_report_uuids_.PushBack(report_uuid);
+        break;
+
+      default:
+        break;
     }
   }
 
+  ProcessPendingReportList(known_reports);
+  if (!thread_.is_running()) {
+    return;
+  }
+
   // Known pending reports are always processed (above). The rest of this
   // function is concerned with scanning for pending reports not already known
   // to this thread.
-  if (!options_.watch_pending_reports) {
+  if (!full_scan) {
     return;
   }
 
@@ -114,30 +216,66 @@ void CrashReportUploadThread::ProcessPendingReports() {
     return;
   }
 
-  for (const CrashReportDatabase::Report& report : reports) {
-    if (std::find(known_report_uuids.begin(),
-                  known_report_uuids.end(),
-                  report.uuid) != known_report_uuids.end()) {
-      // An attempt to process the report already occurred above. The report is
-      // still pending, so upload must have failed. Don’t retry it immediately,
-      // it can wait until at least the next pass through this method.
-      continue;
+  // An attempt to process the known reports already occurred above. Any that
+  // are still pending are waiting to be retried, and don’t need to be
+  // processed again until at least the next pass through this method.
+  reports.erase(
+      std::remove_if(reports.begin(),
+                     reports.end(),
+                     [&known_report_uuids](
+                         const CrashReportDatabase::Report& report) {
+                       return std::find(known_report_uuids.begin(),
+                                        known_report_uuids.end(),
+                                        report.uuid) !=
+                              known_report_uuids.end();
+                     }),
+      reports.end());
+
+  ProcessPendingReportList(reports);
+}
+
+void CrashReportUploadThread::ProcessPendingReportList(
+    const std::vector<CrashReportDatabase::Report>& reports) {
+  // Reports are taken in order by this thread and by up to
+  // upload_concurrency - 1 additional threads that exist for the duration of
+  // this call.
+  std::atomic<size_t> next_index(0);
+  auto process_reports = [this, &reports, &next_index]() {
+    for (size_t index = next_index++; index < reports.size();
+         index = next_index++) {
+      ProcessPendingReport(reports[index]);
+
+      // Respect Stop() being called after at least one attempt to process a
+      // report.
+      if (!thread_.is_running()) {
+        return;
+      }
     }
+  };
+
+  const size_t thread_count =
+      std::min(reports.size(),
+               static_cast<size_t>(std::max(options_.upload_concurrency, 1u)));
+  std::vector<std::unique_ptr<ReportProcessorThread>> threads;
+  for (size_t index = 1; index < thread_count; ++index) {
+    threads.push_back(std::make_unique<ReportProcessorThread>(process_reports));
+    threads.back()->Start();
+  }
 
-    ProcessPendingReport(report);
+  process_reports();
 
-    // Respect Stop() being called after at least one attempt to process a
-    // report.
-    if (!thread_.is_running()) {
-      return;
-    }
+  for (const auto& thread : threads) {
+    thread->Join();
   }
 }
 
 void CrashReportUploadThread::ProcessPendingReport(
     const CrashReportDatabase::Report& report) {
 #if defined(OS_MACOSX)
-  RecordFileLimitAnnotation();
+  {
+    base::AutoLock lock_owner(upload_start_lock_);
+    RecordFileLimitAnnotation();
+  }
 #endif  // OS_MACOSX
 
   Settings* const settings = database_->GetSettings();
@@ -153,58 +291,63 @@ void CrashReportUploadThread::ProcessPendingReport(
     return;
   }
 
-  // This currently implements very simplistic rate-limiting, compatible with
-  // the Breakpad client, where the strategy is to permit one upload attempt per
-  // hour, and retire reports that would exceed this limit or for which the
-  // upload fails on the first attempt.
-  //
-  // If upload was requested explicitly (i.e. by user action), we do not
-  // throttle the upload.
-  //
-  // TODO(mark): Provide a proper rate-limiting strategy and allow for failed
-  // upload attempts to be retried.
-  if (!report.upload_explicitly_requested && options_.rate_limit) {
-    time_t last_upload_attempt_time;
-    if (settings->GetLastUploadAttemptTime(&last_upload_attempt_time)) {
-      time_t now = time(nullptr);
-      if (now >= last_upload_attempt_time) {
-        // If the most recent upload attempt occurred within the past hour,
-        // don’t attempt to upload the new report. If it happened longer ago,
-        // attempt to upload the report.
-        constexpr int kUploadAttemptIntervalSeconds = 60 * 60;  // 1 hour
-        if (now - last_upload_attempt_time < kUploadAttemptIntervalSeconds) {
-          database_->SkipReportUpload(
-              report.uuid, Metrics::CrashSkippedReason::kUploadThrottled);
-          return;
-        }
-      } else {
-        // The most recent upload attempt purportedly occurred in the future. If
-        // it “happened” at least one day in the future, assume that the last
-        // upload attempt time is bogus, and attempt to upload the report. If
-        // the most recent upload time is in the future but within one day,
-        // accept it and don’t attempt to upload the report.
-        constexpr int kBackwardsClockTolerance = 60 * 60 * 24;  // 1 day
-        if (last_upload_attempt_time - now < kBackwardsClockTolerance) {
-          database_->SkipReportUpload(
-              report.uuid, Metrics::CrashSkippedReason::kUnexpectedTime);
-          return;
-        }
-      }
+  if (options_.retry_failed_uploads && !report.upload_explicitly_requested &&
+      report.upload_attempts > 0) {
+    // A previous upload attempt failed. Leave the report pending until it’s
+    // time to try again.
+    const time_t retry_time = report.last_upload_attempt_time +
+                              RetryDelaySeconds(report.upload_attempts);
+    if (time(nullptr) < retry_time) {
+      retry_report_uuids_.PushBack(report.uuid);
+      return;
     }
   }
 
   std::unique_ptr<const CrashReportDatabase::UploadReport> upload_report;
-  CrashReportDatabase::OperationStatus status =
-      database_->GetReportForUploading(report.uuid, &upload_report);
+  CrashReportDatabase::OperationStatus status;
+  {
+    // When several reports are being processed at once, checking the rate
+    // limit and starting an upload must happen together, so that the limit
+    // applies to all of them.
+    base::AutoLock lock_owner(upload_start_lock_);
+    if (SkipReportIfRateLimited(report)) {
+      return;
+    }
+
+    status =
+        database_->CheckOutReportForUploading(report.uuid, &upload_report);
+    if (status == CrashReportDatabase::kNoError &&
+        !report.upload_explicitly_requested && options_.rate_limit) {
+      // Claim this upload attempt for the purposes of the rate limit now,
+      // rather than when the upload completes.
+      settings->SetLastUploadAttemptTime(time(nullptr));
+    }
+  }
+
+  // Compressing the report can take a while, so it’s done once the lock is
+  // released, allowing other reports to be compressed at the same time.
+  if (status == CrashReportDatabase::kNoError) {
+    status = database_->PrepareReportForUploading(upload_report.get());
+    if (status != CrashReportDatabase::kNoError) {
+      upload_report.reset();
+    }
+  }
+
   switch (status) {
     case CrashReportDatabase::kNoError:
       break;
 
     case CrashReportDatabase::kBusyError:
+      // Someone else may have gotten to it first, or it may be locked while
+      // it’s compressed in the background. If this thread is watching for
+      // pending reports, look at it again on a later pass.
+      if (options_.watch_pending_reports) {
+        retry_report_uuids_.PushBack(report.uuid);
+      }
+      return;
+
     case CrashReportDatabase::kReportNotFound:
-      // Someone else may have gotten to it first. If they’re working on it now,
-      // this will be kBusyError. If they’ve already finished with it, it’ll be
-      // kReportNotFound.
+      // Someone else already finished with it.
       return;
 
     case CrashReportDatabase::kFileSystemError:
@@ -233,17 +376,67 @@ void CrashReportUploadThread::ProcessPendingReport(
           report.uuid, Metrics::CrashSkippedReason::kPrepareForUploadFailed);
       break;
     case UploadResult::kRetry:
+      // Releasing upload_report records the failed attempt.
       upload_report.reset();
 
-      // TODO(mark): Deal with retries properly: don’t call SkipReportUplaod()
-      // if the result was kRetry and the report hasn’t already been retried
-      // too many times.
-      database_->SkipReportUpload(report.uuid,
-                                  Metrics::CrashSkippedReason::kUploadFailed);
+      // Reports are only retried when that’s been asked for and this thread
+      // will be around to do so on a later pass.
+      if (options_.retry_failed_uploads && options_.watch_pending_reports &&
+          report.upload_attempts + 1 < kMaxUploadAttempts) {
+        retry_report_uuids_.PushBack(report.uuid);
+      } else {
+        database_->SkipReportUpload(report.uuid,
+                                    Metrics::CrashSkippedReason::kUploadFailed);
+      }
       break;
   }
 }
 
+bool CrashReportUploadThread::SkipReportIfRateLimited(
+    const CrashReportDatabase::Report& report) {
+  // This currently implements very simplistic rate-limiting, compatible with
+  // the Breakpad client, where the strategy is to permit one upload attempt per
+  // hour, and retire reports that would exceed this limit. A report whose
+  // upload fails may be retried, but each retry counts toward the limit too.
+  //
+  // If upload was requested explicitly (i.e. by user action), we do not
+  // throttle the upload.
+  //
+  // TODO(mark): Provide a proper rate-limiting strategy.
+  if (!report.upload_explicitly_requested && options_.rate_limit) {
+    Settings* const settings = database_->GetSettings();
+    time_t last_upload_attempt_time;
+    if (settings->GetLastUploadAttemptTime(&last_upload_attempt_time)) {
+      time_t now = time(nullptr);
+      if (now >= last_upload_attempt_time) {
+        // If the most recent upload attempt occurred within the past hour,
+        // don’t attempt to upload the new report. If it happened longer ago,
+        // attempt to upload the report.
+        constexpr int kUploadAttemptIntervalSeconds = 60 * 60;  // 1 hour
+        if (now - last_upload_attempt_time < kUploadAttemptIntervalSeconds) {
+          database_->SkipReportUpload(
+              report.uuid, Metrics::CrashSkippedReason::kUploadThrottled);
+          return true;
+        }
+      } else {
+        // The most recent upload attempt purportedly occurred in the future. If
+        // it “happened” at least one day in the future, assume that the last
+        // upload attempt time is bogus, and attempt to upload the report. If
+        // the most recent upload time is in the future but within one day,
+        // accept it and don’t attempt to upload the report.
+        constexpr int kBackwardsClockTolerance = 60 * 60 * 24;  // 1 day
+        if (last_upload_attempt_time - now < kBackwardsClockTolerance) {
+          database_->SkipReportUpload(
+              report.uuid, Metrics::CrashSkippedReason::kUnexpectedTime);
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
 CrashReportUploadThread::UploadResult CrashReportUploadThread::UploadReport(
     const CrashReportDatabase::UploadReport* report,
     std::string* response_body) {
@@ -260,7 +453,16 @@ CrashReportUploadThread::UploadResult CrashReportUploadThread::UploadReport(
   // parameters, but as long as there’s a dump file, the server can decide what
   // to do with it.
   ProcessSnapshotMinidump minidump_process_snapshot;
-  if (minidump_process_snapshot.Initialize(reader)) {
+#if defined(OS_POSIX)
+  // Only annotations and module information are needed, so map the minidump
+  // rather than reading all of it.
+  const bool minidump_initialized =
+      minidump_process_snapshot.InitializeMapped(reader->file_handle());
+#else
+  const bool minidump_initialized =
+      minidump_process_snapshot.Initialize(reader);
+#endif  // OS_POSIX
+  if (minidump_initialized) {
     parameters =
         BreakpadHTTPFormParametersFromMinidump(&minidump_process_snapshot);
   }
@@ -271,6 +473,8 @@ CrashReportUploadThread::UploadResult CrashReportUploadThread::UploadReport(
 
   HTTPMultipartBuilder http_multipart_builder;
   http_multipart_builder.SetGzipEnabled(options_.upload_gzip);
+  http_multipart_builder.SetGzipCompression(options_.upload_gzip_level,
+                                            options_.upload_gzip_window_bits);
 
   static constexpr char kMinidumpKey[] = "upload_file_minidump";
 
@@ -293,13 +497,29 @@ CrashReportUploadThread::UploadResult CrashReportUploadThread::UploadReport(
                                            reader,
                                            "application/octet-stream");
 
+  // A copy compressed when the report was written covers the whole report, so
+  // it can only stand in for the report when the upload starts at its
+  // beginning.
+  FileReader* precompressed_reader = report->PrecompressedReader();
+  if (options_.upload_gzip && precompressed_reader && start_offset == 0 &&
+      precompressed_reader->SeekSet(0)) {
+    http_multipart_builder.SetPrecompressedFileAttachment(kMinidumpKey,
+                                                          precompressed_reader);
+  }
+
   std::unique_ptr<HTTPTransport> http_transport(HTTPTransport::Create());
   HTTPHeaders content_headers;
   http_multipart_builder.PopulateContentHeaders(&content_headers);
   for (const auto& content_header : content_headers) {
     http_transport->SetHeader(content_header.first, content_header.second);
   }
-  http_transport->SetBodyStream(http_multipart_builder.GetBodyStream());
+  std::unique_ptr<HTTPBodyStream> body_stream =
+      http_multipart_builder.GetBodyStream();
+  if (bandwidth_limiter_) {
+    body_stream = std::make_unique<BandwidthLimitedHTTPBodyStream>(
+        std::move(body_stream), bandwidth_limiter_.get());
+  }
+  http_transport->SetBodyStream(std::move(body_stream));
   // TODO(mark): The timeout should be configurable by the client.
   http_transport->SetTimeout(60.0);  // 1 minute.
 
@@ -339,4 +559,8 @@ void CrashReportUploadThread::DoWork(const WorkerThread* thread) {
   ProcessPendingReports();
 }
 
+void CrashReportUploadThread::PendingReportsAvailable() {
+  thread_.DoWorkNow();
+}
+
 }  // namespace crashpad
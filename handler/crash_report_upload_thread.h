@@ -15,12 +15,18 @@
 #ifndef CRASHPAD_HANDLER_CRASH_REPORT_UPLOAD_THREAD_H_
 #define CRASHPAD_HANDLER_CRASH_REPORT_UPLOAD_THREAD_H_
 
+#include <stdint.h>
+
 #include <memory>
 #include <string>
 
+#include <vector>
+
 #include "base/macros.h"
+#include "base/synchronization/lock.h"
 #include "client/crash_report_database.h"
 #include "util/misc/uuid.h"
+#include "util/net/http_body_bandwidth_limited.h"
 #include "util/stdlib/thread_safe_vector.h"
 #include "util/thread/stoppable.h"
 #include "util/thread/worker_thread.h"
@@ -40,8 +46,20 @@ namespace crashpad {
 //! It also catches reports that are added without a ReportPending() signal
 //! being caught. This may happen if crash reports are added to the database by
 //! other processes.
-class CrashReportUploadThread : public WorkerThread::Delegate,
-                                public Stoppable {
+//!
+//! Where the database supports CrashReportDatabase::WatchPendingReports(),
+//! objects of this class learn of new pending reports, including those added by
+//! other processes, as soon as they are added. The database is then only
+//! scanned in full occasionally, as a safety net.
+//!
+//! Several reports may be uploaded at once, each on its own thread. When
+//! Options::retry_failed_uploads is set, a report whose upload fails in a way
+//! that might not recur is left pending and retried later, a limited number of
+//! times. Otherwise, it’s retired.
+class CrashReportUploadThread
+    : public WorkerThread::Delegate,
+      public CrashReportDatabase::PendingReportWatcher::Delegate,
+      public Stoppable {
  public:
    //! \brief Options to be passed to the CrashReportUploadThread constructor.
    struct Options {
@@ -55,11 +73,35 @@ class CrashReportUploadThread : public WorkerThread::Delegate,
     //! Whether uploads should use `gzip` compression.
     bool upload_gzip;
 
+    //! The `zlib` compression level to use when \a upload_gzip is set, from
+    //! `0` to `9`, or GzipHTTPBodyStream::kDefaultLevel.
+    int upload_gzip_level;
+
+    //! The base-2 logarithm of the `zlib` window size to use when \a
+    //! upload_gzip is set, from `9` to `15`.
+    int upload_gzip_window_bits;
+
     //! Whether to periodically check for new pending reports not already known
     //! to exist. When `false`, only an initial upload attempt will be made for
     //! reports known to exist by having been added by the ReportPending()
-    //! method. No scans for new pending reports will be conducted.
+    //! method. No scans for new pending reports will be conducted, and failed
+    //! uploads will not be retried.
     bool watch_pending_reports;
+
+    //! Whether a report whose upload fails in a way that might not recur should
+    //! be left pending and retried later, a limited number of times. When
+    //! `false`, a report whose upload fails is retired. Failed uploads are
+    //! only retried when \a watch_pending_reports is also set.
+    bool retry_failed_uploads;
+
+    //! The maximum number of reports to upload at the same time. `0` is
+    //! treated as `1`.
+    unsigned int upload_concurrency;
+
+    //! The maximum combined rate, in bytes per second, at which report data is
+    //! sent to the server by all uploads. `0` means that the rate is not
+    //! limited.
+    uint64_t upload_bandwidth_limit;
   };
 
   //! \brief Constructs a new object.
@@ -128,11 +170,22 @@ class CrashReportUploadThread : public WorkerThread::Delegate,
   //!
   //! Assuming Stop() has not been called, this will process reports that the
   //! object has been made aware of in ReportPending(). Additionally, if the
-  //! object was constructed with \a watch_pending_reports, it will also scan
-  //! the crash report database for other pending reports, and process those as
-  //! well.
+  //! object was constructed with \a watch_pending_reports, it will also
+  //! process reports reported by #pending_report_watcher_ and scan the crash
+  //! report database for other pending reports, and process those as well.
+  //! When #pending_report_watcher_ is available, the database is only scanned
+  //! if the watcher may have missed reports or if it hasn’t been scanned
+  //! recently.
   void ProcessPendingReports();
 
+  //! \brief Calls ProcessPendingReport() on each of \a reports, using up to
+  //!     Options::upload_concurrency threads.
+  //!
+  //! This method returns when every report has been processed, or sooner if
+  //! Stop() has been called.
+  void ProcessPendingReportList(
+      const std::vector<CrashReportDatabase::Report>& reports);
+
   //! \brief Processes a single pending report from the database.
   //!
   //! \param[in] report The crash report to process.
@@ -145,8 +198,17 @@ class CrashReportUploadThread : public WorkerThread::Delegate,
   //! remain in the “pending” state. If the upload fails and no more retries are
   //! desired, or report upload is disabled, it will be marked as “completed” in
   //! the database without ever having been uploaded.
+  //!
+  //! This method may be called on several threads at once.
   void ProcessPendingReport(const CrashReportDatabase::Report& report);
 
+  //! \brief Marks \a report as “completed” without uploading it if uploading
+  //!     it now would exceed the upload rate limit.
+  //!
+  //! \return `true` if the report was marked as “completed”, `false` if it may
+  //!     be uploaded.
+  bool SkipReportIfRateLimited(const CrashReportDatabase::Report& report);
+
   //! \brief Attempts to upload a crash report.
   //!
   //! \param[in] report The report to upload. The caller is responsible for
@@ -167,10 +229,24 @@ class CrashReportUploadThread : public WorkerThread::Delegate,
   //!     been called on any thread, as well as periodically on a timer.
   void DoWork(const WorkerThread* thread) override;
 
+  // CrashReportDatabase::PendingReportWatcher::Delegate:
+  //! \brief Calls ProcessPendingReports() in response to reports becoming
+  //!     pending in the database.
+  void PendingReportsAvailable() override;
+
   const Options options_;
   const std::string url_;
   WorkerThread thread_;
   ThreadSafeVector<UUID> known_pending_report_uuids_;
+  ThreadSafeVector<UUID> retry_report_uuids_;
+  std::unique_ptr<CrashReportDatabase::PendingReportWatcher>
+      pending_report_watcher_;
+  uint64_t next_full_scan_time_ns_;
+  std::unique_ptr<BandwidthLimiter> bandwidth_limiter_;
+
+  // Held while deciding whether to start an upload and starting it.
+  base::Lock upload_start_lock_;
+
   CrashReportDatabase* database_;  // weak
 
   DISALLOW_COPY_AND_ASSIGN(CrashReportUploadThread);
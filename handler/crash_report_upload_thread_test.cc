@@ -0,0 +1,352 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "handler/crash_report_upload_thread.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+#include "build/build_config.h"
+#include "client/settings.h"
+#include "gtest/gtest.h"
+#include "test/scoped_temp_dir.h"
+#include "util/misc/clock.h"
+#include "util/net/http_body_gzip.h"
+#include "util/thread/thread.h"
+
+#if COMPILER_MSVC
+#pragma warning(push)
+#pragma warning(disable: 4244 4245 4267 4702)
+#endif
+
+#include "third_party/cpp-httplib/cpp-httplib/httplib.h"
+
+#if COMPILER_MSVC
+#pragma warning(pop)
+#endif
+
+namespace crashpad {
+namespace test {
+namespace {
+
+constexpr uint64_t kNanosecondsPerSecond = 1000000000;
+
+// A stand-in for a crash report collection server, which responds to each
+// upload with a fixed status code after a fixed delay.
+//
+// Each upload is also held until concurrency_target uploads have been in
+// progress at once, or for 10 seconds, so that the uploader’s concurrency can
+// be observed without depending on timing.
+class TestUploadServer final : public Thread {
+ public:
+  TestUploadServer(int status,
+                   uint64_t latency_ns,
+                   size_t concurrency_target = 1)
+      : Thread(),
+        server_(),
+        lock_(),
+        condition_(),
+        status_(status),
+        latency_ns_(latency_ns),
+        concurrency_target_(concurrency_target),
+        port_(0),
+        uploads_(0),
+        uploads_in_progress_(0),
+        max_uploads_in_progress_(0) {
+    // Stopping the server waits for idle kept-alive connections to time out,
+    // so have the uploader close each connection after its upload.
+    server_.set_keep_alive_max_count(1);
+    server_.Post("/upload",
+                 [this](const httplib::Request& request,
+                        httplib::Response& response) {
+                   HandleUpload(&response);
+                 });
+  }
+
+  ~TestUploadServer() override {}
+
+  bool StartServer() {
+    port_ = server_.bind_to_any_port("127.0.0.1");
+    if (port_ <= 0) {
+      LOG(ERROR) << "bind_to_any_port";
+      return false;
+    }
+    Start();
+    return true;
+  }
+
+  void StopServer() {
+    server_.stop();
+    Join();
+  }
+
+  std::string URL() const {
+    return base::StringPrintf("http://127.0.0.1:%d/upload", port_);
+  }
+
+  size_t Uploads() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return uploads_;
+  }
+
+  size_t MaxUploadsInProgress() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return max_uploads_in_progress_;
+  }
+
+ private:
+  // Thread:
+  void ThreadMain() override { server_.listen_after_bind(); }
+
+  void HandleUpload(httplib::Response* response) {
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      ++uploads_in_progress_;
+      max_uploads_in_progress_ =
+          std::max(max_uploads_in_progress_, uploads_in_progress_);
+      condition_.notify_all();
+      condition_.wait_for(lock, std::chrono::seconds(10), [this] {
+        return max_uploads_in_progress_ >= concurrency_target_;
+      });
+    }
+
+    SleepNanoseconds(latency_ns_);
+
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      --uploads_in_progress_;
+      ++uploads_;
+    }
+
+    response->status = status_;
+    response->set_content("id", "text/plain");
+  }
+
+  httplib::Server server_;
+  std::mutex lock_;
+  std::condition_variable condition_;
+  const int status_;
+  const uint64_t latency_ns_;
+  const size_t concurrency_target_;
+  int port_;
+
+  // These are guarded by lock_.
+  size_t uploads_;
+  size_t uploads_in_progress_;
+  size_t max_uploads_in_progress_;
+
+  DISALLOW_COPY_AND_ASSIGN(TestUploadServer);
+};
+
+class CrashReportUploadThreadTest : public testing::Test {
+ public:
+  CrashReportUploadThreadTest() : temp_dir_(), database_() {}
+
+ protected:
+  // testing::Test:
+  void SetUp() override {
+    database_ = CrashReportDatabase::Initialize(temp_dir_.path());
+    ASSERT_TRUE(database_);
+    ASSERT_TRUE(database_->GetSettings()->SetUploadsEnabled(true));
+  }
+
+  CrashReportDatabase* database() { return database_.get(); }
+
+  void CreatePendingReports(size_t count) {
+    for (size_t index = 0; index < count; ++index) {
+      std::unique_ptr<CrashReportDatabase::NewReport> new_report;
+      ASSERT_EQ(database_->PrepareNewCrashReport(&new_report),
+                CrashReportDatabase::kNoError);
+      static constexpr char kTest[] = "test";
+      ASSERT_TRUE(new_report->Writer()->Write(kTest, sizeof(kTest)));
+      UUID uuid;
+      ASSERT_EQ(
+          database_->FinishedWritingCrashReport(std::move(new_report), &uuid),
+          CrashReportDatabase::kNoError);
+    }
+  }
+
+  // Waits for there to be count completed reports, returning them.
+  std::vector<CrashReportDatabase::Report> WaitForCompletedReports(
+      size_t count) {
+    const uint64_t deadline_ns =
+        ClockMonotonicNanoseconds() + 10 * kNanosecondsPerSecond;
+    std::vector<CrashReportDatabase::Report> reports;
+    do {
+      reports.clear();
+      EXPECT_EQ(database_->GetCompletedReports(&reports),
+                CrashReportDatabase::kNoError);
+      if (reports.size() >= count) {
+        break;
+      }
+      SleepNanoseconds(kNanosecondsPerSecond / 100);
+    } while (ClockMonotonicNanoseconds() < deadline_ns);
+    return reports;
+  }
+
+  static CrashReportUploadThread::Options UploadOptions(
+      unsigned int upload_concurrency,
+      bool rate_limit,
+      bool retry_failed_uploads = false) {
+    CrashReportUploadThread::Options options;
+    options.identify_client_via_url = false;
+    options.rate_limit = rate_limit;
+    options.upload_gzip = false;
+    options.upload_gzip_level = GzipHTTPBodyStream::kDefaultLevel;
+    options.upload_gzip_window_bits = GzipHTTPBodyStream::kDefaultWindowBits;
+    options.watch_pending_reports = true;
+    options.retry_failed_uploads = retry_failed_uploads;
+    options.upload_concurrency = upload_concurrency;
+    options.upload_bandwidth_limit = 0;
+    return options;
+  }
+
+ private:
+  ScopedTempDir temp_dir_;
+  std::unique_ptr<CrashReportDatabase> database_;
+
+  DISALLOW_COPY_AND_ASSIGN(CrashReportUploadThreadTest);
+};
+
+TEST_F(CrashReportUploadThreadTest, ConcurrentUploads) {
+  constexpr size_t kReportCount = 8;
+  constexpr unsigned int kUploadConcurrency = 4;
+
+  ASSERT_NO_FATAL_FAILURE(CreatePendingReports(kReportCount));
+
+  TestUploadServer server(200, 0, kUploadConcurrency);
+  ASSERT_TRUE(server.StartServer());
+
+  CrashReportUploadThread upload_thread(
+      database(), server.URL(), UploadOptions(kUploadConcurrency, false));
+  upload_thread.Start();
+  std::vector<CrashReportDatabase::Report> reports =
+      WaitForCompletedReports(kReportCount);
+  upload_thread.Stop();
+  server.StopServer();
+
+  ASSERT_EQ(reports.size(), kReportCount);
+  for (const CrashReportDatabase::Report& report : reports) {
+    EXPECT_TRUE(report.uploaded);
+    EXPECT_EQ(report.id, "id");
+    EXPECT_EQ(report.upload_attempts, 1);
+  }
+  EXPECT_EQ(server.Uploads(), kReportCount);
+  EXPECT_EQ(server.MaxUploadsInProgress(), kUploadConcurrency);
+}
+
+TEST_F(CrashReportUploadThreadTest, RateLimitAppliesToConcurrentUploads) {
+  constexpr size_t kReportCount = 4;
+
+  ASSERT_NO_FATAL_FAILURE(CreatePendingReports(kReportCount));
+
+  TestUploadServer server(200, kNanosecondsPerSecond / 10);
+  ASSERT_TRUE(server.StartServer());
+
+  CrashReportUploadThread upload_thread(
+      database(), server.URL(), UploadOptions(kReportCount, true));
+  upload_thread.Start();
+  std::vector<CrashReportDatabase::Report> reports =
+      WaitForCompletedReports(kReportCount);
+  upload_thread.Stop();
+  server.StopServer();
+
+  // Only one upload is permitted per hour. The other reports are skipped.
+  ASSERT_EQ(reports.size(), kReportCount);
+  EXPECT_EQ(std::count_if(reports.begin(),
+                          reports.end(),
+                          [](const CrashReportDatabase::Report& report) {
+                            return report.uploaded;
+                          }),
+            1);
+  EXPECT_EQ(server.Uploads(), 1u);
+}
+
+TEST_F(CrashReportUploadThreadTest, FailedUploadIsRetiredByDefault) {
+  ASSERT_NO_FATAL_FAILURE(CreatePendingReports(1));
+
+  TestUploadServer server(500, 0);
+  ASSERT_TRUE(server.StartServer());
+
+  CrashReportUploadThread upload_thread(
+      database(), server.URL(), UploadOptions(1, false));
+  upload_thread.Start();
+  std::vector<CrashReportDatabase::Report> reports =
+      WaitForCompletedReports(1);
+  upload_thread.Stop();
+  server.StopServer();
+
+  EXPECT_EQ(server.Uploads(), 1u);
+  ASSERT_EQ(reports.size(), 1u);
+  EXPECT_FALSE(reports[0].uploaded);
+  EXPECT_EQ(reports[0].upload_attempts, 1);
+
+  reports.clear();
+  ASSERT_EQ(database()->GetPendingReports(&reports),
+            CrashReportDatabase::kNoError);
+  EXPECT_TRUE(reports.empty());
+}
+
+TEST_F(CrashReportUploadThreadTest, FailedUploadIsRetried) {
+  ASSERT_NO_FATAL_FAILURE(CreatePendingReports(1));
+
+  TestUploadServer server(500, 0);
+  ASSERT_TRUE(server.StartServer());
+
+  CrashReportUploadThread upload_thread(
+      database(),
+      server.URL(),
+      UploadOptions(1, false, /* retry_failed_uploads= */ true));
+  upload_thread.Start();
+
+  // The failed attempt is recorded when the upload thread is done with the
+  // report.
+  const uint64_t deadline_ns =
+      ClockMonotonicNanoseconds() + 10 * kNanosecondsPerSecond;
+  std::vector<CrashReportDatabase::Report> reports;
+  do {
+    SleepNanoseconds(kNanosecondsPerSecond / 100);
+    reports.clear();
+    ASSERT_EQ(database()->GetPendingReports(&reports),
+              CrashReportDatabase::kNoError);
+  } while ((reports.empty() || reports[0].upload_attempts == 0) &&
+           ClockMonotonicNanoseconds() < deadline_ns);
+  upload_thread.Stop();
+  server.StopServer();
+
+  // The report remains pending, to be retried later.
+  EXPECT_EQ(server.Uploads(), 1u);
+  ASSERT_EQ(reports.size(), 1u);
+  EXPECT_FALSE(reports[0].uploaded);
+  EXPECT_EQ(reports[0].upload_attempts, 1);
+
+  reports.clear();
+  ASSERT_EQ(database()->GetCompletedReports(&reports),
+            CrashReportDatabase::kNoError);
+  EXPECT_TRUE(reports.empty());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
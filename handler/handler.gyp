@@ -36,6 +36,8 @@
         '..',
       ],
       'sources': [
+        'compress_crash_reports_thread.cc',
+        'compress_crash_reports_thread.h',
         'crash_report_upload_thread.cc',
         'crash_report_upload_thread.h',
         'handler_main.cc',
@@ -43,6 +43,7 @@
 #include "client/crashpad_info.h"
 #include "client/prune_crash_reports.h"
 #include "client/simple_string_dictionary.h"
+#include "handler/compress_crash_reports_thread.h"
 #include "handler/crash_report_upload_thread.h"
 #include "handler/prune_crash_reports_thread.h"
 #include "tools/tool_support.h"
@@ -50,6 +51,7 @@
 #include "util/misc/address_types.h"
 #include "util/misc/metrics.h"
 #include "util/misc/paths.h"
+#include "util/net/http_body_gzip.h"
 #include "util/numeric/in_range_cast.h"
 #include "util/stdlib/map_insert.h"
 #include "util/stdlib/string_number_conversion.h"
@@ -101,7 +103,13 @@ void Usage(const base::FilePath& me) {
 "Crashpad's exception handler server.\n"
 "\n"
 "      --annotation=KEY=VALUE  set a process annotation in each crash report\n"
+"      --compress-reports      store crash reports compressed\n"
 "      --database=PATH         store the crash report database at PATH\n"
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+"      --finalize-reports-in-background\n"
+"                              release crashed clients before their reports\n"
+"                              are written out\n"
+#endif  // OS_LINUX || OS_ANDROID
 #if defined(OS_MACOSX)
 "      --handshake-fd=FD       establish communication with the client over FD\n"
 #endif  // OS_MACOSX
@@ -122,6 +130,10 @@ void Usage(const base::FilePath& me) {
 #if defined(OS_MACOSX)
 "      --mach-service=SERVICE  register SERVICE with the bootstrap server\n"
 #endif  // OS_MACOSX
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+"      --max-concurrent-dumps=N\n"
+"                              service up to N crash dump requests at once\n"
+#endif  // OS_LINUX || OS_ANDROID
 "      --metrics-dir=DIR       store metrics files in DIR (only in Chromium)\n"
 "      --monitor-self          run a second handler to catch crashes in the first\n"
 "      --monitor-self-annotation=KEY=VALUE\n"
@@ -141,10 +153,12 @@ void Usage(const base::FilePath& me) {
 #if defined(OS_WIN)
 "      --pipe-name=PIPE        communicate with the client over PIPE\n"
 #endif  // OS_WIN
+"      --precompress-reports   keep compressed reports for upload retries\n"
 #if defined(OS_MACOSX)
 "      --reset-own-crash-exception-port-to-system-default\n"
 "                              reset the server's exception handler to default\n"
 #endif  // OS_MACOSX
+"      --retry-failed-uploads  retry crash uploads that fail, up to 3 times\n"
 #if defined(OS_LINUX) || defined(OS_ANDROID)
 "      --sanitization-information=SANITIZATION_INFORMATION_ADDRESS\n"
 "                              the address of a SanitizationInformation struct.\n"
@@ -154,6 +168,12 @@ void Usage(const base::FilePath& me) {
 "      --trace-parent-with-exception=EXCEPTION_INFORMATION_ADDRESS\n"
 "                              request a dump for the handler's parent process\n"
 #endif  // OS_LINUX || OS_ANDROID
+"      --upload-bandwidth-limit=BYTES_PER_SECOND\n"
+"                              limit the combined rate of crash uploads\n"
+"      --upload-concurrency=N  upload up to N crash reports at once\n"
+"      --upload-gzip-level=N   use gzip compression level N when uploading\n"
+"      --upload-gzip-window-bits=N\n"
+"                              use a 2^N-byte gzip window when uploading\n"
 "      --url=URL               send crash reports to this Breakpad server URL,\n"
 "                              only if uploads are enabled for the database\n"
 #if defined(OS_CHROMEOS)
@@ -192,6 +212,8 @@ struct Options {
   VMAddress exception_information_address;
   VMAddress sanitization_information_address;
   int initial_client_fd;
+  unsigned int max_concurrent_dumps;
+  bool finalize_reports_in_background;
   bool shared_client_connection;
 #if defined(OS_ANDROID)
   bool write_minidump_to_log;
@@ -201,11 +223,18 @@ struct Options {
   std::string pipe_name;
   InitialClientData initial_client_data;
 #endif  // OS_MACOSX
+  bool compress_reports;
   bool identify_client_via_url;
   bool monitor_self;
   bool periodic_tasks;
+  bool precompress_reports;
   bool rate_limit;
+  bool retry_failed_uploads;
   bool upload_gzip;
+  int upload_gzip_level;
+  int upload_gzip_window_bits;
+  unsigned int upload_concurrency;
+  uint64_t upload_bandwidth_limit;
 #if defined(OS_CHROMEOS)
   bool use_cros_crash_reporter = false;
   base::FilePath minidump_dir_for_tests;
@@ -436,6 +465,15 @@ void MonitorSelf(const Options& options) {
   if (!options.upload_gzip) {
     extra_arguments.push_back("--no-upload-gzip");
   }
+  if (options.upload_gzip_level != GzipHTTPBodyStream::kDefaultLevel) {
+    extra_arguments.push_back(base::StringPrintf("--upload-gzip-level=%d",
+                                                 options.upload_gzip_level));
+  }
+  if (options.upload_gzip_window_bits !=
+      GzipHTTPBodyStream::kDefaultWindowBits) {
+    extra_arguments.push_back(base::StringPrintf(
+        "--upload-gzip-window-bits=%d", options.upload_gzip_window_bits));
+  }
   for (const auto& iterator : options.monitor_self_annotations) {
     extra_arguments.push_back(
         base::StringPrintf("--monitor-self-annotation=%s=%s",
@@ -516,7 +554,11 @@ int HandlerMain(int argc,
     // Long options without short equivalents.
     kOptionLastChar = 255,
     kOptionAnnotation,
+    kOptionCompressReports,
     kOptionDatabase,
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    kOptionFinalizeReportsInBackground,
+#endif  // OS_LINUX || OS_ANDROID
 #if defined(OS_MACOSX)
     kOptionHandshakeFD,
 #endif  // OS_MACOSX
@@ -529,6 +571,9 @@ int HandlerMain(int argc,
 #if defined(OS_MACOSX)
     kOptionMachService,
 #endif  // OS_MACOSX
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    kOptionMaxConcurrentDumps,
+#endif  // OS_LINUX || OS_ANDROID
     kOptionMetrics,
     kOptionMonitorSelf,
     kOptionMonitorSelfAnnotation,
@@ -543,14 +588,20 @@ int HandlerMain(int argc,
 #if defined(OS_WIN)
     kOptionPipeName,
 #endif  // OS_WIN
+    kOptionPrecompressReports,
 #if defined(OS_MACOSX)
     kOptionResetOwnCrashExceptionPortToSystemDefault,
 #endif  // OS_MACOSX
+    kOptionRetryFailedUploads,
 #if defined(OS_LINUX) || defined(OS_ANDROID)
     kOptionSanitizationInformation,
     kOptionSharedClientConnection,
     kOptionTraceParentWithException,
 #endif
+    kOptionUploadBandwidthLimit,
+    kOptionUploadConcurrency,
+    kOptionUploadGzipLevel,
+    kOptionUploadGzipWindowBits,
     kOptionURL,
 #if defined(OS_CHROMEOS)
     kOptionUseCrosCrashReporter,
@@ -568,7 +619,14 @@ int HandlerMain(int argc,
 
   static constexpr option long_options[] = {
     {"annotation", required_argument, nullptr, kOptionAnnotation},
+    {"compress-reports", no_argument, nullptr, kOptionCompressReports},
     {"database", required_argument, nullptr, kOptionDatabase},
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    {"finalize-reports-in-background",
+     no_argument,
+     nullptr,
+     kOptionFinalizeReportsInBackground},
+#endif  // OS_LINUX || OS_ANDROID
 #if defined(OS_MACOSX)
     {"handshake-fd", required_argument, nullptr, kOptionHandshakeFD},
 #endif  // OS_MACOSX
@@ -584,6 +642,12 @@ int HandlerMain(int argc,
 #if defined(OS_MACOSX)
     {"mach-service", required_argument, nullptr, kOptionMachService},
 #endif  // OS_MACOSX
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    {"max-concurrent-dumps",
+     required_argument,
+     nullptr,
+     kOptionMaxConcurrentDumps},
+#endif  // OS_LINUX || OS_ANDROID
     {"metrics-dir", required_argument, nullptr, kOptionMetrics},
     {"monitor-self", no_argument, nullptr, kOptionMonitorSelf},
     {"monitor-self-annotation",
@@ -610,12 +674,14 @@ int HandlerMain(int argc,
 #if defined(OS_WIN)
     {"pipe-name", required_argument, nullptr, kOptionPipeName},
 #endif  // OS_WIN
+    {"precompress-reports", no_argument, nullptr, kOptionPrecompressReports},
 #if defined(OS_MACOSX)
     {"reset-own-crash-exception-port-to-system-default",
      no_argument,
      nullptr,
      kOptionResetOwnCrashExceptionPortToSystemDefault},
 #endif  // OS_MACOSX
+    {"retry-failed-uploads", no_argument, nullptr, kOptionRetryFailedUploads},
 #if defined(OS_LINUX) || defined(OS_ANDROID)
     {"sanitization-information",
      required_argument,
@@ -630,6 +696,19 @@ int HandlerMain(int argc,
      nullptr,
      kOptionTraceParentWithException},
 #endif  // OS_LINUX || OS_ANDROID
+    {"upload-bandwidth-limit",
+     required_argument,
+     nullptr,
+     kOptionUploadBandwidthLimit},
+    {"upload-concurrency",
+     required_argument,
+     nullptr,
+     kOptionUploadConcurrency},
+    {"upload-gzip-level", required_argument, nullptr, kOptionUploadGzipLevel},
+    {"upload-gzip-window-bits",
+     required_argument,
+     nullptr,
+     kOptionUploadGzipWindowBits},
     {"url", required_argument, nullptr, kOptionURL},
 #if defined(OS_CHROMEOS)
     {"use-cros-crash-reporter",
@@ -660,10 +739,14 @@ int HandlerMain(int argc,
   options.identify_client_via_url = true;
 #if defined(OS_LINUX) || defined(OS_ANDROID)
   options.initial_client_fd = kInvalidFileHandle;
+  options.max_concurrent_dumps = 1;
 #endif
   options.periodic_tasks = true;
   options.rate_limit = true;
   options.upload_gzip = true;
+  options.upload_gzip_level = GzipHTTPBodyStream::kDefaultLevel;
+  options.upload_gzip_window_bits = GzipHTTPBodyStream::kDefaultWindowBits;
+  options.upload_concurrency = 1;
 #if defined(OS_ANDROID)
   options.write_minidump_to_database = true;
 #endif
@@ -677,11 +760,21 @@ int HandlerMain(int argc,
         }
         break;
       }
+      case kOptionCompressReports: {
+        options.compress_reports = true;
+        break;
+      }
       case kOptionDatabase: {
         options.database = base::FilePath(
             ToolSupport::CommandLineArgumentToFilePathStringType(optarg));
         break;
       }
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+      case kOptionFinalizeReportsInBackground: {
+        options.finalize_reports_in_background = true;
+        break;
+      }
+#endif  // OS_LINUX || OS_ANDROID
 #if defined(OS_MACOSX)
       case kOptionHandshakeFD: {
         if (!StringToNumber(optarg, &options.handshake_fd) ||
@@ -716,6 +809,16 @@ int HandlerMain(int argc,
         break;
       }
 #endif  // OS_ANDROID || OS_LINUX
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+      case kOptionMaxConcurrentDumps: {
+        if (!StringToNumber(optarg, &options.max_concurrent_dumps) ||
+            options.max_concurrent_dumps < 1) {
+          ToolSupport::UsageHint(me, "failed to parse --max-concurrent-dumps");
+          return ExitFailure();
+        }
+        break;
+      }
+#endif  // OS_LINUX || OS_ANDROID
       case kOptionMetrics: {
         options.metrics_dir = base::FilePath(
             ToolSupport::CommandLineArgumentToFilePathStringType(optarg));
@@ -765,12 +868,20 @@ int HandlerMain(int argc,
         break;
       }
 #endif  // OS_WIN
+      case kOptionPrecompressReports: {
+        options.precompress_reports = true;
+        break;
+      }
 #if defined(OS_MACOSX)
       case kOptionResetOwnCrashExceptionPortToSystemDefault: {
         options.reset_own_crash_exception_port_to_system_default = true;
         break;
       }
 #endif  // OS_MACOSX
+      case kOptionRetryFailedUploads: {
+        options.retry_failed_uploads = true;
+        break;
+      }
 #if defined(OS_LINUX) || defined(OS_ANDROID)
       case kOptionSanitizationInformation: {
         if (!StringToNumber(optarg,
@@ -794,6 +905,40 @@ int HandlerMain(int argc,
         break;
       }
 #endif  // OS_LINUX || OS_ANDROID
+      case kOptionUploadBandwidthLimit: {
+        if (!StringToNumber(optarg, &options.upload_bandwidth_limit)) {
+          ToolSupport::UsageHint(me,
+                                 "failed to parse --upload-bandwidth-limit");
+          return ExitFailure();
+        }
+        break;
+      }
+      case kOptionUploadConcurrency: {
+        if (!StringToNumber(optarg, &options.upload_concurrency) ||
+            options.upload_concurrency < 1) {
+          ToolSupport::UsageHint(me, "failed to parse --upload-concurrency");
+          return ExitFailure();
+        }
+        break;
+      }
+      case kOptionUploadGzipLevel: {
+        if (!StringToNumber(optarg, &options.upload_gzip_level) ||
+            options.upload_gzip_level < 0 || options.upload_gzip_level > 9) {
+          ToolSupport::UsageHint(me, "failed to parse --upload-gzip-level");
+          return ExitFailure();
+        }
+        break;
+      }
+      case kOptionUploadGzipWindowBits: {
+        if (!StringToNumber(optarg, &options.upload_gzip_window_bits) ||
+            options.upload_gzip_window_bits < 9 ||
+            options.upload_gzip_window_bits > 15) {
+          ToolSupport::UsageHint(me,
+                                 "failed to parse --upload-gzip-window-bits");
+          return ExitFailure();
+        }
+        break;
+      }
       case kOptionURL: {
         options.url = optarg;
         break;
@@ -935,6 +1080,24 @@ int HandlerMain(int argc,
     return ExitFailure();
   }
 
+  ScopedStoppable compress_thread;
+  if (options.compress_reports) {
+    // Stored reports can also be uploaded as they are, so they are compressed
+    // with the upload parameters. They’re compressed in the background whether
+    // or not they’re uploaded.
+    if (database->EnableCompressedStorage(options.upload_gzip_level,
+                                          options.upload_gzip_window_bits)) {
+      compress_thread.Reset(new CompressCrashReportThread(database.get()));
+      compress_thread.Get()->Start();
+    } else {
+      LOG(WARNING) << "--compress-reports is not supported by this database";
+    }
+  } else if (options.precompress_reports && options.upload_gzip &&
+             !database->EnablePrecompression(options.upload_gzip_level,
+                                             options.upload_gzip_window_bits)) {
+    LOG(WARNING) << "--precompress-reports is not supported by this database";
+  }
+
   ScopedStoppable upload_thread;
   if (!options.url.empty()) {
     // TODO(scottmg): options.rate_limit should be removed when we have a
@@ -945,7 +1108,14 @@ int HandlerMain(int argc,
         options.identify_client_via_url;
     upload_thread_options.rate_limit = options.rate_limit;
     upload_thread_options.upload_gzip = options.upload_gzip;
+    upload_thread_options.upload_gzip_level = options.upload_gzip_level;
+    upload_thread_options.upload_gzip_window_bits =
+        options.upload_gzip_window_bits;
     upload_thread_options.watch_pending_reports = options.periodic_tasks;
+    upload_thread_options.retry_failed_uploads = options.retry_failed_uploads;
+    upload_thread_options.upload_concurrency = options.upload_concurrency;
+    upload_thread_options.upload_bandwidth_limit =
+        options.upload_bandwidth_limit;
 
     upload_thread.Reset(new CrashReportUploadThread(
         database.get(), options.url, upload_thread_options));
@@ -975,16 +1145,22 @@ int HandlerMain(int argc,
 
     exception_handler = std::move(cros_handler);
   } else {
-    exception_handler = std::make_unique<CrashReportExceptionHandler>(
+    auto crash_report_handler = std::make_unique<CrashReportExceptionHandler>(
         database.get(),
         static_cast<CrashReportUploadThread*>(upload_thread.Get()),
         &options.annotations,
         true,
         false,
         user_stream_sources);
+
+    if (options.finalize_reports_in_background) {
+      crash_report_handler->StartBackgroundFinalization();
+    }
+
+    exception_handler = std::move(crash_report_handler);
   }
 #else
-  exception_handler = std::make_unique<CrashReportExceptionHandler>(
+  auto crash_report_handler = std::make_unique<CrashReportExceptionHandler>(
       database.get(),
       static_cast<CrashReportUploadThread*>(upload_thread.Get()),
       &options.annotations,
@@ -997,6 +1173,14 @@ int HandlerMain(int argc,
       false,
 #endif  // OS_LINUX
       user_stream_sources);
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  if (options.finalize_reports_in_background) {
+    crash_report_handler->StartBackgroundFinalization();
+  }
+#endif  // OS_LINUX || OS_ANDROID
+
+  exception_handler = std::move(crash_report_handler);
 #endif  // OS_CHROMEOS
 
 #if defined(OS_LINUX) || defined(OS_ANDROID)
@@ -1073,6 +1257,7 @@ int HandlerMain(int argc,
   }
 #elif defined(OS_LINUX) || defined(OS_ANDROID)
   ExceptionHandlerServer exception_handler_server;
+  exception_handler_server.SetMaxConcurrentDumps(options.max_concurrent_dumps);
 #endif  // OS_MACOSX
 
   base::GlobalHistogramAllocator* histogram_allocator = nullptr;
@@ -37,7 +37,10 @@
         '..',
       ],
       'sources': [
+        'compress_crash_reports_thread_test.cc',
+        'crash_report_upload_thread_test.cc',
         'crashpad_handler_test.cc',
+        'linux/crash_report_exception_handler_test.cc',
         'linux/exception_handler_server_test.cc',
         'minidump_to_upload_parameters_test.cc',
       ],
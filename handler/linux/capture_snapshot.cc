@@ -28,13 +28,17 @@ bool CaptureSnapshot(
     const ExceptionHandlerProtocol::ClientInformation& info,
     const std::map<std::string, std::string>& process_annotations,
     uid_t client_uid,
+    ModuleMetadataCache* module_metadata_cache,
     VMAddress requesting_thread_stack_address,
     pid_t* requesting_thread_id,
     std::unique_ptr<ProcessSnapshotLinux>* snapshot,
     std::unique_ptr<ProcessSnapshotSanitized>* sanitized_snapshot) {
   std::unique_ptr<ProcessSnapshotLinux> process_snapshot(
       new ProcessSnapshotLinux());
-  if (!process_snapshot->Initialize(connection)) {
+  // The client remains suspended until the dump is complete, so its memory
+  // can be cached for the lifetime of the snapshot.
+  if (!process_snapshot->Initialize(
+          connection, /* cache_memory= */ true, module_metadata_cache)) {
     Metrics::ExceptionCaptureResult(Metrics::CaptureResult::kSnapshotFailed);
     return false;
   }
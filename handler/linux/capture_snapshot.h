@@ -21,6 +21,7 @@
 #include <memory>
 #include <string>
 
+#include "snapshot/elf/module_metadata_cache.h"
 #include "snapshot/linux/process_snapshot_linux.h"
 #include "snapshot/sanitized/process_snapshot_sanitized.h"
 #include "util/linux/exception_handler_protocol.h"
@@ -36,6 +37,8 @@ namespace crashpad {
 //! \param[in] process_annotations A map of annotations to insert as
 //!     process-level annotations into the snapshot.
 //! \param[in] client_uid The client's user ID.
+//! \param[in] module_metadata_cache A cache of module metadata shared between
+//!     snapshots. Optional, weak.
 //! \param[in] requesting_thread_stack_address An address on the stack of the
 //!     thread requesting the snapshot. If \a info includes an exception
 //!     address, the exception will be assigned to the thread whose stack
@@ -57,6 +60,7 @@ bool CaptureSnapshot(
     const ExceptionHandlerProtocol::ClientInformation& info,
     const std::map<std::string, std::string>& process_annotations,
     uid_t client_uid,
+    ModuleMetadataCache* module_metadata_cache,
     VMAddress requesting_thread_stack_address,
     pid_t* requesting_thread_id,
     std::unique_ptr<ProcessSnapshotLinux>* process_snapshot,
@@ -33,16 +33,28 @@
 #include "util/stream/base94_output_stream.h"
 #include "util/stream/log_output_stream.h"
 #include "util/stream/zlib_output_stream.h"
+#include "util/thread/thread.h"
 
 namespace crashpad {
 
 namespace {
 
+// Creates the compress->base94-encoding->log output stream pipeline.
+//
+// This compresses on the calling thread. base94_encoder can compress on
+// several threads instead, producing different output that decompresses to
+// the same data, but no gain on several CPUs has been shown that would justify
+// doing so here.
+std::unique_ptr<OutputStreamInterface> CreateLogOutputStream() {
+  return std::make_unique<ZlibOutputStream>(
+      ZlibOutputStream::Mode::kCompress,
+      std::make_unique<Base94OutputStream>(
+          Base94OutputStream::Mode::kEncode,
+          std::make_unique<LogOutputStream>()));
+}
+
 bool WriteMinidumpLogFromFile(FileReaderInterface* file_reader) {
-  ZlibOutputStream stream(ZlibOutputStream::Mode::kCompress,
-                          std::make_unique<Base94OutputStream>(
-                              Base94OutputStream::Mode::kEncode,
-                              std::make_unique<LogOutputStream>()));
+  std::unique_ptr<OutputStreamInterface> stream = CreateLogOutputStream();
   FileOperationResult read_result;
   do {
     uint8_t buffer[4096];
@@ -50,14 +62,30 @@ bool WriteMinidumpLogFromFile(FileReaderInterface* file_reader) {
     if (read_result < 0)
       return false;
 
-    if (read_result > 0 && (!stream.Write(buffer, read_result)))
+    if (read_result > 0 && (!stream->Write(buffer, read_result)))
       return false;
   } while (read_result > 0);
-  return stream.Flush();
+  return stream->Flush();
 }
 
 }  // namespace
 
+class CrashReportExceptionHandler::FinalizationThread : public Thread {
+ public:
+  explicit FinalizationThread(CrashReportExceptionHandler* handler)
+      : Thread(), handler_(handler) {}
+
+  ~FinalizationThread() override {}
+
+ private:
+  // Thread:
+  void ThreadMain() override { handler_->RunFinalizationThread(); }
+
+  CrashReportExceptionHandler* handler_;
+
+  DISALLOW_COPY_AND_ASSIGN(FinalizationThread);
+};
+
 CrashReportExceptionHandler::CrashReportExceptionHandler(
     CrashReportDatabase* database,
     CrashReportUploadThread* upload_thread,
@@ -70,11 +98,44 @@ CrashReportExceptionHandler::CrashReportExceptionHandler(
       process_annotations_(process_annotations),
       write_minidump_to_database_(write_minidump_to_database),
       write_minidump_to_log_(write_minidump_to_log),
-      user_stream_data_sources_(user_stream_data_sources) {
+      user_stream_data_sources_(user_stream_data_sources),
+      module_metadata_cache_(),
+      finalization_thread_(),
+      max_pending_finalizations_(0),
+      max_pending_finalization_bytes_(0),
+      finalization_lock_(),
+      finalization_condition_(),
+      pending_finalizations_(),
+      reserved_finalizations_(0),
+      pending_finalization_bytes_(0),
+      stop_finalization_thread_(false) {
   DCHECK(write_minidump_to_database_ | write_minidump_to_log_);
 }
 
-CrashReportExceptionHandler::~CrashReportExceptionHandler() = default;
+CrashReportExceptionHandler::~CrashReportExceptionHandler() {
+  if (!finalization_thread_) {
+    return;
+  }
+
+  // Reports that have already been captured are finalized before the thread
+  // exits.
+  {
+    std::lock_guard<std::mutex> lock(finalization_lock_);
+    stop_finalization_thread_ = true;
+  }
+  finalization_condition_.notify_all();
+  finalization_thread_->Join();
+}
+
+void CrashReportExceptionHandler::StartBackgroundFinalization(
+    size_t max_pending_reports,
+    size_t max_pending_bytes) {
+  DCHECK(!finalization_thread_);
+  max_pending_finalizations_ = max_pending_reports;
+  max_pending_finalization_bytes_ = max_pending_bytes;
+  finalization_thread_ = std::make_unique<FinalizationThread>(this);
+  finalization_thread_->Start();
+}
 
 bool CrashReportExceptionHandler::HandleException(
     pid_t client_process_id,
@@ -85,8 +146,10 @@ bool CrashReportExceptionHandler::HandleException(
     UUID* local_report_id) {
   Metrics::ExceptionEncountered();
 
+  // The handler isn’t subject to a seccomp policy, so it can stop the client’s
+  // threads with PTRACE_SEIZE.
   DirectPtraceConnection connection;
-  if (!connection.Initialize(client_process_id)) {
+  if (!connection.Initialize(client_process_id, /* seize= */ true)) {
     Metrics::ExceptionCaptureResult(
         Metrics::CaptureResult::kDirectPtraceFailed);
     return false;
@@ -132,6 +195,7 @@ bool CrashReportExceptionHandler::HandleExceptionWithConnection(
                        info,
                        *process_annotations_,
                        client_uid,
+                       &module_metadata_cache_,
                        requesting_thread_stack_address,
                        requesting_thread_id,
                        &process_snapshot,
@@ -183,6 +247,25 @@ bool CrashReportExceptionHandler::WriteMinidumpToDatabase(
   minidump.InitializeFromSnapshot(snapshot);
   AddUserExtensionStreams(user_stream_data_sources_, snapshot, &minidump);
 
+  if (ReserveFinalization()) {
+    auto request = std::make_unique<FinalizationRequest>();
+    if (!minidump.WriteEverything(&request->minidump)) {
+      CancelFinalization();
+      LOG(ERROR) << "WriteEverything failed";
+      Metrics::ExceptionCaptureResult(
+          Metrics::CaptureResult::kMinidumpWriteFailed);
+      return false;
+    }
+
+    if (local_report_id != nullptr) {
+      *local_report_id = new_report->ReportID();
+    }
+    request->new_report = std::move(new_report);
+    request->write_minidump_to_log = write_minidump_to_log;
+    QueueFinalization(std::move(request));
+    return true;
+  }
+
   if (!minidump.WriteEverything(new_report->Writer())) {
     LOG(ERROR) << "WriteEverything failed";
     Metrics::ExceptionCaptureResult(
@@ -190,18 +273,29 @@ bool CrashReportExceptionHandler::WriteMinidumpToDatabase(
     return false;
   }
 
+  FileReaderInterface* log_reader =
+      write_minidump_to_log ? new_report->Reader() : nullptr;
+  return FinishReport(std::move(new_report),
+                      write_minidump_to_log,
+                      log_reader,
+                      local_report_id);
+}
+
+bool CrashReportExceptionHandler::FinishReport(
+    std::unique_ptr<CrashReportDatabase::NewReport> new_report,
+    bool write_minidump_to_log,
+    FileReaderInterface* log_reader,
+    UUID* local_report_id) {
   bool write_minidump_to_log_succeed = false;
-  if (write_minidump_to_log) {
-    if (auto* file_reader = new_report->Reader()) {
-      if (WriteMinidumpLogFromFile(file_reader))
-        write_minidump_to_log_succeed = true;
-      else
-        LOG(ERROR) << "WriteMinidumpLogFromFile failed";
-    }
+  if (log_reader) {
+    if (WriteMinidumpLogFromFile(log_reader))
+      write_minidump_to_log_succeed = true;
+    else
+      LOG(ERROR) << "WriteMinidumpLogFromFile failed";
   }
 
   UUID uuid;
-  database_status =
+  CrashReportDatabase::OperationStatus database_status =
       database_->FinishedWritingCrashReport(std::move(new_report), &uuid);
   if (database_status != CrashReportDatabase::kNoError) {
     LOG(ERROR) << "FinishedWritingCrashReport failed";
@@ -233,11 +327,20 @@ bool CrashReportExceptionHandler::WriteMinidumpToLog(
   minidump.InitializeFromSnapshot(snapshot);
   AddUserExtensionStreams(user_stream_data_sources_, snapshot, &minidump);
 
-  OutputStreamFileWriter writer(std::make_unique<ZlibOutputStream>(
-      ZlibOutputStream::Mode::kCompress,
-      std::make_unique<Base94OutputStream>(
-          Base94OutputStream::Mode::kEncode,
-          std::make_unique<LogOutputStream>())));
+  if (ReserveFinalization()) {
+    auto request = std::make_unique<FinalizationRequest>();
+    if (!minidump.WriteMinidump(&request->minidump, false /* allow_seek */)) {
+      CancelFinalization();
+      LOG(ERROR) << "WriteMinidump failed";
+      return false;
+    }
+
+    request->write_minidump_to_log = true;
+    QueueFinalization(std::move(request));
+    return true;
+  }
+
+  OutputStreamFileWriter writer(CreateLogOutputStream());
   if (!minidump.WriteMinidump(&writer, false /* allow_seek */)) {
     LOG(ERROR) << "WriteMinidump failed";
     return false;
@@ -245,4 +348,91 @@ bool CrashReportExceptionHandler::WriteMinidumpToLog(
   return writer.Flush();
 }
 
+bool CrashReportExceptionHandler::ReserveFinalization() {
+  if (!finalization_thread_) {
+    return false;
+  }
+
+  // The byte limit is checked before the size of the next minidump is known,
+  // so minidumps being captured concurrently may exceed it by their sizes.
+  std::lock_guard<std::mutex> lock(finalization_lock_);
+  if (reserved_finalizations_ >= max_pending_finalizations_ ||
+      pending_finalization_bytes_ >= max_pending_finalization_bytes_) {
+    LOG(WARNING) << "too many reports waiting, finalizing synchronously";
+    return false;
+  }
+  ++reserved_finalizations_;
+  return true;
+}
+
+void CrashReportExceptionHandler::CancelFinalization() {
+  std::lock_guard<std::mutex> lock(finalization_lock_);
+  DCHECK_GT(reserved_finalizations_, 0u);
+  --reserved_finalizations_;
+}
+
+void CrashReportExceptionHandler::QueueFinalization(
+    std::unique_ptr<FinalizationRequest> request) {
+  {
+    std::lock_guard<std::mutex> lock(finalization_lock_);
+    pending_finalization_bytes_ += request->minidump.string().size();
+    pending_finalizations_.push_back(std::move(request));
+  }
+  finalization_condition_.notify_one();
+}
+
+void CrashReportExceptionHandler::RunFinalizationThread() {
+  std::unique_lock<std::mutex> lock(finalization_lock_);
+  while (true) {
+    if (pending_finalizations_.empty()) {
+      if (stop_finalization_thread_) {
+        return;
+      }
+      finalization_condition_.wait(lock);
+      continue;
+    }
+
+    std::unique_ptr<FinalizationRequest> request =
+        std::move(pending_finalizations_.front());
+    pending_finalizations_.pop_front();
+    lock.unlock();
+
+    const size_t request_bytes = request->minidump.string().size();
+    Finalize(request.get());
+    request.reset();
+
+    lock.lock();
+    --reserved_finalizations_;
+    pending_finalization_bytes_ -= request_bytes;
+  }
+}
+
+void CrashReportExceptionHandler::Finalize(FinalizationRequest* request) {
+  if (request->minidump.Seek(0, SEEK_SET) != 0) {
+    LOG(ERROR) << "Seek failed";
+    return;
+  }
+
+  if (!request->new_report) {
+    if (!WriteMinidumpLogFromFile(&request->minidump)) {
+      LOG(ERROR) << "WriteMinidumpLogFromFile failed";
+    }
+    return;
+  }
+
+  const std::string& minidump = request->minidump.string();
+  if (!request->new_report->Writer()->Write(minidump.data(),
+                                            minidump.size())) {
+    LOG(ERROR) << "Write failed";
+    Metrics::ExceptionCaptureResult(
+        Metrics::CaptureResult::kMinidumpWriteFailed);
+    return;
+  }
+
+  FinishReport(std::move(request->new_report),
+               request->write_minidump_to_log,
+               request->write_minidump_to_log ? &request->minidump : nullptr,
+               nullptr);
+}
+
 }  // namespace crashpad
@@ -15,7 +15,13 @@
 #ifndef CRASHPAD_HANDLER_LINUX_CRASH_REPORT_EXCEPTION_HANDLER_H_
 #define CRASHPAD_HANDLER_LINUX_CRASH_REPORT_EXCEPTION_HANDLER_H_
 
+#include <stddef.h>
+
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include "base/macros.h"
@@ -23,6 +29,8 @@
 #include "handler/crash_report_upload_thread.h"
 #include "handler/linux/exception_handler_server.h"
 #include "handler/user_stream_data_source.h"
+#include "snapshot/elf/module_metadata_cache.h"
+#include "util/file/string_file.h"
 #include "util/linux/exception_handler_protocol.h"
 #include "util/linux/ptrace_connection.h"
 #include "util/misc/address_types.h"
@@ -37,6 +45,15 @@ class ProcessSnapshotSanitized;
 //!     to a CrashReportDatabase.
 class CrashReportExceptionHandler : public ExceptionHandlerServer::Delegate {
  public:
+  //! \brief The default maximum number of minidumps waiting to be finalized
+  //!     in the background.
+  static constexpr size_t kDefaultMaxPendingFinalizations = 8;
+
+  //! \brief The default number of bytes of minidumps waiting to be finalized
+  //!     in the background beyond which no more are queued.
+  static constexpr size_t kDefaultMaxPendingFinalizationBytes =
+      64 * 1024 * 1024;
+
   //! \brief Creates a new object that will store crash reports in \a database.
   //!
   //! \param[in] database The database to store crash reports in. Weak.
@@ -69,8 +86,51 @@ class CrashReportExceptionHandler : public ExceptionHandlerServer::Delegate {
       bool write_minidump_to_log,
       const UserStreamDataSources* user_stream_data_sources);
 
+  //! \brief Waits for reports being finalized in the background, if any, to
+  //!     be finalized.
   ~CrashReportExceptionHandler() override;
 
+  //! \brief Finalizes crash reports on a background thread.
+  //!
+  //! By default, the crashed client is released only once its crash report has
+  //! been written to the database and log, and the database has been updated.
+  //! After this is called, the minidump is instead written into memory, which
+  //! captures everything it needs from the client, and the client is released
+  //! immediately. Writing the minidump to the database and log, completing the
+  //! report in the database, and notifying the upload thread are done later, in
+  //! order, on a background thread.
+  //!
+  //! When reports are finalized in the background, HandleException() only
+  //! reports whether the minidump was captured, and the report identified by
+  //! its \a local_report_id may not be available in the database yet. Failures
+  //! while finalizing are logged and recorded in metrics.
+  //!
+  //! Minidumps waiting to be finalized are held in memory. Once
+  //! \a max_pending_reports of them are waiting, or they occupy at least
+  //! \a max_pending_bytes, further crash reports are finalized before their
+  //! clients are released, as if this method had not been called.
+  //!
+  //! This method must be called before the first call to HandleException(),
+  //! and at most once.
+  //!
+  //! \param[in] max_pending_reports The maximum number of minidumps waiting to
+  //!     be finalized.
+  //! \param[in] max_pending_bytes The number of bytes of minidumps waiting to
+  //!     be finalized beyond which no more are queued.
+  void StartBackgroundFinalization(
+      size_t max_pending_reports = kDefaultMaxPendingFinalizations,
+      size_t max_pending_bytes = kDefaultMaxPendingFinalizationBytes);
+
+  //! \brief Returns counters describing how often module metadata was reused
+  //!     from earlier crash reports.
+  //!
+  //! The metadata of modules seen in an earlier crash report, identified by
+  //! their files and build IDs, is not parsed from later crashing clients
+  //! again.
+  ModuleMetadataCache::Stats ModuleMetadataCacheStats() const {
+    return module_metadata_cache_.GetStats();
+  }
+
   // ExceptionHandlerServer::Delegate:
 
   bool HandleException(pid_t client_process_id,
@@ -88,6 +148,20 @@ class CrashReportExceptionHandler : public ExceptionHandlerServer::Delegate {
       UUID* local_report_id = nullptr) override;
 
  private:
+  // A captured minidump waiting to be finalized in the background.
+  struct FinalizationRequest {
+    // The report to write the minidump to, or nullptr if it’s only written to
+    // the log.
+    std::unique_ptr<CrashReportDatabase::NewReport> new_report;
+
+    // The serialized minidump.
+    StringFile minidump;
+
+    bool write_minidump_to_log;
+  };
+
+  class FinalizationThread;
+
   bool HandleExceptionWithConnection(
       PtraceConnection* connection,
       const ExceptionHandlerProtocol::ClientInformation& info,
@@ -103,12 +177,47 @@ class CrashReportExceptionHandler : public ExceptionHandlerServer::Delegate {
   bool WriteMinidumpToLog(ProcessSnapshotLinux* process_snapshot,
                           ProcessSnapshotSanitized* sanitized_snapshot);
 
+  // Optionally writes the minidump in |new_report| to the log, read from
+  // |log_reader|, then completes |new_report| in the database and notifies the
+  // upload thread.
+  bool FinishReport(std::unique_ptr<CrashReportDatabase::NewReport> new_report,
+                    bool write_minidump_to_log,
+                    FileReaderInterface* log_reader,
+                    UUID* local_report_id);
+
+  // Returns true and reserves a place in the queue if another minidump may be
+  // captured into memory and finalized in the background. The reservation is
+  // either used by QueueFinalization() or released by CancelFinalization().
+  bool ReserveFinalization();
+  void CancelFinalization();
+
+  void QueueFinalization(std::unique_ptr<FinalizationRequest> request);
+  void RunFinalizationThread();
+  void Finalize(FinalizationRequest* request);
+
   CrashReportDatabase* database_;  // weak
   CrashReportUploadThread* upload_thread_;  // weak
   const std::map<std::string, std::string>* process_annotations_;  // weak
   bool write_minidump_to_database_;
   bool write_minidump_to_log_;
   const UserStreamDataSources* user_stream_data_sources_;  // weak
+  ModuleMetadataCache module_metadata_cache_;
+
+  std::unique_ptr<FinalizationThread> finalization_thread_;
+  size_t max_pending_finalizations_;
+  size_t max_pending_finalization_bytes_;
+
+  std::mutex finalization_lock_;
+  std::condition_variable finalization_condition_;
+
+  // The following members are guarded by finalization_lock_.
+  std::deque<std::unique_ptr<FinalizationRequest>> pending_finalizations_;
+
+  // The number of minidumps being captured for, waiting for, or undergoing
+  // finalization in the background, and the size of those captured.
+  size_t reserved_finalizations_;
+  size_t pending_finalization_bytes_;
+  bool stop_finalization_thread_;
 
   DISALLOW_COPY_AND_ASSIGN(CrashReportExceptionHandler);
 };
@@ -0,0 +1,158 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "handler/linux/crash_report_exception_handler.h"
+
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "gtest/gtest.h"
+#include "test/multiprocess.h"
+#include "test/scoped_temp_dir.h"
+#include "util/file/file_io.h"
+#include "util/linux/exception_information.h"
+#include "util/misc/from_pointer_cast.h"
+#include "util/posix/signals.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+constexpr size_t kReportCount = 3;
+
+// Captures several crash reports from a crashed child, with reports finalized
+// in the background, subject to the given limits.
+class BackgroundFinalizationTest : public Multiprocess {
+ public:
+  BackgroundFinalizationTest(size_t max_pending_reports,
+                             size_t max_pending_bytes)
+      : Multiprocess(),
+        max_pending_reports_(max_pending_reports),
+        max_pending_bytes_(max_pending_bytes) {
+    SetExpectedChildTerminationBuiltinTrap();
+  }
+
+  ~BackgroundFinalizationTest() {}
+
+ private:
+  static void HandleCrash(int signo, siginfo_t* siginfo, void* context) {
+    ExceptionInformation info = {};
+    info.siginfo_address = FromPointerCast<VMAddress>(siginfo);
+    info.context_address = FromPointerCast<VMAddress>(context);
+    info.thread_id = syscall(SYS_gettid);
+
+    auto info_address = FromPointerCast<VMAddress>(&info);
+    CheckedWriteFile(write_pipe_, &info_address, sizeof(info_address));
+
+    CheckedReadFileAtEOF(read_pipe_);
+    Signals::RestoreHandlerAndReraiseSignalOnReturn(siginfo, nullptr);
+  }
+
+  // Multiprocess:
+
+  void MultiprocessParent() override {
+    VMAddress info_address;
+    CheckedReadFileExactly(
+        ReadPipeHandle(), &info_address, sizeof(info_address));
+
+    ScopedTempDir temp_dir;
+    std::unique_ptr<CrashReportDatabase> database =
+        CrashReportDatabase::Initialize(temp_dir.path());
+    ASSERT_TRUE(database);
+
+    const std::map<std::string, std::string> annotations;
+    ExceptionHandlerProtocol::ClientInformation info;
+    info.exception_information_address = info_address;
+
+    const bool synchronous = max_pending_reports_ == 0 ||
+                             max_pending_bytes_ == 0;
+    {
+      CrashReportExceptionHandler handler(
+          database.get(), nullptr, &annotations, true, false, nullptr);
+      handler.StartBackgroundFinalization(max_pending_reports_,
+                                          max_pending_bytes_);
+
+      for (size_t index = 0; index < kReportCount; ++index) {
+        UUID local_report_id;
+        ASSERT_TRUE(handler.HandleException(
+            ChildPID(), getuid(), info, 0, nullptr, &local_report_id));
+
+        // With no room in the queue, each report must be complete by the time
+        // HandleException() returns.
+        if (synchronous) {
+          CrashReportDatabase::Report report;
+          EXPECT_EQ(database->LookUpCrashReport(local_report_id, &report),
+                    CrashReportDatabase::kNoError);
+        }
+      }
+    }
+
+    // Reports still waiting to be finalized are finalized before the handler
+    // is destroyed.
+    std::vector<CrashReportDatabase::Report> reports;
+    ASSERT_EQ(database->GetPendingReports(&reports),
+              CrashReportDatabase::kNoError);
+    EXPECT_EQ(reports.size(), kReportCount);
+
+    CloseWritePipe();
+  }
+
+  void MultiprocessChild() override {
+    read_pipe_ = ReadPipeHandle();
+    write_pipe_ = WritePipeHandle();
+    ASSERT_TRUE(Signals::InstallCrashHandlers(HandleCrash, 0, nullptr));
+
+    __builtin_trap();
+  }
+
+  static FileHandle read_pipe_;
+  static FileHandle write_pipe_;
+
+  size_t max_pending_reports_;
+  size_t max_pending_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundFinalizationTest);
+};
+
+FileHandle BackgroundFinalizationTest::read_pipe_ = kInvalidFileHandle;
+FileHandle BackgroundFinalizationTest::write_pipe_ = kInvalidFileHandle;
+
+TEST(CrashReportExceptionHandler, QueuedReportsFinalizedAtShutdown) {
+  BackgroundFinalizationTest test(
+      CrashReportExceptionHandler::kDefaultMaxPendingFinalizations,
+      CrashReportExceptionHandler::kDefaultMaxPendingFinalizationBytes);
+  test.Run();
+}
+
+TEST(CrashReportExceptionHandler, FullQueueByCountFinalizesSynchronously) {
+  BackgroundFinalizationTest test(
+      0, CrashReportExceptionHandler::kDefaultMaxPendingFinalizationBytes);
+  test.Run();
+}
+
+TEST(CrashReportExceptionHandler, FullQueueByBytesFinalizesSynchronously) {
+  BackgroundFinalizationTest test(
+      CrashReportExceptionHandler::kDefaultMaxPendingFinalizations, 0);
+  test.Run();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
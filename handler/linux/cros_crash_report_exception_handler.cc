@@ -134,6 +134,7 @@ CrosCrashReportExceptionHandler::CrosCrashReportExceptionHandler(
     : database_(database),
       process_annotations_(process_annotations),
       user_stream_data_sources_(user_stream_data_sources),
+      module_metadata_cache_(),
       always_allow_feedback_(false) {}
 
 CrosCrashReportExceptionHandler::~CrosCrashReportExceptionHandler() = default;
@@ -147,8 +148,10 @@ bool CrosCrashReportExceptionHandler::HandleException(
     UUID* local_report_id) {
   Metrics::ExceptionEncountered();
 
+  // The handler isn’t subject to a seccomp policy, so it can stop the client’s
+  // threads with PTRACE_SEIZE.
   DirectPtraceConnection connection;
-  if (!connection.Initialize(client_process_id)) {
+  if (!connection.Initialize(client_process_id, /* seize= */ true)) {
     Metrics::ExceptionCaptureResult(
         Metrics::CaptureResult::kDirectPtraceFailed);
     return false;
@@ -194,6 +197,7 @@ bool CrosCrashReportExceptionHandler::HandleExceptionWithConnection(
                        info,
                        *process_annotations_,
                        client_uid,
+                       &module_metadata_cache_,
                        requesting_thread_stack_address,
                        requesting_thread_id,
                        &process_snapshot,
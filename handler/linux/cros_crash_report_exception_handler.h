@@ -22,6 +22,7 @@
 #include "client/crash_report_database.h"
 #include "handler/linux/exception_handler_server.h"
 #include "handler/user_stream_data_source.h"
+#include "snapshot/elf/module_metadata_cache.h"
 #include "util/linux/exception_handler_protocol.h"
 #include "util/linux/ptrace_connection.h"
 #include "util/misc/address_types.h"
@@ -78,6 +79,13 @@ class CrosCrashReportExceptionHandler
 
   void SetDumpDir(const base::FilePath& dump_dir) { dump_dir_ = dump_dir; }
   void SetAlwaysAllowFeedback() { always_allow_feedback_ = true; }
+
+  //! \brief Returns counters describing how often module metadata was reused
+  //!     from earlier crash reports.
+  ModuleMetadataCache::Stats ModuleMetadataCacheStats() const {
+    return module_metadata_cache_.GetStats();
+  }
+
  private:
   bool HandleExceptionWithConnection(
       PtraceConnection* connection,
@@ -91,6 +99,7 @@ class CrosCrashReportExceptionHandler
   const std::map<std::string, std::string>* process_annotations_;  // weak
   const UserStreamDataSources* user_stream_data_sources_;  // weak
   base::FilePath dump_dir_;
+  ModuleMetadataCache module_metadata_cache_;
   bool always_allow_feedback_;
 
   DISALLOW_COPY_AND_ASSIGN(CrosCrashReportExceptionHandler);
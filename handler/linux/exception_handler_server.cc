@@ -35,6 +35,7 @@
 #include "util/linux/proc_task_reader.h"
 #include "util/linux/socket.h"
 #include "util/misc/as_underlying_type.h"
+#include "util/thread/thread.h"
 
 namespace crashpad {
 
@@ -236,9 +237,36 @@ class PtraceStrategyDeciderImpl : public PtraceStrategyDecider {
 
 }  // namespace
 
+// Services crash dump requests queued by Run() when concurrent dumps are
+// enabled.
+class ExceptionHandlerServer::DumpWorker : public Thread {
+ public:
+  explicit DumpWorker(ExceptionHandlerServer* server)
+      : Thread(), server_(server) {}
+
+  ~DumpWorker() override {}
+
+ private:
+  // Thread:
+  void ThreadMain() override { server_->RunDumpWorker(); }
+
+  ExceptionHandlerServer* server_;
+
+  DISALLOW_COPY_AND_ASSIGN(DumpWorker);
+};
+
 ExceptionHandlerServer::ExceptionHandlerServer()
     : clients_(),
       shutdown_event_(),
+      dump_complete_event_(),
+      dump_workers_(),
+      dump_lock_(),
+      dump_condition_(),
+      pending_dumps_(),
+      completed_dumps_(),
+      busy_clients_(),
+      stop_dump_workers_(false),
+      max_concurrent_dumps_(1),
       strategy_decider_(new PtraceStrategyDeciderImpl()),
       delegate_(nullptr),
       pollfd_(),
@@ -251,6 +279,12 @@ void ExceptionHandlerServer::SetPtraceStrategyDecider(
   strategy_decider_ = std::move(decider);
 }
 
+void ExceptionHandlerServer::SetMaxConcurrentDumps(
+    size_t max_concurrent_dumps) {
+  DCHECK_GE(max_concurrent_dumps, 1u);
+  max_concurrent_dumps_ = max_concurrent_dumps;
+}
+
 bool ExceptionHandlerServer::InitializeWithClient(ScopedFileHandle sock,
                                                   bool multiple_clients) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
@@ -280,6 +314,26 @@ bool ExceptionHandlerServer::InitializeWithClient(ScopedFileHandle sock,
     return false;
   }
 
+  if (max_concurrent_dumps_ > 1) {
+    dump_complete_event_ = std::make_unique<Event>();
+    dump_complete_event_->type = Event::Type::kDumpComplete;
+    dump_complete_event_->fd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (!dump_complete_event_->fd.is_valid()) {
+      PLOG(ERROR) << "eventfd";
+      return false;
+    }
+
+    poll_event.events = EPOLLIN;
+    poll_event.data.ptr = dump_complete_event_.get();
+    if (epoll_ctl(pollfd_.get(),
+                  EPOLL_CTL_ADD,
+                  dump_complete_event_->fd.get(),
+                  &poll_event) != 0) {
+      PLOG(ERROR) << "epoll_ctl";
+      return false;
+    }
+  }
+
   if (!InstallClientSocket(std::move(sock),
                            multiple_clients ? Event::Type::kSharedSocketMessage
                                             : Event::Type::kClientMessage)) {
@@ -294,12 +348,14 @@ void ExceptionHandlerServer::Run(Delegate* delegate) {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
   delegate_ = delegate;
 
+  StartDumpWorkers();
+
   while (keep_running_ && clients_.size() > 0) {
     epoll_event poll_event;
     int res = HANDLE_EINTR(epoll_wait(pollfd_.get(), &poll_event, 1, -1));
     if (res < 0) {
       PLOG(ERROR) << "epoll_wait";
-      return;
+      break;
     }
     DCHECK_EQ(res, 1);
 
@@ -309,10 +365,14 @@ void ExceptionHandlerServer::Run(Delegate* delegate) {
         LogSocketError(eventp->fd.get());
       }
       keep_running_ = false;
+    } else if (eventp->type == Event::Type::kDumpComplete) {
+      CollectCompletedDumps();
     } else {
       HandleEvent(eventp, poll_event.events);
     }
   }
+
+  StopDumpWorkers();
 }
 
 void ExceptionHandlerServer::Stop() {
@@ -336,7 +396,9 @@ void ExceptionHandlerServer::HandleEvent(Event* event, uint32_t event_type) {
   if (event_type & EPOLLIN) {
     if (!ReceiveClientMessage(event)) {
       UninstallClientSocket(event);
+      return;
     }
+    RearmClientSocket(event);
     return;
   }
 
@@ -346,6 +408,7 @@ void ExceptionHandlerServer::HandleEvent(Event* event, uint32_t event_type) {
   }
 
   LOG(ERROR) << "Unexpected event 0x" << std::hex << event_type;
+  RearmClientSocket(event);
   return;
 }
 
@@ -374,6 +437,8 @@ bool ExceptionHandlerServer::InstallClientSocket(ScopedFileHandle socket,
   auto event = std::make_unique<Event>();
   event->type = type;
   event->fd.reset(socket.release());
+  event->dumps_in_progress = 0;
+  event->uninstall_pending = false;
 
   Event* eventp = event.get();
 
@@ -383,8 +448,15 @@ bool ExceptionHandlerServer::InstallClientSocket(ScopedFileHandle socket,
     return false;
   }
 
+  // When crash dump requests are serviced on dump workers, private client
+  // sockets are only monitored for one message at a time, and are rearmed once
+  // that message has been fully handled. This keeps the server from reading the
+  // socket while a dump worker is using it to communicate with the client.
   epoll_event poll_event;
   poll_event.events = EPOLLIN | EPOLLRDHUP;
+  if (max_concurrent_dumps_ > 1 && type == Event::Type::kClientMessage) {
+    poll_event.events |= EPOLLONESHOT;
+  }
   poll_event.data.ptr = eventp;
 
   if (epoll_ctl(pollfd_.get(), EPOLL_CTL_ADD, eventp->fd.get(), &poll_event) !=
@@ -403,6 +475,11 @@ bool ExceptionHandlerServer::UninstallClientSocket(Event* event) {
     return false;
   }
 
+  if (event->dumps_in_progress > 0) {
+    event->uninstall_pending = true;
+    return true;
+  }
+
   if (clients_.erase(event->fd.get()) != 1) {
     LOG(ERROR) << "event not found";
     return false;
@@ -411,6 +488,24 @@ bool ExceptionHandlerServer::UninstallClientSocket(Event* event) {
   return true;
 }
 
+bool ExceptionHandlerServer::RearmClientSocket(Event* event) {
+  if (max_concurrent_dumps_ <= 1 ||
+      event->type != Event::Type::kClientMessage ||
+      event->dumps_in_progress > 0) {
+    return true;
+  }
+
+  epoll_event poll_event;
+  poll_event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+  poll_event.data.ptr = event;
+  if (epoll_ctl(pollfd_.get(), EPOLL_CTL_MOD, event->fd.get(), &poll_event) !=
+      0) {
+    PLOG(ERROR) << "epoll_ctl";
+    return false;
+  }
+  return true;
+}
+
 bool ExceptionHandlerServer::ReceiveClientMessage(Event* event) {
   ExceptionHandlerProtocol::ClientToServerMessage message;
   ucred creds;
@@ -424,6 +519,11 @@ bool ExceptionHandlerServer::ReceiveClientMessage(Event* event) {
       return SendCredentials(event->fd.get());
 
     case ExceptionHandlerProtocol::ClientToServerMessage::kTypeCrashDumpRequest:
+      if (max_concurrent_dumps_ > 1) {
+        return DispatchCrashDumpRequest(
+            event, creds, message.client_info,
+            message.requesting_thread_stack_address);
+      }
       return HandleCrashDumpRequest(
           creds,
           message.client_info,
@@ -490,4 +590,144 @@ bool ExceptionHandlerServer::HandleCrashDumpRequest(
       ExceptionHandlerProtocol::ServerToClientMessage::kTypeCrashDumpComplete);
 }
 
+bool ExceptionHandlerServer::DispatchCrashDumpRequest(
+    Event* event,
+    const ucred& creds,
+    const ExceptionHandlerProtocol::ClientInformation& client_info,
+    VMAddress requesting_thread_stack_address) {
+  auto request = std::make_unique<DumpRequest>();
+  request->creds = creds;
+  request->client_info = client_info;
+  request->requesting_thread_stack_address = requesting_thread_stack_address;
+  request->client = event;
+  request->client_sock = event->fd.get();
+  request->client_type = event->type;
+  request->result = false;
+
+  ++event->dumps_in_progress;
+
+  {
+    std::lock_guard<std::mutex> lock(dump_lock_);
+    pending_dumps_.push_back(std::move(request));
+  }
+  dump_condition_.notify_one();
+  return true;
+}
+
+void ExceptionHandlerServer::RunDumpWorker() {
+  std::unique_lock<std::mutex> lock(dump_lock_);
+  while (true) {
+    // Take the oldest request whose client isn't already being dumped by
+    // another worker, so that each client's requests are serviced in order.
+    auto request_iter = pending_dumps_.begin();
+    while (request_iter != pending_dumps_.end() &&
+           busy_clients_.find((*request_iter)->creds.pid) !=
+               busy_clients_.end()) {
+      ++request_iter;
+    }
+
+    if (request_iter == pending_dumps_.end()) {
+      if (stop_dump_workers_ && pending_dumps_.empty()) {
+        return;
+      }
+      dump_condition_.wait(lock);
+      continue;
+    }
+
+    std::unique_ptr<DumpRequest> request = std::move(*request_iter);
+    pending_dumps_.erase(request_iter);
+    busy_clients_.insert(request->creds.pid);
+    lock.unlock();
+
+    request->result = HandleCrashDumpRequest(
+        request->creds,
+        request->client_info,
+        request->requesting_thread_stack_address,
+        request->client_sock,
+        request->client_type == Event::Type::kSharedSocketMessage);
+
+    lock.lock();
+    busy_clients_.erase(request->creds.pid);
+    completed_dumps_.push_back(std::move(request));
+
+    uint64_t value = 1;
+    LoggingWriteFile(dump_complete_event_->fd.get(), &value, sizeof(value));
+
+    // Wake workers that may be waiting for this client to become available.
+    dump_condition_.notify_all();
+  }
+}
+
+void ExceptionHandlerServer::StartDumpWorkers() {
+  if (max_concurrent_dumps_ <= 1) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(dump_lock_);
+    stop_dump_workers_ = false;
+  }
+
+  for (size_t index = 0; index < max_concurrent_dumps_; ++index) {
+    dump_workers_.push_back(std::make_unique<DumpWorker>(this));
+    dump_workers_.back()->Start();
+  }
+}
+
+void ExceptionHandlerServer::StopDumpWorkers() {
+  if (dump_workers_.empty()) {
+    return;
+  }
+
+  // Clients that have already requested a dump are blocked waiting for it, so
+  // let the workers finish any queued requests before exiting.
+  {
+    std::lock_guard<std::mutex> lock(dump_lock_);
+    stop_dump_workers_ = true;
+  }
+  dump_condition_.notify_all();
+
+  for (auto& worker : dump_workers_) {
+    worker->Join();
+  }
+  dump_workers_.clear();
+
+  CollectCompletedDumps();
+}
+
+void ExceptionHandlerServer::CollectCompletedDumps() {
+  uint64_t value;
+  if (HANDLE_EINTR(
+          read(dump_complete_event_->fd.get(), &value, sizeof(value))) < 0 &&
+      errno != EAGAIN) {
+    PLOG(ERROR) << "read";
+  }
+
+  std::vector<std::unique_ptr<DumpRequest>> completed_dumps;
+  {
+    std::lock_guard<std::mutex> lock(dump_lock_);
+    completed_dumps.swap(completed_dumps_);
+  }
+
+  for (const auto& request : completed_dumps) {
+    Event* event = request->client;
+    DCHECK_GT(event->dumps_in_progress, 0u);
+    --event->dumps_in_progress;
+
+    // The socket may have been uninstalled while its dumps were in progress.
+    if (event->uninstall_pending) {
+      if (event->dumps_in_progress == 0) {
+        clients_.erase(event->fd.get());
+      }
+      continue;
+    }
+
+    if (!request->result) {
+      UninstallClientSocket(event);
+      continue;
+    }
+    RearmClientSocket(event);
+  }
+}
+
 }  // namespace crashpad
@@ -19,8 +19,13 @@
 #include <sys/socket.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
 #include "base/macros.h"
 #include "util/file/file_io.h"
@@ -75,6 +80,11 @@ class ExceptionHandlerServer {
    public:
     //! \brief Called on receipt of a crash dump request from a client.
     //!
+    //! If concurrent dumps have been enabled with
+    //! ExceptionHandlerServer::SetMaxConcurrentDumps(), this method and
+    //! HandleExceptionWithBroker() may be called simultaneously on multiple
+    //! threads, but never simultaneously for the same client.
+    //!
     //! \param[in] client_process_id The process ID of the crashing client.
     //! \param[in] client_uid The user ID of the crashing client.
     //! \param[in] info Information on the client.
@@ -124,6 +134,25 @@ class ExceptionHandlerServer {
   //! used.
   void SetPtraceStrategyDecider(std::unique_ptr<PtraceStrategyDecider> decider);
 
+  //! \brief Sets the maximum number of crash dump requests that may be
+  //!     serviced at the same time.
+  //!
+  //! By default, crash dump requests are serviced one at a time on the thread
+  //! that called Run(). If \a max_concurrent_dumps is greater than `1`, Run()
+  //! hands crash dump requests to a pool of that many worker threads, so that
+  //! independent clients are dumped in parallel while the server continues to
+  //! receive requests. Requests from a single client are always serviced one
+  //! at a time, in the order in which they were received.
+  //!
+  //! The Delegate passed to Run() must be safe to call from multiple threads
+  //! when \a max_concurrent_dumps is greater than `1`.
+  //!
+  //! This method must be called before InitializeWithClient().
+  //!
+  //! \param[in] max_concurrent_dumps The maximum number of concurrent dumps.
+  //!     Must be at least `1`.
+  void SetMaxConcurrentDumps(size_t max_concurrent_dumps);
+
   //! \brief Initializes this object.
   //!
   //! This method must be successfully called before Run().
@@ -139,7 +168,8 @@ class ExceptionHandlerServer {
   //!
   //! This method must only be called once on an ExceptionHandlerServer object.
   //! This method returns when there are no more client connections or Stop()
-  //! has been called.
+  //! has been called. If concurrent dumps are enabled, crash dump requests that
+  //! have already been received are serviced before this method returns.
   //!
   //! \param[in] delegate An object to send exceptions to.
   void Run(Delegate* delegate);
@@ -162,17 +192,53 @@ class ExceptionHandlerServer {
       kClientMessage,
 
       // A message from a client on a shared socket connection.
-      kSharedSocketMessage
+      kSharedSocketMessage,
+
+      // Used by dump workers to report completed crash dump requests.
+      kDumpComplete
     };
 
     Type type;
     ScopedFileHandle fd;
+
+    // The number of crash dump requests received on this socket that are being
+    // serviced by dump workers. A private socket is not monitored for further
+    // messages while this is nonzero.
+    size_t dumps_in_progress;
+
+    // Whether the socket has been removed from the poll set but is being kept
+    // open until dumps_in_progress reaches zero. This keeps its descriptor
+    // from being reused by a new client while a dump worker is using it.
+    bool uninstall_pending;
   };
 
+  // A crash dump request handed from Run() to a dump worker.
+  struct DumpRequest {
+    ucred creds;
+    ExceptionHandlerProtocol::ClientInformation client_info;
+    VMAddress requesting_thread_stack_address;
+    Event* client;  // weak
+    int client_sock;
+    Event::Type client_type;
+    bool result;
+  };
+
+  class DumpWorker;
+
   void HandleEvent(Event* event, uint32_t event_type);
   bool InstallClientSocket(ScopedFileHandle socket, Event::Type type);
   bool UninstallClientSocket(Event* event);
+  bool RearmClientSocket(Event* event);
   bool ReceiveClientMessage(Event* event);
+  bool DispatchCrashDumpRequest(
+      Event* event,
+      const ucred& creds,
+      const ExceptionHandlerProtocol::ClientInformation& client_info,
+      VMAddress requesting_thread_stack_address);
+  void RunDumpWorker();
+  void StartDumpWorkers();
+  void StopDumpWorkers();
+  void CollectCompletedDumps();
   bool HandleCrashDumpRequest(
       const ucred& creds,
       const ExceptionHandlerProtocol::ClientInformation& client_info,
@@ -182,6 +248,19 @@ class ExceptionHandlerServer {
 
   std::unordered_map<int, std::unique_ptr<Event>> clients_;
   std::unique_ptr<Event> shutdown_event_;
+  std::unique_ptr<Event> dump_complete_event_;
+  std::vector<std::unique_ptr<DumpWorker>> dump_workers_;
+
+  std::mutex dump_lock_;
+  std::condition_variable dump_condition_;
+
+  // The following members are guarded by dump_lock_.
+  std::deque<std::unique_ptr<DumpRequest>> pending_dumps_;
+  std::vector<std::unique_ptr<DumpRequest>> completed_dumps_;
+  std::set<pid_t> busy_clients_;
+  bool stop_dump_workers_;
+
+  size_t max_concurrent_dumps_;
   std::unique_ptr<PtraceStrategyDecider> strategy_decider_;
   Delegate* delegate_;
   ScopedFileHandle pollfd_;
@@ -15,9 +15,18 @@
 #include "handler/linux/exception_handler_server.h"
 
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
 #include "build/build_config.h"
 #include "gtest/gtest.h"
 #include "snapshot/linux/process_snapshot_linux.h"
@@ -370,6 +379,201 @@ INSTANTIATE_TEST_SUITE_P(ExceptionHandlerServerTestSuite,
                          testing::Bool()
 );
 
+// Holds each crash dump until a target number of dumps have been in progress
+// at once, and records the largest number of dumps that were in progress at
+// once. If the target is never reached, dumps are released after a timeout so
+// that the test fails rather than hangs.
+class ConcurrentDumpDelegate : public ExceptionHandlerServer::Delegate {
+ public:
+  explicit ConcurrentDumpDelegate(size_t target_dumps_in_progress)
+      : Delegate(),
+        lock_(),
+        condition_(),
+        target_dumps_in_progress_(target_dumps_in_progress),
+        dumps_in_progress_(0),
+        max_dumps_in_progress_(0),
+        dumps_completed_(0) {}
+
+  ~ConcurrentDumpDelegate() {}
+
+  size_t MaxDumpsInProgress() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return max_dumps_in_progress_;
+  }
+
+  size_t DumpsCompleted() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return dumps_completed_;
+  }
+
+  bool HandleException(pid_t client_process_id,
+                       uid_t client_uid,
+                       const ExceptionHandlerProtocol::ClientInformation& info,
+                       VMAddress requesting_thread_stack_address,
+                       pid_t* requesting_thread_id = nullptr,
+                       UUID* local_report_id = nullptr) override {
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      ++dumps_in_progress_;
+      max_dumps_in_progress_ =
+          std::max(max_dumps_in_progress_, dumps_in_progress_);
+      condition_.notify_all();
+      condition_.wait_for(lock, std::chrono::seconds(10), [this]() {
+        return max_dumps_in_progress_ >= target_dumps_in_progress_;
+      });
+      --dumps_in_progress_;
+      ++dumps_completed_;
+    }
+
+    if (requesting_thread_id) {
+      *requesting_thread_id = -1;
+    }
+    return true;
+  }
+
+  bool HandleExceptionWithBroker(
+      pid_t client_process_id,
+      uid_t client_uid,
+      const ExceptionHandlerProtocol::ClientInformation& info,
+      int broker_sock,
+      UUID* local_report_id = nullptr) override {
+    ADD_FAILURE() << "unexpected broker";
+    return false;
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable condition_;
+  const size_t target_dumps_in_progress_;
+  size_t dumps_in_progress_;
+  size_t max_dumps_in_progress_;
+  size_t dumps_completed_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentDumpDelegate);
+};
+
+// Forks kClients children which simultaneously request crash dumps on a shared
+// socket, and waits for all of them to be released.
+void RunSimultaneousCrashes(size_t max_concurrent_dumps,
+                            ConcurrentDumpDelegate* delegate) {
+  constexpr size_t kClients = 8;
+
+  int socks[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socks), 0);
+  ScopedFileHandle sock_to_handler(socks[0]);
+
+  ExceptionHandlerServer server;
+  server.SetMaxConcurrentDumps(max_concurrent_dumps);
+  server.SetPtraceStrategyDecider(std::make_unique<MockPtraceStrategyDecider>(
+      PtraceStrategyDecider::Strategy::kDirectPtrace));
+  ASSERT_TRUE(server.InitializeWithClient(ScopedFileHandle(socks[1]), true));
+
+  RunServerThread server_thread(&server, delegate);
+  ScopedStopServerAndJoinThread stop_server(&server, &server_thread);
+  server_thread.Start();
+
+  pid_t children[kClients];
+  for (size_t index = 0; index < kClients; ++index) {
+    children[index] = fork();
+    ASSERT_GE(children[index], 0) << ErrnoMessage("fork");
+    if (children[index] == 0) {
+      ExceptionHandlerProtocol::ClientInformation info = {};
+      info.exception_information_address = 42;
+      ExceptionHandlerClient client(sock_to_handler.get(), true);
+      _exit(client.RequestCrashDump(info) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  }
+
+  for (size_t index = 0; index < kClients; ++index) {
+    int status;
+    ASSERT_EQ(HANDLE_EINTR(waitpid(children[index], &status, 0)),
+              children[index])
+        << ErrnoMessage("waitpid");
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), EXIT_SUCCESS);
+  }
+
+  EXPECT_EQ(delegate->DumpsCompleted(), kClients);
+}
+
+TEST(ExceptionHandlerServerConcurrency, SimultaneousCrashes) {
+  ConcurrentDumpDelegate serial_delegate(1);
+  ASSERT_NO_FATAL_FAILURE(RunSimultaneousCrashes(1, &serial_delegate));
+  EXPECT_EQ(serial_delegate.MaxDumpsInProgress(), 1u);
+
+  // Each dump is held until the worker limit is reached, so the dumps must
+  // overlap for the clients to be released promptly.
+  constexpr size_t kMaxConcurrentDumps = 4;
+  ConcurrentDumpDelegate concurrent_delegate(kMaxConcurrentDumps);
+  ASSERT_NO_FATAL_FAILURE(
+      RunSimultaneousCrashes(kMaxConcurrentDumps, &concurrent_delegate));
+  EXPECT_EQ(concurrent_delegate.MaxDumpsInProgress(), kMaxConcurrentDumps);
+}
+
+TEST(ExceptionHandlerServerConcurrency, PrivateSocketsRearmed) {
+  // Each client has its own server and private socket, and sends a second
+  // request after the first has been handled. The second request is only
+  // received if the socket was rearmed once the first dump completed.
+  constexpr size_t kClients = 4;
+  constexpr size_t kRequestsPerClient = 2;
+  constexpr size_t kMaxConcurrentDumps = 2;
+
+  ConcurrentDumpDelegate delegate(1);
+  std::vector<std::unique_ptr<ExceptionHandlerServer>> servers;
+  std::vector<std::unique_ptr<RunServerThread>> server_threads;
+  std::vector<std::unique_ptr<ScopedStopServerAndJoinThread>> stop_servers;
+  pid_t children[kClients];
+  for (size_t index = 0; index < kClients; ++index) {
+    int socks[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socks), 0);
+    ScopedFileHandle sock_to_handler(socks[0]);
+
+    servers.push_back(std::make_unique<ExceptionHandlerServer>());
+    ExceptionHandlerServer* server = servers.back().get();
+    server->SetMaxConcurrentDumps(kMaxConcurrentDumps);
+    server->SetPtraceStrategyDecider(
+        std::make_unique<MockPtraceStrategyDecider>(
+            PtraceStrategyDecider::Strategy::kDirectPtrace));
+    ASSERT_TRUE(
+        server->InitializeWithClient(ScopedFileHandle(socks[1]), false));
+
+    server_threads.push_back(
+        std::make_unique<RunServerThread>(server, &delegate));
+    stop_servers.push_back(std::make_unique<ScopedStopServerAndJoinThread>(
+        server, server_threads.back().get()));
+    server_threads.back()->Start();
+
+    children[index] = fork();
+    ASSERT_GE(children[index], 0) << ErrnoMessage("fork");
+    if (children[index] == 0) {
+      // A request that is never received would otherwise hang the test.
+      alarm(10);
+
+      ExceptionHandlerProtocol::ClientInformation info = {};
+      info.exception_information_address = 42;
+      ExceptionHandlerClient client(sock_to_handler.get(), false);
+      for (size_t request = 0; request < kRequestsPerClient; ++request) {
+        if (client.RequestCrashDump(info) != 0) {
+          _exit(EXIT_FAILURE);
+        }
+      }
+      _exit(EXIT_SUCCESS);
+    }
+  }
+
+  for (size_t index = 0; index < kClients; ++index) {
+    int status;
+    ASSERT_EQ(HANDLE_EINTR(waitpid(children[index], &status, 0)),
+              children[index])
+        << ErrnoMessage("waitpid");
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), EXIT_SUCCESS);
+  }
+
+  stop_servers.clear();
+  EXPECT_EQ(delegate.DumpsCompleted(), kClients * kRequestsPerClient);
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace crashpad
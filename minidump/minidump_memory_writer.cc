@@ -14,17 +14,242 @@
 
 #include "minidump/minidump_memory_writer.h"
 
+#include <string.h>
+
 #include <algorithm>
 #include <iterator>
+#include <map>
 #include <utility>
 
 #include "base/auto_reset.h"
 #include "base/logging.h"
 #include "util/file/file_writer.h"
 #include "util/numeric/safe_assignment.h"
+#include "util/process/process_memory.h"
 
 namespace crashpad {
 
+namespace {
+
+// The size of the pieces that large memory regions are read and written in.
+constexpr size_t kChunkSize = 64 * 1024;
+
+// Returns a buffer of kChunkSize bytes, each of which is the value that is
+// written in place of memory that couldn’t be read.
+const uint8_t* UnreadableMemoryChunk() {
+  static const uint8_t* const chunk = []() {
+    uint8_t* chunk = new uint8_t[kChunkSize];
+    memset(chunk, 0xfe, kChunkSize);
+    return chunk;
+  }();
+  return chunk;
+}
+
+// Writes size bytes of the value used in place of memory that couldn’t be read,
+// without allocating a buffer of that size.
+bool WriteUnreadableMemory(FileWriterInterface* file_writer, uint64_t size) {
+  std::vector<WritableIoVec> iovecs;
+  while (size > 0) {
+    WritableIoVec iov;
+    iov.iov_base = UnreadableMemoryChunk();
+    iov.iov_len = static_cast<size_t>(std::min(size, uint64_t{kChunkSize}));
+    iovecs.push_back(iov);
+    size -= iov.iov_len;
+  }
+  return iovecs.empty() || file_writer->WriteIoVec(&iovecs);
+}
+
+}  // namespace
+
+namespace internal {
+
+// Reads the data of the SnapshotMinidumpMemoryWriter objects listed by a
+// MinidumpMemoryListWriter in batches, in the order that the objects are
+// written. Each batch holds the data of consecutive objects whose snapshots are
+// copied from the same ProcessMemory, so that it can be read with a single
+// ProcessMemory::ReadMultiple() call. Batches are limited to kBatchSize bytes,
+// and only one batch is held at a time. Objects larger than that are instead
+// streamed by WriteStreamed() through a buffer of kBatchSize bytes, so that the
+// memory used to write a minidump doesn’t depend on the size of the regions in
+// it.
+class MinidumpMemoryBatchReader {
+ public:
+  explicit MinidumpMemoryBatchReader(
+      const std::vector<SnapshotMinidumpMemoryWriter*>& memory_writers)
+      : memory_writers_(memory_writers),
+        batch_data_(),
+        batch_(),
+        stream_data_(),
+        sorted_(false) {}
+
+  ~MinidumpMemoryBatchReader() {}
+
+  // Returns the data for memory_writer, reading the batch that contains it if
+  // it isn’t in the current batch. Returns nullptr if the data couldn’t be read
+  // in a batch, in which case it should be obtained with
+  // MemorySnapshot::Read().
+  uint8_t* DataForWriter(const SnapshotMinidumpMemoryWriter* memory_writer) {
+    if (!sorted_) {
+      // All offsets are known by the time that the first object is written.
+      std::stable_sort(memory_writers_.begin(),
+                       memory_writers_.end(),
+                       [](const SnapshotMinidumpMemoryWriter* a,
+                          const SnapshotMinidumpMemoryWriter* b) {
+                         return a->file_offset_ < b->file_offset_;
+                       });
+      sorted_ = true;
+    }
+
+    auto batch_iterator = batch_.find(memory_writer);
+    if (batch_iterator == batch_.end()) {
+      auto iterator = std::lower_bound(
+          memory_writers_.begin(),
+          memory_writers_.end(),
+          memory_writer->file_offset_,
+          [](const SnapshotMinidumpMemoryWriter* a, FileOffset offset) {
+            return a->file_offset_ < offset;
+          });
+      while (iterator != memory_writers_.end() && *iterator != memory_writer) {
+        ++iterator;
+      }
+      DCHECK(iterator != memory_writers_.end());
+
+      ReadBatch(iterator - memory_writers_.begin());
+      batch_iterator = batch_.find(memory_writer);
+      if (batch_iterator == batch_.end()) {
+        return nullptr;
+      }
+    }
+    return batch_iterator->second;
+  }
+
+  // Returns true if snapshot’s data should be written with WriteStreamed()
+  // rather than obtained from DataForWriter().
+  static bool ShouldStream(const MemorySnapshot* snapshot) {
+    return snapshot->SourceProcessMemory() && snapshot->Size() > kBatchSize;
+  }
+
+  // Copies snapshot’s data from its ProcessMemory to file_writer, kBatchSize
+  // bytes at a time. Each batch is read as a series of kChunkSize requests with
+  // a single ProcessMemory::ReadMultiple() call, and written with a single
+  // FileWriterInterface::WriteIoVec() call. Chunks that can’t be read are
+  // written as 0xfe. Returns false only if writing fails.
+  bool WriteStreamed(const MemorySnapshot* snapshot,
+                     FileWriterInterface* file_writer) {
+    DCHECK(ShouldStream(snapshot));
+
+    // The current batch won’t be needed again, because objects are written in
+    // order and this object isn’t part of it.
+    batch_.clear();
+    batch_data_.reset();
+    if (!stream_data_) {
+      stream_data_.reset(new uint8_t[kBatchSize]);
+    }
+
+    const ProcessMemory* memory = snapshot->SourceProcessMemory();
+    std::vector<ProcessMemory::ReadRequest> requests;
+    std::vector<WritableIoVec> iovecs;
+    for (size_t offset = 0; offset < snapshot->Size(); offset += kBatchSize) {
+      const size_t batch_size =
+          std::min(size_t{kBatchSize}, snapshot->Size() - offset);
+
+      requests.clear();
+      for (size_t chunk_offset = 0; chunk_offset < batch_size;
+           chunk_offset += kChunkSize) {
+        ProcessMemory::ReadRequest request;
+        request.address = snapshot->Address() + offset + chunk_offset;
+        request.size = std::min(kChunkSize, batch_size - chunk_offset);
+        request.buffer = &stream_data_[chunk_offset];
+        request.succeeded = false;
+        requests.push_back(request);
+      }
+
+      // Failures are logged.
+      memory->ReadMultiple(&requests[0], requests.size());
+
+      iovecs.clear();
+      for (const ProcessMemory::ReadRequest& request : requests) {
+        WritableIoVec iov;
+        iov.iov_base =
+            request.succeeded ? request.buffer : UnreadableMemoryChunk();
+        iov.iov_len = request.size;
+        iovecs.push_back(iov);
+      }
+      if (!file_writer->WriteIoVec(&iovecs)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  static constexpr size_t kBatchSize = 4 * 1024 * 1024;
+
+  void ReadBatch(size_t first_index) {
+    batch_.clear();
+    batch_data_.reset();
+
+    const ProcessMemory* memory = memory_writers_[first_index]
+                                      ->UnderlyingSnapshot()
+                                      ->SourceProcessMemory();
+    if (!memory) {
+      return;
+    }
+
+    std::vector<ProcessMemory::ReadRequest> requests;
+    size_t batch_size = 0;
+    for (size_t index = first_index; index < memory_writers_.size(); ++index) {
+      const MemorySnapshot* snapshot =
+          memory_writers_[index]->UnderlyingSnapshot();
+      if (snapshot->SourceProcessMemory() != memory ||
+          snapshot->Size() > kBatchSize - batch_size) {
+        break;
+      }
+
+      ProcessMemory::ReadRequest request;
+      request.address = snapshot->Address();
+      request.size = snapshot->Size();
+      request.buffer = nullptr;
+      request.succeeded = false;
+      requests.push_back(request);
+      batch_size += request.size;
+    }
+
+    if (requests.empty()) {
+      return;
+    }
+
+    batch_data_.reset(new uint8_t[batch_size]);
+    size_t offset = 0;
+    for (ProcessMemory::ReadRequest& request : requests) {
+      request.buffer = &batch_data_[offset];
+      offset += request.size;
+    }
+
+    // Failures are logged, and the objects whose data couldn’t be read are
+    // recorded without data so that it’s obtained with MemorySnapshot::Read().
+    memory->ReadMultiple(&requests[0], requests.size());
+
+    for (size_t index = 0; index < requests.size(); ++index) {
+      batch_[memory_writers_[first_index + index]] =
+          requests[index].succeeded
+              ? static_cast<uint8_t*>(requests[index].buffer)
+              : nullptr;
+    }
+  }
+
+  std::vector<SnapshotMinidumpMemoryWriter*> memory_writers_;  // weak
+  std::unique_ptr<uint8_t[]> batch_data_;
+  std::map<const SnapshotMinidumpMemoryWriter*, uint8_t*> batch_;
+  std::unique_ptr<uint8_t[]> stream_data_;
+  bool sorted_;
+
+  DISALLOW_COPY_AND_ASSIGN(MinidumpMemoryBatchReader);
+};
+
+}  // namespace internal
+
 SnapshotMinidumpMemoryWriter::SnapshotMinidumpMemoryWriter(
     const MemorySnapshot* memory_snapshot)
     : internal::MinidumpWritable(),
@@ -32,7 +257,9 @@ SnapshotMinidumpMemoryWriter::SnapshotMinidumpMemoryWriter(
       memory_descriptor_(),
       registered_memory_descriptors_(),
       memory_snapshot_(memory_snapshot),
-      file_writer_(nullptr) {}
+      file_writer_(nullptr),
+      batch_reader_(nullptr),
+      file_offset_(0) {}
 
 SnapshotMinidumpMemoryWriter::~SnapshotMinidumpMemoryWriter() {}
 
@@ -51,6 +278,17 @@ bool SnapshotMinidumpMemoryWriter::WriteObject(
   base::AutoReset<FileWriterInterface*> file_writer_reset(&file_writer_,
                                                           file_writer);
 
+  if (batch_reader_) {
+    if (internal::MinidumpMemoryBatchReader::ShouldStream(memory_snapshot_)) {
+      return batch_reader_->WriteStreamed(memory_snapshot_, file_writer);
+    }
+
+    uint8_t* data = batch_reader_->DataForWriter(this);
+    if (data) {
+      return MemorySnapshotDelegateRead(data, memory_snapshot_->Size());
+    }
+  }
+
   // This will result in MemorySnapshotDelegateRead() being called.
   if (!memory_snapshot_->Read(this)) {
     // If the Read() fails (perhaps because the process' memory map has changed
@@ -58,8 +296,7 @@ bool SnapshotMinidumpMemoryWriter::WriteObject(
     // would be nice to instead not include this memory, but at this point in
     // the writing process, it would be difficult to amend the minidump's
     // structure. See https://crashpad.chromium.org/234 for background.
-    std::vector<uint8_t> empty(memory_snapshot_->Size(), 0xfe);
-    MemorySnapshotDelegateRead(empty.data(), empty.size());
+    return WriteUnreadableMemory(file_writer, memory_snapshot_->Size());
   }
 
   return true;
@@ -123,6 +360,8 @@ bool SnapshotMinidumpMemoryWriter::WillWriteAtOffsetImpl(FileOffset offset) {
     memory_descriptor->StartOfMemoryRange = local_address;
   }
 
+  file_offset_ = offset;
+
   return MinidumpWritable::WillWriteAtOffsetImpl(offset);
 }
 
@@ -141,6 +380,7 @@ MinidumpMemoryListWriter::MinidumpMemoryListWriter()
       children_(),
       snapshots_created_during_merge_(),
       all_memory_writers_(),
+      batch_reader_(),
       memory_list_base_() {}
 
 MinidumpMemoryListWriter::~MinidumpMemoryListWriter() {
@@ -230,6 +470,11 @@ bool MinidumpMemoryListWriter::Freeze() {
   for (const auto& ptr : children_)
     all_memory_writers_.push_back(ptr.get());
 
+  batch_reader_.reset(
+      new internal::MinidumpMemoryBatchReader(all_memory_writers_));
+  for (SnapshotMinidumpMemoryWriter* memory_writer : all_memory_writers_)
+    memory_writer->batch_reader_ = batch_reader_.get();
+
   if (!MinidumpStreamWriter::Freeze()) {
     return false;
   }
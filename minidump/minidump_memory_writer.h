@@ -31,6 +31,10 @@
 
 namespace crashpad {
 
+namespace internal {
+class MinidumpMemoryBatchReader;
+}  // namespace internal
+
 //! \brief The base class for writers of memory ranges pointed to by
 //!     MINIDUMP_MEMORY_DESCRIPTOR objects in a minidump file.
 class SnapshotMinidumpMemoryWriter : public internal::MinidumpWritable,
@@ -68,6 +72,7 @@ class SnapshotMinidumpMemoryWriter : public internal::MinidumpWritable,
 
  private:
   friend class MinidumpMemoryListWriter;
+  friend class internal::MinidumpMemoryBatchReader;
 
   // MemorySnapshot::Delegate:
   bool MemorySnapshotDelegateRead(void* data, size_t size) override;
@@ -112,6 +117,11 @@ class SnapshotMinidumpMemoryWriter : public internal::MinidumpWritable,
   const MemorySnapshot* memory_snapshot_;
   FileWriterInterface* file_writer_;
 
+  // Set by a MinidumpMemoryListWriter that lists this object, to read this
+  // object’s data in a batch with other objects that it lists.
+  internal::MinidumpMemoryBatchReader* batch_reader_;  // weak
+  FileOffset file_offset_;
+
   DISALLOW_COPY_AND_ASSIGN(SnapshotMinidumpMemoryWriter);
 };
 
@@ -196,6 +206,7 @@ class MinidumpMemoryListWriter final : public internal::MinidumpStreamWriter {
   std::vector<std::unique_ptr<const MemorySnapshot>>
       snapshots_created_during_merge_;
   std::vector<SnapshotMinidumpMemoryWriter*> all_memory_writers_;  // weak
+  std::unique_ptr<internal::MinidumpMemoryBatchReader> batch_reader_;
   MINIDUMP_MEMORY_LIST memory_list_base_;
 
   DISALLOW_COPY_AND_ASSIGN(MinidumpMemoryListWriter);
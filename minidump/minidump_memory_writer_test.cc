@@ -14,19 +14,40 @@
 
 #include "minidump/minidump_memory_writer.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <utility>
+#include <vector>
 
 #include "base/format_macros.h"
 #include "base/stl_util.h"
 #include "base/strings/stringprintf.h"
+#include "build/build_config.h"
 #include "gtest/gtest.h"
 #include "minidump/minidump_extensions.h"
 #include "minidump/minidump_file_writer.h"
 #include "minidump/test/minidump_file_writer_test_util.h"
 #include "minidump/test/minidump_memory_writer_test_util.h"
 #include "minidump/test/minidump_writable_test_util.h"
+#include "snapshot/memory_snapshot_generic.h"
 #include "snapshot/test/test_memory_snapshot.h"
 #include "util/file/string_file.h"
+#include "util/process/process_memory.h"
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "base/files/file_path.h"
+#include "base/logging.h"
+#include "util/file/file_io.h"
+#include "util/file/file_writer.h"
+#include "util/misc/clock.h"
+#include "util/posix/scoped_mmap.h"
+#include "util/process/process_memory_linux.h"
+#endif  // OS_LINUX || OS_ANDROID
 
 namespace crashpad {
 namespace test {
@@ -230,6 +251,305 @@ TEST(MinidumpMemoryWriter, RegionReadFails) {
       true);
 }
 
+// A ProcessMemory backed by a local buffer, of which only a prefix is readable,
+// that counts the calls made to it.
+class CountingProcessMemory final : public ProcessMemory {
+ public:
+  CountingProcessMemory(VMAddress base, size_t size, size_t readable_size)
+      : ProcessMemory(),
+        data_(size),
+        base_(base),
+        readable_size_(readable_size),
+        reads_(0),
+        batches_(0) {
+    for (size_t index = 0; index < size; ++index) {
+      data_[index] = static_cast<uint8_t>(index % 251);
+    }
+  }
+
+  ~CountingProcessMemory() override {}
+
+  const uint8_t* Data() const { return data_.data(); }
+  VMAddress Base() const { return base_; }
+  size_t Reads() const { return reads_; }
+  size_t Batches() const { return batches_; }
+
+ private:
+  ssize_t ReadUpTo(VMAddress address,
+                   size_t size,
+                   void* buffer) const override {
+    ++reads_;
+    if (address < base_ || address >= base_ + readable_size_) {
+      return -1;
+    }
+    size_t offset = address - base_;
+    size_t copy_size = std::min(size, readable_size_ - offset);
+    memcpy(buffer, &data_[offset], copy_size);
+    return copy_size;
+  }
+
+  void ReadMultipleImpl(ReadRequest* requests, size_t count) const override {
+    ++batches_;
+    ProcessMemory::ReadMultipleImpl(requests, count);
+  }
+
+  std::vector<uint8_t> data_;
+  VMAddress base_;
+  size_t readable_size_;
+  mutable size_t reads_;
+  mutable size_t batches_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingProcessMemory);
+};
+
+TEST(MinidumpMemoryWriter, BatchedReads) {
+  constexpr VMAddress kBaseAddress = 0x10000;
+  constexpr size_t kReadableSize = 0x3000;
+  CountingProcessMemory process_memory(kBaseAddress, 0x4000, kReadableSize);
+
+  struct {
+    VMAddress offset;
+    size_t size;
+  } const kRegions[] = {
+      {0x0, 0x100},
+      {0x1000, 0x800},
+      {0x2ff0, 0x10},
+      {0x3800, 0x100},  // Unreadable.
+  };
+
+  std::vector<std::unique_ptr<internal::MemorySnapshotGeneric>> snapshots;
+  std::vector<const MemorySnapshot*> snapshot_pointers;
+  for (const auto& region : kRegions) {
+    snapshots.push_back(std::make_unique<internal::MemorySnapshotGeneric>());
+    snapshots.back()->Initialize(
+        &process_memory, kBaseAddress + region.offset, region.size);
+    snapshot_pointers.push_back(snapshots.back().get());
+  }
+
+  MinidumpFileWriter minidump_file_writer;
+  auto memory_list_writer = std::make_unique<MinidumpMemoryListWriter>();
+  memory_list_writer->AddFromSnapshot(snapshot_pointers);
+  ASSERT_TRUE(minidump_file_writer.AddStream(std::move(memory_list_writer)));
+
+  StringFile string_file;
+  ASSERT_TRUE(minidump_file_writer.WriteEverything(&string_file));
+
+  // All of the regions are read in one batch. The unreadable region is read
+  // once more through MemorySnapshot::Read() before being written as 0xfe.
+  EXPECT_EQ(process_memory.Batches(), 1u);
+  EXPECT_EQ(process_memory.Reads(), base::size(kRegions) + 1);
+
+  const MINIDUMP_MEMORY_LIST* memory_list = nullptr;
+  ASSERT_NO_FATAL_FAILURE(
+      GetMemoryListStream(string_file.string(), &memory_list, 1));
+  ASSERT_EQ(memory_list->NumberOfMemoryRanges, base::size(kRegions));
+
+  for (size_t index = 0; index < base::size(kRegions); ++index) {
+    SCOPED_TRACE(base::StringPrintf("index %" PRIuS, index));
+    const MINIDUMP_MEMORY_DESCRIPTOR& descriptor =
+        memory_list->MemoryRanges[index];
+    EXPECT_EQ(descriptor.StartOfMemoryRange,
+              kBaseAddress + kRegions[index].offset);
+    ASSERT_EQ(descriptor.Memory.DataSize, kRegions[index].size);
+    ASSERT_LE(descriptor.Memory.Rva + descriptor.Memory.DataSize,
+              string_file.string().size());
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(
+        &string_file.string()[descriptor.Memory.Rva]);
+    if (kRegions[index].offset < kReadableSize) {
+      EXPECT_EQ(memcmp(data,
+                       process_memory.Data() + kRegions[index].offset,
+                       kRegions[index].size),
+                0);
+    } else {
+      EXPECT_EQ(std::count(data, data + kRegions[index].size, 0xfe),
+                static_cast<ptrdiff_t>(kRegions[index].size));
+    }
+  }
+}
+
+TEST(MinidumpMemoryWriter, StreamedRegion) {
+  // The large region spans several 4 MB batches, and the end of the readable
+  // part of it falls inside a 64 kB chunk.
+  constexpr VMAddress kBaseAddress = 0x100000;
+  constexpr size_t kSmallSize = 0x100;
+  constexpr size_t kLargeOffset = 0x1000;
+  constexpr size_t kLargeSize = 9 * 1024 * 1024 + 0x345;
+  constexpr size_t kReadableSize = kLargeOffset + 6 * 1024 * 1024 + 0x8010;
+  constexpr size_t kChunkSize = 64 * 1024;
+  CountingProcessMemory process_memory(
+      kBaseAddress, kLargeOffset + kLargeSize, kReadableSize);
+
+  internal::MemorySnapshotGeneric small_snapshot;
+  small_snapshot.Initialize(&process_memory, kBaseAddress, kSmallSize);
+  internal::MemorySnapshotGeneric large_snapshot;
+  large_snapshot.Initialize(
+      &process_memory, kBaseAddress + kLargeOffset, kLargeSize);
+
+  MinidumpFileWriter minidump_file_writer;
+  auto memory_list_writer = std::make_unique<MinidumpMemoryListWriter>();
+  memory_list_writer->AddFromSnapshot({&small_snapshot, &large_snapshot});
+  ASSERT_TRUE(minidump_file_writer.AddStream(std::move(memory_list_writer)));
+
+  StringFile string_file;
+  ASSERT_TRUE(minidump_file_writer.WriteEverything(&string_file));
+
+  // The small region is read in a batch of its own, and the large region is
+  // read one batch at a time, one chunk per request, without falling back to
+  // MemorySnapshot::Read() for the chunks that can’t be read. The chunk
+  // containing the end of the readable part takes a second read after its
+  // short first one.
+  constexpr size_t kBatchSize = 4 * 1024 * 1024;
+  EXPECT_EQ(process_memory.Batches(),
+            1 + (kLargeSize + kBatchSize - 1) / kBatchSize);
+  EXPECT_EQ(process_memory.Reads(),
+            2 + (kLargeSize + kChunkSize - 1) / kChunkSize);
+
+  const MINIDUMP_MEMORY_LIST* memory_list = nullptr;
+  ASSERT_NO_FATAL_FAILURE(
+      GetMemoryListStream(string_file.string(), &memory_list, 1));
+  ASSERT_EQ(memory_list->NumberOfMemoryRanges, 2u);
+
+  const MINIDUMP_MEMORY_DESCRIPTOR& small_descriptor =
+      memory_list->MemoryRanges[0];
+  EXPECT_EQ(small_descriptor.StartOfMemoryRange, kBaseAddress);
+  ASSERT_EQ(small_descriptor.Memory.DataSize, kSmallSize);
+  ASSERT_LE(small_descriptor.Memory.Rva + small_descriptor.Memory.DataSize,
+            string_file.string().size());
+  EXPECT_EQ(memcmp(&string_file.string()[small_descriptor.Memory.Rva],
+                   process_memory.Data(),
+                   kSmallSize),
+            0);
+
+  const MINIDUMP_MEMORY_DESCRIPTOR& large_descriptor =
+      memory_list->MemoryRanges[1];
+  EXPECT_EQ(large_descriptor.StartOfMemoryRange, kBaseAddress + kLargeOffset);
+  ASSERT_EQ(large_descriptor.Memory.DataSize, kLargeSize);
+  ASSERT_LE(large_descriptor.Memory.Rva + large_descriptor.Memory.DataSize,
+            string_file.string().size());
+
+  // Only whole chunks are written from memory. The chunk containing the end of
+  // the readable part is written as 0xfe, like the rest of the region after
+  // it.
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(
+      &string_file.string()[large_descriptor.Memory.Rva]);
+  const size_t written_size =
+      (kReadableSize - kLargeOffset) / kChunkSize * kChunkSize;
+  EXPECT_EQ(memcmp(data, process_memory.Data() + kLargeOffset, written_size),
+            0);
+  EXPECT_EQ(std::count(data + written_size, data + kLargeSize, 0xfe),
+            static_cast<ptrdiff_t>(kLargeSize - written_size));
+}
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+
+// Hides the ProcessMemory that a snapshot is copied from, so that its data is
+// obtained in full with Read() rather than streamed.
+class UnstreamedMemorySnapshot final : public MemorySnapshot {
+ public:
+  explicit UnstreamedMemorySnapshot(const MemorySnapshot* snapshot)
+      : MemorySnapshot(), snapshot_(snapshot) {}
+
+  ~UnstreamedMemorySnapshot() override {}
+
+  // MemorySnapshot:
+  uint64_t Address() const override { return snapshot_->Address(); }
+  size_t Size() const override { return snapshot_->Size(); }
+  bool Read(Delegate* delegate) const override {
+    return snapshot_->Read(delegate);
+  }
+  const MemorySnapshot* MergeWithOtherSnapshot(
+      const MemorySnapshot* other) const override {
+    return nullptr;
+  }
+
+ private:
+  const MemorySnapshot* snapshot_;  // weak
+
+  DISALLOW_COPY_AND_ASSIGN(UnstreamedMemorySnapshot);
+};
+
+// Returns the value, in kB, of the field named field in /proc/self/status.
+size_t ProcSelfStatusKB(const char* field) {
+  std::string contents;
+  if (!LoggingReadEntireFile(base::FilePath("/proc/self/status"),
+                             &contents)) {
+    return 0;
+  }
+  const std::string prefix = std::string("\n") + field + ":";
+  const size_t position = contents.find(prefix);
+  if (position == std::string::npos) {
+    return 0;
+  }
+  return strtoul(&contents[position + prefix.size()], nullptr, 10);
+}
+
+// Writes a minidump of snapshot to /dev/null and returns the growth of this
+// process’ peak resident set size, in kB, while doing so.
+size_t PeakRSSGrowthKB(const MemorySnapshot* snapshot) {
+  // Writing 5 resets the peak resident set size to the current one.
+  ScopedFileHandle clear_refs(
+      LoggingOpenFileForWrite(base::FilePath("/proc/self/clear_refs"),
+                              FileWriteMode::kReuseOrFail,
+                              FilePermissions::kOwnerOnly));
+  EXPECT_TRUE(clear_refs.is_valid());
+  EXPECT_TRUE(LoggingWriteFile(clear_refs.get(), "5", 1));
+  const size_t rss_before = ProcSelfStatusKB("VmRSS");
+
+  MinidumpFileWriter minidump_file_writer;
+  auto memory_list_writer = std::make_unique<MinidumpMemoryListWriter>();
+  memory_list_writer->AddFromSnapshot({snapshot});
+  EXPECT_TRUE(minidump_file_writer.AddStream(std::move(memory_list_writer)));
+
+  ScopedFileHandle dev_null(
+      LoggingOpenFileForWrite(base::FilePath("/dev/null"),
+                              FileWriteMode::kReuseOrFail,
+                              FilePermissions::kOwnerOnly));
+  EXPECT_TRUE(dev_null.is_valid());
+  WeakFileHandleFileWriter file_writer(dev_null.get());
+  EXPECT_TRUE(minidump_file_writer.WriteEverything(&file_writer));
+
+  const size_t peak = ProcSelfStatusKB("VmHWM");
+  return peak > rss_before ? peak - rss_before : 0;
+}
+
+TEST(MinidumpMemoryWriter, DISABLED_StreamingPeakRSSBenchmark) {
+  ProcessMemoryLinux process_memory;
+  ASSERT_TRUE(process_memory.Initialize(getpid()));
+
+  for (size_t size_mb : {16, 64, 256}) {
+    const size_t size = size_mb * 1024 * 1024;
+    ScopedMmap mapping;
+    ASSERT_TRUE(mapping.ResetMmap(nullptr,
+                                  size,
+                                  PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS,
+                                  -1,
+                                  0));
+    memset(mapping.addr(), 'm', size);
+
+    internal::MemorySnapshotGeneric snapshot;
+    snapshot.Initialize(
+        &process_memory, mapping.addr_as<VMAddress>(), mapping.len());
+    UnstreamedMemorySnapshot unstreamed_snapshot(&snapshot);
+
+    uint64_t start = ClockMonotonicNanoseconds();
+    const size_t unstreamed_kb = PeakRSSGrowthKB(&unstreamed_snapshot);
+    const uint64_t unstreamed_time = ClockMonotonicNanoseconds() - start;
+
+    start = ClockMonotonicNanoseconds();
+    const size_t streamed_kb = PeakRSSGrowthKB(&snapshot);
+    const uint64_t streamed_time = ClockMonotonicNanoseconds() - start;
+
+    LOG(INFO) << size_mb << " MB region: peak RSS growth " << unstreamed_kb
+              << " kB in " << unstreamed_time / 1000000
+              << " ms unstreamed, " << streamed_kb << " kB in "
+              << streamed_time / 1000000 << " ms streamed";
+  }
+}
+
+#endif  // OS_LINUX || OS_ANDROID
+
 class TestMemoryStream final : public internal::MinidumpStreamWriter {
  public:
   TestMemoryStream(uint64_t base_address, size_t size, uint8_t value)
@@ -16,50 +16,326 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 
 #include "base/logging.h"
 #include "base/stl_util.h"
+#include "build/build_config.h"
 #include "snapshot/memory_snapshot.h"
 
+#if defined(ARCH_CPU_X86_64)
+#include <emmintrin.h>
+#if defined(COMPILER_GCC)
+#include <immintrin.h>
+#endif  // COMPILER_GCC
+#elif defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
 namespace crashpad {
 namespace internal {
 
 namespace {
 
-void MaybeCaptureMemoryAround(CaptureMemory::Delegate* delegate,
-                              uint64_t address) {
-  constexpr uint64_t non_address_offset = 0x10000;
-  if (address < non_address_offset)
-    return;
+// Memory is captured in a window of kCaptureSize bytes starting
+// kRegisterByteOffset bytes before each pointer-like value.
+constexpr uint64_t kNonAddressOffset = 0x10000;
+constexpr uint64_t kRegisterByteOffset = 128;
+constexpr uint64_t kCaptureSize = 512;
+static_assert(kRegisterByteOffset <= kCaptureSize / 2,
+              "negative offset too large");
 
-  const uint64_t max_address = delegate->Is64Bit() ?
-      std::numeric_limits<uint64_t>::max() :
-      std::numeric_limits<uint32_t>::max();
-  if (address > max_address - non_address_offset)
-    return;
+// Overlapping windows are merged into ranges of at most this size, so that a
+// single range can’t exceed the remaining budget by much.
+constexpr uint64_t kMaxMergedSize = 4096;
+
+// A value is pointer-like if it’s at least kNonAddressOffset and at most
+// kNonAddressOffset less than the largest value of its type.
+template <class T>
+bool IsPointerLike(T value) {
+  return static_cast<T>(value - kNonAddressOffset) <=
+         std::numeric_limits<T>::max() - 2 * kNonAddressOffset;
+}
+
+// Because kNonAddressOffset is a power of 2, a value is pointer-like exactly
+// when its bits at and above kNonAddressOffset are neither all clear nor all
+// set. SIMD instructions test this on several values at once.
+static_assert((kNonAddressOffset & (kNonAddressOffset - 1)) == 0,
+              "kNonAddressOffset must be a power of 2");
+
+// Appends the values at |values| whose lanes are set in |mask| to
+// |candidates|.
+template <class T>
+void AppendLanes(const T* values,
+                 size_t lanes,
+                 unsigned int mask,
+                 std::vector<uint64_t>* candidates) {
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    if (mask & (1u << lane)) {
+      candidates->push_back(values[lane]);
+    }
+  }
+}
+
+// Each Scan function examines as many whole vectors of |values| as fit in
+// |count|, appends the pointer-like ones to |candidates|, and returns the
+// number of values examined. Most values on a stack aren’t pointer-like, so
+// vectors without any are skipped without examining their values
+// individually.
+
+#if defined(ARCH_CPU_X86_64)
+
+size_t ScanSSE2(const uint32_t* values,
+                size_t count,
+                std::vector<uint64_t>* candidates) {
+  const __m128i high_bits =
+      _mm_set1_epi32(static_cast<int>(~(kNonAddressOffset - 1)));
+  const __m128i zero = _mm_setzero_si128();
+  size_t index = 0;
+  for (; index + 4 <= count; index += 4) {
+    const __m128i high = _mm_and_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + index)),
+        high_bits);
+    const __m128i rejected = _mm_or_si128(_mm_cmpeq_epi32(high, zero),
+                                          _mm_cmpeq_epi32(high, high_bits));
+    const unsigned int mask =
+        ~_mm_movemask_ps(_mm_castsi128_ps(rejected)) & 0xf;
+    if (mask) {
+      AppendLanes(values + index, 4, mask, candidates);
+    }
+  }
+  return index;
+}
+
+size_t ScanSSE2(const uint64_t* values,
+                size_t count,
+                std::vector<uint64_t>* candidates) {
+  const __m128i high_bits =
+      _mm_set1_epi64x(static_cast<int64_t>(~(kNonAddressOffset - 1)));
+  const __m128i zero = _mm_setzero_si128();
+  size_t index = 0;
+  for (; index + 2 <= count; index += 2) {
+    const __m128i high = _mm_and_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + index)),
+        high_bits);
 
-  constexpr uint64_t kRegisterByteOffset = 128;
-  const uint64_t target = address - kRegisterByteOffset;
-  constexpr uint64_t size = 512;
-  static_assert(kRegisterByteOffset <= size / 2,
-                "negative offset too large");
-  auto ranges =
-      delegate->GetReadableRanges(CheckedRange<uint64_t>(target, size));
-  for (const auto& range : ranges) {
-    delegate->AddNewMemorySnapshot(range);
+    // SSE2 only compares 32-bit lanes, so a 64-bit lane is equal when both of
+    // its halves are.
+    const __m128i zero_halves = _mm_cmpeq_epi32(high, zero);
+    const __m128i high_halves = _mm_cmpeq_epi32(high, high_bits);
+    const __m128i rejected = _mm_or_si128(
+        _mm_and_si128(zero_halves,
+                      _mm_shuffle_epi32(zero_halves, _MM_SHUFFLE(2, 3, 0, 1))),
+        _mm_and_si128(high_halves,
+                      _mm_shuffle_epi32(high_halves, _MM_SHUFFLE(2, 3, 0, 1))));
+    const unsigned int mask =
+        ~_mm_movemask_pd(_mm_castsi128_pd(rejected)) & 0x3;
+    if (mask) {
+      AppendLanes(values + index, 2, mask, candidates);
+    }
+  }
+  return index;
+}
+
+#if defined(COMPILER_GCC)
+
+__attribute__((target("avx2"))) size_t ScanAVX2(
+    const uint32_t* values,
+    size_t count,
+    std::vector<uint64_t>* candidates) {
+  const __m256i high_bits =
+      _mm256_set1_epi32(static_cast<int>(~(kNonAddressOffset - 1)));
+  const __m256i zero = _mm256_setzero_si256();
+  size_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    const __m256i high = _mm256_and_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + index)),
+        high_bits);
+    const __m256i rejected = _mm256_or_si256(
+        _mm256_cmpeq_epi32(high, zero), _mm256_cmpeq_epi32(high, high_bits));
+    const unsigned int mask =
+        ~_mm256_movemask_ps(_mm256_castsi256_ps(rejected)) & 0xff;
+    if (mask) {
+      AppendLanes(values + index, 8, mask, candidates);
+    }
+  }
+  return index;
+}
+
+__attribute__((target("avx2"))) size_t ScanAVX2(
+    const uint64_t* values,
+    size_t count,
+    std::vector<uint64_t>* candidates) {
+  const __m256i high_bits =
+      _mm256_set1_epi64x(static_cast<int64_t>(~(kNonAddressOffset - 1)));
+  const __m256i zero = _mm256_setzero_si256();
+  size_t index = 0;
+  for (; index + 4 <= count; index += 4) {
+    const __m256i high = _mm256_and_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + index)),
+        high_bits);
+    const __m256i rejected = _mm256_or_si256(
+        _mm256_cmpeq_epi64(high, zero), _mm256_cmpeq_epi64(high, high_bits));
+    const unsigned int mask =
+        ~_mm256_movemask_pd(_mm256_castsi256_pd(rejected)) & 0xf;
+    if (mask) {
+      AppendLanes(values + index, 4, mask, candidates);
+    }
   }
+  return index;
 }
 
+bool HasAVX2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+#endif  // COMPILER_GCC
+
+template <class T>
+size_t ScanVectors(const T* values,
+                   size_t count,
+                   std::vector<uint64_t>* candidates) {
+#if defined(COMPILER_GCC)
+  if (HasAVX2()) {
+    return ScanAVX2(values, count, candidates);
+  }
+#endif  // COMPILER_GCC
+  return ScanSSE2(values, count, candidates);
+}
+
+#elif defined(ARCH_CPU_ARM64)
+
 template <class T>
-void CaptureAtPointersInRange(uint8_t* buffer,
-                              uint64_t buffer_size,
-                              CaptureMemory::Delegate* delegate) {
-  for (uint64_t address_offset = 0; address_offset < buffer_size;
-       address_offset += sizeof(T)) {
-    uint64_t target_address = *reinterpret_cast<T*>(&buffer[address_offset]);
-    MaybeCaptureMemoryAround(delegate, target_address);
+void AppendPointerLikeLanes(const T* values,
+                            size_t lanes,
+                            std::vector<uint64_t>* candidates) {
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    if (IsPointerLike(values[lane])) {
+      candidates->push_back(values[lane]);
+    }
+  }
+}
+
+size_t ScanVectors(const uint32_t* values,
+                   size_t count,
+                   std::vector<uint64_t>* candidates) {
+  const uint32x4_t high_bits =
+      vdupq_n_u32(static_cast<uint32_t>(~(kNonAddressOffset - 1)));
+  const uint32x4_t zero = vdupq_n_u32(0);
+  size_t index = 0;
+  for (; index + 4 <= count; index += 4) {
+    const uint32x4_t high = vandq_u32(vld1q_u32(values + index), high_bits);
+    const uint32x4_t rejected =
+        vorrq_u32(vceqq_u32(high, zero), vceqq_u32(high, high_bits));
+    if (vminvq_u32(rejected) == 0) {
+      AppendPointerLikeLanes(values + index, 4, candidates);
+    }
+  }
+  return index;
+}
+
+size_t ScanVectors(const uint64_t* values,
+                   size_t count,
+                   std::vector<uint64_t>* candidates) {
+  const uint64x2_t high_bits = vdupq_n_u64(~(kNonAddressOffset - 1));
+  const uint64x2_t zero = vdupq_n_u64(0);
+  size_t index = 0;
+  for (; index + 2 <= count; index += 2) {
+    const uint64x2_t high = vandq_u64(vld1q_u64(values + index), high_bits);
+    const uint64x2_t rejected =
+        vorrq_u64(vceqq_u64(high, zero), vceqq_u64(high, high_bits));
+    if (vminvq_u32(vreinterpretq_u32_u64(rejected)) == 0) {
+      AppendPointerLikeLanes(values + index, 2, candidates);
+    }
+  }
+  return index;
+}
+
+#else
+
+template <class T>
+size_t ScanVectors(const T* values,
+                   size_t count,
+                   std::vector<uint64_t>* candidates) {
+  return 0;
+}
+
+#endif
+
+template <class T>
+void AppendPointerCandidates(const T* values,
+                             size_t count,
+                             std::vector<uint64_t>* candidates) {
+  for (size_t index = ScanVectors(values, count, candidates); index < count;
+       ++index) {
+    if (IsPointerLike(values[index])) {
+      candidates->push_back(values[index]);
+    }
+  }
+}
+
+// Captures the memory around each of |addresses|, which are given in order of
+// decreasing importance. Duplicate and overlapping windows are merged before
+// the delegate is asked which parts of them are readable, and the merged
+// ranges are added in the order of their most important address, so that the
+// budget is spent on the same memory that it would be if each address were
+// captured in turn.
+void CaptureMemoryAround(CaptureMemory::Delegate* delegate,
+                         const std::vector<uint64_t>& addresses) {
+  struct Window {
+    uint64_t base;
+    size_t order;
+  };
+  std::vector<Window> windows;
+  windows.reserve(addresses.size());
+  for (size_t index = 0; index < addresses.size(); ++index) {
+    windows.push_back({addresses[index] - kRegisterByteOffset, index});
+  }
+  std::sort(windows.begin(),
+            windows.end(),
+            [](const Window& lhs, const Window& rhs) {
+              return lhs.base < rhs.base;
+            });
+
+  struct Range {
+    uint64_t base;
+    uint64_t end;
+    size_t order;
+  };
+  std::vector<Range> ranges;
+  for (const Window& window : windows) {
+    const uint64_t end = window.base + kCaptureSize;
+    if (!ranges.empty() && window.base <= ranges.back().end) {
+      Range& last = ranges.back();
+      last.order = std::min(last.order, window.order);
+      if (end <= last.end) {
+        continue;
+      }
+      if (end - last.base <= kMaxMergedSize) {
+        last.end = end;
+        continue;
+      }
+      const uint64_t base = last.end;
+      ranges.push_back({base, end, window.order});
+      continue;
+    }
+    ranges.push_back({window.base, end, window.order});
+  }
+  std::sort(ranges.begin(),
+            ranges.end(),
+            [](const Range& lhs, const Range& rhs) {
+              return lhs.order < rhs.order;
+            });
+
+  for (const Range& range : ranges) {
+    auto readable_ranges = delegate->GetReadableRanges(
+        CheckedRange<uint64_t>(range.base, range.end - range.base));
+    for (const auto& readable_range : readable_ranges) {
+      delegate->AddNewMemorySnapshot(readable_range);
+    }
   }
 }
 
@@ -68,53 +344,63 @@ void CaptureAtPointersInRange(uint8_t* buffer,
 // static
 void CaptureMemory::PointedToByContext(const CPUContext& context,
                                        Delegate* delegate) {
+  std::vector<uint64_t> registers;
 #if defined(ARCH_CPU_X86_FAMILY)
   if (context.architecture == kCPUArchitectureX86_64) {
-    MaybeCaptureMemoryAround(delegate, context.x86_64->rax);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->rbx);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->rcx);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->rdx);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->rdi);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->rsi);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->rbp);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->r8);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->r9);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->r10);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->r11);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->r12);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->r13);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->r14);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->r15);
-    MaybeCaptureMemoryAround(delegate, context.x86_64->rip);
+    registers = {context.x86_64->rax,
+                 context.x86_64->rbx,
+                 context.x86_64->rcx,
+                 context.x86_64->rdx,
+                 context.x86_64->rdi,
+                 context.x86_64->rsi,
+                 context.x86_64->rbp,
+                 context.x86_64->r8,
+                 context.x86_64->r9,
+                 context.x86_64->r10,
+                 context.x86_64->r11,
+                 context.x86_64->r12,
+                 context.x86_64->r13,
+                 context.x86_64->r14,
+                 context.x86_64->r15,
+                 context.x86_64->rip};
   } else {
-    MaybeCaptureMemoryAround(delegate, context.x86->eax);
-    MaybeCaptureMemoryAround(delegate, context.x86->ebx);
-    MaybeCaptureMemoryAround(delegate, context.x86->ecx);
-    MaybeCaptureMemoryAround(delegate, context.x86->edx);
-    MaybeCaptureMemoryAround(delegate, context.x86->edi);
-    MaybeCaptureMemoryAround(delegate, context.x86->esi);
-    MaybeCaptureMemoryAround(delegate, context.x86->ebp);
-    MaybeCaptureMemoryAround(delegate, context.x86->eip);
+    registers = {context.x86->eax,
+                 context.x86->ebx,
+                 context.x86->ecx,
+                 context.x86->edx,
+                 context.x86->edi,
+                 context.x86->esi,
+                 context.x86->ebp,
+                 context.x86->eip};
   }
 #elif defined(ARCH_CPU_ARM_FAMILY)
   if (context.architecture == kCPUArchitectureARM64) {
-    MaybeCaptureMemoryAround(delegate, context.arm64->pc);
+    registers.push_back(context.arm64->pc);
     for (size_t i = 0; i < base::size(context.arm64->regs); ++i) {
-      MaybeCaptureMemoryAround(delegate, context.arm64->regs[i]);
+      registers.push_back(context.arm64->regs[i]);
     }
   } else {
-    MaybeCaptureMemoryAround(delegate, context.arm->pc);
+    registers.push_back(context.arm->pc);
     for (size_t i = 0; i < base::size(context.arm->regs); ++i) {
-      MaybeCaptureMemoryAround(delegate, context.arm->regs[i]);
+      registers.push_back(context.arm->regs[i]);
     }
   }
 #elif defined(ARCH_CPU_MIPS_FAMILY)
   for (size_t i = 0; i < base::size(context.mipsel->regs); ++i) {
-    MaybeCaptureMemoryAround(delegate, context.mipsel->regs[i]);
+    registers.push_back(context.mipsel->regs[i]);
   }
 #else
 #error Port.
 #endif
+
+  std::vector<uint64_t> candidates;
+  for (uint64_t value : registers) {
+    if (delegate->Is64Bit() ? IsPointerLike(value)
+                            : IsPointerLike(static_cast<uint32_t>(value))) {
+      candidates.push_back(value);
+    }
+  }
+  CaptureMemoryAround(delegate, candidates);
 }
 
 // static
@@ -136,10 +422,31 @@ void CaptureMemory::PointedToByMemoryRange(const MemorySnapshot& memory,
     return;
   }
 
-  if (delegate->Is64Bit())
-    CaptureAtPointersInRange<uint64_t>(buffer.get(), memory.Size(), delegate);
-  else
-    CaptureAtPointersInRange<uint32_t>(buffer.get(), memory.Size(), delegate);
+  std::vector<uint64_t> candidates;
+  if (delegate->Is64Bit()) {
+    FindPointerCandidates(reinterpret_cast<const uint64_t*>(buffer.get()),
+                          memory.Size() / sizeof(uint64_t),
+                          &candidates);
+  } else {
+    FindPointerCandidates(reinterpret_cast<const uint32_t*>(buffer.get()),
+                          memory.Size() / sizeof(uint32_t),
+                          &candidates);
+  }
+  CaptureMemoryAround(delegate, candidates);
+}
+
+// static
+void CaptureMemory::FindPointerCandidates(const uint32_t* values,
+                                          size_t count,
+                                          std::vector<uint64_t>* candidates) {
+  AppendPointerCandidates(values, count, candidates);
+}
+
+// static
+void CaptureMemory::FindPointerCandidates(const uint64_t* values,
+                                          size_t count,
+                                          std::vector<uint64_t>* candidates) {
+  AppendPointerCandidates(values, count, candidates);
 }
 
 }  // namespace internal
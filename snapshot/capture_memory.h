@@ -86,9 +86,31 @@ class CaptureMemory {
   //!     pointers long.
   //! \param[in] delegate A Delegate that handles reading from the target
   //!     process and adding new ranges.
+  //!
+  //! Memory near pointer-like values that are close together is captured in
+  //! merged ranges, so each byte is added at most once.
   static void PointedToByMemoryRange(const MemorySnapshot& memory,
                                      Delegate* delegate);
 
+  //! \brief Appends the pointer-like values among \a count values at \a
+  //!     values to \a candidates, in order.
+  //!
+  //! The values are read from a process whose pointers are the same size as
+  //! \a values’ elements. Where SIMD instructions are available, several values
+  //! are examined at once.
+  //!
+  //! \param[in] values The values to examine.
+  //! \param[in] count The number of values at \a values.
+  //! \param[in,out] candidates The pointer-like values are appended to this.
+  static void FindPointerCandidates(const uint32_t* values,
+                                    size_t count,
+                                    std::vector<uint64_t>* candidates);
+
+  //! \copydoc FindPointerCandidates()
+  static void FindPointerCandidates(const uint64_t* values,
+                                    size_t count,
+                                    std::vector<uint64_t>* candidates);
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(CaptureMemory);
 };
@@ -0,0 +1,329 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "snapshot/capture_memory.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/stl_util.h"
+#include "gtest/gtest.h"
+#include "snapshot/test/test_memory_snapshot.h"
+#include "util/misc/clock.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+// Serves reads from a local buffer mapped at a fake address and records the
+// ranges that are added.
+class TestDelegate : public internal::CaptureMemory::Delegate {
+ public:
+  TestDelegate(bool is_64_bit, uint64_t address, const void* data, size_t size)
+      : readable_(0, std::numeric_limits<uint64_t>::max()),
+        added_(),
+        address_(address),
+        data_(static_cast<const char*>(data)),
+        size_(size),
+        is_64_bit_(is_64_bit),
+        readable_range_requests_(0) {}
+
+  ~TestDelegate() override {}
+
+  void SetReadable(const CheckedRange<uint64_t>& readable) {
+    readable_ = readable;
+  }
+
+  const std::vector<CheckedRange<uint64_t>>& Added() const { return added_; }
+  size_t ReadableRangeRequests() const { return readable_range_requests_; }
+
+  // CaptureMemory::Delegate:
+
+  bool Is64Bit() const override { return is_64_bit_; }
+
+  bool ReadMemory(uint64_t at, uint64_t num_bytes, void* into) const override {
+    if (at < address_ || at - address_ + num_bytes > size_) {
+      return false;
+    }
+    memcpy(into, data_ + (at - address_), num_bytes);
+    return true;
+  }
+
+  std::vector<CheckedRange<uint64_t>> GetReadableRanges(
+      const CheckedRange<uint64_t, uint64_t>& range) const override {
+    ++readable_range_requests_;
+    std::vector<CheckedRange<uint64_t>> result;
+    if (readable_.OverlapsRange(range)) {
+      const uint64_t base = std::max(range.base(), readable_.base());
+      const uint64_t end = std::min(range.end(), readable_.end());
+      result.emplace_back(base, end - base);
+    }
+    return result;
+  }
+
+  void AddNewMemorySnapshot(
+      const CheckedRange<uint64_t, uint64_t>& range) override {
+    added_.push_back(range);
+  }
+
+ private:
+  CheckedRange<uint64_t> readable_;
+  std::vector<CheckedRange<uint64_t>> added_;
+  uint64_t address_;
+  const char* data_;
+  size_t size_;
+  bool is_64_bit_;
+  mutable size_t readable_range_requests_;
+
+  DISALLOW_COPY_AND_ASSIGN(TestDelegate);
+};
+
+constexpr uint64_t kStackAddress = 0x7f0000000000;
+
+template <class T>
+std::vector<CheckedRange<uint64_t>> CaptureFromValues(
+    const std::vector<T>& values) {
+  TestDelegate delegate(sizeof(T) == sizeof(uint64_t),
+                        kStackAddress,
+                        values.data(),
+                        values.size() * sizeof(T));
+  TestMemorySnapshot memory;
+  memory.SetAddress(kStackAddress);
+  memory.SetSize(values.size() * sizeof(T));
+  internal::CaptureMemory::PointedToByMemoryRange(memory, &delegate);
+  return delegate.Added();
+}
+
+TEST(CaptureMemory, NonPointersIgnored) {
+  constexpr uint64_t kMax = std::numeric_limits<uint64_t>::max();
+  std::vector<uint64_t> values = {0, 1, 0xffff, kMax, kMax - 0xffff};
+  EXPECT_TRUE(CaptureFromValues(values).empty());
+
+  // Values that are pointer-like in a 64-bit process are too large for a
+  // 32-bit process.
+  std::vector<uint32_t> values_32 = {0, 0xffff, 0xffffffff, 0xffff0001};
+  EXPECT_TRUE(CaptureFromValues(values_32).empty());
+}
+
+TEST(CaptureMemory, MemoryAroundPointers) {
+  std::vector<uint64_t> values = {0x10000, 0x20000};
+  std::vector<CheckedRange<uint64_t>> added = CaptureFromValues(values);
+  ASSERT_EQ(added.size(), 2u);
+  EXPECT_EQ(added[0].base(), 0x10000u - 128);
+  EXPECT_EQ(added[0].size(), 512u);
+  EXPECT_EQ(added[1].base(), 0x20000u - 128);
+  EXPECT_EQ(added[1].size(), 512u);
+
+  std::vector<uint32_t> values_32 = {0x12345678};
+  added = CaptureFromValues(values_32);
+  ASSERT_EQ(added.size(), 1u);
+  EXPECT_EQ(added[0].base(), 0x12345678u - 128);
+  EXPECT_EQ(added[0].size(), 512u);
+}
+
+TEST(CaptureMemory, OverlappingRangesMerged) {
+  // Duplicates and nearby pointers are captured once, and ranges are added in
+  // the order in which they’re first referenced.
+  std::vector<uint64_t> values = {
+      0x30000, 0x10000, 0x10040, 0x30000, 0x10000, 0x10200};
+  std::vector<CheckedRange<uint64_t>> added = CaptureFromValues(values);
+  ASSERT_EQ(added.size(), 2u);
+  EXPECT_EQ(added[0].base(), 0x30000u - 128);
+  EXPECT_EQ(added[0].size(), 512u);
+  EXPECT_EQ(added[1].base(), 0x10000u - 128);
+  EXPECT_EQ(added[1].end(), 0x10200u + 384);
+}
+
+TEST(CaptureMemory, MergedRangesLimited) {
+  // A long run of nearby pointers is split into several ranges that together
+  // cover it exactly once.
+  std::vector<uint64_t> values;
+  for (uint64_t address = 0x10000; address < 0x20000; address += 0x100) {
+    values.push_back(address);
+  }
+  std::vector<CheckedRange<uint64_t>> added = CaptureFromValues(values);
+  ASSERT_GT(added.size(), 1u);
+  uint64_t expected_base = 0x10000 - 128;
+  for (const auto& range : added) {
+    EXPECT_EQ(range.base(), expected_base);
+    EXPECT_LE(range.size(), 4096u);
+    expected_base = range.end();
+  }
+  EXPECT_EQ(expected_base, 0x20000u - 0x100 + 384);
+}
+
+TEST(CaptureMemory, ReadableRanges) {
+  std::vector<uint64_t> values = {0x10000, 0x10100, 0x50000};
+  TestDelegate delegate(true,
+                        kStackAddress,
+                        values.data(),
+                        values.size() * sizeof(values[0]));
+  delegate.SetReadable(CheckedRange<uint64_t>(0x10000, 0x1000));
+
+  TestMemorySnapshot memory;
+  memory.SetAddress(kStackAddress);
+  memory.SetSize(values.size() * sizeof(values[0]));
+  internal::CaptureMemory::PointedToByMemoryRange(memory, &delegate);
+
+  // The delegate is consulted once per merged range.
+  EXPECT_EQ(delegate.ReadableRangeRequests(), 2u);
+  ASSERT_EQ(delegate.Added().size(), 1u);
+  EXPECT_EQ(delegate.Added()[0].base(), 0x10000u);
+  EXPECT_EQ(delegate.Added()[0].end(), 0x10100u + 384);
+}
+
+TEST(CaptureMemory, UnalignedRange) {
+  std::vector<uint64_t> values = {0x10000, 0x20000};
+  TestDelegate delegate(true,
+                        kStackAddress,
+                        values.data(),
+                        values.size() * sizeof(values[0]));
+  TestMemorySnapshot memory;
+  memory.SetAddress(kStackAddress + 1);
+  memory.SetSize(sizeof(values[0]));
+  internal::CaptureMemory::PointedToByMemoryRange(memory, &delegate);
+  EXPECT_TRUE(delegate.Added().empty());
+}
+
+// Examines one value at a time.
+template <class T>
+std::vector<uint64_t> ReferencePointerCandidates(const T* values,
+                                                 size_t count) {
+  std::vector<uint64_t> candidates;
+  for (size_t index = 0; index < count; ++index) {
+    if (values[index] >= 0x10000 &&
+        values[index] <= std::numeric_limits<T>::max() - 0x10000) {
+      candidates.push_back(values[index]);
+    }
+  }
+  return candidates;
+}
+
+template <class T>
+void ExpectCandidatesMatchReference() {
+  // Edge cases are mixed into random values, and every starting offset and
+  // length up to a few vectors is examined so that every lane position and
+  // remainder is covered.
+  const T max = std::numeric_limits<T>::max();
+  const T edge_values[] = {0,
+                           1,
+                           0xffff,
+                           0x10000,
+                           0x10001,
+                           max / 2,
+                           max - 0x10001,
+                           max - 0x10000,
+                           max - 0xffff,
+                           max};
+  std::mt19937_64 random;
+  std::vector<T> values(256);
+  for (size_t index = 0; index < values.size(); ++index) {
+    switch (random() % 3) {
+      case 0:
+        values[index] = edge_values[random() % base::size(edge_values)];
+        break;
+      case 1:
+        values[index] = static_cast<T>(random() % 0x20000);
+        break;
+      default:
+        values[index] = static_cast<T>(random());
+        break;
+    }
+  }
+
+  for (size_t start = 0; start < 16; ++start) {
+    for (size_t count = 0; start + count <= values.size(); ++count) {
+      std::vector<uint64_t> candidates = {1};
+      internal::CaptureMemory::FindPointerCandidates(
+          &values[start], count, &candidates);
+      std::vector<uint64_t> expected = {1};
+      std::vector<uint64_t> reference =
+          ReferencePointerCandidates(&values[start], count);
+      expected.insert(expected.end(), reference.begin(), reference.end());
+      ASSERT_EQ(candidates, expected) << "start " << start << " count "
+                                      << count;
+    }
+  }
+}
+
+TEST(CaptureMemory, FindPointerCandidates) {
+  ExpectCandidatesMatchReference<uint64_t>();
+  ExpectCandidatesMatchReference<uint32_t>();
+}
+
+void TimePointerScans(const uint64_t* values, size_t count, int iterations) {
+  uint64_t start = ClockMonotonicNanoseconds();
+  size_t reference_count = 0;
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    reference_count += ReferencePointerCandidates(values, count).size();
+  }
+  const uint64_t reference_time =
+      (ClockMonotonicNanoseconds() - start) / iterations;
+
+  start = ClockMonotonicNanoseconds();
+  size_t candidate_count = 0;
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    std::vector<uint64_t> candidates;
+    internal::CaptureMemory::FindPointerCandidates(values, count, &candidates);
+    candidate_count += candidates.size();
+  }
+  const uint64_t time = (ClockMonotonicNanoseconds() - start) / iterations;
+  EXPECT_EQ(candidate_count, reference_count);
+
+  LOG(INFO) << count * sizeof(values[0]) << " bytes, one value at a time: "
+            << reference_time << " ns, FindPointerCandidates: " << time
+            << " ns";
+}
+
+TEST(CaptureMemory, DISABLED_PointerScanBenchmark) {
+  // A synthetic 8 MB stack made mostly of small integers and zeroes, with one
+  // value in 32 pointing into one of a few heap-like regions.
+  constexpr size_t kStackSize = 8 * 1024 * 1024;
+  std::vector<uint64_t> stack(kStackSize / sizeof(uint64_t));
+  std::mt19937_64 random;
+  for (uint64_t& value : stack) {
+    if (random() % 32 == 0) {
+      value = 0x550000000000 + (random() % 8) * 0x10000000 +
+              (random() % 0x100000) * 8;
+    } else {
+      value = random() % 2 ? 0 : random() % 0x1000;
+    }
+  }
+
+  // The whole stack is limited by memory bandwidth. A part that fits in cache
+  // shows the cost of the scan itself.
+  TimePointerScans(stack.data(), stack.size(), 20);
+  TimePointerScans(stack.data(), 256 * 1024 / sizeof(uint64_t), 1000);
+
+  TestDelegate delegate(
+      true, kStackAddress, stack.data(), stack.size() * sizeof(stack[0]));
+  TestMemorySnapshot memory;
+  memory.SetAddress(kStackAddress);
+  memory.SetSize(stack.size() * sizeof(stack[0]));
+  const uint64_t start = ClockMonotonicNanoseconds();
+  internal::CaptureMemory::PointedToByMemoryRange(memory, &delegate);
+  LOG(INFO) << "PointedToByMemoryRange: " << ClockMonotonicNanoseconds() - start
+            << " ns, " << delegate.ReadableRangeRequests()
+            << " readable range requests";
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
@@ -231,6 +231,19 @@ ElfImageReader::NoteReader::Result ElfImageReader::NoteReader::NextNote(
 
 namespace {
 
+// The number of bytes copied from the start of an image when it is read. This
+// is enough to hold the ELF header and program header table of typical images,
+// and often their build ID notes as well.
+constexpr VMSize kHeaderPrefetchSize = 1024;
+
+// String tables no larger than this are copied on first use, which costs no
+// more than reading a single string would. Larger string tables are only
+// copied once a symbol is looked up, which reads several strings.
+constexpr VMSize kSmallStringTableSize = 4096;
+
+// Regions larger than this are not copied, and are read as needed instead.
+constexpr VMSize kMaxPrefetchSize = 256 * 1024;
+
 // The maximum size the user can specify for maximum note size. Clamping this
 // ensures that buffer allocations cannot be wildly large. It is not expected
 // that a note would be larger than ~1k in normal usage.
@@ -374,13 +387,16 @@ ElfImageReader::ElfImageReader()
     : header_64_(),
       ehdr_address_(0),
       load_bias_(0),
+      prefetched_memory_(),
       memory_(),
       program_headers_(),
       dynamic_array_(),
       symbol_table_(),
       initialized_(),
       dynamic_array_initialized_(),
-      symbol_table_initialized_() {}
+      symbol_table_initialized_(),
+      string_table_prefetched_(false),
+      note_segments_prefetched_(false) {}
 
 ElfImageReader::~ElfImageReader() {}
 
@@ -389,9 +405,17 @@ bool ElfImageReader::Initialize(const ProcessMemoryRange& memory,
                                 bool verbose) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
   ehdr_address_ = address;
-  if (!memory_.Initialize(memory)) {
+
+  // All reads of the image go through prefetched_memory_, so that the parts of
+  // it copied by Prefetch() are read from the target process only once.
+  prefetched_memory_.Initialize(memory.Memory());
+  if (!memory_.Initialize(&prefetched_memory_,
+                          memory.Is64Bit(),
+                          memory.Base(),
+                          memory.Size())) {
     return false;
   }
+  Prefetch(ehdr_address_, kHeaderPrefetchSize);
 
   uint8_t e_ident[EI_NIDENT];
   if (!memory_.Read(ehdr_address_, EI_NIDENT, e_ident)) {
@@ -579,9 +603,7 @@ bool ElfImageReader::ReadDynamicStringTableAtOffset(VMSize offset,
 
   VMAddress string_table_address;
   VMSize string_table_size;
-  if (!GetAddressFromDynamicArray(DT_STRTAB, true, &string_table_address) ||
-      !dynamic_array_->GetValue(DT_STRSZ, true, &string_table_size)) {
-    LOG(ERROR) << "missing string table info";
+  if (!GetStringTable(&string_table_address, &string_table_size)) {
     return false;
   }
   if (offset >= string_table_size) {
@@ -589,12 +611,9 @@ bool ElfImageReader::ReadDynamicStringTableAtOffset(VMSize offset,
     return false;
   }
 
-  // GNU ld.so doesn't adjust the vdso's dynamic array entries by the load bias.
-  // If the address is too small to point into the loaded module range and is
-  // small enough to be an offset from the base of the module, adjust it now.
-  if (string_table_address < memory_.Base() &&
-      string_table_address < memory_.Size()) {
-    string_table_address += GetLoadBias();
+  if (!string_table_prefetched_ && string_table_size <= kSmallStringTableSize) {
+    string_table_prefetched_ = true;
+    Prefetch(string_table_address, string_table_size);
   }
 
   if (!memory_.ReadCStringSizeLimited(
@@ -675,6 +694,12 @@ bool ElfImageReader::InitializeDynamicArray() {
   }
   dyn_segment_address += GetLoadBias();
 
+  // ElfDynamicArrayReader reads one entry at a time, so the array is copied in
+  // a single read first.
+  if (dyn_segment_size <= kMaxPrefetchSize) {
+    Prefetch(dyn_segment_address, dyn_segment_size);
+  }
+
   dynamic_array_.reset(new ElfDynamicArrayReader());
   if (!dynamic_array_->Initialize(
           memory_, dyn_segment_address, dyn_segment_size)) {
@@ -713,12 +738,47 @@ bool ElfImageReader::InitializeDynamicSymbolTable() {
   VMSize number_of_symbol_table_entries;
   if (!GetNumberOfSymbolEntriesFromDtHash(&number_of_symbol_table_entries) &&
       !GetNumberOfSymbolEntriesFromDtGnuHash(&number_of_symbol_table_entries)) {
-    LOG(ERROR) << "could not retrieve number of symbol table entries";
-    return false;
+    // Without either hash table, linkers conventionally place the string table
+    // immediately after the symbol table, which bounds the number of entries
+    // well enough for the symbol table to be scanned.
+    VMAddress string_table_address;
+    if (!GetAddressFromDynamicArray(DT_STRTAB, false, &string_table_address) ||
+        string_table_address <= symbol_table_address) {
+      LOG(ERROR) << "could not retrieve number of symbol table entries";
+      return false;
+    }
+    number_of_symbol_table_entries =
+        (string_table_address - symbol_table_address) /
+        (memory_.Is64Bit() ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym));
+  }
+
+  // The hash tables, when present, are used to look symbols up without
+  // scanning the symbol table.
+  VMAddress gnu_hash_address;
+  if (!GetAddressFromDynamicArray(DT_GNU_HASH, false, &gnu_hash_address)) {
+    gnu_hash_address = 0;
+  }
+  VMAddress hash_address;
+  if (!GetAddressFromDynamicArray(DT_HASH, false, &hash_address)) {
+    hash_address = 0;
   }
 
-  symbol_table_.reset(new ElfSymbolTableReader(
-      &memory_, this, symbol_table_address, number_of_symbol_table_entries));
+  // Looking up a symbol compares the names of several symbols.
+  VMAddress string_table_address;
+  VMSize string_table_size;
+  if (!string_table_prefetched_ &&
+      GetStringTable(&string_table_address, &string_table_size) &&
+      string_table_size <= kMaxPrefetchSize) {
+    string_table_prefetched_ = true;
+    Prefetch(string_table_address, string_table_size);
+  }
+
+  symbol_table_.reset(new ElfSymbolTableReader(&memory_,
+                                               this,
+                                               symbol_table_address,
+                                               number_of_symbol_table_entries,
+                                               gnu_hash_address,
+                                               hash_address));
   symbol_table_initialized_.set_valid();
   return true;
 }
@@ -739,6 +799,49 @@ bool ElfImageReader::GetAddressFromDynamicArray(uint64_t tag,
   return true;
 }
 
+bool ElfImageReader::GetStringTable(VMAddress* address, VMSize* size) {
+  if (!GetAddressFromDynamicArray(DT_STRTAB, true, address) ||
+      !dynamic_array_->GetValue(DT_STRSZ, true, size)) {
+    LOG(ERROR) << "missing string table info";
+    return false;
+  }
+
+  // GNU ld.so doesn't adjust the vdso's dynamic array entries by the load bias.
+  // If the address is too small to point into the loaded module range and is
+  // small enough to be an offset from the base of the module, adjust it now.
+  if (*address < memory_.Base() && *address < memory_.Size()) {
+    *address += GetLoadBias();
+  }
+  return true;
+}
+
+void ElfImageReader::PrefetchNoteSegments() {
+  if (note_segments_prefetched_) {
+    return;
+  }
+  note_segments_prefetched_ = true;
+
+  size_t index = 0;
+  VMAddress address;
+  VMSize size;
+  while (program_headers_->GetNoteSegment(&index, &address, &size)) {
+    if (size <= kMaxPrefetchSize) {
+      Prefetch(address + GetLoadBias(), size);
+    }
+  }
+}
+
+void ElfImageReader::Prefetch(VMAddress address, VMSize size) {
+  CheckedVMAddressRange image_range(
+      memory_.Is64Bit(), memory_.Base(), memory_.Size());
+  if (!image_range.ContainsValue(address)) {
+    return;
+  }
+  prefetched_memory_.Prefetch(
+      address,
+      static_cast<size_t>(std::min(size, image_range.End() - address)));
+}
+
 bool ElfImageReader::GetNumberOfSymbolEntriesFromDtHash(
     VMSize* number_of_symbol_table_entries) {
   if (!InitializeDynamicArray()) {
@@ -835,6 +938,7 @@ bool ElfImageReader::GetNumberOfSymbolEntriesFromDtGnuHash(
 
 std::unique_ptr<ElfImageReader::NoteReader> ElfImageReader::Notes(
     size_t max_note_size) {
+  PrefetchNoteSegments();
   return std::make_unique<NoteReader>(
       this, &memory_, program_headers_.get(), max_note_size);
 }
@@ -843,6 +947,7 @@ std::unique_ptr<ElfImageReader::NoteReader>
 ElfImageReader::NotesWithNameAndType(const std::string& name,
                                      NoteReader::NoteType type,
                                      size_t max_note_size) {
+  PrefetchNoteSegments();
   return std::make_unique<NoteReader>(
       this, &memory_, program_headers_.get(), max_note_size, name, type, true);
 }
@@ -28,6 +28,7 @@
 #include "util/misc/address_types.h"
 #include "util/misc/initialization_state.h"
 #include "util/misc/initialization_state_dcheck.h"
+#include "util/process/process_memory_prefetched.h"
 #include "util/process/process_memory_range.h"
 
 namespace crashpad {
@@ -271,6 +272,12 @@ class ElfImageReader {
   bool InitializeDynamicArray();
   bool InitializeDynamicSymbolTable();
   bool GetAddressFromDynamicArray(uint64_t tag, bool log, VMAddress* address);
+  bool GetStringTable(VMAddress* address, VMSize* size);
+  void PrefetchNoteSegments();
+
+  // Copies the part of a region that lies within the image so that later reads
+  // within it are served locally.
+  void Prefetch(VMAddress address, VMSize size);
 
   union {
     Elf32_Ehdr header_32_;
@@ -278,6 +285,7 @@ class ElfImageReader {
   };
   VMAddress ehdr_address_;
   VMOffset load_bias_;
+  ProcessMemoryPrefetched prefetched_memory_;
   ProcessMemoryRange memory_;
   std::unique_ptr<ProgramHeaderTable> program_headers_;
   std::unique_ptr<ElfDynamicArrayReader> dynamic_array_;
@@ -285,6 +293,8 @@ class ElfImageReader {
   InitializationStateDcheck initialized_;
   InitializationState dynamic_array_initialized_;
   InitializationState symbol_table_initialized_;
+  bool string_table_prefetched_;
+  bool note_segments_prefetched_;
 
   DISALLOW_COPY_AND_ASSIGN(ElfImageReader);
 };
@@ -0,0 +1,77 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This module exports a large number of symbols, to exercise and benchmark
+// symbol lookup in ElfImageReader. The symbols are named
+// ElfImageReaderTestManySymbols00000 through
+// ElfImageReaderTestManySymbols49999.
+
+#define SYMBOL(n) \
+  __attribute__((visibility("default"))) int ElfImageReaderTestManySymbols##n;
+
+#define SYMBOLS_10(prefix) \
+  SYMBOL(prefix##0)        \
+  SYMBOL(prefix##1)        \
+  SYMBOL(prefix##2)        \
+  SYMBOL(prefix##3)        \
+  SYMBOL(prefix##4)        \
+  SYMBOL(prefix##5)        \
+  SYMBOL(prefix##6)        \
+  SYMBOL(prefix##7)        \
+  SYMBOL(prefix##8)        \
+  SYMBOL(prefix##9)
+
+#define SYMBOLS_100(prefix) \
+  SYMBOLS_10(prefix##0)     \
+  SYMBOLS_10(prefix##1)     \
+  SYMBOLS_10(prefix##2)     \
+  SYMBOLS_10(prefix##3)     \
+  SYMBOLS_10(prefix##4)     \
+  SYMBOLS_10(prefix##5)     \
+  SYMBOLS_10(prefix##6)     \
+  SYMBOLS_10(prefix##7)     \
+  SYMBOLS_10(prefix##8)     \
+  SYMBOLS_10(prefix##9)
+
+#define SYMBOLS_1000(prefix) \
+  SYMBOLS_100(prefix##0)     \
+  SYMBOLS_100(prefix##1)     \
+  SYMBOLS_100(prefix##2)     \
+  SYMBOLS_100(prefix##3)     \
+  SYMBOLS_100(prefix##4)     \
+  SYMBOLS_100(prefix##5)     \
+  SYMBOLS_100(prefix##6)     \
+  SYMBOLS_100(prefix##7)     \
+  SYMBOLS_100(prefix##8)     \
+  SYMBOLS_100(prefix##9)
+
+#define SYMBOLS_10000(prefix) \
+  SYMBOLS_1000(prefix##0)     \
+  SYMBOLS_1000(prefix##1)     \
+  SYMBOLS_1000(prefix##2)     \
+  SYMBOLS_1000(prefix##3)     \
+  SYMBOLS_1000(prefix##4)     \
+  SYMBOLS_1000(prefix##5)     \
+  SYMBOLS_1000(prefix##6)     \
+  SYMBOLS_1000(prefix##7)     \
+  SYMBOLS_1000(prefix##8)     \
+  SYMBOLS_1000(prefix##9)
+
+extern "C" {
+SYMBOLS_10000(0)
+SYMBOLS_10000(1)
+SYMBOLS_10000(2)
+SYMBOLS_10000(3)
+SYMBOLS_10000(4)
+}  // extern "C"
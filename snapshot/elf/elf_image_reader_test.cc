@@ -16,17 +16,24 @@
 
 #include <dlfcn.h>
 #include <link.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <string>
+#include <vector>
+
 #include "base/logging.h"
+#include "base/strings/stringprintf.h"
 #include "build/build_config.h"
 #include "gtest/gtest.h"
+#include "snapshot/elf/elf_symbol_table_reader.h"
 #include "test/multiprocess_exec.h"
 #include "test/process_type.h"
 #include "test/scoped_module_handle.h"
 #include "test/test_paths.h"
 #include "util/file/file_io.h"
 #include "util/misc/address_types.h"
+#include "util/misc/clock.h"
 #include "util/misc/elf_note_types.h"
 #include "util/misc/from_pointer_cast.h"
 #include "util/process/process_memory_native.h"
@@ -294,6 +301,279 @@ TEST(ElfImageReader, OneModuleChild) {
   test.Run();
 }
 
+#if !defined(ARCH_CPU_MIPS_FAMILY)
+
+// crashpad_snapshot_test_many_symbols exports kManySymbolsCount symbols and is
+// built with both .hash and .gnu.hash sections.
+constexpr size_t kManySymbolsCount = 50000;
+
+std::string ManySymbolsName(size_t index) {
+  return base::StringPrintf("ElfImageReaderTestManySymbols%05zu", index);
+}
+
+ScopedModuleHandle LoadManySymbolsModule() {
+  base::FilePath module_path =
+      TestPaths::BuildArtifact(FILE_PATH_LITERAL("snapshot"),
+                               FILE_PATH_LITERAL("many_symbols"),
+                               TestPaths::FileType::kLoadableModule);
+#if defined(OS_FUCHSIA)
+  // TODO(scottmg): Remove this when upstream Fuchsia bug ZX-1619 is resolved.
+  // See also explanation in build/run_tests.py for Fuchsia .so files.
+  module_path = module_path.BaseName();
+#endif  // OS_FUCHSIA
+  ScopedModuleHandle module(
+      dlopen(module_path.value().c_str(), RTLD_LAZY | RTLD_LOCAL));
+  EXPECT_TRUE(module.valid())
+      << "dlopen " << module_path.value() << ": " << dlerror();
+  return module;
+}
+
+// Returns the address that the dynamic array entry |tag| of the module loaded
+// at |lm| refers to, found without the help of ElfImageReader, or 0 if there is
+// no such entry.
+VMAddress GetDynamicArrayAddress(const struct link_map* lm, ElfW(Sxword) tag) {
+  for (const ElfW(Dyn)* dyn = lm->l_ld; dyn->d_tag != DT_NULL; ++dyn) {
+    if (dyn->d_tag == tag) {
+#if defined(OS_ANDROID) || defined(OS_FUCHSIA)
+      // Only the GNU loader relocates the dynamic array.
+      return lm->l_addr + dyn->d_un.d_ptr;
+#else
+      return dyn->d_un.d_ptr;
+#endif  // OS_ANDROID || OS_FUCHSIA
+    }
+  }
+  return 0;
+}
+
+// A ProcessMemory for this process that counts the reads made through it.
+class CountingProcessMemory : public ProcessMemory {
+ public:
+  CountingProcessMemory() : ProcessMemory(), reads_(0) {}
+  ~CountingProcessMemory() {}
+
+  size_t Reads() const { return reads_; }
+
+ private:
+  ssize_t ReadUpTo(VMAddress address,
+                   size_t size,
+                   void* buffer) const override {
+    ++reads_;
+    memcpy(buffer, reinterpret_cast<const void*>(address), size);
+    return size;
+  }
+
+  mutable size_t reads_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingProcessMemory);
+};
+
+TEST(ElfImageReader, ManySymbols) {
+  ScopedModuleHandle module = LoadManySymbolsModule();
+  ASSERT_TRUE(module.valid());
+
+#if defined(ARCH_CPU_64_BITS)
+  constexpr bool am_64_bit = true;
+#else
+  constexpr bool am_64_bit = false;
+#endif  // ARCH_CPU_64_BITS
+
+  ProcessMemoryNative memory;
+  ASSERT_TRUE(memory.Initialize(GetSelfProcess()));
+  ProcessMemoryRange range;
+  ASSERT_TRUE(range.Initialize(&memory, am_64_bit));
+
+  struct link_map* lm = reinterpret_cast<struct link_map*>(module.get());
+
+  ElfImageReader reader;
+  ASSERT_TRUE(reader.Initialize(range, lm->l_addr));
+
+  VMSize number_of_symbols;
+  ASSERT_TRUE(reader.GetNumberOfSymbolEntriesFromDtHash(&number_of_symbols));
+  EXPECT_GT(number_of_symbols, kManySymbolsCount);
+
+  // A reader without the hash tables scans the symbol table instead.
+  const VMAddress symbol_table_address = GetDynamicArrayAddress(lm, DT_SYMTAB);
+  ASSERT_NE(symbol_table_address, 0u);
+  ElfSymbolTableReader scanning_reader(
+      &range, &reader, symbol_table_address, number_of_symbols);
+
+  for (size_t index :
+       {size_t{0}, size_t{1}, kManySymbolsCount / 2, kManySymbolsCount - 1}) {
+    const std::string name = ManySymbolsName(index);
+    SCOPED_TRACE(name);
+
+    VMAddress address;
+    VMSize size;
+    ASSERT_TRUE(reader.GetDynamicSymbol(name, &address, &size));
+    EXPECT_EQ(address,
+              FromPointerCast<VMAddress>(
+                  module.LookUpSymbol<void*>(name.c_str())));
+    EXPECT_EQ(size, sizeof(int));
+
+    ElfSymbolTableReader::SymbolInformation info;
+    ASSERT_TRUE(scanning_reader.GetSymbol(name, &info));
+    EXPECT_EQ(info.address + reader.GetLoadBias(), address);
+  }
+
+  VMAddress address;
+  VMSize size;
+  const std::string missing_name = ManySymbolsName(kManySymbolsCount);
+  EXPECT_FALSE(reader.GetDynamicSymbol(missing_name, &address, &size));
+  ElfSymbolTableReader::SymbolInformation info;
+  EXPECT_FALSE(scanning_reader.GetSymbol(missing_name, &info));
+}
+
+TEST(ElfImageReader, InvalidGnuHashHeader) {
+  ScopedModuleHandle module = LoadManySymbolsModule();
+  ASSERT_TRUE(module.valid());
+
+#if defined(ARCH_CPU_64_BITS)
+  constexpr bool am_64_bit = true;
+#else
+  constexpr bool am_64_bit = false;
+#endif  // ARCH_CPU_64_BITS
+
+  ProcessMemoryNative memory;
+  ASSERT_TRUE(memory.Initialize(GetSelfProcess()));
+  ProcessMemoryRange range;
+  ASSERT_TRUE(range.Initialize(&memory, am_64_bit));
+
+  struct link_map* lm = reinterpret_cast<struct link_map*>(module.get());
+
+  ElfImageReader reader;
+  ASSERT_TRUE(reader.Initialize(range, lm->l_addr));
+
+  VMSize number_of_symbols;
+  ASSERT_TRUE(reader.GetNumberOfSymbolEntriesFromDtHash(&number_of_symbols));
+  const VMAddress symbol_table_address = GetDynamicArrayAddress(lm, DT_SYMTAB);
+  ASSERT_NE(symbol_table_address, 0u);
+  const VMAddress gnu_hash_address = GetDynamicArrayAddress(lm, DT_GNU_HASH);
+  ASSERT_NE(gnu_hash_address, 0u);
+
+  struct GnuHashHeader {
+    uint32_t nbuckets;
+    uint32_t symoffset;
+    uint32_t bloom_size;
+    uint32_t bloom_shift;
+  };
+  GnuHashHeader valid_header;
+  memcpy(&valid_header,
+         reinterpret_cast<const void*>(gnu_hash_address),
+         sizeof(valid_header));
+
+  // A copy of the header that breaks one of the constraints on it is rejected,
+  // and the symbol is looked up in DT_HASH or by scanning instead.
+  for (size_t variant = 0; variant < 3; ++variant) {
+    SCOPED_TRACE(base::StringPrintf("variant %zu", variant));
+    GnuHashHeader header = valid_header;
+    switch (variant) {
+      case 0:
+        header.bloom_shift = 32;
+        break;
+      case 1:
+        header.bloom_size = 0;
+        break;
+      case 2:
+        header.bloom_size = 3;
+        break;
+    }
+
+    ElfSymbolTableReader symbol_table(&range,
+                                      &reader,
+                                      symbol_table_address,
+                                      number_of_symbols,
+                                      FromPointerCast<VMAddress>(&header),
+                                      GetDynamicArrayAddress(lm, DT_HASH));
+
+    const std::string name = ManySymbolsName(kManySymbolsCount / 2);
+    ElfSymbolTableReader::SymbolInformation info;
+    ASSERT_TRUE(symbol_table.GetSymbol(name, &info));
+    EXPECT_EQ(info.address + reader.GetLoadBias(),
+              FromPointerCast<VMAddress>(
+                  module.LookUpSymbol<void*>(name.c_str())));
+
+    EXPECT_FALSE(
+        symbol_table.GetSymbol(ManySymbolsName(kManySymbolsCount), &info));
+  }
+}
+
+TEST(ElfImageReader, DISABLED_ManySymbolsBenchmark) {
+  ScopedModuleHandle module = LoadManySymbolsModule();
+  ASSERT_TRUE(module.valid());
+
+#if defined(ARCH_CPU_64_BITS)
+  constexpr bool am_64_bit = true;
+#else
+  constexpr bool am_64_bit = false;
+#endif  // ARCH_CPU_64_BITS
+
+  struct link_map* lm = reinterpret_cast<struct link_map*>(module.get());
+  const VMAddress symbol_table_address = GetDynamicArrayAddress(lm, DT_SYMTAB);
+  ASSERT_NE(symbol_table_address, 0u);
+
+  // Every hundredth symbol is looked up, so that the scan is measured over
+  // symbols throughout the table.
+  std::vector<std::string> names;
+  for (size_t index = 0; index < kManySymbolsCount; index += 100) {
+    names.push_back(ManySymbolsName(index));
+  }
+
+  // Times the lookups through ProcessMemoryNative, and counts the reads
+  // they make through CountingProcessMemory.
+  ProcessMemoryNative native_memory;
+  ASSERT_TRUE(native_memory.Initialize(GetSelfProcess()));
+  CountingProcessMemory counting_memory;
+  for (bool hashed : {true, false}) {
+    double nanoseconds_per_lookup = 0;
+    double reads_per_lookup = 0;
+    for (const ProcessMemory* memory :
+         {static_cast<const ProcessMemory*>(&native_memory),
+          static_cast<const ProcessMemory*>(&counting_memory)}) {
+      ProcessMemoryRange range;
+      ASSERT_TRUE(range.Initialize(memory, am_64_bit));
+      ElfImageReader reader;
+      ASSERT_TRUE(reader.Initialize(range, lm->l_addr));
+
+      VMSize number_of_symbols;
+      ASSERT_TRUE(
+          reader.GetNumberOfSymbolEntriesFromDtHash(&number_of_symbols));
+      const VMAddress gnu_hash_address =
+          hashed ? GetDynamicArrayAddress(lm, DT_GNU_HASH) : 0;
+      const VMAddress hash_address =
+          hashed ? GetDynamicArrayAddress(lm, DT_HASH) : 0;
+      ElfSymbolTableReader symbol_table(&range,
+                                        &reader,
+                                        symbol_table_address,
+                                        number_of_symbols,
+                                        gnu_hash_address,
+                                        hash_address);
+
+      const size_t reads_before = counting_memory.Reads();
+      const uint64_t start = ClockMonotonicNanoseconds();
+      for (const std::string& name : names) {
+        ElfSymbolTableReader::SymbolInformation info;
+        ASSERT_TRUE(symbol_table.GetSymbol(name, &info));
+      }
+      const uint64_t end = ClockMonotonicNanoseconds();
+
+      if (memory == &native_memory) {
+        nanoseconds_per_lookup =
+            static_cast<double>(end - start) / names.size();
+      } else {
+        reads_per_lookup =
+            static_cast<double>(counting_memory.Reads() - reads_before) /
+            names.size();
+      }
+    }
+
+    LOG(INFO) << (hashed ? "hashed" : "scanning") << " lookup: "
+              << nanoseconds_per_lookup / 1E3 << " µs, " << reads_per_lookup
+              << " reads";
+  }
+}
+
+#endif  // !ARCH_CPU_MIPS_FAMILY
+
 #if defined(OS_FUCHSIA)
 
 // crashpad_snapshot_test_both_dt_hash_styles is specially built and forced to
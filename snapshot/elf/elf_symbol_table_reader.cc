@@ -16,6 +16,9 @@
 
 #include <elf.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "base/logging.h"
 #include "snapshot/elf/elf_image_reader.h"
 
@@ -47,46 +50,306 @@ uint8_t GetVisibility(const Elf64_Sym& sym) {
   return ELF64_ST_VISIBILITY(sym.st_other);
 }
 
+template <typename SymEnt>
+void SetSymbolInformation(const SymEnt& entry,
+                          ElfSymbolTableReader::SymbolInformation* info) {
+  info->address = entry.st_value;
+  info->size = entry.st_size;
+  info->shndx = entry.st_shndx;
+  info->binding = GetBinding(entry);
+  info->type = GetType(entry);
+  info->visibility = GetVisibility(entry);
+}
+
+// The hash function used by DT_GNU_HASH.
+uint32_t GnuHash(const std::string& name) {
+  uint32_t hash = 5381;
+  for (unsigned char c : name) {
+    hash = hash * 33 + c;
+  }
+  return hash;
+}
+
+// The hash function used by DT_HASH, from the System V ABI.
+uint32_t ElfHash(const std::string& name) {
+  uint32_t hash = 0;
+  for (unsigned char c : name) {
+    hash = (hash << 4) + c;
+    const uint32_t high = hash & 0xf0000000;
+    if (high) {
+      hash ^= high >> 24;
+    }
+    hash &= ~high;
+  }
+  return hash;
+}
+
+// The number of symbol table entries read at once when scanning the table.
+constexpr size_t kSymbolsPerRead = 128;
+
 }  // namespace
 
 ElfSymbolTableReader::ElfSymbolTableReader(const ProcessMemoryRange* memory,
                                            ElfImageReader* elf_reader,
                                            VMAddress address,
-                                           VMSize num_entries)
+                                           VMSize num_entries,
+                                           VMAddress gnu_hash_address,
+                                           VMAddress hash_address)
     : memory_(memory),
       elf_reader_(elf_reader),
       base_address_(address),
-      num_entries_(num_entries) {}
+      num_entries_(num_entries),
+      gnu_hash_address_(gnu_hash_address),
+      hash_address_(hash_address) {}
 
 ElfSymbolTableReader::~ElfSymbolTableReader() {}
 
 bool ElfSymbolTableReader::GetSymbol(const std::string& name,
                                      SymbolInformation* info) {
-  return memory_->Is64Bit() ? ScanSymbolTable<Elf64_Sym>(name, info)
-                            : ScanSymbolTable<Elf32_Sym>(name, info);
+  return memory_->Is64Bit() ? LookUpSymbol<Elf64_Sym>(name, info)
+                            : LookUpSymbol<Elf32_Sym>(name, info);
+}
+
+template <typename SymEnt>
+bool ElfSymbolTableReader::LookUpSymbol(const std::string& name,
+                                        SymbolInformation* info) {
+  // If a hash table can’t be read, fall back to the next way of looking up the
+  // symbol.
+  if (gnu_hash_address_) {
+    switch (LookUpInGnuHash<SymEnt>(name, info)) {
+      case LookupResult::kFound:
+        return true;
+      case LookupResult::kNotFound:
+        return false;
+      case LookupResult::kError:
+        break;
+    }
+  }
+
+  if (hash_address_) {
+    switch (LookUpInHash<SymEnt>(name, info)) {
+      case LookupResult::kFound:
+        return true;
+      case LookupResult::kNotFound:
+        return false;
+      case LookupResult::kError:
+        break;
+    }
+  }
+
+  return ScanSymbolTable<SymEnt>(name, info);
+}
+
+template <typename SymEnt>
+ElfSymbolTableReader::LookupResult ElfSymbolTableReader::LookUpInGnuHash(
+    const std::string& name,
+    SymbolInformation* info) {
+  // See https://flapenguin.me/2017/05/10/elf-lookup-dt-gnu-hash/ and
+  // https://sourceware.org/ml/binutils/2006-10/msg00377.html.
+  struct {
+    uint32_t nbuckets;
+    uint32_t symoffset;
+    uint32_t bloom_size;
+    uint32_t bloom_shift;
+  } header;
+  if (!memory_->Read(gnu_hash_address_, sizeof(header), &header)) {
+    LOG(ERROR) << "failed to read DT_GNU_HASH header";
+    return LookupResult::kError;
+  }
+  // The dynamic linker masks with bloom_size - 1 and shifts a 32-bit hash by
+  // bloom_shift, so a table that breaks these constraints is unusable.
+  if (header.nbuckets == 0 || header.bloom_size == 0 ||
+      (header.bloom_size & (header.bloom_size - 1)) != 0 ||
+      header.bloom_shift >= 32) {
+    LOG(ERROR) << "invalid DT_GNU_HASH header";
+    return LookupResult::kError;
+  }
+
+  const uint32_t hash = GnuHash(name);
+
+  // The Bloom filter’s words are the image’s native word size. Two bits of a
+  // word must be set for the symbol to be present.
+  using BloomWord = decltype(SymEnt::st_size);
+  constexpr uint32_t kBloomWordBits = sizeof(BloomWord) * 8;
+  const VMAddress bloom_address = gnu_hash_address_ + sizeof(header);
+  BloomWord bloom_word;
+  if (!memory_->Read(bloom_address + sizeof(bloom_word) *
+                                         ((hash / kBloomWordBits) %
+                                          header.bloom_size),
+                     sizeof(bloom_word),
+                     &bloom_word)) {
+    LOG(ERROR) << "failed to read DT_GNU_HASH bloom filter";
+    return LookupResult::kError;
+  }
+  const BloomWord bloom_mask =
+      (BloomWord{1} << (hash % kBloomWordBits)) |
+      (BloomWord{1} << ((hash >> header.bloom_shift) % kBloomWordBits));
+  if ((bloom_word & bloom_mask) != bloom_mask) {
+    return LookupResult::kNotFound;
+  }
+
+  const VMAddress buckets_address =
+      bloom_address + sizeof(bloom_word) * header.bloom_size;
+  uint32_t index;
+  if (!memory_->Read(
+          buckets_address + sizeof(index) * (hash % header.nbuckets),
+          sizeof(index),
+          &index)) {
+    LOG(ERROR) << "failed to read DT_GNU_HASH bucket";
+    return LookupResult::kError;
+  }
+  if (index == 0) {
+    return LookupResult::kNotFound;
+  }
+  if (index < header.symoffset) {
+    LOG(ERROR) << "invalid DT_GNU_HASH bucket";
+    return LookupResult::kError;
+  }
+
+  // Each chain entry holds the hash of the corresponding symbol with its low
+  // bit replaced by whether it’s the last symbol in the chain.
+  const VMAddress chains_address =
+      buckets_address + sizeof(index) * header.nbuckets;
+  for (; index < num_entries_; ++index) {
+    uint32_t chain_hash;
+    if (!memory_->Read(
+            chains_address + sizeof(chain_hash) * (index - header.symoffset),
+            sizeof(chain_hash),
+            &chain_hash)) {
+      LOG(ERROR) << "failed to read DT_GNU_HASH chain";
+      return LookupResult::kError;
+    }
+
+    if ((chain_hash | 1) == (hash | 1)) {
+      LookupResult result = CheckSymbol<SymEnt>(index, name, info);
+      if (result != LookupResult::kNotFound) {
+        return result;
+      }
+    }
+
+    if (chain_hash & 1) {
+      return LookupResult::kNotFound;
+    }
+  }
+
+  LOG(ERROR) << "unterminated DT_GNU_HASH chain";
+  return LookupResult::kError;
+}
+
+template <typename SymEnt>
+ElfSymbolTableReader::LookupResult ElfSymbolTableReader::LookUpInHash(
+    const std::string& name,
+    SymbolInformation* info) {
+  struct {
+    uint32_t nbucket;
+    uint32_t nchain;
+  } header;
+  if (!memory_->Read(hash_address_, sizeof(header), &header)) {
+    LOG(ERROR) << "failed to read DT_HASH header";
+    return LookupResult::kError;
+  }
+  if (header.nbucket == 0) {
+    LOG(ERROR) << "invalid DT_HASH header";
+    return LookupResult::kError;
+  }
+
+  const VMAddress buckets_address = hash_address_ + sizeof(header);
+  uint32_t index;
+  if (!memory_->Read(
+          buckets_address + sizeof(index) * (ElfHash(name) % header.nbucket),
+          sizeof(index),
+          &index)) {
+    LOG(ERROR) << "failed to read DT_HASH bucket";
+    return LookupResult::kError;
+  }
+
+  // Each chain entry is the index of the next symbol with the same hash, with
+  // STN_UNDEF ending the chain. The walk is limited to the number of symbols in
+  // case the chain loops.
+  const VMAddress chains_address =
+      buckets_address + sizeof(index) * header.nbucket;
+  for (uint32_t links = 0; index != STN_UNDEF && links < header.nchain;
+       ++links) {
+    if (index >= header.nchain) {
+      LOG(ERROR) << "invalid DT_HASH chain";
+      return LookupResult::kError;
+    }
+
+    LookupResult result = CheckSymbol<SymEnt>(index, name, info);
+    if (result != LookupResult::kNotFound) {
+      return result;
+    }
+
+    if (!memory_->Read(chains_address + sizeof(index) * index,
+                       sizeof(index),
+                       &index)) {
+      LOG(ERROR) << "failed to read DT_HASH chain";
+      return LookupResult::kError;
+    }
+  }
+
+  if (index != STN_UNDEF) {
+    LOG(ERROR) << "unterminated DT_HASH chain";
+    return LookupResult::kError;
+  }
+  return LookupResult::kNotFound;
+}
+
+template <typename SymEnt>
+ElfSymbolTableReader::LookupResult ElfSymbolTableReader::CheckSymbol(
+    uint32_t index,
+    const std::string& name,
+    SymbolInformation* info) {
+  // TODO(scottmg): This should respect DT_SYMENT if present.
+  SymEnt entry;
+  if (!memory_->Read(
+          base_address_ + sizeof(entry) * index, sizeof(entry), &entry)) {
+    return LookupResult::kError;
+  }
+
+  std::string string;
+  if (!elf_reader_->ReadDynamicStringTableAtOffset(entry.st_name, &string)) {
+    return LookupResult::kError;
+  }
+  if (string != name) {
+    return LookupResult::kNotFound;
+  }
+
+  SetSymbolInformation(entry, info);
+  return LookupResult::kFound;
 }
 
 template <typename SymEnt>
 bool ElfSymbolTableReader::ScanSymbolTable(const std::string& name,
                                            SymbolInformation* info_out) {
-  VMAddress address = base_address_;
-  SymEnt entry;
+  // Entries are read several at a time. If a group can’t be read, its entries
+  // are read one at a time, stopping at the first that can’t be read.
+  std::vector<SymEnt> entries(
+      std::min(num_entries_, static_cast<VMSize>(kSymbolsPerRead)));
   std::string string;
-  size_t i = 0;
-  while (i < num_entries_ && memory_->Read(address, sizeof(entry), &entry)) {
-    if (elf_reader_->ReadDynamicStringTableAtOffset(entry.st_name, &string) &&
-        string == name) {
-      info_out->address = entry.st_value;
-      info_out->size = entry.st_size;
-      info_out->shndx = entry.st_shndx;
-      info_out->binding = GetBinding(entry);
-      info_out->type = GetType(entry);
-      info_out->visibility = GetVisibility(entry);
-      return true;
-    }
+  VMSize index = 0;
+  while (index < num_entries_) {
     // TODO(scottmg): This should respect DT_SYMENT if present.
-    address += sizeof(entry);
-    ++i;
+    const VMAddress address = base_address_ + sizeof(SymEnt) * index;
+    size_t count = static_cast<size_t>(
+        std::min(num_entries_ - index, static_cast<VMSize>(entries.size())));
+    if (!memory_->Read(address, sizeof(SymEnt) * count, entries.data())) {
+      if (!memory_->Read(address, sizeof(SymEnt), entries.data())) {
+        return false;
+      }
+      count = 1;
+    }
+
+    for (size_t entry_index = 0; entry_index < count; ++entry_index) {
+      const SymEnt& entry = entries[entry_index];
+      if (elf_reader_->ReadDynamicStringTableAtOffset(entry.st_name,
+                                                      &string) &&
+          string == name) {
+        SetSymbolInformation(entry, info_out);
+        return true;
+      }
+    }
+    index += count;
   }
   return false;
 }
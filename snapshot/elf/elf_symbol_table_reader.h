@@ -57,22 +57,53 @@ class ElfSymbolTableReader {
     uint8_t visibility;
   };
 
-  // TODO(jperaza): Support using .hash and .gnu.hash sections to improve symbol
-  // lookup.
+  //! \param[in] memory The memory of the image containing the symbol table.
+  //! \param[in] elf_reader The reader for the image, used to read symbol names.
+  //! \param[in] address The address of the symbol table, `DT_SYMTAB`.
+  //! \param[in] num_entries The number of entries in the symbol table.
+  //! \param[in] gnu_hash_address The address of the image’s `DT_GNU_HASH`
+  //!     table, or `0` if it doesn’t have one.
+  //! \param[in] hash_address The address of the image’s `DT_HASH` table, or
+  //!     `0` if it doesn’t have one.
   ElfSymbolTableReader(const ProcessMemoryRange* memory,
                        ElfImageReader* elf_reader,
                        VMAddress address,
-                       VMSize num_entries);
+                       VMSize num_entries,
+                       VMAddress gnu_hash_address = 0,
+                       VMAddress hash_address = 0);
   ~ElfSymbolTableReader();
 
   //! \brief Lookup information about a symbol.
   //!
+  //! The symbol is looked up in the `DT_GNU_HASH` table if there is one, or
+  //! otherwise in the `DT_HASH` table, reading only the few symbol table
+  //! entries that share its hash. The whole symbol table is scanned only if
+  //! neither hash table is present or readable. `DT_GNU_HASH` doesn’t include
+  //! undefined symbols, so they may not be found when it is used.
+  //!
   //! \param[in] name The name of the symbol to search for.
   //! \param[out] info The symbol information, if found.
   //! \return `true` if the symbol is found.
   bool GetSymbol(const std::string& name, SymbolInformation* info);
 
  private:
+  enum class LookupResult {
+    kFound,
+    kNotFound,
+    kError,
+  };
+
+  template <typename SymEnt>
+  bool LookUpSymbol(const std::string& name, SymbolInformation* info);
+  template <typename SymEnt>
+  LookupResult LookUpInGnuHash(const std::string& name,
+                               SymbolInformation* info);
+  template <typename SymEnt>
+  LookupResult LookUpInHash(const std::string& name, SymbolInformation* info);
+  template <typename SymEnt>
+  LookupResult CheckSymbol(uint32_t index,
+                           const std::string& name,
+                           SymbolInformation* info);
   template <typename SymEnt>
   bool ScanSymbolTable(const std::string& name, SymbolInformation* info);
 
@@ -80,6 +111,8 @@ class ElfSymbolTableReader {
   ElfImageReader* const elf_reader_;  // weak
   const VMAddress base_address_;
   const VMSize num_entries_;
+  const VMAddress gnu_hash_address_;
+  const VMAddress hash_address_;
 
   DISALLOW_COPY_AND_ASSIGN(ElfSymbolTableReader);
 };
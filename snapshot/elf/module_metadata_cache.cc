@@ -0,0 +1,81 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "snapshot/elf/module_metadata_cache.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+namespace crashpad {
+
+bool ModuleMetadataCache::Key::operator<(const Key& other) const {
+  return std::tie(device, inode, build_id) <
+         std::tie(other.device, other.inode, other.build_id);
+}
+
+ModuleMetadataCache::ModuleMetadataCache(size_t capacity)
+    : capacity_(std::max(capacity, size_t{1})),
+      entries_(),
+      index_(),
+      stats_(),
+      lock_() {}
+
+ModuleMetadataCache::~ModuleMetadataCache() {}
+
+bool ModuleMetadataCache::Lookup(const Key& key, Metadata* metadata) {
+  std::lock_guard<std::mutex> lock(lock_);
+
+  auto iterator = index_.find(key);
+  if (iterator == index_.end()) {
+    ++stats_.misses;
+    return false;
+  }
+
+  ++stats_.hits;
+  entries_.splice(entries_.begin(), entries_, iterator->second);
+  *metadata = iterator->second->metadata;
+  return true;
+}
+
+void ModuleMetadataCache::Insert(const Key& key, const Metadata& metadata) {
+  if (key.build_id.empty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+
+  auto iterator = index_.find(key);
+  if (iterator != index_.end()) {
+    entries_.splice(entries_.begin(), entries_, iterator->second);
+    iterator->second->metadata = metadata;
+    return;
+  }
+
+  while (entries_.size() >= capacity_) {
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+    ++stats_.evictions;
+  }
+
+  entries_.push_front({key, metadata});
+  index_.insert(std::make_pair(key, entries_.begin()));
+}
+
+ModuleMetadataCache::Stats ModuleMetadataCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return stats_;
+}
+
+}  // namespace crashpad
@@ -0,0 +1,129 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_SNAPSHOT_ELF_MODULE_METADATA_CACHE_H_
+#define CRASHPAD_SNAPSHOT_ELF_MODULE_METADATA_CACHE_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "base/macros.h"
+#include "util/misc/address_types.h"
+
+namespace crashpad {
+
+//! \brief Remembers metadata about ELF modules across snapshots.
+//!
+//! A long-running handler captures snapshots of processes that load the same
+//! modules over and over. The metadata held here is a property of a module’s
+//! file, not of the process that loaded it, so it can be reused by later
+//! snapshots instead of being parsed from each target process again. Data that
+//! can differ between processes, such as a module’s load address and
+//! annotations, is never cached.
+//!
+//! Entries are keyed by the identity of the mapped file and the module’s build
+//! ID, so a file that is replaced is not confused with the original. Modules
+//! without a build ID are not cached. When the cache is full, the least
+//! recently used entry is discarded.
+//!
+//! This class is thread-safe.
+class ModuleMetadataCache {
+ public:
+  //! \brief Identifies a module’s file.
+  struct Key {
+    //! \brief The device containing the mapped file.
+    dev_t device;
+
+    //! \brief The inode of the mapped file.
+    ino_t inode;
+
+    //! \brief The module’s build ID.
+    std::vector<uint8_t> build_id;
+
+    bool operator<(const Key& other) const;
+  };
+
+  //! \brief The cached metadata for a module.
+  struct Metadata {
+    //! \brief The offset of the module’s CrashpadInfo structure from the
+    //!     module’s address, valid if \a has_crashpad_info is `true`.
+    VMOffset crashpad_info_offset;
+
+    //! \brief Whether the module has a CrashpadInfo structure.
+    bool has_crashpad_info;
+  };
+
+  //! \brief Counters describing the effectiveness of the cache.
+  struct Stats {
+    //! \brief The number of lookups that found an entry.
+    uint64_t hits;
+
+    //! \brief The number of lookups that did not find an entry.
+    uint64_t misses;
+
+    //! \brief The number of entries discarded to make room for others.
+    uint64_t evictions;
+  };
+
+  //! \brief The default maximum number of entries held.
+  static constexpr size_t kDefaultCapacity = 1024;
+
+  //! \param[in] capacity The maximum number of entries to hold.
+  explicit ModuleMetadataCache(size_t capacity = kDefaultCapacity);
+  ~ModuleMetadataCache();
+
+  //! \brief Looks up the metadata for a module.
+  //!
+  //! \param[in] key The module to look up.
+  //! \param[out] metadata The module’s metadata, if found.
+  //! \return `true` if the module was found, with \a metadata set. `false` if
+  //!     it was not found.
+  bool Lookup(const Key& key, Metadata* metadata);
+
+  //! \brief Adds or replaces the metadata for a module.
+  //!
+  //! \param[in] key The module whose metadata is being added. Keys with an
+  //!     empty build ID are ignored.
+  //! \param[in] metadata The module’s metadata.
+  void Insert(const Key& key, const Metadata& metadata);
+
+  //! \brief Returns counters describing how lookups have been served.
+  Stats GetStats() const;
+
+ private:
+  struct Entry {
+    Key key;
+    Metadata metadata;
+  };
+
+  // Entries ordered from most to least recently used.
+  using EntryList = std::list<Entry>;
+
+  size_t capacity_;
+  EntryList entries_;
+  std::map<Key, EntryList::iterator> index_;
+  Stats stats_;
+  mutable std::mutex lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(ModuleMetadataCache);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_SNAPSHOT_ELF_MODULE_METADATA_CACHE_H_
@@ -0,0 +1,97 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "snapshot/elf/module_metadata_cache.h"
+
+#include "gtest/gtest.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+ModuleMetadataCache::Key MakeKey(ino_t inode, uint8_t build_id) {
+  ModuleMetadataCache::Key key;
+  key.device = 1;
+  key.inode = inode;
+  key.build_id = {build_id, 0x12, 0x34};
+  return key;
+}
+
+ModuleMetadataCache::Metadata MakeMetadata(VMOffset crashpad_info_offset) {
+  ModuleMetadataCache::Metadata metadata;
+  metadata.crashpad_info_offset = crashpad_info_offset;
+  metadata.has_crashpad_info = true;
+  return metadata;
+}
+
+TEST(ModuleMetadataCache, LookupAndInsert) {
+  ModuleMetadataCache cache;
+
+  ModuleMetadataCache::Metadata metadata;
+  EXPECT_FALSE(cache.Lookup(MakeKey(1, 1), &metadata));
+
+  cache.Insert(MakeKey(1, 1), MakeMetadata(0x1000));
+  ASSERT_TRUE(cache.Lookup(MakeKey(1, 1), &metadata));
+  EXPECT_TRUE(metadata.has_crashpad_info);
+  EXPECT_EQ(metadata.crashpad_info_offset, 0x1000u);
+
+  // The same file with a different build ID, or a different file with the same
+  // build ID, is a different module.
+  EXPECT_FALSE(cache.Lookup(MakeKey(1, 2), &metadata));
+  EXPECT_FALSE(cache.Lookup(MakeKey(2, 1), &metadata));
+
+  // Inserting an existing key replaces its metadata.
+  cache.Insert(MakeKey(1, 1), MakeMetadata(0x2000));
+  ASSERT_TRUE(cache.Lookup(MakeKey(1, 1), &metadata));
+  EXPECT_EQ(metadata.crashpad_info_offset, 0x2000u);
+
+  const ModuleMetadataCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 2u);
+  EXPECT_EQ(stats.misses, 3u);
+  EXPECT_EQ(stats.evictions, 0u);
+}
+
+TEST(ModuleMetadataCache, NoBuildID) {
+  ModuleMetadataCache cache;
+
+  ModuleMetadataCache::Key key = MakeKey(1, 1);
+  key.build_id.clear();
+  cache.Insert(key, MakeMetadata(0x1000));
+
+  ModuleMetadataCache::Metadata metadata;
+  EXPECT_FALSE(cache.Lookup(key, &metadata));
+}
+
+TEST(ModuleMetadataCache, LeastRecentlyUsedIsEvicted) {
+  ModuleMetadataCache cache(2);
+
+  cache.Insert(MakeKey(1, 1), MakeMetadata(0x1000));
+  cache.Insert(MakeKey(2, 1), MakeMetadata(0x2000));
+
+  // Using the first entry makes the second the least recently used.
+  ModuleMetadataCache::Metadata metadata;
+  ASSERT_TRUE(cache.Lookup(MakeKey(1, 1), &metadata));
+
+  cache.Insert(MakeKey(3, 1), MakeMetadata(0x3000));
+  EXPECT_TRUE(cache.Lookup(MakeKey(1, 1), &metadata));
+  EXPECT_FALSE(cache.Lookup(MakeKey(2, 1), &metadata));
+  ASSERT_TRUE(cache.Lookup(MakeKey(3, 1), &metadata));
+  EXPECT_EQ(metadata.crashpad_info_offset, 0x3000u);
+
+  EXPECT_EQ(cache.GetStats().evictions, 1u);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
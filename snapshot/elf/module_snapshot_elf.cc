@@ -37,13 +37,16 @@ ModuleSnapshotElf::ModuleSnapshotElf(const std::string& name,
       process_memory_range_(process_memory_range),
       process_memory_(process_memory),
       crashpad_info_(),
+      build_id_(),
       type_(type),
       initialized_(),
       streams_() {}
 
 ModuleSnapshotElf::~ModuleSnapshotElf() = default;
 
-bool ModuleSnapshotElf::Initialize() {
+bool ModuleSnapshotElf::Initialize(ModuleMetadataCache* metadata_cache,
+                                   dev_t device,
+                                   ino_t inode) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
 
   if (!elf_reader_) {
@@ -51,31 +54,40 @@ bool ModuleSnapshotElf::Initialize() {
     return false;
   }
 
-  // The data payload is only sizeof(VMAddress) in the note, but add a bit to
-  // account for the name, header, and padding.
-  constexpr ssize_t kMaxNoteSize = 256;
-  std::unique_ptr<ElfImageReader::NoteReader> notes =
-      elf_reader_->NotesWithNameAndType(CRASHPAD_ELF_NOTE_NAME,
-                                        CRASHPAD_ELF_NOTE_TYPE_CRASHPAD_INFO,
-                                        kMaxNoteSize);
-  std::string desc;
-  VMAddress info_address;
-  VMAddress desc_address;
-  if (notes->NextNote(nullptr, nullptr, &desc, &desc_address) ==
-      ElfImageReader::NoteReader::Result::kSuccess) {
-    VMOffset offset;
-    if (elf_reader_->Memory()->Is64Bit()) {
-      offset = *reinterpret_cast<VMOffset*>(&desc[0]);
-    } else {
-      int32_t offset32 = *reinterpret_cast<int32_t*>(&desc[0]);
-      offset = offset32;
+  build_id_ = ReadBuildID();
+
+  // The location of the CrashpadInfo structure within the module is a property
+  // of the module’s file, so it can be reused for every process that loads the
+  // same file. Its contents must be read from each process.
+  ModuleMetadataCache::Metadata metadata = {};
+  bool cached = false;
+  ModuleMetadataCache::Key key;
+  if (metadata_cache && !build_id_.empty()) {
+    key.device = device;
+    key.inode = inode;
+    key.build_id = build_id_;
+    cached = metadata_cache->Lookup(key, &metadata);
+  }
+  if (!cached) {
+    const ElfImageReader::NoteReader::Result result =
+        FindCrashpadInfo(&metadata.crashpad_info_offset);
+    metadata.has_crashpad_info =
+        result == ElfImageReader::NoteReader::Result::kSuccess;
+
+    // A failure to read the notes may be particular to this process, so it
+    // isn’t remembered as the module lacking a CrashpadInfo structure.
+    if (metadata_cache && !build_id_.empty() &&
+        result != ElfImageReader::NoteReader::Result::kError) {
+      metadata_cache->Insert(key, metadata);
     }
-    info_address = desc_address + offset;
+  }
 
+  if (metadata.has_crashpad_info) {
     ProcessMemoryRange range;
     if (range.Initialize(*elf_reader_->Memory())) {
       auto info = std::make_unique<CrashpadInfoReader>();
-      if (info->Initialize(&range, info_address)) {
+      if (info->Initialize(
+              &range, elf_reader_->Address() + metadata.crashpad_info_offset)) {
         crashpad_info_ = std::move(info);
       }
     }
@@ -174,17 +186,7 @@ std::string ModuleSnapshotElf::DebugFileName() const {
 
 std::vector<uint8_t> ModuleSnapshotElf::BuildID() const {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
-
-  std::unique_ptr<ElfImageReader::NoteReader> notes =
-      elf_reader_->NotesWithNameAndType(ELF_NOTE_GNU, NT_GNU_BUILD_ID, 64);
-  std::string desc;
-  VMAddress desc_addr;
-  notes->NextNote(nullptr, nullptr, &desc, &desc_addr);
-
-  std::vector<uint8_t> build_id;
-  build_id.reserve(desc.size());
-  std::copy(desc.begin(), desc.end(), std::back_inserter(build_id));
-  return build_id;
+  return build_id_;
 }
 
 std::vector<std::string> ModuleSnapshotElf::AnnotationsVector() const {
@@ -249,5 +251,46 @@ ModuleSnapshotElf::CustomMinidumpStreams() const {
   return result;
 }
 
+std::vector<uint8_t> ModuleSnapshotElf::ReadBuildID() const {
+  std::unique_ptr<ElfImageReader::NoteReader> notes =
+      elf_reader_->NotesWithNameAndType(ELF_NOTE_GNU, NT_GNU_BUILD_ID, 64);
+  std::string desc;
+  VMAddress desc_addr;
+  notes->NextNote(nullptr, nullptr, &desc, &desc_addr);
+
+  std::vector<uint8_t> build_id;
+  build_id.reserve(desc.size());
+  std::copy(desc.begin(), desc.end(), std::back_inserter(build_id));
+  return build_id;
+}
+
+ElfImageReader::NoteReader::Result ModuleSnapshotElf::FindCrashpadInfo(
+    VMOffset* offset) const {
+  // The data payload is only sizeof(VMAddress) in the note, but add a bit to
+  // account for the name, header, and padding.
+  constexpr ssize_t kMaxNoteSize = 256;
+  std::unique_ptr<ElfImageReader::NoteReader> notes =
+      elf_reader_->NotesWithNameAndType(CRASHPAD_ELF_NOTE_NAME,
+                                        CRASHPAD_ELF_NOTE_TYPE_CRASHPAD_INFO,
+                                        kMaxNoteSize);
+  std::string desc;
+  VMAddress desc_address;
+  const ElfImageReader::NoteReader::Result result =
+      notes->NextNote(nullptr, nullptr, &desc, &desc_address);
+  if (result != ElfImageReader::NoteReader::Result::kSuccess) {
+    return result;
+  }
+
+  VMOffset desc_offset;
+  if (elf_reader_->Memory()->Is64Bit()) {
+    desc_offset = *reinterpret_cast<VMOffset*>(&desc[0]);
+  } else {
+    int32_t offset32 = *reinterpret_cast<int32_t*>(&desc[0]);
+    desc_offset = offset32;
+  }
+  *offset = desc_address + desc_offset - elf_reader_->Address();
+  return result;
+}
+
 }  // namespace internal
 }  // namespace crashpad
@@ -27,6 +27,7 @@
 #include "snapshot/crashpad_info_client_options.h"
 #include "snapshot/crashpad_types/crashpad_info_reader.h"
 #include "snapshot/elf/elf_image_reader.h"
+#include "snapshot/elf/module_metadata_cache.h"
 #include "snapshot/module_snapshot.h"
 #include "util/misc/initialization_state_dcheck.h"
 
@@ -54,9 +55,19 @@ class ModuleSnapshotElf final : public ModuleSnapshot {
 
   //! \brief Initializes the object.
   //!
+  //! \param[in] metadata_cache A cache of module metadata shared between
+  //!     snapshots, used to avoid parsing metadata that was already parsed for
+  //!     the same file in an earlier snapshot. Optional, weak.
+  //! \param[in] device The device containing the file the module was mapped
+  //!     from. Only used with \a metadata_cache.
+  //! \param[in] inode The inode of the file the module was mapped from. Only
+  //!     used with \a metadata_cache.
+  //!
   //! \return `true` if the snapshot could be created, `false` otherwise with
   //!     an appropriate message logged.
-  bool Initialize();
+  bool Initialize(ModuleMetadataCache* metadata_cache = nullptr,
+                  dev_t device = 0,
+                  ino_t inode = 0);
 
   //! \brief Returns options from the module’s CrashpadInfo structure.
   //!
@@ -89,11 +100,20 @@ class ModuleSnapshotElf final : public ModuleSnapshot {
   std::vector<const UserMinidumpStream*> CustomMinidumpStreams() const override;
 
  private:
+  // Returns the module’s build ID, read from its notes.
+  std::vector<uint8_t> ReadBuildID() const;
+
+  // Finds the module’s CrashpadInfo structure, setting offset to its offset
+  // from the module’s address. Returns kSuccess if it was found, kNoMoreNotes
+  // if the module has none, and kError if the module’s notes couldn’t be read.
+  ElfImageReader::NoteReader::Result FindCrashpadInfo(VMOffset* offset) const;
+
   std::string name_;
   ElfImageReader* elf_reader_;
   ProcessMemoryRange* process_memory_range_;
   const ProcessMemory* process_memory_;
   std::unique_ptr<CrashpadInfoReader> crashpad_info_;
+  std::vector<uint8_t> build_id_;
   ModuleType type_;
   InitializationStateDcheck initialized_;
   // Too const-y: https://crashpad.chromium.org/bug/9.
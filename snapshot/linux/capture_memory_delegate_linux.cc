@@ -0,0 +1,117 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "snapshot/linux/capture_memory_delegate_linux.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "base/numerics/safe_conversions.h"
+#include "base/process/process_metrics.h"
+#include "snapshot/memory_snapshot_generic.h"
+#include "util/linux/memory_map.h"
+
+namespace crashpad {
+namespace internal {
+
+CaptureMemoryDelegateLinux::CaptureMemoryDelegateLinux(
+    ProcessReaderLinux* process_reader,
+    const ProcessReaderLinux::Thread* thread,
+    std::vector<std::unique_ptr<MemorySnapshotGeneric>>* snapshots,
+    uint32_t* budget_remaining)
+    : stack_(thread ? thread->stack_region_address : 0,
+             thread ? thread->stack_region_size : 0),
+      process_reader_(process_reader),
+      snapshots_(snapshots),
+      budget_remaining_(budget_remaining),
+      page_size_(base::GetPageSize()) {}
+
+bool CaptureMemoryDelegateLinux::Is64Bit() const {
+  return process_reader_->Is64Bit();
+}
+
+bool CaptureMemoryDelegateLinux::ReadMemory(uint64_t at,
+                                            uint64_t num_bytes,
+                                            void* into) const {
+  return process_reader_->Memory()->Read(
+      at, base::checked_cast<size_t>(num_bytes), into);
+}
+
+std::vector<CheckedRange<uint64_t>>
+CaptureMemoryDelegateLinux::GetReadableRanges(
+    const CheckedRange<uint64_t, uint64_t>& range) const {
+  const MemoryMap* memory_map = process_reader_->GetMemoryMap();
+
+  // Mappings are page-aligned, so an address that isn’t mapped can be skipped
+  // along with the rest of its page.
+  std::vector<CheckedRange<uint64_t>> ranges;
+  uint64_t address = range.base();
+  const uint64_t end = range.end();
+  while (address < end) {
+    const MemoryMap::Mapping* mapping = memory_map->FindMapping(address);
+    if (!mapping) {
+      const uint64_t next_page = (address | (page_size_ - 1)) + 1;
+      if (next_page == 0) {
+        break;
+      }
+      address = next_page;
+      continue;
+    }
+
+    const uint64_t mapping_end =
+        std::min(end, static_cast<uint64_t>(mapping->range.End()));
+
+    // Reading from a device mapping may have side effects.
+    const bool device = mapping->shareable &&
+                        strncmp(mapping->name.c_str(), "/dev/", 5) == 0;
+    if (mapping->readable && !device) {
+      if (!ranges.empty() && ranges.back().end() == address) {
+        ranges.back().SetRange(ranges.back().base(),
+                               mapping_end - ranges.back().base());
+      } else {
+        ranges.emplace_back(address, mapping_end - address);
+      }
+    }
+    address = mapping_end;
+  }
+  return ranges;
+}
+
+void CaptureMemoryDelegateLinux::AddNewMemorySnapshot(
+    const CheckedRange<uint64_t, uint64_t>& range) {
+  // Don't bother storing this memory if it points back into the stack.
+  if (stack_.ContainsRange(range))
+    return;
+  if (range.size() == 0)
+    return;
+  if (budget_remaining_ && *budget_remaining_ == 0)
+    return;
+  snapshots_->push_back(std::make_unique<internal::MemorySnapshotGeneric>());
+  internal::MemorySnapshotGeneric* snapshot = snapshots_->back().get();
+  snapshot->Initialize(process_reader_->Memory(), range.base(), range.size());
+  if (budget_remaining_) {
+    if (!base::IsValueInRangeForNumericType<int64_t>(range.size())) {
+      *budget_remaining_ = 0;
+    } else {
+      int64_t temp = *budget_remaining_;
+      temp -= range.size();
+      *budget_remaining_ = base::saturated_cast<uint32_t>(temp);
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace crashpad
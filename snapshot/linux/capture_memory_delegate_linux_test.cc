@@ -0,0 +1,119 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "snapshot/linux/capture_memory_delegate_linux.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/process/process_metrics.h"
+#include "gtest/gtest.h"
+#include "snapshot/memory_snapshot_generic.h"
+#include "test/linux/fake_ptrace_connection.h"
+#include "util/misc/from_pointer_cast.h"
+#include "util/posix/scoped_mmap.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+TEST(CaptureMemoryDelegateLinux, GetReadableRanges) {
+  FakePtraceConnection connection;
+  ASSERT_TRUE(connection.Initialize(getpid()));
+
+  // Pages 0 and 1 are readable mappings with different protections, page 2 is
+  // inaccessible, page 3 is readable, page 4 is unmapped, and page 5 is
+  // readable.
+  const size_t page_size = base::GetPageSize();
+  ScopedMmap mapping;
+  ASSERT_TRUE(mapping.ResetMmap(nullptr,
+                                page_size * 6,
+                                PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANON,
+                                -1,
+                                0));
+  char* base = mapping.addr_as<char*>();
+  ASSERT_EQ(mprotect(base + page_size, page_size, PROT_READ), 0);
+  ASSERT_EQ(mprotect(base + page_size * 2, page_size, PROT_NONE), 0);
+  ASSERT_EQ(munmap(base + page_size * 4, page_size), 0);
+
+  ProcessReaderLinux process_reader;
+  ASSERT_TRUE(process_reader.Initialize(&connection));
+
+  std::vector<std::unique_ptr<internal::MemorySnapshotGeneric>> snapshots;
+  internal::CaptureMemoryDelegateLinux delegate(
+      &process_reader, nullptr, &snapshots, nullptr);
+
+  const uint64_t address = FromPointerCast<uint64_t>(base);
+  std::vector<CheckedRange<uint64_t>> ranges = delegate.GetReadableRanges(
+      CheckedRange<uint64_t>(address + 16, page_size * 6 - 32));
+  ASSERT_EQ(ranges.size(), 3u);
+  EXPECT_EQ(ranges[0].base(), address + 16);
+  EXPECT_EQ(ranges[0].end(), address + page_size * 2);
+  EXPECT_EQ(ranges[1].base(), address + page_size * 3);
+  EXPECT_EQ(ranges[1].end(), address + page_size * 4);
+  EXPECT_EQ(ranges[2].base(), address + page_size * 5);
+  EXPECT_EQ(ranges[2].end(), address + page_size * 6 - 16);
+
+  ranges = delegate.GetReadableRanges(
+      CheckedRange<uint64_t>(address + page_size * 2, page_size));
+  EXPECT_TRUE(ranges.empty());
+
+  ranges = delegate.GetReadableRanges(
+      CheckedRange<uint64_t>(address + page_size * 4, page_size));
+  EXPECT_TRUE(ranges.empty());
+}
+
+TEST(CaptureMemoryDelegateLinux, AddNewMemorySnapshot) {
+  FakePtraceConnection connection;
+  ASSERT_TRUE(connection.Initialize(getpid()));
+
+  ProcessReaderLinux process_reader;
+  ASSERT_TRUE(process_reader.Initialize(&connection));
+
+  ProcessReaderLinux::Thread thread;
+  thread.stack_region_address = 0x10000;
+  thread.stack_region_size = 0x1000;
+
+  std::vector<std::unique_ptr<internal::MemorySnapshotGeneric>> snapshots;
+  uint32_t budget = 1000;
+  internal::CaptureMemoryDelegateLinux delegate(
+      &process_reader, &thread, &snapshots, &budget);
+
+  // Ranges within the stack are skipped.
+  delegate.AddNewMemorySnapshot(CheckedRange<uint64_t>(0x10100, 0x200));
+  EXPECT_TRUE(snapshots.empty());
+  EXPECT_EQ(budget, 1000u);
+
+  delegate.AddNewMemorySnapshot(CheckedRange<uint64_t>(0x20000, 600));
+  ASSERT_EQ(snapshots.size(), 1u);
+  EXPECT_EQ(snapshots[0]->Address(), 0x20000u);
+  EXPECT_EQ(snapshots[0]->Size(), 600u);
+  EXPECT_EQ(budget, 400u);
+
+  // The last range may exceed the budget, after which nothing more is added.
+  delegate.AddNewMemorySnapshot(CheckedRange<uint64_t>(0x30000, 600));
+  EXPECT_EQ(snapshots.size(), 2u);
+  EXPECT_EQ(budget, 0u);
+
+  delegate.AddNewMemorySnapshot(CheckedRange<uint64_t>(0x40000, 600));
+  EXPECT_EQ(snapshots.size(), 2u);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
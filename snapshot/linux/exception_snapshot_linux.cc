@@ -17,6 +17,8 @@
 #include <signal.h>
 
 #include "base/logging.h"
+#include "snapshot/capture_memory.h"
+#include "snapshot/linux/capture_memory_delegate_linux.h"
 #include "snapshot/linux/cpu_context_linux.h"
 #include "snapshot/linux/process_reader_linux.h"
 #include "snapshot/linux/signal_context.h"
@@ -32,6 +34,7 @@ ExceptionSnapshotLinux::ExceptionSnapshotLinux()
       context_union_(),
       context_(),
       codes_(),
+      extra_memory_(),
       thread_id_(0),
       exception_address_(0),
       signal_number_(0),
@@ -325,10 +328,12 @@ bool ExceptionSnapshotLinux::ReadContext<ContextTraits64>(
 
 #endif  // ARCH_CPU_X86_FAMILY
 
-bool ExceptionSnapshotLinux::Initialize(ProcessReaderLinux* process_reader,
-                                        LinuxVMAddress siginfo_address,
-                                        LinuxVMAddress context_address,
-                                        pid_t thread_id) {
+bool ExceptionSnapshotLinux::Initialize(
+    ProcessReaderLinux* process_reader,
+    LinuxVMAddress siginfo_address,
+    LinuxVMAddress context_address,
+    pid_t thread_id,
+    uint32_t* gather_indirectly_referenced_memory_bytes_remaining) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
 
   thread_id_ = thread_id;
@@ -345,6 +350,15 @@ bool ExceptionSnapshotLinux::Initialize(ProcessReaderLinux* process_reader,
     }
   }
 
+  if (gather_indirectly_referenced_memory_bytes_remaining) {
+    CaptureMemoryDelegateLinux capture_memory_delegate(
+        process_reader,
+        nullptr,
+        &extra_memory_,
+        gather_indirectly_referenced_memory_bytes_remaining);
+    CaptureMemory::PointedToByContext(context_, &capture_memory_delegate);
+  }
+
   INITIALIZATION_STATE_SET_VALID(initialized_);
   return true;
 }
@@ -462,7 +476,12 @@ const std::vector<uint64_t>& ExceptionSnapshotLinux::Codes() const {
 
 std::vector<const MemorySnapshot*> ExceptionSnapshotLinux::ExtraMemory() const {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
-  return std::vector<const MemorySnapshot*>();
+  std::vector<const MemorySnapshot*> result;
+  result.reserve(extra_memory_.size());
+  for (const auto& em : extra_memory_) {
+    result.push_back(em.get());
+  }
+  return result;
 }
 
 }  // namespace internal
@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <memory>
 #include <vector>
 
 #include "base/macros.h"
@@ -26,6 +27,7 @@
 #include "snapshot/exception_snapshot.h"
 #include "snapshot/linux/process_reader_linux.h"
 #include "snapshot/memory_snapshot.h"
+#include "snapshot/memory_snapshot_generic.h"
 #include "util/linux/address_types.h"
 #include "util/misc/initialization_state_dcheck.h"
 
@@ -49,13 +51,20 @@ class ExceptionSnapshotLinux final : public ExceptionSnapshot {
   //! \param[in] context_address The address in the target process' address
   //!     space of the ucontext_t passed to the signal handler.
   //! \param[in] thread_id The thread ID of the thread that received the signal.
+  //! \param[in,out] gather_indirectly_referenced_memory_bytes_remaining If
+  //!     non-null, add extra memory regions to the snapshot pointed to by the
+  //!     exception context's registers. The size of the regions added is
+  //!     subtracted from the count, and when it's `0`, no more regions will be
+  //!     added.
   //!
   //! \return `true` if the snapshot could be created, `false` otherwise with
   //!     an appropriate message logged.
-  bool Initialize(ProcessReaderLinux* process_reader,
-                  LinuxVMAddress siginfo_address,
-                  LinuxVMAddress context_address,
-                  pid_t thread_id);
+  bool Initialize(
+      ProcessReaderLinux* process_reader,
+      LinuxVMAddress siginfo_address,
+      LinuxVMAddress context_address,
+      pid_t thread_id,
+      uint32_t* gather_indirectly_referenced_memory_bytes_remaining = nullptr);
 
   // ExceptionSnapshot:
 
@@ -88,6 +97,7 @@ class ExceptionSnapshotLinux final : public ExceptionSnapshot {
   } context_union_;
   CPUContext context_;
   std::vector<uint64_t> codes_;
+  std::vector<std::unique_ptr<MemorySnapshotGeneric>> extra_memory_;
   uint64_t thread_id_;
   uint64_t exception_address_;
   uint32_t signal_number_;
@@ -186,12 +186,17 @@ void ProcessReaderLinux::Thread::InitializeStackFromSP(
 }
 
 ProcessReaderLinux::Module::Module()
-    : name(), elf_reader(nullptr), type(ModuleSnapshot::kModuleTypeUnknown) {}
+    : name(),
+      elf_reader(nullptr),
+      type(ModuleSnapshot::kModuleTypeUnknown),
+      device(0),
+      inode(0) {}
 
 ProcessReaderLinux::Module::~Module() = default;
 
 ProcessReaderLinux::ProcessReaderLinux()
     : connection_(),
+      memory_cache_(),
       process_info_(),
       memory_map_(),
       threads_(),
@@ -204,11 +209,19 @@ ProcessReaderLinux::ProcessReaderLinux()
 
 ProcessReaderLinux::~ProcessReaderLinux() {}
 
-bool ProcessReaderLinux::Initialize(PtraceConnection* connection) {
+bool ProcessReaderLinux::Initialize(PtraceConnection* connection,
+                                    bool cache_memory) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
   DCHECK(connection);
   connection_ = connection;
 
+  if (cache_memory) {
+    memory_cache_ = std::make_unique<ProcessMemoryCaching>();
+    if (!memory_cache_->Initialize(connection_->Memory())) {
+      return false;
+    }
+  }
+
   if (!process_info_.InitializeWithPtrace(connection_)) {
     return false;
   }
@@ -234,29 +247,22 @@ bool ProcessReaderLinux::CPUTimes(timeval* user_time,
   timerclear(user_time);
   timerclear(system_time);
 
-  timeval local_user_time;
-  timerclear(&local_user_time);
-  timeval local_system_time;
-  timerclear(&local_system_time);
-
-  for (const Thread& thread : threads_) {
-    ProcStatReader stat;
-    if (!stat.Initialize(connection_, thread.tid)) {
-      return false;
-    }
-
-    timeval thread_user_time;
-    if (!stat.UserCPUTime(&thread_user_time)) {
-      return false;
-    }
+  // /proc/<tid>/stat reports the CPU time of the entire process even when tid
+  // isn’t the main thread, so it’s only read once, for the process. This
+  // includes the time of threads that have exited.
+  ProcStatReader stat;
+  if (!stat.Initialize(connection_, ProcessID())) {
+    return false;
+  }
 
-    timeval thread_system_time;
-    if (!stat.SystemCPUTime(&thread_system_time)) {
-      return false;
-    }
+  timeval local_user_time;
+  if (!stat.UserCPUTime(&local_user_time)) {
+    return false;
+  }
 
-    timeradd(&local_user_time, &thread_user_time, &local_user_time);
-    timeradd(&local_system_time, &thread_system_time, &local_system_time);
+  timeval local_system_time;
+  if (!stat.SystemCPUTime(&local_system_time)) {
+    return false;
   }
 
   *user_time = local_user_time;
@@ -468,6 +474,8 @@ void ProcessReaderLinux::InitializeModules() {
                                                : exe_mapping->name;
   exe.elf_reader = exe_reader.get();
   exe.type = ModuleSnapshot::ModuleType::kModuleTypeExecutable;
+  exe.device = exe_mapping->device;
+  exe.inode = exe_mapping->inode;
 
   modules_.push_back(exe);
   elf_readers_.push_back(std::move(exe_reader));
@@ -534,6 +542,8 @@ void ProcessReaderLinux::InitializeModules() {
     module.type = loader_base && elf_reader->Address() == loader_base
                       ? ModuleSnapshot::kModuleTypeDynamicLoader
                       : ModuleSnapshot::kModuleTypeSharedLibrary;
+    module.device = module_mapping->device;
+    module.inode = module_mapping->inode;
     modules_.push_back(module);
     elf_readers_.push_back(std::move(elf_reader));
   }
@@ -32,6 +32,7 @@
 #include "util/misc/initialization_state_dcheck.h"
 #include "util/posix/process_info.h"
 #include "util/process/process_memory.h"
+#include "util/process/process_memory_caching.h"
 
 namespace crashpad {
 
@@ -96,6 +97,12 @@ class ProcessReaderLinux {
 
     //! \brief The module's type.
     ModuleSnapshot::ModuleType type;
+
+    //! \brief The device containing the file the module was mapped from.
+    dev_t device;
+
+    //! \brief The inode of the file the module was mapped from.
+    ino_t inode;
   };
 
   ProcessReaderLinux();
@@ -107,8 +114,12 @@ class ProcessReaderLinux {
   //! this class and may only be called once.
   //!
   //! \param[in] connection A PtraceConnection to the target process.
+  //! \param[in] cache_memory If `true`, reads of the target process’ memory
+  //!     are served through a ProcessMemoryCaching object for the lifetime of
+  //!     this object. This must only be used while the target process is
+  //!     suspended.
   //! \return `true` on success. `false` on failure with a message logged.
-  bool Initialize(PtraceConnection* connection);
+  bool Initialize(PtraceConnection* connection, bool cache_memory = false);
 
   //! \brief Return `true` if the target task is a 64-bit process.
   bool Is64Bit() const { return is_64_bit_; }
@@ -120,7 +131,15 @@ class ProcessReaderLinux {
   pid_t ParentProcessID() const { return process_info_.ParentProcessID(); }
 
   //! \brief Return a memory reader for the target process.
-  const ProcessMemory* Memory() const { return connection_->Memory(); }
+  const ProcessMemory* Memory() const {
+    return memory_cache_ ? memory_cache_.get() : connection_->Memory();
+  }
+
+  //! \brief Return the memory cache used by Memory(), or `nullptr` if memory
+  //!     caching was not requested in Initialize().
+  const ProcessMemoryCaching* MemoryCache() const {
+    return memory_cache_.get();
+  }
 
   //! \brief Return a memory map of the target process.
   MemoryMap* GetMemoryMap() { return &memory_map_; }
@@ -165,6 +184,7 @@ class ProcessReaderLinux {
   void ReadAbortMessage(const MemoryMap::Mapping* mapping);
 
   PtraceConnection* connection_;  // weak
+  std::unique_ptr<ProcessMemoryCaching> memory_cache_;
   ProcessInfo process_info_;
   MemoryMap memory_map_;
   std::vector<Thread> threads_;
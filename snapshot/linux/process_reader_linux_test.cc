@@ -30,6 +30,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/format_macros.h"
 #include "base/memory/free_deleter.h"
@@ -48,6 +49,7 @@
 #include "util/file/filesystem.h"
 #include "util/linux/direct_ptrace_connection.h"
 #include "util/misc/address_sanitizer.h"
+#include "util/misc/clock.h"
 #include "util/misc/from_pointer_cast.h"
 #include "util/misc/memory_sanitizer.h"
 #include "util/synchronization/semaphore.h"
@@ -388,6 +390,65 @@ TEST(ProcessReaderLinux, ChildThreadsWithSmallUserStacks) {
   test.Run();
 }
 
+// Measures how long a process with many threads stays stopped while its
+// threads are captured, from attaching to it until detaching from it.
+class ChildThreadsBenchmarkTest : public Multiprocess {
+ public:
+  ChildThreadsBenchmarkTest() : Multiprocess() {}
+  ~ChildThreadsBenchmarkTest() {}
+
+ private:
+  void MultiprocessParent() override {
+    char c;
+    CheckedReadFileExactly(ReadPipeHandle(), &c, sizeof(c));
+
+    const uint64_t start = ClockMonotonicNanoseconds();
+    uint64_t threads_end;
+    uint64_t cpu_times_end;
+    size_t thread_count;
+    {
+      DirectPtraceConnection connection;
+      ASSERT_TRUE(connection.Initialize(ChildPID(), /* seize= */ true));
+
+      ProcessReaderLinux process_reader;
+      ASSERT_TRUE(process_reader.Initialize(&connection));
+      thread_count = process_reader.Threads().size();
+      threads_end = ClockMonotonicNanoseconds();
+
+      timeval user_time;
+      timeval system_time;
+      ASSERT_TRUE(process_reader.CPUTimes(&user_time, &system_time));
+      cpu_times_end = ClockMonotonicNanoseconds();
+    }
+    const uint64_t end = ClockMonotonicNanoseconds();
+
+    EXPECT_EQ(thread_count, kThreadCount + 1);
+    LOG(INFO) << thread_count << " threads in " << (threads_end - start) / 1E6
+              << " ms, CPU times in " << (cpu_times_end - threads_end) / 1E6
+              << " ms, detached in " << (end - cpu_times_end) / 1E6
+              << " ms, stopped for " << (end - start) / 1E6 << " ms";
+  }
+
+  void MultiprocessChild() override {
+    TestThreadPool thread_pool;
+    thread_pool.StartThreads(kThreadCount, kStackSize);
+
+    char c = 0;
+    CheckedWriteFile(WritePipeHandle(), &c, sizeof(c));
+    CheckedReadFileAtEOF(ReadPipeHandle());
+  }
+
+  static constexpr size_t kThreadCount = 2000;
+  static constexpr size_t kStackSize = 64 * 1024;
+
+  DISALLOW_COPY_AND_ASSIGN(ChildThreadsBenchmarkTest);
+};
+
+TEST(ProcessReaderLinux, DISABLED_ChildThreadsBenchmark) {
+  ChildThreadsBenchmarkTest test;
+  test.Run();
+}
+
 // Tests a thread with a stack that spans multiple mappings.
 class ChildWithSplitStackTest : public Multiprocess {
  public:
@@ -789,6 +850,48 @@ TEST(ProcessReaderLinux, SelfModules) {
   ExpectTestModule(&process_reader, module_soname);
 }
 
+TEST(ProcessReaderLinux, DISABLED_SelfModulesBenchmark) {
+  // Module enumeration is measured in a process with a large number of loaded
+  // modules.
+  constexpr size_t kModuleCount = 500;
+  std::vector<ScopedModuleHandle> modules;
+  for (size_t index = 0; index < kModuleCount; ++index) {
+    modules.push_back(LoadTestModule(
+        base::StringPrintf("benchmark_module_%" PRIuS ".so", index),
+        base::StringPrintf("benchmark_module_soname_%" PRIuS, index)));
+    ASSERT_TRUE(modules.back().valid());
+  }
+
+  FakePtraceConnection connection;
+  connection.Initialize(getpid());
+
+  for (bool cache_memory : {false, true}) {
+    ProcessReaderLinux process_reader;
+    ASSERT_TRUE(process_reader.Initialize(&connection, cache_memory));
+
+    const uint64_t start = ClockMonotonicNanoseconds();
+    const size_t module_count = process_reader.Modules().size();
+    const uint64_t end = ClockMonotonicNanoseconds();
+    EXPECT_GT(module_count, kModuleCount);
+
+    // With the cache, every read made while enumerating modules is counted,
+    // along with the reads that the cache made of the target process.
+    std::string reads;
+    if (cache_memory) {
+      const ProcessMemoryCaching::Stats& stats =
+          process_reader.MemoryCache()->GetStats();
+      reads = base::StringPrintf(", %" PRIu64 " reads, %" PRIu64
+                                 " underlying reads",
+                                 stats.hits + stats.misses +
+                                     stats.uncached_reads,
+                                 stats.underlying_reads);
+    }
+    LOG(INFO) << (cache_memory ? "cached" : "uncached") << ": "
+              << module_count << " modules in " << (end - start) / 1E6
+              << " ms" << reads;
+  }
+}
+
 class ChildModuleTest : public Multiprocess {
  public:
   ChildModuleTest() : Multiprocess(), module_soname_("test_module_soname") {}
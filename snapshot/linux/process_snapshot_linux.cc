@@ -25,7 +25,10 @@ ProcessSnapshotLinux::ProcessSnapshotLinux() = default;
 
 ProcessSnapshotLinux::~ProcessSnapshotLinux() = default;
 
-bool ProcessSnapshotLinux::Initialize(PtraceConnection* connection) {
+bool ProcessSnapshotLinux::Initialize(
+    PtraceConnection* connection,
+    bool cache_memory,
+    ModuleMetadataCache* module_metadata_cache) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
 
   if (gettimeofday(&snapshot_time_, nullptr) != 0) {
@@ -33,7 +36,7 @@ bool ProcessSnapshotLinux::Initialize(PtraceConnection* connection) {
     return false;
   }
 
-  if (!process_reader_.Initialize(connection) ||
+  if (!process_reader_.Initialize(connection, cache_memory) ||
       !memory_range_.Initialize(process_reader_.Memory(),
                                 process_reader_.Is64Bit())) {
     return false;
@@ -41,8 +44,13 @@ bool ProcessSnapshotLinux::Initialize(PtraceConnection* connection) {
 
   system_.Initialize(&process_reader_, &snapshot_time_);
 
+  InitializeModules(module_metadata_cache);
+
+  GetCrashpadOptionsInternal(&options_);
+  indirectly_referenced_memory_bytes_remaining_ =
+      options_.indirectly_referenced_memory_cap;
+
   InitializeThreads();
-  InitializeModules();
   InitializeAnnotations();
 
   INITIALIZATION_STATE_SET_VALID(initialized_);
@@ -84,23 +92,36 @@ bool ProcessSnapshotLinux::InitializeException(
   if (!exception_->Initialize(&process_reader_,
                               info.siginfo_address,
                               info.context_address,
-                              info.thread_id)) {
+                              info.thread_id,
+                              IndirectlyReferencedMemoryBytesRemaining())) {
     exception_.reset();
     return false;
   }
 
   // The thread's existing snapshot will have captured the stack for the signal
   // handler. Replace it with a thread snapshot which captures the stack for the
-  // exception context.
+  // exception context. Indirectly referenced memory charged to the budget by
+  // the snapshot being replaced is returned to it first, so that the
+  // replacement doesn't charge the budget a second time for the same thread.
   for (const auto& reader_thread : process_reader_.Threads()) {
     if (reader_thread.tid == info.thread_id) {
       ProcessReaderLinux::Thread thread = reader_thread;
       thread.InitializeStackFromSP(&process_reader_,
                                    exception_->Context()->StackPointer());
 
+      const auto charged =
+          thread_indirectly_referenced_memory_bytes_.find(thread.tid);
+      if (charged != thread_indirectly_referenced_memory_bytes_.end()) {
+        indirectly_referenced_memory_bytes_remaining_ += charged->second;
+        thread_indirectly_referenced_memory_bytes_.erase(charged);
+      }
+
       auto exc_thread_snapshot =
           std::make_unique<internal::ThreadSnapshotLinux>();
-      if (!exc_thread_snapshot->Initialize(&process_reader_, thread)) {
+      if (!exc_thread_snapshot->Initialize(
+              &process_reader_,
+              thread,
+              IndirectlyReferencedMemoryBytesRemaining())) {
         return false;
       }
 
@@ -124,7 +145,11 @@ bool ProcessSnapshotLinux::InitializeException(
 void ProcessSnapshotLinux::GetCrashpadOptions(
     CrashpadInfoClientOptions* options) {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  *options = options_;
+}
 
+void ProcessSnapshotLinux::GetCrashpadOptionsInternal(
+    CrashpadInfoClientOptions* options) {
   CrashpadInfoClientOptions local_options;
 
   for (const auto& module : modules_) {
@@ -262,16 +287,25 @@ const ProcessMemory* ProcessSnapshotLinux::Memory() const {
 void ProcessSnapshotLinux::InitializeThreads() {
   const std::vector<ProcessReaderLinux::Thread>& process_reader_threads =
       process_reader_.Threads();
+  uint32_t* const budget = IndirectlyReferencedMemoryBytesRemaining();
   for (const ProcessReaderLinux::Thread& process_reader_thread :
        process_reader_threads) {
+    const uint32_t budget_before = budget ? *budget : 0;
     auto thread = std::make_unique<internal::ThreadSnapshotLinux>();
-    if (thread->Initialize(&process_reader_, process_reader_thread)) {
+    const bool initialized =
+        thread->Initialize(&process_reader_, process_reader_thread, budget);
+    if (budget) {
+      thread_indirectly_referenced_memory_bytes_[process_reader_thread.tid] =
+          budget_before - *budget;
+    }
+    if (initialized) {
       threads_.push_back(std::move(thread));
     }
   }
 }
 
-void ProcessSnapshotLinux::InitializeModules() {
+void ProcessSnapshotLinux::InitializeModules(
+    ModuleMetadataCache* module_metadata_cache) {
   for (const ProcessReaderLinux::Module& reader_module :
        process_reader_.Modules()) {
     auto module =
@@ -280,12 +314,20 @@ void ProcessSnapshotLinux::InitializeModules() {
                                                       reader_module.type,
                                                       &memory_range_,
                                                       process_reader_.Memory());
-    if (module->Initialize()) {
+    if (module->Initialize(module_metadata_cache,
+                           reader_module.device,
+                           reader_module.inode)) {
       modules_.push_back(std::move(module));
     }
   }
 }
 
+uint32_t* ProcessSnapshotLinux::IndirectlyReferencedMemoryBytesRemaining() {
+  return options_.gather_indirectly_referenced_memory == TriState::kEnabled
+             ? &indirectly_referenced_memory_bytes_remaining_
+             : nullptr;
+}
+
 void ProcessSnapshotLinux::InitializeAnnotations() {
 #if defined(OS_ANDROID)
   const std::string& abort_message = process_reader_.AbortMessage();
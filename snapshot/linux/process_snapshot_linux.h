@@ -25,6 +25,7 @@
 
 #include "base/macros.h"
 #include "snapshot/crashpad_info_client_options.h"
+#include "snapshot/elf/module_metadata_cache.h"
 #include "snapshot/elf/module_snapshot_elf.h"
 #include "snapshot/linux/exception_snapshot_linux.h"
 #include "snapshot/linux/process_reader_linux.h"
@@ -54,10 +55,19 @@ class ProcessSnapshotLinux final : public ProcessSnapshot {
   //! \brief Initializes the object.
   //!
   //! \param[in] connection A connection to the process to snapshot.
+  //! \param[in] cache_memory If `true`, reads of the target process’ memory
+  //!     are cached for the lifetime of the snapshot. The target process must
+  //!     remain suspended for as long as the snapshot is in use.
+  //! \param[in] module_metadata_cache A cache of module metadata shared
+  //!     between snapshots. If not `nullptr`, metadata for modules already
+  //!     seen by an earlier snapshot is taken from the cache instead of being
+  //!     parsed again. Optional, weak.
   //!
   //! \return `true` if the snapshot could be created, `false` otherwise with
   //!     an appropriate message logged.
-  bool Initialize(PtraceConnection* connection);
+  bool Initialize(PtraceConnection* connection,
+                  bool cache_memory = false,
+                  ModuleMetadataCache* module_metadata_cache = nullptr);
 
   //! \brief Finds the thread whose stack contains \a stack_address.
   //!
@@ -133,9 +143,16 @@ class ProcessSnapshotLinux final : public ProcessSnapshot {
 
  private:
   void InitializeThreads();
-  void InitializeModules();
+  void InitializeModules(ModuleMetadataCache* module_metadata_cache);
   void InitializeAnnotations();
 
+  // Initializes options_ on behalf of Initialize().
+  void GetCrashpadOptionsInternal(CrashpadInfoClientOptions* options);
+
+  // Returns the remaining budget for indirectly referenced memory, or nullptr
+  // if it isn’t to be gathered.
+  uint32_t* IndirectlyReferencedMemoryBytesRemaining();
+
   std::map<std::string, std::string> annotations_simple_map_;
   timeval snapshot_time_;
   UUID report_id_;
@@ -146,6 +163,13 @@ class ProcessSnapshotLinux final : public ProcessSnapshot {
   internal::SystemSnapshotLinux system_;
   ProcessReaderLinux process_reader_;
   ProcessMemoryRange memory_range_;
+  CrashpadInfoClientOptions options_;
+  uint32_t indirectly_referenced_memory_bytes_remaining_ = 0;
+
+  // The portion of the indirectly referenced memory budget charged by each
+  // thread’s initial snapshot, by thread ID, so that it can be returned to the
+  // budget if the snapshot is replaced.
+  std::map<pid_t, uint32_t> thread_indirectly_referenced_memory_bytes_;
   InitializationStateDcheck initialized_;
 
   DISALLOW_COPY_AND_ASSIGN(ProcessSnapshotLinux);
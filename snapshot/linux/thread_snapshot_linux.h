@@ -17,6 +17,9 @@
 
 #include <stdint.h>
 
+#include <memory>
+#include <vector>
+
 #include "base/macros.h"
 #include "build/build_config.h"
 #include "snapshot/cpu_context.h"
@@ -41,11 +44,18 @@ class ThreadSnapshotLinux final : public ThreadSnapshot {
   //!     the thread.
   //! \param[in] thread The thread within the ProcessReaderLinux for
   //!     which the snapshot should be created.
+  //! \param[in,out] gather_indirectly_referenced_memory_bytes_remaining If
+  //!     non-null, add extra memory regions to the snapshot pointed to by the
+  //!     thread's registers and stack. The size of the regions added is
+  //!     subtracted from the count, and when it's `0`, no more regions will be
+  //!     added.
   //!
   //! \return `true` if the snapshot could be created, `false` otherwise with
   //!     a message logged.
-  bool Initialize(ProcessReaderLinux* process_reader,
-                  const ProcessReaderLinux::Thread& thread);
+  bool Initialize(
+      ProcessReaderLinux* process_reader,
+      const ProcessReaderLinux::Thread& thread,
+      uint32_t* gather_indirectly_referenced_memory_bytes_remaining);
 
   // ThreadSnapshot:
 
@@ -74,6 +84,7 @@ class ThreadSnapshotLinux final : public ThreadSnapshot {
   } context_union_;
   CPUContext context_;
   MemorySnapshotGeneric stack_;
+  std::vector<std::unique_ptr<MemorySnapshotGeneric>> pointed_to_memory_;
   LinuxVMAddress thread_specific_data_address_;
   pid_t thread_id_;
   int priority_;
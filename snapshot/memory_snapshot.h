@@ -24,6 +24,8 @@
 
 namespace crashpad {
 
+class ProcessMemory;
+
 //! \brief An abstract interface to a snapshot representing a region of memory
 //!     present in a snapshot process.
 class MemorySnapshot {
@@ -75,6 +77,19 @@ class MemorySnapshot {
   //!     success and `false` on failure.
   virtual bool Read(Delegate* delegate) const = 0;
 
+  //! \brief Returns the ProcessMemory that Read() copies this snapshot’s data
+  //!     from, if Read() provides the data at Address() in that ProcessMemory
+  //!     without modification.
+  //!
+  //! Clients that read many memory snapshots may use this to copy the data of
+  //! several snapshots with a single call to ProcessMemory::ReadMultiple()
+  //! instead of calling Read() on each.
+  //!
+  //! \return The ProcessMemory, or `nullptr` if the snapshot’s data can only be
+  //!     obtained by calling Read(). The default implementation returns
+  //!     `nullptr`.
+  virtual const ProcessMemory* SourceProcessMemory() const { return nullptr; }
+
   //! \brief Creates a new MemorySnapshot based on merging this one with \a
   //!     other.
   //!
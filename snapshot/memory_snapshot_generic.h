@@ -83,6 +83,11 @@ class MemorySnapshotGeneric final : public MemorySnapshot {
     return delegate->MemorySnapshotDelegateRead(buffer.get(), size_);
   }
 
+  const ProcessMemory* SourceProcessMemory() const override {
+    INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+    return process_memory_;
+  }
+
   const MemorySnapshot* MergeWithOtherSnapshot(
       const MemorySnapshot* other) const override {
     const MemorySnapshotGeneric* other_as_memory_snapshot_concrete =
@@ -24,13 +24,17 @@ namespace internal {
 MemorySnapshotMinidump::MemorySnapshotMinidump()
     : MemorySnapshot(),
       address_(0),
+      contents_(nullptr),
+      size_(0),
       data_(),
       initialized_() {}
 
 MemorySnapshotMinidump::~MemorySnapshotMinidump() {}
 
-bool MemorySnapshotMinidump::Initialize(FileReaderInterface* file_reader,
-                                        RVA location) {
+bool MemorySnapshotMinidump::Initialize(
+    FileReaderInterface* file_reader,
+    RVA location,
+    const MemoryFileReader* file_contents) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
 
   MINIDUMP_MEMORY_DESCRIPTOR descriptor;
@@ -44,14 +48,25 @@ bool MemorySnapshotMinidump::Initialize(FileReaderInterface* file_reader,
   }
 
   address_ = descriptor.StartOfMemoryRange;
-  data_.resize(descriptor.Memory.DataSize);
+  size_ = descriptor.Memory.DataSize;
 
-  if (!file_reader->SeekSet(descriptor.Memory.Rva)) {
-    return false;
-  }
+  if (file_contents) {
+    if (!file_contents->ContainsRange(descriptor.Memory.Rva, size_)) {
+      return false;
+    }
+    contents_ = file_contents->data() + descriptor.Memory.Rva;
+  } else {
+    data_.resize(size_);
 
-  if (!file_reader->ReadExactly(data_.data(), data_.size())) {
-    return false;
+    if (!file_reader->SeekSet(descriptor.Memory.Rva)) {
+      return false;
+    }
+
+    if (!file_reader->ReadExactly(data_.data(), data_.size())) {
+      return false;
+    }
+
+    contents_ = data_.data();
   }
 
   INITIALIZATION_STATE_SET_VALID(initialized_);
@@ -65,13 +80,13 @@ uint64_t MemorySnapshotMinidump::Address() const {
 
 size_t MemorySnapshotMinidump::Size() const {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
-  return data_.size();
+  return size_;
 }
 
 bool MemorySnapshotMinidump::Read(Delegate* delegate) const {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
-  return delegate->MemorySnapshotDelegateRead(
-      const_cast<uint8_t*>(data_.data()), data_.size());
+  return delegate->MemorySnapshotDelegateRead(const_cast<uint8_t*>(contents_),
+                                              size_);
 }
 
 const MemorySnapshot* MemorySnapshotMinidump::MergeWithOtherSnapshot(
@@ -94,16 +109,18 @@ const MemorySnapshot* MemorySnapshotMinidump::MergeWithOtherSnapshot(
 
   auto result = std::make_unique<MemorySnapshotMinidump>();
   result->address_ = merged.base();
-  result->data_ = data_;
-
-  if (result->data_.size() == merged.size()) {
-    return result.release();
+  result->data_.assign(contents_, contents_ + size_);
+
+  if (result->data_.size() != merged.size()) {
+    result->data_.resize(
+        base::checked_cast<size_t>(other_cast->address_ - address_));
+    result->data_.insert(result->data_.end(),
+                         other_cast->contents_,
+                         other_cast->contents_ + other_cast->size_);
   }
 
-  result->data_.resize(
-      base::checked_cast<size_t>(other_cast->address_ - address_));
-  result->data_.insert(result->data_.end(), other_cast->data_.begin(),
-                       other_cast->data_.end());
+  result->contents_ = result->data_.data();
+  result->size_ = result->data_.size();
   return result.release();
 }
 
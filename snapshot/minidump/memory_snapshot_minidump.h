@@ -23,6 +23,7 @@
 #include "base/macros.h"
 #include "snapshot/memory_snapshot.h"
 #include "util/file/file_reader.h"
+#include "util/file/memory_file_reader.h"
 #include "util/misc/initialization_state_dcheck.h"
 
 namespace crashpad {
@@ -38,10 +39,16 @@ class MemorySnapshotMinidump : public MemorySnapshot {
   //!     The file reader must support seeking.
   //! \param[in] location The location within the file where we will find a
   //!     MINIDUMP_MEMORY_DESCRIPTOR from which to initialize this object.
+  //! \param[in] file_contents If not `nullptr`, the same minidump file as \a
+  //!     file_reader, held in memory. The snapshot then refers to the memory
+  //!     region’s contents in place rather than copying them, so \a
+  //!     file_contents’ buffer must outlive this object.
   //!
   //! \return `true` if the snapshot could be created, `false` otherwise with
   //!     an appropriate message logged.
-  bool Initialize(FileReaderInterface* file_reader, RVA location);
+  bool Initialize(FileReaderInterface* file_reader,
+                  RVA location,
+                  const MemoryFileReader* file_contents = nullptr);
 
   uint64_t Address() const override;
   size_t Size() const override;
@@ -51,7 +58,15 @@ class MemorySnapshotMinidump : public MemorySnapshot {
 
  private:
   uint64_t address_;
+
+  // The memory region’s contents, either within data_ or within a file held in
+  // memory.
+  const uint8_t* contents_;
+  size_t size_;
+
+  // The memory region’s contents, if they were copied from the file.
   std::vector<uint8_t> data_;
+
   InitializationStateDcheck initialized_;
 
   DISALLOW_COPY_AND_ASSIGN(MemorySnapshotMinidump);
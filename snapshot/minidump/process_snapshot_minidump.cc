@@ -18,12 +18,17 @@
 
 #include "base/logging.h"
 #include "base/notreached.h"
+#include "base/numerics/safe_conversions.h"
 #include "base/strings/utf_string_conversions.h"
 #include "minidump/minidump_extensions.h"
 #include "snapshot/memory_map_region_snapshot.h"
 #include "snapshot/minidump/minidump_simple_string_dictionary_reader.h"
 #include "util/file/file_io.h"
 
+#if defined(OS_POSIX)
+#include <sys/mman.h>
+#endif  // OS_POSIX
+
 namespace crashpad {
 
 namespace internal {
@@ -46,14 +51,20 @@ class MemoryMapRegionSnapshotMinidump : public MemoryMapRegionSnapshot {
 ProcessSnapshotMinidump::ProcessSnapshotMinidump()
     : ProcessSnapshot(),
       header_(),
+#if defined(OS_POSIX)
+      mapping_(),
+#endif  // OS_POSIX
+      mapped_file_reader_(),
       stream_directory_(),
       stream_map_(),
       modules_(),
       threads_(),
+      custom_streams_(),
+      threads_initialized_(false),
+      custom_streams_initialized_(false),
       unloaded_modules_(),
       mem_regions_(),
       mem_regions_exposed_(),
-      custom_streams_(),
       crashpad_info_(),
       system_snapshot_(),
       exception_snapshot_(),
@@ -73,6 +84,61 @@ bool ProcessSnapshotMinidump::Initialize(FileReaderInterface* file_reader) {
 
   file_reader_ = file_reader;
 
+  if (!InitializeFromFileReader() || !InitializeThreads() ||
+      !InitializeCustomMinidumpStreams()) {
+    return false;
+  }
+
+  threads_initialized_ = true;
+  custom_streams_initialized_ = true;
+
+  INITIALIZATION_STATE_SET_VALID(initialized_);
+  return true;
+}
+
+#if defined(OS_POSIX)
+bool ProcessSnapshotMinidump::InitializeMapped(FileHandle file_handle) {
+  INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
+
+  const FileOffset file_size = LoggingFileSizeByHandle(file_handle);
+  if (file_size < 0) {
+    return false;
+  }
+
+  if (static_cast<uint64_t>(file_size) < sizeof(header_)) {
+    LOG(ERROR) << "minidump too small";
+    return false;
+  }
+
+  if (!base::IsValueInRangeForNumericType<size_t>(file_size)) {
+    LOG(ERROR) << "minidump too large to map";
+    return false;
+  }
+
+  if (!mapping_.ResetMmap(nullptr,
+                          static_cast<size_t>(file_size),
+                          PROT_READ,
+                          MAP_PRIVATE,
+                          file_handle,
+                          0)) {
+    return false;
+  }
+
+  mapped_file_reader_.reset(
+      new MemoryFileReader(mapping_.addr(), mapping_.len()));
+  file_reader_ = mapped_file_reader_.get();
+
+  // The thread list and custom streams are initialized on first use.
+  if (!InitializeFromFileReader()) {
+    return false;
+  }
+
+  INITIALIZATION_STATE_SET_VALID(initialized_);
+  return true;
+}
+#endif  // OS_POSIX
+
+bool ProcessSnapshotMinidump::InitializeFromFileReader() {
   if (!file_reader_->SeekSet(0)) {
     return false;
   }
@@ -91,7 +157,7 @@ bool ProcessSnapshotMinidump::Initialize(FileReaderInterface* file_reader) {
     return false;
   }
 
-  if (!file_reader->SeekSet(header_.StreamDirectoryRva)) {
+  if (!file_reader_->SeekSet(header_.StreamDirectoryRva)) {
     return false;
   }
 
@@ -114,15 +180,9 @@ bool ProcessSnapshotMinidump::Initialize(FileReaderInterface* file_reader) {
     stream_map_[stream_type] = &directory.Location;
   }
 
-  if (!InitializeCrashpadInfo() || !InitializeMiscInfo() ||
-      !InitializeModules() || !InitializeSystemSnapshot() ||
-      !InitializeMemoryInfo() || !InitializeThreads() ||
-      !InitializeCustomMinidumpStreams() || !InitializeExceptionSnapshot()) {
-    return false;
-  }
-
-  INITIALIZATION_STATE_SET_VALID(initialized_);
-  return true;
+  return InitializeCrashpadInfo() && InitializeMiscInfo() &&
+         InitializeModules() && InitializeSystemSnapshot() &&
+         InitializeMemoryInfo() && InitializeExceptionSnapshot();
 }
 
 crashpad::ProcessID ProcessSnapshotMinidump::ProcessID() const {
@@ -186,6 +246,13 @@ const SystemSnapshot* ProcessSnapshotMinidump::System() const {
 
 std::vector<const ThreadSnapshot*> ProcessSnapshotMinidump::Threads() const {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  if (!threads_initialized_) {
+    threads_initialized_ = true;
+    if (!InitializeThreads()) {
+      threads_.clear();
+    }
+  }
+
   std::vector<const ThreadSnapshot*> threads;
   for (const auto& thread : threads_) {
     threads.push_back(thread.get());
@@ -245,6 +312,12 @@ const ProcessMemory* ProcessSnapshotMinidump::Memory() const {
 std::vector<const MinidumpStream*>
 ProcessSnapshotMinidump::CustomMinidumpStreams() const {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  if (!custom_streams_initialized_) {
+    custom_streams_initialized_ = true;
+    if (!InitializeCustomMinidumpStreams()) {
+      custom_streams_.clear();
+    }
+  }
 
   std::vector<const MinidumpStream*> result;
   result.reserve(custom_streams_.size());
@@ -497,7 +570,7 @@ bool ProcessSnapshotMinidump::InitializeMemoryInfo() {
   return true;
 }
 
-bool ProcessSnapshotMinidump::InitializeThreads() {
+bool ProcessSnapshotMinidump::InitializeThreads() const {
   const auto& stream_it = stream_map_.find(kMinidumpStreamTypeThreadList);
   if (stream_it == stream_map_.end()) {
     return true;
@@ -528,7 +601,8 @@ bool ProcessSnapshotMinidump::InitializeThreads() {
                            thread_index * sizeof(MINIDUMP_THREAD);
 
     auto thread = std::make_unique<internal::ThreadSnapshotMinidump>();
-    if (!thread->Initialize(file_reader_, thread_rva, arch_)) {
+    if (!thread->Initialize(
+            file_reader_, thread_rva, arch_, mapped_file_reader_.get())) {
       return false;
     }
 
@@ -558,7 +632,7 @@ bool ProcessSnapshotMinidump::InitializeSystemSnapshot() {
   return true;
 }
 
-bool ProcessSnapshotMinidump::InitializeCustomMinidumpStreams() {
+bool ProcessSnapshotMinidump::InitializeCustomMinidumpStreams() const {
   for (size_t i = 0; i < stream_directory_.size(); i++) {
     const auto& stream = stream_directory_[i];
 
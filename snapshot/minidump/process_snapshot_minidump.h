@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "base/macros.h"
+#include "build/build_config.h"
 #include "minidump/minidump_extensions.h"
 #include "snapshot/exception_snapshot.h"
 #include "snapshot/memory_snapshot.h"
@@ -39,11 +40,17 @@
 #include "snapshot/system_snapshot.h"
 #include "snapshot/thread_snapshot.h"
 #include "snapshot/unloaded_module_snapshot.h"
+#include "util/file/file_io.h"
 #include "util/file/file_reader.h"
+#include "util/file/memory_file_reader.h"
 #include "util/misc/initialization_state_dcheck.h"
 #include "util/misc/uuid.h"
 #include "util/process/process_id.h"
 
+#if defined(OS_POSIX)
+#include "util/posix/scoped_mmap.h"
+#endif  // OS_POSIX
+
 namespace crashpad {
 
 namespace internal {
@@ -65,6 +72,31 @@ class ProcessSnapshotMinidump final : public ProcessSnapshot {
   //!     an appropriate message logged.
   bool Initialize(FileReaderInterface* file_reader);
 
+#if defined(OS_POSIX)
+  //! \brief Initializes the object from a minidump file mapped into memory.
+  //!
+  //! This is an alternative to Initialize() for callers that use only part of
+  //! a minidump, such as its annotations and module information. Because the
+  //! file is mapped rather than read, only the pages that are used are read
+  //! from disk. Thread stacks are referred to in place rather than copied, and
+  //! the thread list and custom streams are not interpreted until Threads() or
+  //! CustomMinidumpStreams() is first called. An error in one of those streams
+  //! is logged at that point, and the corresponding method returns an empty
+  //! list, rather than causing this method to fail.
+  //!
+  //! Because Threads() and CustomMinidumpStreams() then modify this object, an
+  //! object initialized this way must not be used by more than one thread at a
+  //! time, even through `const` methods.
+  //!
+  //! \param[in] file_handle A handle to a minidump file open for reading. The
+  //!     file must not be modified while this object exists. The handle is not
+  //!     retained, and may be closed once this method returns.
+  //!
+  //! \return `true` if the snapshot could be created, `false` otherwise with
+  //!     an appropriate message logged.
+  bool InitializeMapped(FileHandle file_handle);
+#endif  // OS_POSIX
+
   // ProcessSnapshot:
 
   crashpad::ProcessID ProcessID() const override;
@@ -97,6 +129,10 @@ class ProcessSnapshotMinidump final : public ProcessSnapshot {
   std::vector<const MinidumpStream*> CustomMinidumpStreams() const;
 
  private:
+  // Reads the header and stream directory from file_reader_ and initializes
+  // data carried in streams on behalf of Initialize() and InitializeMapped().
+  bool InitializeFromFileReader();
+
   // Initializes data carried in a MinidumpCrashpadInfo stream on behalf of
   // Initialize().
   bool InitializeCrashpadInfo();
@@ -106,8 +142,8 @@ class ProcessSnapshotMinidump final : public ProcessSnapshot {
   bool InitializeModules();
 
   // Initializes data carried in a MINIDUMP_THREAD_LIST stream on behalf of
-  // Initialize().
-  bool InitializeThreads();
+  // Initialize(), or on the first call to Threads() for a mapped minidump.
+  bool InitializeThreads() const;
 
   // Initializes data carried in a MINIDUMP_MEMORY_INFO_LIST stream on behalf of
   // Initialize().
@@ -128,23 +164,36 @@ class ProcessSnapshotMinidump final : public ProcessSnapshot {
   // Initialize().
   bool InitializeMiscInfo();
 
-  // Initializes custom minidump streams.
-  bool InitializeCustomMinidumpStreams();
+  // Initializes custom minidump streams on behalf of Initialize(), or on the
+  // first call to CustomMinidumpStreams() for a mapped minidump.
+  bool InitializeCustomMinidumpStreams() const;
 
   // Initializes data carried in a MINIDUMP_EXCEPTION_STREAM stream on behalf of
   // Initialize().
   bool InitializeExceptionSnapshot();
 
   MINIDUMP_HEADER header_;
+#if defined(OS_POSIX)
+  ScopedMmap mapping_;
+#endif  // OS_POSIX
+  std::unique_ptr<MemoryFileReader> mapped_file_reader_;
   std::vector<MINIDUMP_DIRECTORY> stream_directory_;
   std::map<MinidumpStreamType, const MINIDUMP_LOCATION_DESCRIPTOR*> stream_map_;
   std::vector<std::unique_ptr<internal::ModuleSnapshotMinidump>> modules_;
-  std::vector<std::unique_ptr<internal::ThreadSnapshotMinidump>> threads_;
+
+  // For a mapped minidump, these are populated on first use, and the
+  // corresponding *_initialized_ flag is set once that has been attempted.
+  // They aren’t synchronized, so the object isn’t thread-safe.
+  mutable std::vector<std::unique_ptr<internal::ThreadSnapshotMinidump>>
+      threads_;
+  mutable std::vector<std::unique_ptr<MinidumpStream>> custom_streams_;
+  mutable bool threads_initialized_;
+  mutable bool custom_streams_initialized_;
+
   std::vector<UnloadedModuleSnapshot> unloaded_modules_;
   std::vector<std::unique_ptr<internal::MemoryMapRegionSnapshotMinidump>>
       mem_regions_;
   std::vector<const MemoryMapRegionSnapshot*> mem_regions_exposed_;
-  std::vector<std::unique_ptr<MinidumpStream>> custom_streams_;
   MinidumpCrashpadInfo crashpad_info_;
   internal::SystemSnapshotMinidump system_snapshot_;
   internal::ExceptionSnapshotMinidump exception_snapshot_;
@@ -24,11 +24,14 @@
 #include "base/numerics/safe_math.h"
 #include "base/stl_util.h"
 #include "base/strings/utf_string_conversions.h"
+#include "build/build_config.h"
 #include "gtest/gtest.h"
 #include "minidump/minidump_context.h"
 #include "snapshot/memory_map_region_snapshot.h"
 #include "snapshot/minidump/minidump_annotation_reader.h"
 #include "snapshot/module_snapshot.h"
+#include "test/scoped_temp_dir.h"
+#include "util/file/file_writer.h"
 #include "util/file/string_file.h"
 #include "util/misc/pdb_structures.h"
 
@@ -1240,6 +1243,153 @@ TEST(ProcessSnapshotMinidump, Stacks) {
   EXPECT_EQ(delegate.result, minidump_stack);
 }
 
+#if defined(OS_POSIX)
+
+// Writes the contents of string_file to a new file named "minidump" in
+// temp_dir and opens it for reading.
+void WriteAndOpenMinidump(const StringFile& string_file,
+                          const ScopedTempDir& temp_dir,
+                          ScopedFileHandle* handle) {
+  const base::FilePath path =
+      temp_dir.path().Append(FILE_PATH_LITERAL("minidump"));
+  FileWriter writer;
+  ASSERT_TRUE(writer.Open(
+      path, FileWriteMode::kTruncateOrCreate, FilePermissions::kOwnerOnly));
+  ASSERT_TRUE(
+      writer.Write(string_file.string().data(), string_file.string().size()));
+  writer.Close();
+
+  handle->reset(LoggingOpenFileForRead(path));
+  ASSERT_TRUE(handle->is_valid());
+}
+
+TEST(ProcessSnapshotMinidump, MappedEmptyFile) {
+  ScopedTempDir temp_dir;
+  ScopedFileHandle handle;
+  ASSERT_NO_FATAL_FAILURE(
+      WriteAndOpenMinidump(StringFile(), temp_dir, &handle));
+
+  ProcessSnapshotMinidump process_snapshot;
+  EXPECT_FALSE(process_snapshot.InitializeMapped(handle.get()));
+}
+
+TEST(ProcessSnapshotMinidump, MappedStacks) {
+  StringFile string_file;
+
+  MINIDUMP_HEADER header = {};
+  ASSERT_TRUE(string_file.Write(&header, sizeof(header)));
+
+  std::vector<uint8_t> minidump_stack(4096);
+  for (size_t index = 0; index < minidump_stack.size(); ++index) {
+    minidump_stack[index] = static_cast<uint8_t>(index);
+  }
+
+  MINIDUMP_THREAD minidump_thread = {};
+  minidump_thread.ThreadId = 42;
+  minidump_thread.Stack.StartOfMemoryRange = 0xbeefd00d;
+  minidump_thread.Stack.Memory.DataSize =
+      base::checked_cast<uint32_t>(minidump_stack.size());
+  minidump_thread.Stack.Memory.Rva = static_cast<RVA>(string_file.SeekGet());
+  ASSERT_TRUE(string_file.Write(minidump_stack.data(), minidump_stack.size()));
+
+  static const char kStreamData[] = "A string";
+  MINIDUMP_DIRECTORY directories[2] = {};
+  directories[0].StreamType = static_cast<MinidumpStreamType>(0xffffffff);
+  directories[0].Location.DataSize = sizeof(kStreamData);
+  directories[0].Location.Rva = static_cast<RVA>(string_file.SeekGet());
+  ASSERT_TRUE(string_file.Write(kStreamData, sizeof(kStreamData)));
+
+  const uint32_t minidump_thread_count = 1;
+  directories[1].StreamType = kMinidumpStreamTypeThreadList;
+  directories[1].Location.DataSize =
+      sizeof(MINIDUMP_THREAD_LIST) +
+      minidump_thread_count * sizeof(MINIDUMP_THREAD);
+  directories[1].Location.Rva = static_cast<RVA>(string_file.SeekGet());
+  ASSERT_TRUE(
+      string_file.Write(&minidump_thread_count, sizeof(minidump_thread_count)));
+  ASSERT_TRUE(string_file.Write(&minidump_thread, sizeof(minidump_thread)));
+
+  header.StreamDirectoryRva = static_cast<RVA>(string_file.SeekGet());
+  ASSERT_TRUE(string_file.Write(directories, sizeof(directories)));
+
+  header.Signature = MINIDUMP_SIGNATURE;
+  header.Version = MINIDUMP_VERSION;
+  header.NumberOfStreams = static_cast<uint32_t>(base::size(directories));
+  ASSERT_TRUE(string_file.SeekSet(0));
+  ASSERT_TRUE(string_file.Write(&header, sizeof(header)));
+
+  ScopedTempDir temp_dir;
+  ScopedFileHandle handle;
+  ASSERT_NO_FATAL_FAILURE(WriteAndOpenMinidump(string_file, temp_dir, &handle));
+
+  ProcessSnapshotMinidump process_snapshot;
+  ASSERT_TRUE(process_snapshot.InitializeMapped(handle.get()));
+
+  // The mapping remains valid after the file is closed.
+  handle.reset();
+
+  std::vector<const ThreadSnapshot*> threads = process_snapshot.Threads();
+  ASSERT_EQ(threads.size(), minidump_thread_count);
+  EXPECT_EQ(threads[0]->ThreadID(), 42u);
+  EXPECT_EQ(threads[0]->Stack()->Address(), 0xbeefd00d);
+
+  ReadToVector delegate;
+  ASSERT_TRUE(threads[0]->Stack()->Read(&delegate));
+  EXPECT_EQ(delegate.result, minidump_stack);
+
+  // Threads are only read once.
+  EXPECT_EQ(process_snapshot.Threads(), threads);
+
+  auto custom_streams = process_snapshot.CustomMinidumpStreams();
+  ASSERT_EQ(custom_streams.size(), 1u);
+  EXPECT_EQ(custom_streams[0]->stream_type(), 0xffffffff);
+  EXPECT_STREQ(reinterpret_cast<const char*>(custom_streams[0]->data().data()),
+               kStreamData);
+}
+
+TEST(ProcessSnapshotMinidump, MappedInvalidThreadList) {
+  StringFile string_file;
+
+  MINIDUMP_HEADER header = {};
+  ASSERT_TRUE(string_file.Write(&header, sizeof(header)));
+
+  // The thread list claims a thread but is too small to hold it.
+  const uint32_t minidump_thread_count = 1;
+  MINIDUMP_DIRECTORY minidump_thread_list_directory = {};
+  minidump_thread_list_directory.StreamType = kMinidumpStreamTypeThreadList;
+  minidump_thread_list_directory.Location.DataSize =
+      sizeof(minidump_thread_count);
+  minidump_thread_list_directory.Location.Rva =
+      static_cast<RVA>(string_file.SeekGet());
+  ASSERT_TRUE(
+      string_file.Write(&minidump_thread_count, sizeof(minidump_thread_count)));
+
+  header.StreamDirectoryRva = static_cast<RVA>(string_file.SeekGet());
+  ASSERT_TRUE(string_file.Write(&minidump_thread_list_directory,
+                                sizeof(minidump_thread_list_directory)));
+
+  header.Signature = MINIDUMP_SIGNATURE;
+  header.Version = MINIDUMP_VERSION;
+  header.NumberOfStreams = 1;
+  ASSERT_TRUE(string_file.SeekSet(0));
+  ASSERT_TRUE(string_file.Write(&header, sizeof(header)));
+
+  ProcessSnapshotMinidump eager_process_snapshot;
+  EXPECT_FALSE(eager_process_snapshot.Initialize(&string_file));
+
+  ScopedTempDir temp_dir;
+  ScopedFileHandle handle;
+  ASSERT_NO_FATAL_FAILURE(WriteAndOpenMinidump(string_file, temp_dir, &handle));
+
+  // The thread list isn’t needed to initialize a mapped minidump, so the error
+  // is only found when the threads are requested.
+  ProcessSnapshotMinidump process_snapshot;
+  ASSERT_TRUE(process_snapshot.InitializeMapped(handle.get()));
+  EXPECT_TRUE(process_snapshot.Threads().empty());
+}
+
+#endif  // OS_POSIX
+
 TEST(ProcessSnapshotMinidump, CustomMinidumpStreams) {
   StringFile string_file;
 
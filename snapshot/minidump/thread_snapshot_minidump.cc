@@ -32,9 +32,11 @@ ThreadSnapshotMinidump::ThreadSnapshotMinidump()
 
 ThreadSnapshotMinidump::~ThreadSnapshotMinidump() {}
 
-bool ThreadSnapshotMinidump::Initialize(FileReaderInterface* file_reader,
-                                        RVA minidump_thread_rva,
-                                        CPUArchitecture arch) {
+bool ThreadSnapshotMinidump::Initialize(
+    FileReaderInterface* file_reader,
+    RVA minidump_thread_rva,
+    CPUArchitecture arch,
+    const MemoryFileReader* file_contents) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
   std::vector<unsigned char> minidump_context;
 
@@ -64,7 +66,7 @@ bool ThreadSnapshotMinidump::Initialize(FileReaderInterface* file_reader,
   RVA stack_info_location =
       minidump_thread_rva + offsetof(MINIDUMP_THREAD, Stack);
 
-  if (!stack_.Initialize(file_reader, stack_info_location)) {
+  if (!stack_.Initialize(file_reader, stack_info_location, file_contents)) {
     return false;
   }
 
@@ -23,6 +23,7 @@
 #include "snapshot/minidump/minidump_context_converter.h"
 #include "snapshot/thread_snapshot.h"
 #include "util/file/file_reader.h"
+#include "util/file/memory_file_reader.h"
 #include "util/misc/initialization_state_dcheck.h"
 
 namespace crashpad {
@@ -42,12 +43,17 @@ class ThreadSnapshotMinidump : public ThreadSnapshot {
   //!     the thread’s MINIDUMP_THREAD structure is located.
   //! \param[in] arch The architecture of the system this thread is running on.
   //!     Used to decode CPU Context.
+  //! \param[in] file_contents If not `nullptr`, the same minidump file as
+  //!     \a file_reader, held in memory. The thread’s stack snapshot then
+  //!     refers to the stack’s contents in place, as described for
+  //!     MemorySnapshotMinidump::Initialize().
   //!
   //! \return `true` if the snapshot could be created, `false` otherwise with
   //!     an appropriate message logged.
   bool Initialize(FileReaderInterface* file_reader,
                   RVA minidump_thread_rva,
-                  CPUArchitecture arch);
+                  CPUArchitecture arch,
+                  const MemoryFileReader* file_contents = nullptr);
 
   const CPUContext* Context() const override;
   const MemorySnapshot* Stack() const override;
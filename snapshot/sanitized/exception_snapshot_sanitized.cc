@@ -0,0 +1,57 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "snapshot/sanitized/exception_snapshot_sanitized.h"
+
+namespace crashpad {
+namespace internal {
+
+ExceptionSnapshotSanitized::ExceptionSnapshotSanitized(
+    const ExceptionSnapshot* snapshot)
+    : ExceptionSnapshot(), snapshot_(snapshot) {}
+
+ExceptionSnapshotSanitized::~ExceptionSnapshotSanitized() = default;
+
+const CPUContext* ExceptionSnapshotSanitized::Context() const {
+  return snapshot_->Context();
+}
+
+uint64_t ExceptionSnapshotSanitized::ThreadID() const {
+  return snapshot_->ThreadID();
+}
+
+uint32_t ExceptionSnapshotSanitized::Exception() const {
+  return snapshot_->Exception();
+}
+
+uint32_t ExceptionSnapshotSanitized::ExceptionInfo() const {
+  return snapshot_->ExceptionInfo();
+}
+
+uint64_t ExceptionSnapshotSanitized::ExceptionAddress() const {
+  return snapshot_->ExceptionAddress();
+}
+
+const std::vector<uint64_t>& ExceptionSnapshotSanitized::Codes() const {
+  return snapshot_->Codes();
+}
+
+std::vector<const MemorySnapshot*> ExceptionSnapshotSanitized::ExtraMemory()
+    const {
+  // Indirectly referenced memory isn’t sanitized, so it’s omitted.
+  return std::vector<const MemorySnapshot*>();
+}
+
+}  // namespace internal
+}  // namespace crashpad
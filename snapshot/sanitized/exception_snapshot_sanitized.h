@@ -0,0 +1,55 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_SNAPSHOT_SANITIZED_EXCEPTION_SNAPSHOT_SANITIZED_H_
+#define CRASHPAD_SNAPSHOT_SANITIZED_EXCEPTION_SNAPSHOT_SANITIZED_H_
+
+#include "snapshot/exception_snapshot.h"
+
+#include "base/macros.h"
+
+namespace crashpad {
+namespace internal {
+
+//! \brief An ExceptionSnapshot which wraps and filters sensitive information
+//!     from another ExceptionSnapshot.
+class ExceptionSnapshotSanitized final : public ExceptionSnapshot {
+ public:
+  //! \brief Constructs this object.
+  //!
+  //! \param[in] snapshot The ExceptionSnapshot to sanitize.
+  explicit ExceptionSnapshotSanitized(const ExceptionSnapshot* snapshot);
+
+  ~ExceptionSnapshotSanitized() override;
+
+  // ExceptionSnapshot:
+
+  const CPUContext* Context() const override;
+  uint64_t ThreadID() const override;
+  uint32_t Exception() const override;
+  uint32_t ExceptionInfo() const override;
+  uint64_t ExceptionAddress() const override;
+  const std::vector<uint64_t>& Codes() const override;
+  std::vector<const MemorySnapshot*> ExtraMemory() const override;
+
+ private:
+  const ExceptionSnapshot* snapshot_;
+
+  DISALLOW_COPY_AND_ASSIGN(ExceptionSnapshotSanitized);
+};
+
+}  // namespace internal
+}  // namespace crashpad
+
+#endif  // CRASHPAD_SNAPSHOT_SANITIZED_EXCEPTION_SNAPSHOT_SANITIZED_H_
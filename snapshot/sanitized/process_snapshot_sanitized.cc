@@ -157,6 +157,11 @@ bool ProcessSnapshotSanitized::Initialize(
       threads_.emplace_back(std::make_unique<internal::ThreadSnapshotSanitized>(
           thread, &address_ranges_));
     }
+
+    if (snapshot_->Exception()) {
+      exception_ = std::make_unique<internal::ExceptionSnapshotSanitized>(
+          snapshot_->Exception());
+    }
   }
 
   process_memory_.Initialize(snapshot_->Memory(), memory_range_whitelist.get());
@@ -246,6 +251,9 @@ std::vector<UnloadedModuleSnapshot> ProcessSnapshotSanitized::UnloadedModules()
 
 const ExceptionSnapshot* ProcessSnapshotSanitized::Exception() const {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  if (sanitize_stacks_) {
+    return exception_.get();
+  }
   return snapshot_->Exception();
 }
 
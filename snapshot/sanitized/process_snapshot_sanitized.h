@@ -22,6 +22,7 @@
 #include "base/macros.h"
 #include "snapshot/exception_snapshot.h"
 #include "snapshot/process_snapshot.h"
+#include "snapshot/sanitized/exception_snapshot_sanitized.h"
 #include "snapshot/sanitized/module_snapshot_sanitized.h"
 #include "snapshot/sanitized/thread_snapshot_sanitized.h"
 #include "snapshot/thread_snapshot.h"
@@ -98,6 +99,7 @@ class ProcessSnapshotSanitized final : public ProcessSnapshot {
 
   // Only used when sanitize_stacks_ == true.
   std::vector<std::unique_ptr<internal::ThreadSnapshotSanitized>> threads_;
+  std::unique_ptr<internal::ExceptionSnapshotSanitized> exception_;
 
   RangeSet address_ranges_;
   const ProcessSnapshot* snapshot_;
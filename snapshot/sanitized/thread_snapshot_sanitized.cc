@@ -53,9 +53,7 @@ uint64_t ThreadSnapshotSanitized::ThreadSpecificDataAddress() const {
 
 std::vector<const MemorySnapshot*> ThreadSnapshotSanitized::ExtraMemory()
     const {
-  // TODO(jperaza): If/when ExtraMemory() is used, decide whether and how it
-  // should be sanitized.
-  DCHECK(snapshot_->ExtraMemory().empty());
+  // Indirectly referenced memory isn’t sanitized, so it’s omitted.
   return std::vector<const MemorySnapshot*>();
 }
 
@@ -49,11 +49,15 @@
         'elf/elf_image_reader.h',
         'elf/elf_symbol_table_reader.cc',
         'elf/elf_symbol_table_reader.h',
+        'elf/module_metadata_cache.cc',
+        'elf/module_metadata_cache.h',
         'elf/module_snapshot_elf.cc',
         'elf/module_snapshot_elf.h',
         'exception_snapshot.h',
         'handle_snapshot.cc',
         'handle_snapshot.h',
+        'linux/capture_memory_delegate_linux.cc',
+        'linux/capture_memory_delegate_linux.h',
         'linux/cpu_context_linux.cc',
         'linux/cpu_context_linux.h',
         'linux/debug_rendezvous.cc',
@@ -134,6 +138,8 @@
         'posix/timezone.cc',
         'posix/timezone.h',
         'process_snapshot.h',
+        'sanitized/exception_snapshot_sanitized.cc',
+        'sanitized/exception_snapshot_sanitized.h',
         'sanitized/memory_snapshot_sanitized.cc',
         'sanitized/memory_snapshot_sanitized.h',
         'sanitized/module_snapshot_sanitized.cc',
@@ -186,12 +192,7 @@
             ],
           },
         }],
-        ['OS=="linux" or OS=="android"', {
-          'sources!': [
-            'capture_memory.cc',
-            'capture_memory.h',
-          ],
-        }, {  # else: OS!="linux" and OS!="android"
+        ['OS!="linux" and OS!="android"', {
           'sources/': [
             ['exclude', '^elf/'],
             ['exclude', '^crashpad_types/'],
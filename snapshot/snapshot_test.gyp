@@ -69,6 +69,7 @@
         '..',
       ],
       'sources': [
+        'capture_memory_test.cc',
         'cpu_context_test.cc',
         'memory_snapshot_test.cc',
         'crashpad_info_client_options_test.cc',
@@ -76,6 +77,8 @@
         'crashpad_types/image_annotation_reader_test.cc',
         'elf/elf_image_reader_test.cc',
         'elf/elf_image_reader_test_note.S',
+        'elf/module_metadata_cache_test.cc',
+        'linux/capture_memory_delegate_linux_test.cc',
         'linux/debug_rendezvous_test.cc',
         'linux/exception_snapshot_linux_test.cc',
         'linux/process_reader_linux_test.cc',
@@ -103,7 +106,10 @@
       'conditions': [
         # .gnu.hash is incompatible with the MIPS ABI
         ['target_arch!="mips"', {
-          'dependencies': ['crashpad_snapshot_test_both_dt_hash_styles']
+          'dependencies': [
+            'crashpad_snapshot_test_both_dt_hash_styles',
+            'crashpad_snapshot_test_many_symbols',
+          ],
         }],
         ['OS=="mac"', {
           'dependencies': [
@@ -242,6 +248,22 @@
         ]
       ],
     },
+    {
+      'target_name': 'crashpad_snapshot_test_many_symbols',
+      'type': 'loadable_module',
+      'conditions': [
+        # .gnu.hash is incompatible with the MIPS ABI
+        ['target_arch!="mips"', {
+          'sources': [
+            'elf/elf_image_reader_many_symbols_test_module.cc',
+          ],
+          'ldflags': [
+            # This makes `ld` emit both .hash and .gnu.hash sections.
+            '-Wl,--hash-style=both',
+          ]},
+        ]
+      ],
+    },
   ],
   'conditions': [
     ['OS=="mac"', {
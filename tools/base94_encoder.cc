@@ -15,14 +15,66 @@
 #include <getopt.h>
 #include <stdio.h>
 
+#include <memory>
+
 #include "base/files/file_path.h"
+#include "base/macros.h"
 #include "build/build_config.h"
+#include "tools/parallel_zlib_output_stream.h"
 #include "tools/tool_support.h"
+#include "util/file/file_io.h"
+#include "util/file/file_reader.h"
+#include "util/file/scoped_remove_file.h"
+#include "util/stdlib/string_number_conversion.h"
+#include "util/stream/base94_output_stream.h"
 #include "util/stream/file_encoder.h"
+#include "util/stream/file_output_stream.h"
 
 namespace crashpad {
 namespace {
 
+// Encodes like FileEncoder in FileEncoder::Mode::kEncode mode, but compresses
+// with a ParallelZlibOutputStream using thread_count threads.
+bool EncodeInParallel(const base::FilePath& input_path,
+                      const base::FilePath& output_path,
+                      size_t thread_count) {
+  ScopedRemoveFile file_remover;
+  ScopedFileHandle write_handle(LoggingOpenFileForWrite(
+      output_path, FileWriteMode::kCreateOrFail, FilePermissions::kOwnerOnly));
+  if (!write_handle.is_valid())
+    return false;
+
+  // Remove the output file on failure.
+  file_remover.reset(output_path);
+
+  ParallelZlibOutputStream output(
+      thread_count,
+      std::make_unique<Base94OutputStream>(
+          Base94OutputStream::Mode::kEncode,
+          std::make_unique<FileOutputStream>(write_handle.get())));
+
+  FileReader file_reader;
+  if (!file_reader.Open(input_path))
+    return false;
+
+  FileOperationResult read_result;
+  do {
+    uint8_t buffer[4096];
+    read_result = file_reader.Read(buffer, sizeof(buffer));
+    if (read_result < 0)
+      return false;
+
+    if (read_result > 0 && !output.Write(buffer, read_result))
+      return false;
+  } while (read_result > 0);
+
+  if (!output.Flush())
+    return false;
+
+  ignore_result(file_remover.release());
+  return true;
+}
+
 void Usage(const base::FilePath& me) {
   fprintf(stderr,
 "Usage: %" PRFilePath " [options] <input-file> <output-file>\n"
@@ -31,6 +83,8 @@ void Usage(const base::FilePath& me) {
 "  -e, --encode   compress and encode the input file to a base94 encoded"
                   " file\n"
 "  -d, --decode   decode and decompress a base94 encoded file\n"
+"  -j, --threads=N\n"
+"                 compress with N threads when encoding\n"
 "      --help     display this help and exit\n"
 "      --version  output version information and exit\n",
           me.value().c_str());
@@ -46,6 +100,7 @@ int Base94EncoderMain(int argc, char* argv[]) {
     // “Short” (single-character) options.
     kOptionEncode = 'e',
     kOptionDecode = 'd',
+    kOptionThreads = 'j',
 
     // Standard options.
     kOptionHelp = -2,
@@ -54,6 +109,7 @@ int Base94EncoderMain(int argc, char* argv[]) {
 
   struct Options {
     bool encoding;
+    unsigned int threads;
     base::FilePath input_file;
     base::FilePath output_file;
   } options = {};
@@ -61,6 +117,7 @@ int Base94EncoderMain(int argc, char* argv[]) {
   static constexpr option long_options[] = {
       {"encode", no_argument, nullptr, kOptionEncode},
       {"decode", no_argument, nullptr, kOptionDecode},
+      {"threads", required_argument, nullptr, kOptionThreads},
       {"help", no_argument, nullptr, kOptionHelp},
       {"version", no_argument, nullptr, kOptionVersion},
       {nullptr, 0, nullptr, 0},
@@ -68,7 +125,7 @@ int Base94EncoderMain(int argc, char* argv[]) {
 
   bool encoding_valid = false;
   int opt;
-  while ((opt = getopt_long(argc, argv, "de", long_options, nullptr)) != -1) {
+  while ((opt = getopt_long(argc, argv, "dej:", long_options, nullptr)) != -1) {
     switch (opt) {
       case kOptionEncode:
         options.encoding = true;
@@ -78,6 +135,12 @@ int Base94EncoderMain(int argc, char* argv[]) {
         options.encoding = false;
         encoding_valid = true;
         break;
+      case kOptionThreads:
+        if (!StringToNumber(optarg, &options.threads) || options.threads < 1) {
+          ToolSupport::UsageHint(me, "failed to parse --threads");
+          return EXIT_FAILURE;
+        }
+        break;
       case kOptionHelp:
         Usage(me);
         return EXIT_SUCCESS;
@@ -107,6 +170,13 @@ int Base94EncoderMain(int argc, char* argv[]) {
   options.output_file = base::FilePath(
       ToolSupport::CommandLineArgumentToFilePathStringType(argv[1]));
 
+  if (options.encoding && options.threads > 0) {
+    return EncodeInParallel(
+               options.input_file, options.output_file, options.threads)
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+  }
+
   FileEncoder encoder(options.encoding ? crashpad::FileEncoder::Mode::kEncode
                                        : crashpad::FileEncoder::Mode::kDecode,
                       options.input_file,
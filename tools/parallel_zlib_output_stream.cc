@@ -0,0 +1,318 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/parallel_zlib_output_stream.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/numerics/safe_conversions.h"
+#include "third_party/zlib/zlib_crashpad.h"
+#include "util/misc/zlib.h"
+#include "util/thread/thread.h"
+
+namespace crashpad {
+
+namespace {
+
+// The size of the deflate window, and so of the dictionary that each block is
+// primed with.
+constexpr size_t kDictionarySize = 32 * 1024;
+
+// The default value for zlib’s internal DEF_MEM_LEVEL.
+constexpr int kZlibDefaultMemoryLevel = 8;
+
+}  // namespace
+
+class ParallelZlibOutputStream::CompressorThread final : public Thread {
+ public:
+  explicit CompressorThread(ParallelZlibOutputStream* stream)
+      : Thread(), stream_(stream) {}
+  ~CompressorThread() override {}
+
+ private:
+  // Thread:
+  void ThreadMain() override { stream_->CompressBlocks(); }
+
+  ParallelZlibOutputStream* stream_;  // weak
+
+  DISALLOW_COPY_AND_ASSIGN(CompressorThread);
+};
+
+ParallelZlibOutputStream::ParallelZlibOutputStream(
+    size_t thread_count,
+    std::unique_ptr<OutputStreamInterface> output_stream,
+    size_t block_size)
+    : output_stream_(std::move(output_stream)),
+      threads_(),
+      blocks_(),
+      queue_(),
+      lock_(),
+      queue_condition_(),
+      done_condition_(),
+      input_(),
+      dictionary_(),
+      thread_count_(thread_count),
+      block_size_(std::max(block_size, size_t{1})),
+      adler_(0),
+      header_written_(false),
+      stopping_(false),
+      flush_needed_(false),
+      failed_(false) {
+  input_.reserve(block_size_);
+}
+
+ParallelZlibOutputStream::~ParallelZlibOutputStream() {
+  DCHECK(!flush_needed_ || failed_);
+  StopThreads();
+}
+
+bool ParallelZlibOutputStream::Write(const uint8_t* data, size_t size) {
+  if (failed_) {
+    return false;
+  }
+
+  flush_needed_ = true;
+  while (size > 0) {
+    const size_t copy_size = std::min(size, block_size_ - input_.size());
+    input_.insert(input_.end(), data, data + copy_size);
+    data += copy_size;
+    size -= copy_size;
+    if (input_.size() == block_size_ && !SubmitBlock(false)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ParallelZlibOutputStream::Flush() {
+  if (failed_) {
+    return false;
+  }
+
+  if (flush_needed_) {
+    flush_needed_ = false;
+    if (!SubmitBlock(true)) {
+      return false;
+    }
+    while (!blocks_.empty()) {
+      if (!WriteOldestBlock()) {
+        return false;
+      }
+    }
+    StopThreads();
+  }
+  return output_stream_->Flush();
+}
+
+// static
+bool ParallelZlibOutputStream::CompressBlock(Block* block) {
+  block->adler = static_cast<uint32_t>(
+      adler32(adler32(0, Z_NULL, 0),
+              block->input.data(),
+              base::checked_cast<uInt>(block->input.size())));
+
+  z_stream zlib = {};
+  int zr = deflateInit2(&zlib,
+                        Z_BEST_COMPRESSION,
+                        Z_DEFLATED,
+                        -MAX_WBITS,
+                        kZlibDefaultMemoryLevel,
+                        Z_DEFAULT_STRATEGY);
+  if (zr != Z_OK) {
+    LOG(ERROR) << "deflateInit2: " << ZlibErrorString(zr);
+    return false;
+  }
+
+  bool succeeded = true;
+  if (!block->dictionary.empty()) {
+    zr = deflateSetDictionary(
+        &zlib,
+        block->dictionary.data(),
+        base::checked_cast<uInt>(block->dictionary.size()));
+    if (zr != Z_OK) {
+      LOG(ERROR) << "deflateSetDictionary: " << ZlibErrorString(zr);
+      succeeded = false;
+    }
+  }
+
+  // A sync flush into a nearly full buffer can repeat its empty stored block,
+  // so there is always room for more than one.
+  block->output.resize(
+      deflateBound(&zlib, base::checked_cast<uLong>(block->input.size())) + 64);
+  zlib.next_in = block->input.data();
+  zlib.avail_in = base::checked_cast<uInt>(block->input.size());
+  zlib.next_out = block->output.data();
+  zlib.avail_out = base::checked_cast<uInt>(block->output.size());
+  const int flush = block->last ? Z_FINISH : Z_SYNC_FLUSH;
+  while (succeeded) {
+    zr = deflate(&zlib, flush);
+    if (zr == Z_STREAM_END || (zr == Z_OK && zlib.avail_out != 0 &&
+                               zlib.avail_in == 0 && flush == Z_SYNC_FLUSH)) {
+      break;
+    }
+    if (zr != Z_OK && zr != Z_BUF_ERROR) {
+      LOG(ERROR) << "deflate: " << ZlibErrorString(zr);
+      succeeded = false;
+      break;
+    }
+
+    const size_t used = block->output.size() - zlib.avail_out;
+    block->output.resize(block->output.size() * 2);
+    zlib.next_out = block->output.data() + used;
+    zlib.avail_out = base::checked_cast<uInt>(block->output.size() - used);
+  }
+  block->output.resize(block->output.size() - zlib.avail_out);
+
+  // Without Z_FINISH, deflateEnd() reports Z_DATA_ERROR.
+  deflateEnd(&zlib);
+  return succeeded;
+}
+
+void ParallelZlibOutputStream::CompressBlocks() {
+  while (true) {
+    Block* block;
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      queue_condition_.wait(lock,
+                            [this]() { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      block = queue_.front();
+      queue_.pop_front();
+    }
+
+    const bool succeeded = CompressBlock(block);
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      block->succeeded = succeeded;
+      block->done = true;
+    }
+    done_condition_.notify_all();
+  }
+}
+
+bool ParallelZlibOutputStream::SubmitBlock(bool last) {
+  auto block = std::make_unique<Block>();
+  block->dictionary = dictionary_;
+  block->input.swap(input_);
+  block->adler = 0;
+  block->last = last;
+  block->done = false;
+  block->succeeded = false;
+  input_.reserve(block_size_);
+
+  if (!last) {
+    dictionary_.insert(
+        dictionary_.end(), block->input.begin(), block->input.end());
+    if (dictionary_.size() > kDictionarySize) {
+      dictionary_.erase(dictionary_.begin(),
+                        dictionary_.end() - kDictionarySize);
+    }
+  }
+
+  if (thread_count_ <= 1) {
+    block->succeeded = CompressBlock(block.get());
+    block->done = true;
+    blocks_.push_back(std::move(block));
+    return WriteOldestBlock();
+  }
+
+  if (threads_.empty()) {
+    for (size_t index = 0; index < thread_count_; ++index) {
+      threads_.push_back(std::make_unique<CompressorThread>(this));
+      threads_.back()->Start();
+    }
+  }
+
+  // Bound the amount of memory used by blocks that are compressed but not yet
+  // written. While waiting, the calling thread writes the oldest block.
+  while (blocks_.size() >= thread_count_ * 2) {
+    if (!WriteOldestBlock()) {
+      return false;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    queue_.push_back(block.get());
+  }
+  blocks_.push_back(std::move(block));
+  queue_condition_.notify_one();
+  return true;
+}
+
+bool ParallelZlibOutputStream::WriteOldestBlock() {
+  std::unique_ptr<Block> block = std::move(blocks_.front());
+  blocks_.pop_front();
+  {
+    std::unique_lock<std::mutex> lock(lock_);
+    done_condition_.wait(lock, [&block]() { return block->done; });
+  }
+
+  if (!block->succeeded) {
+    failed_ = true;
+    return false;
+  }
+
+  if (!header_written_) {
+    // A zlib header per RFC 1950 for a 32 kB window and maximum compression.
+    static constexpr uint8_t kZlibHeader[] = {0x78, 0xda};
+    if (!output_stream_->Write(kZlibHeader, sizeof(kZlibHeader))) {
+      failed_ = true;
+      return false;
+    }
+    adler_ = static_cast<uint32_t>(adler32(0, Z_NULL, 0));
+    header_written_ = true;
+  }
+
+  adler_ = static_cast<uint32_t>(adler32_combine(
+      adler_, block->adler, base::checked_cast<z_off_t>(block->input.size())));
+  if (!block->output.empty() &&
+      !output_stream_->Write(block->output.data(), block->output.size())) {
+    failed_ = true;
+    return false;
+  }
+
+  if (block->last) {
+    const uint8_t trailer[] = {static_cast<uint8_t>(adler_ >> 24),
+                               static_cast<uint8_t>(adler_ >> 16),
+                               static_cast<uint8_t>(adler_ >> 8),
+                               static_cast<uint8_t>(adler_)};
+    if (!output_stream_->Write(trailer, sizeof(trailer))) {
+      failed_ = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+void ParallelZlibOutputStream::StopThreads() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stopping_ = true;
+  }
+  queue_condition_.notify_all();
+  for (auto& thread : threads_) {
+    thread->Join();
+  }
+  threads_.clear();
+
+  std::lock_guard<std::mutex> lock(lock_);
+  stopping_ = false;
+}
+
+}  // namespace crashpad
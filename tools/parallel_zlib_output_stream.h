@@ -0,0 +1,137 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_TOOLS_PARALLEL_ZLIB_OUTPUT_STREAM_H_
+#define CRASHPAD_TOOLS_PARALLEL_ZLIB_OUTPUT_STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "base/macros.h"
+#include "util/stream/output_stream_interface.h"
+
+namespace crashpad {
+
+//! \brief Compresses data into a `zlib` stream using several threads.
+//!
+//! Input is divided into fixed-size blocks, which are compressed
+//! independently on worker threads, each primed with the 32 kB of input that
+//! precedes it so that compression is nearly as good as for a single stream.
+//! Every block but the last ends with a sync flush, so the compressed blocks
+//! can be joined into one `zlib` stream that ZlibOutputStream in
+//! ZlibOutputStream::Mode::kDecompress mode, or any other `zlib` decoder, can
+//! decompress. The output is the same for any number of threads, but differs
+//! from the output of ZlibOutputStream for the same input, and is usually
+//! slightly larger.
+//!
+//! Compressed blocks are written to the next output stream in order on the
+//! thread that calls Write() and Flush(), while later blocks are still being
+//! compressed.
+class ParallelZlibOutputStream : public OutputStreamInterface {
+ public:
+  //! \brief The default size of the blocks that are compressed independently.
+  static constexpr size_t kDefaultBlockSize = 128 * 1024;
+
+  //! \param[in] thread_count The number of threads to compress with. If this
+  //!     is `0` or `1`, blocks are compressed on the thread that calls
+  //!     Write().
+  //! \param[in] output_stream The output_stream that this object writes to.
+  //! \param[in] block_size The size of the blocks that are compressed
+  //!     independently. Smaller blocks allow more parallelism for small
+  //!     inputs at some cost in compression.
+  ParallelZlibOutputStream(size_t thread_count,
+                           std::unique_ptr<OutputStreamInterface> output_stream,
+                           size_t block_size = kDefaultBlockSize);
+  ~ParallelZlibOutputStream() override;
+
+  // OutputStreamInterface:
+  bool Write(const uint8_t* data, size_t size) override;
+  bool Flush() override;
+
+ private:
+  class CompressorThread;
+
+  struct Block {
+    // The input that precedes this block, used as the deflate dictionary.
+    std::vector<uint8_t> dictionary;
+    std::vector<uint8_t> input;
+    std::vector<uint8_t> output;
+
+    // The Adler-32 checksum of input.
+    uint32_t adler;
+
+    // Whether this block ends the stream.
+    bool last;
+
+    // Set by the thread that compresses the block when it is done. Protected
+    // by lock_.
+    bool done;
+    bool succeeded;
+  };
+
+  // Compresses block->input into block->output.
+  static bool CompressBlock(Block* block);
+
+  // Takes and compresses blocks from queue_ until StopThreads() is called.
+  void CompressBlocks();
+
+  // Hands the input collected so far to be compressed as a block.
+  bool SubmitBlock(bool last);
+
+  // Waits for the oldest block to be compressed and writes it to
+  // output_stream_.
+  bool WriteOldestBlock();
+
+  void StopThreads();
+
+  std::unique_ptr<OutputStreamInterface> output_stream_;
+  std::vector<std::unique_ptr<CompressorThread>> threads_;
+
+  // Blocks that have been submitted but not yet written, in order. Only used
+  // by the thread that calls Write() and Flush().
+  std::deque<std::unique_ptr<Block>> blocks_;
+
+  // Blocks that are waiting for a thread to compress them. Protected by lock_.
+  std::deque<Block*> queue_;
+
+  std::mutex lock_;
+  std::condition_variable queue_condition_;
+  std::condition_variable done_condition_;
+
+  // The input for the next block.
+  std::vector<uint8_t> input_;
+
+  // The last 32 kB of input before input_.
+  std::vector<uint8_t> dictionary_;
+
+  size_t thread_count_;
+  size_t block_size_;
+  uint32_t adler_;
+  bool header_written_;
+  bool stopping_;  // Protected by lock_.
+  bool flush_needed_;
+  bool failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelZlibOutputStream);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_TOOLS_PARALLEL_ZLIB_OUTPUT_STREAM_H_
@@ -0,0 +1,194 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/parallel_zlib_output_stream.h"
+
+#include <string.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/strings/stringprintf.h"
+#include "gtest/gtest.h"
+#include "util/misc/clock.h"
+#include "util/stream/base94_output_stream.h"
+#include "util/stream/zlib_output_stream.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+// Collects everything written to it.
+class CollectingOutputStream : public OutputStreamInterface {
+ public:
+  CollectingOutputStream() : data_(), flush_count_(0) {}
+  ~CollectingOutputStream() override {}
+
+  // OutputStreamInterface:
+  bool Write(const uint8_t* data, size_t size) override {
+    data_.insert(data_.end(), data, data + size);
+    return true;
+  }
+  bool Flush() override {
+    ++flush_count_;
+    return true;
+  }
+
+  const std::vector<uint8_t>& data() const { return data_; }
+  size_t flush_count() const { return flush_count_; }
+
+ private:
+  std::vector<uint8_t> data_;
+  size_t flush_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(CollectingOutputStream);
+};
+
+// Builds input resembling a minidump: runs of zeroes, repeated structures, and
+// some incompressible data.
+std::vector<uint8_t> BuildInput(size_t size) {
+  std::vector<uint8_t> input(size);
+  std::mt19937 random;
+  size_t offset = 0;
+  while (offset < size) {
+    const size_t run = std::min(size - offset, size_t{random() % 8192 + 1});
+    switch (random() % 3) {
+      case 0:
+        break;
+      case 1:
+        for (size_t index = 0; index < run; ++index) {
+          input[offset + index] = static_cast<uint8_t>(index % 48);
+        }
+        break;
+      case 2:
+        for (size_t index = 0; index < run; ++index) {
+          input[offset + index] = static_cast<uint8_t>(random());
+        }
+        break;
+    }
+    offset += run;
+  }
+  return input;
+}
+
+std::vector<uint8_t> Compress(const std::vector<uint8_t>& input,
+                              size_t thread_count,
+                              size_t block_size,
+                              size_t write_size) {
+  auto output_stream = std::make_unique<CollectingOutputStream>();
+  CollectingOutputStream* output_stream_ptr = output_stream.get();
+  ParallelZlibOutputStream stream(
+      thread_count, std::move(output_stream), block_size);
+  for (size_t offset = 0; offset < input.size(); offset += write_size) {
+    EXPECT_TRUE(stream.Write(&input[offset],
+                             std::min(write_size, input.size() - offset)));
+  }
+  EXPECT_TRUE(stream.Flush());
+  return output_stream_ptr->data();
+}
+
+std::vector<uint8_t> Decompress(const std::vector<uint8_t>& compressed) {
+  auto output_stream = std::make_unique<CollectingOutputStream>();
+  CollectingOutputStream* output_stream_ptr = output_stream.get();
+  ZlibOutputStream stream(ZlibOutputStream::Mode::kDecompress,
+                          std::move(output_stream));
+  if (!compressed.empty()) {
+    EXPECT_TRUE(stream.Write(compressed.data(), compressed.size()));
+  }
+  EXPECT_TRUE(stream.Flush());
+  return output_stream_ptr->data();
+}
+
+TEST(ParallelZlibOutputStream, RoundTrip) {
+  for (size_t size : {size_t{1}, size_t{4095}, size_t{100000}}) {
+    const std::vector<uint8_t> input = BuildInput(size);
+    for (size_t thread_count : {0, 1, 4}) {
+      SCOPED_TRACE(base::StringPrintf(
+          "size %zu, thread_count %zu", size, thread_count));
+      EXPECT_EQ(Decompress(Compress(input, thread_count, 4096, 1000)), input);
+    }
+  }
+}
+
+TEST(ParallelZlibOutputStream, SameOutputForAnyThreadCount) {
+  const std::vector<uint8_t> input = BuildInput(1024 * 1024);
+  const std::vector<uint8_t> compressed = Compress(input, 1, 16384, 65536);
+  EXPECT_EQ(Compress(input, 3, 16384, 65536), compressed);
+  EXPECT_EQ(Compress(input, 8, 16384, 1000), compressed);
+  EXPECT_LT(compressed.size(), input.size() / 2);
+}
+
+TEST(ParallelZlibOutputStream, NoInput) {
+  auto output_stream = std::make_unique<CollectingOutputStream>();
+  CollectingOutputStream* output_stream_ptr = output_stream.get();
+  ParallelZlibOutputStream stream(4, std::move(output_stream));
+  EXPECT_TRUE(stream.Flush());
+  EXPECT_TRUE(output_stream_ptr->data().empty());
+  EXPECT_EQ(output_stream_ptr->flush_count(), 1u);
+}
+
+// Discards its input, so that only encoding is measured.
+class NullOutputStream : public OutputStreamInterface {
+ public:
+  NullOutputStream() {}
+  ~NullOutputStream() override {}
+
+  // OutputStreamInterface:
+  bool Write(const uint8_t* data, size_t size) override { return true; }
+  bool Flush() override { return true; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(NullOutputStream);
+};
+
+// Compares the throughput of the chain used for --write-minidump-to-log with
+// the single-threaded ZlibOutputStream and with ParallelZlibOutputStream.
+TEST(ParallelZlibOutputStream, DISABLED_Base94ChainBenchmark) {
+  const std::vector<uint8_t> input = BuildInput(64 * 1024 * 1024);
+  const double megabytes = input.size() / (1024.0 * 1024.0);
+
+  auto run = [&input](OutputStreamInterface* stream) {
+    const uint64_t start = ClockMonotonicNanoseconds();
+    for (size_t offset = 0; offset < input.size(); offset += 4096) {
+      EXPECT_TRUE(stream->Write(&input[offset], 4096));
+    }
+    EXPECT_TRUE(stream->Flush());
+    return (ClockMonotonicNanoseconds() - start) / 1E9;
+  };
+
+  ZlibOutputStream zlib_stream(
+      ZlibOutputStream::Mode::kCompress,
+      std::make_unique<Base94OutputStream>(
+          Base94OutputStream::Mode::kEncode,
+          std::make_unique<NullOutputStream>()));
+  LOG(INFO) << "ZlibOutputStream: " << megabytes / run(&zlib_stream)
+            << " MB/s";
+
+  for (size_t thread_count : {1, 2, 4, 8}) {
+    ParallelZlibOutputStream parallel_stream(
+        thread_count,
+        std::make_unique<Base94OutputStream>(
+            Base94OutputStream::Mode::kEncode,
+            std::make_unique<NullOutputStream>()));
+    LOG(INFO) << "ParallelZlibOutputStream, " << thread_count
+              << " threads: " << megabytes / run(&parallel_stream) << " MB/s";
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
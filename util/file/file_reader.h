@@ -118,6 +118,10 @@ class FileReader : public FileReaderInterface {
   //!     to this method.
   void Close();
 
+  //! \return The handle of the open file, which remains owned by this object,
+  //!     or kInvalidFileHandle if no file is open.
+  FileHandle file_handle() const { return file_.get(); }
+
   // FileReaderInterface:
 
   //! \copydoc FileReaderInterface::Read()
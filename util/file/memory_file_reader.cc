@@ -0,0 +1,98 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/file/memory_file_reader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "base/logging.h"
+#include "base/numerics/safe_math.h"
+#include "util/misc/implicit_cast.h"
+
+namespace crashpad {
+
+MemoryFileReader::MemoryFileReader(const void* data, size_t size)
+    : data_(static_cast<const uint8_t*>(data)), size_(size), offset_(0) {
+  CHECK_LE(size_,
+           implicit_cast<size_t>(std::numeric_limits<FileOffset>::max()));
+}
+
+MemoryFileReader::~MemoryFileReader() {}
+
+bool MemoryFileReader::ContainsRange(uint64_t offset, uint64_t size) const {
+  base::CheckedNumeric<uint64_t> end(offset);
+  end += size;
+  if (!end.IsValid() || end.ValueOrDie() > size_) {
+    LOG(ERROR) << "range " << offset << "+" << size << " outside of file size "
+               << size_;
+    return false;
+  }
+  return true;
+}
+
+FileOperationResult MemoryFileReader::Read(void* data, size_t size) {
+  if (offset_ >= size_) {
+    return 0;
+  }
+
+  const size_t nread =
+      std::min({size,
+                size_ - offset_,
+                implicit_cast<size_t>(
+                    std::numeric_limits<FileOperationResult>::max())});
+  memcpy(data, data_ + offset_, nread);
+  offset_ += nread;
+  return nread;
+}
+
+FileOffset MemoryFileReader::Seek(FileOffset offset, int whence) {
+  size_t base_offset;
+
+  switch (whence) {
+    case SEEK_SET:
+      base_offset = 0;
+      break;
+
+    case SEEK_CUR:
+      base_offset = offset_;
+      break;
+
+    case SEEK_END:
+      base_offset = size_;
+      break;
+
+    default:
+      LOG(ERROR) << "Seek(): invalid whence " << whence;
+      return -1;
+  }
+
+  // The constructor ensures that any offset up to size_ fits in a FileOffset.
+  base::CheckedNumeric<FileOffset> new_offset(
+      static_cast<FileOffset>(base_offset));
+  new_offset += offset;
+  size_t new_offset_sizet;
+  if (!new_offset.AssignIfValid(&new_offset_sizet)) {
+    LOG(ERROR) << "Seek(): new_offset invalid";
+    return -1;
+  }
+
+  offset_ = new_offset_sizet;
+  return new_offset.ValueOrDie();
+}
+
+}  // namespace crashpad
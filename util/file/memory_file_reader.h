@@ -0,0 +1,73 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_UTIL_FILE_MEMORY_FILE_READER_H_
+#define CRASHPAD_UTIL_FILE_MEMORY_FILE_READER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "util/file/file_io.h"
+#include "util/file/file_reader.h"
+
+namespace crashpad {
+
+//! \brief A file reader that reads a file already present in memory, such as
+//!     a memory-mapped file.
+//!
+//! Unlike StringFile, this class does not hold a copy of the file’s contents.
+//! The caller retains ownership of the buffer, which must remain valid and
+//! unchanged for the lifetime of this object. Because the contents are directly
+//! addressable, users that would otherwise copy a region of the file out can
+//! instead refer to it in place with data().
+class MemoryFileReader : public FileReaderInterface {
+ public:
+  //! \param[in] data The contents of the virtual file. Weak.
+  //! \param[in] size The size of \a data, in bytes.
+  MemoryFileReader(const void* data, size_t size);
+  ~MemoryFileReader() override;
+
+  //! \brief Returns the virtual file’s contents.
+  const uint8_t* data() const { return data_; }
+
+  //! \brief Returns the size of the virtual file, in bytes.
+  size_t size() const { return size_; }
+
+  //! \brief Determines whether a region lies entirely within the virtual file.
+  //!
+  //! \param[in] offset The offset of the start of the region.
+  //! \param[in] size The size of the region.
+  //!
+  //! \return `true` if the region lies within the virtual file. `false`
+  //!     otherwise, with a message logged.
+  bool ContainsRange(uint64_t offset, uint64_t size) const;
+
+  // FileReaderInterface:
+  FileOperationResult Read(void* data, size_t size) override;
+
+  // FileSeekerInterface:
+  FileOffset Seek(FileOffset offset, int whence) override;
+
+ private:
+  const uint8_t* data_;  // weak
+  size_t size_;
+  size_t offset_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryFileReader);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_UTIL_FILE_MEMORY_FILE_READER_H_
@@ -0,0 +1,86 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/file/memory_file_reader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+TEST(MemoryFileReader, EmptyFile) {
+  MemoryFileReader reader(nullptr, 0);
+  EXPECT_EQ(reader.size(), 0u);
+  EXPECT_EQ(reader.Seek(0, SEEK_CUR), 0);
+
+  char c = '6';
+  EXPECT_EQ(reader.Read(&c, 1), 0);
+  EXPECT_EQ(c, '6');
+  EXPECT_EQ(reader.Seek(0, SEEK_END), 0);
+
+  EXPECT_TRUE(reader.ContainsRange(0, 0));
+  EXPECT_FALSE(reader.ContainsRange(0, 1));
+}
+
+TEST(MemoryFileReader, ReadAndSeek) {
+  static constexpr char kData[] = "abcdefgh";
+  MemoryFileReader reader(kData, strlen(kData));
+  EXPECT_EQ(reader.data(), reinterpret_cast<const uint8_t*>(kData));
+  EXPECT_EQ(reader.size(), 8u);
+
+  char buffer[8];
+  EXPECT_EQ(reader.Read(buffer, 3), 3);
+  EXPECT_EQ(memcmp(buffer, "abc", 3), 0);
+  EXPECT_EQ(reader.Seek(0, SEEK_CUR), 3);
+
+  EXPECT_EQ(reader.Seek(2, SEEK_CUR), 5);
+  EXPECT_EQ(reader.Read(buffer, sizeof(buffer)), 3);
+  EXPECT_EQ(memcmp(buffer, "fgh", 3), 0);
+  EXPECT_EQ(reader.Read(buffer, sizeof(buffer)), 0);
+
+  EXPECT_EQ(reader.Seek(-2, SEEK_END), 6);
+  EXPECT_TRUE(reader.ReadExactly(buffer, 2));
+  EXPECT_EQ(memcmp(buffer, "gh", 2), 0);
+
+  EXPECT_EQ(reader.Seek(1, SEEK_SET), 1);
+  EXPECT_TRUE(reader.ReadExactly(buffer, 7));
+  EXPECT_EQ(memcmp(buffer, "bcdefgh", 7), 0);
+
+  // Seeking beyond the end is permitted, but nothing can be read there.
+  EXPECT_EQ(reader.Seek(20, SEEK_SET), 20);
+  EXPECT_EQ(reader.Read(buffer, 1), 0);
+
+  EXPECT_LT(reader.Seek(-1, SEEK_SET), 0);
+  EXPECT_LT(reader.Seek(0, 3), 0);
+}
+
+TEST(MemoryFileReader, ContainsRange) {
+  static constexpr char kData[] = "abcdefgh";
+  MemoryFileReader reader(kData, strlen(kData));
+
+  EXPECT_TRUE(reader.ContainsRange(0, 8));
+  EXPECT_TRUE(reader.ContainsRange(4, 4));
+  EXPECT_TRUE(reader.ContainsRange(8, 0));
+  EXPECT_FALSE(reader.ContainsRange(4, 5));
+  EXPECT_FALSE(reader.ContainsRange(9, 0));
+  EXPECT_FALSE(reader.ContainsRange(1, 0xffffffffffffffff));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
@@ -26,14 +26,16 @@ DirectPtraceConnection::DirectPtraceConnection()
       attachments_(),
       memory_(),
       pid_(-1),
+      seize_(false),
       ptracer_(/* can_log= */ true),
       initialized_() {}
 
 DirectPtraceConnection::~DirectPtraceConnection() {}
 
-bool DirectPtraceConnection::Initialize(pid_t pid) {
+bool DirectPtraceConnection::Initialize(pid_t pid, bool seize) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
 
+  seize_ = seize;
   if (!Attach(pid) || !ptracer_.Initialize(pid)) {
     return false;
   }
@@ -54,7 +56,7 @@ pid_t DirectPtraceConnection::GetProcessID() {
 
 bool DirectPtraceConnection::Attach(pid_t tid) {
   std::unique_ptr<ScopedPtraceAttach> attach(new ScopedPtraceAttach);
-  if (!attach->ResetAttach(tid)) {
+  if (!attach->ResetAttach(tid, seize_)) {
     return false;
   }
   attachments_.push_back(std::move(attach));
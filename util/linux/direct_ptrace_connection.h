@@ -44,8 +44,10 @@ class DirectPtraceConnection : public PtraceConnection {
   //! The main thread of the process is automatically attached by this call.
   //!
   //! \param[in] pid The process ID of the process to connect to.
+  //! \param[in] seize Whether threads are attached with `PTRACE_SEIZE`. See
+  //!     ScopedPtraceAttach::ResetAttach().
   //! \return `true` on success. `false` on failure with a message logged.
-  bool Initialize(pid_t pid);
+  bool Initialize(pid_t pid, bool seize = false);
 
   // PtraceConnection:
 
@@ -62,6 +64,7 @@ class DirectPtraceConnection : public PtraceConnection {
   std::vector<std::unique_ptr<ScopedPtraceAttach>> attachments_;
   ProcessMemoryLinux memory_;
   pid_t pid_;
+  bool seize_;
   Ptracer ptracer_;
   InitializationStateDcheck initialized_;
 
@@ -18,22 +18,107 @@
 #include <string.h>
 #include <sys/sysmacros.h>
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
 #include "base/bit_cast.h"
 #include "base/files/file_path.h"
 #include "base/logging.h"
 #include "build/build_config.h"
-#include "util/file/delimited_file_reader.h"
-#include "util/file/file_io.h"
-#include "util/file/string_file.h"
-#include "util/stdlib/string_number_conversion.h"
 
 namespace crashpad {
 
 namespace {
 
+// Returns the value of c as a digit in base, or base if it isn’t one.
+unsigned int DigitValue(char c, unsigned int base) {
+  unsigned int value;
+  if (c >= '0' && c <= '9') {
+    value = c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    value = c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    value = c - 'A' + 10;
+  } else {
+    return base;
+  }
+  return value < base ? value : base;
+}
+
+// Converts the digits in base at the start of [*input, end) to a number and
+// advances *input past them. Fails if there are fewer than min_digits digits
+// or if the number doesn’t fit in Type.
 template <typename Type>
-bool HexStringToNumber(const std::string& string, Type* number) {
-  return StringToNumber("0x" + string, number);
+bool AdvancePastDigits(const char** input,
+                       const char* end,
+                       unsigned int base,
+                       size_t min_digits,
+                       Type* number) {
+  using UnsignedType = typename std::make_unsigned<Type>::type;
+  constexpr UnsignedType kMax = std::numeric_limits<Type>::max();
+
+  UnsignedType value = 0;
+  const char* position = *input;
+  for (; position != end; ++position) {
+    const unsigned int digit = DigitValue(*position, base);
+    if (digit == base) {
+      break;
+    }
+    if (value > (kMax - digit) / base) {
+      return false;
+    }
+    value = value * base + digit;
+  }
+  if (static_cast<size_t>(position - *input) < min_digits) {
+    return false;
+  }
+  *number = static_cast<Type>(value);
+  *input = position;
+  return true;
+}
+
+// Advances *input past a hexadecimal number of at least min_digits digits
+// followed by delimiter, storing the number in number.
+template <typename Type>
+bool AdvancePastHexField(const char** input,
+                         const char* end,
+                         size_t min_digits,
+                         char delimiter,
+                         Type* number) {
+  if (!AdvancePastDigits(input, end, 16, min_digits, number) ||
+      *input == end || **input != delimiter) {
+    return false;
+  }
+  ++*input;
+  return true;
+}
+
+// Advances *input past an inode number followed by a space. The kernel writes
+// inode numbers in decimal, but like strtoul() with base 0, which the parser
+// used to rely on, an optional "+" and octal and hexadecimal numbers with a
+// leading "0" or "0x" are also accepted.
+bool AdvancePastInodeField(const char** input, const char* end, ino_t* inode) {
+  if (*input != end && **input == '+') {
+    ++*input;
+  }
+  bool success;
+  if (end - *input > 1 && (*input)[0] == '0' &&
+      ((*input)[1] == 'x' || (*input)[1] == 'X')) {
+    *input += 2;
+    success = AdvancePastDigits(input, end, 16, 1, inode);
+  } else if (*input != end && **input == '0') {
+    success = AdvancePastDigits(input, end, 8, 1, inode);
+  } else {
+    success = AdvancePastDigits(input, end, 10, 1, inode);
+  }
+  if (!success || *input == end || **input != ' ') {
+    return false;
+  }
+  ++*input;
+  return true;
 }
 
 // The result from parsing a line from the maps file.
@@ -52,32 +137,35 @@ enum class ParseResult {
   kError
 };
 
-// Reads a line from a maps file being read by maps_file_reader and extends
-// mappings with a new MemoryMap::Mapping describing the line.
-ParseResult ParseMapsLine(DelimitedFileReader* maps_file_reader,
+// Parses the line at *input in the maps file ending at end, extends mappings
+// with a new MemoryMap::Mapping describing the line, and advances *input to
+// the next line. The line is parsed in place, so that the only allocation is
+// for the mapping’s name.
+ParseResult ParseMapsLine(const char** input,
+                          const char* end,
                           std::vector<MemoryMap::Mapping>* mappings) {
-  std::string field;
+  if (*input == end) {
+    return ParseResult::kEndOfFile;
+  }
+
+  const char* position = *input;
+  const char* line_end =
+      static_cast<const char*>(memchr(position, '\n', end - position));
+  if (!line_end) {
+    line_end = end;
+  }
+
   LinuxVMAddress start_address;
-  switch (maps_file_reader->GetDelim('-', &field)) {
-    case DelimitedFileReader::Result::kError:
-      return ParseResult::kError;
-    case DelimitedFileReader::Result::kEndOfFile:
-      return ParseResult::kEndOfFile;
-    case DelimitedFileReader::Result::kSuccess:
-      field.pop_back();
-      if (!HexStringToNumber(field, &start_address)) {
-        LOG(ERROR) << "format error";
-        return ParseResult::kError;
-      }
-      if (!mappings->empty() && start_address < mappings->back().range.End()) {
-        return ParseResult::kRetry;
-      }
+  if (!AdvancePastHexField(&position, line_end, 1, '-', &start_address)) {
+    LOG(ERROR) << "format error";
+    return ParseResult::kError;
+  }
+  if (!mappings->empty() && start_address < mappings->back().range.End()) {
+    return ParseResult::kRetry;
   }
 
   LinuxVMAddress end_address;
-  if (maps_file_reader->GetDelim(' ', &field) !=
-          DelimitedFileReader::Result::kSuccess ||
-      (field.pop_back(), !HexStringToNumber(field, &end_address))) {
+  if (!AdvancePastHexField(&position, line_end, 1, ' ', &end_address)) {
     LOG(ERROR) << "format error";
     return ParseResult::kError;
   }
@@ -87,12 +175,11 @@ ParseResult ParseMapsLine(DelimitedFileReader* maps_file_reader,
   }
   // Skip zero-length mappings.
   if (end_address == start_address) {
-    std::string rest_of_line;
-    if (maps_file_reader->GetLine(&rest_of_line) !=
-        DelimitedFileReader::Result::kSuccess) {
+    if (position == end) {
       LOG(ERROR) << "format error";
       return ParseResult::kError;
     }
+    *input = line_end == end ? end : line_end + 1;
     return ParseResult::kSuccess;
   }
 
@@ -106,9 +193,7 @@ ParseResult ParseMapsLine(DelimitedFileReader* maps_file_reader,
   MemoryMap::Mapping mapping;
   mapping.range.SetRange(is_64_bit, start_address, end_address - start_address);
 
-  if (maps_file_reader->GetDelim(' ', &field) !=
-          DelimitedFileReader::Result::kSuccess ||
-      (field.pop_back(), field.size() != 4)) {
+  if (line_end - position < 5 || position[4] != ' ') {
     LOG(ERROR) << "format error";
     return ParseResult::kError;
   }
@@ -123,66 +208,57 @@ ParseResult ParseMapsLine(DelimitedFileReader* maps_file_reader,
       return ParseResult::kError;                            \
     }                                                        \
   } while (false)
-  SET_FIELD(field[0], &mapping.readable, "r", "-");
-  SET_FIELD(field[1], &mapping.writable, "w", "-");
-  SET_FIELD(field[2], &mapping.executable, "x", "-");
-  SET_FIELD(field[3], &mapping.shareable, "sS", "p");
+  SET_FIELD(position[0], &mapping.readable, "r", "-");
+  SET_FIELD(position[1], &mapping.writable, "w", "-");
+  SET_FIELD(position[2], &mapping.executable, "x", "-");
+  SET_FIELD(position[3], &mapping.shareable, "sS", "p");
 #undef SET_FIELD
-
-  if (maps_file_reader->GetDelim(' ', &field) !=
-          DelimitedFileReader::Result::kSuccess ||
-      (field.pop_back(), !HexStringToNumber(field, &mapping.offset))) {
-    LOG(ERROR) << "format error";
-    return ParseResult::kError;
-  }
+  position += 5;
 
   uint32_t major;
-  if (maps_file_reader->GetDelim(':', &field) !=
-          DelimitedFileReader::Result::kSuccess ||
-      (field.pop_back(), field.size()) < 2 ||
-      !HexStringToNumber(field, &major)) {
-    LOG(ERROR) << "format error";
-    return ParseResult::kError;
-  }
-
   uint32_t minor;
-  if (maps_file_reader->GetDelim(' ', &field) !=
-          DelimitedFileReader::Result::kSuccess ||
-      (field.pop_back(), field.size()) < 2 ||
-      !HexStringToNumber(field, &minor)) {
+  if (!AdvancePastHexField(&position, line_end, 1, ' ', &mapping.offset) ||
+      !AdvancePastHexField(&position, line_end, 2, ':', &major) ||
+      !AdvancePastHexField(&position, line_end, 2, ' ', &minor) ||
+      !AdvancePastInodeField(&position, line_end, &mapping.inode)) {
     LOG(ERROR) << "format error";
     return ParseResult::kError;
   }
-
   mapping.device = makedev(major, minor);
 
-  if (maps_file_reader->GetDelim(' ', &field) !=
-          DelimitedFileReader::Result::kSuccess ||
-      (field.pop_back(), !StringToNumber(field, &mapping.inode))) {
+  if (line_end == end) {
     LOG(ERROR) << "format error";
     return ParseResult::kError;
   }
 
-  if (maps_file_reader->GetDelim('\n', &field) !=
-      DelimitedFileReader::Result::kSuccess) {
-    LOG(ERROR) << "format error";
-    return ParseResult::kError;
-  }
-  if (field.back() != '\n') {
-    LOG(ERROR) << "format error";
-    return ParseResult::kError;
-  }
-  field.pop_back();
-
   mappings->push_back(mapping);
 
-  size_t path_start = field.find_first_not_of(' ');
-  if (path_start != std::string::npos) {
-    mappings->back().name = field.substr(path_start);
+  while (position != line_end && *position == ' ') {
+    ++position;
   }
+  mappings->back().name.assign(position, line_end);
+
+  *input = line_end + 1;
   return ParseResult::kSuccess;
 }
 
+bool StartsAfter(LinuxVMAddress address, const MemoryMap::Mapping& mapping) {
+  return address < mapping.range.Base();
+}
+
+// Returns the mapping containing address or nullptr. mappings_before_address
+// is the end of the mappings in mappings that start at or before address.
+const MemoryMap::Mapping* ContainingMapping(
+    const std::vector<MemoryMap::Mapping>& mappings,
+    std::vector<MemoryMap::Mapping>::const_iterator mappings_before_address,
+    LinuxVMAddress address) {
+  if (mappings_before_address == mappings.begin()) {
+    return nullptr;
+  }
+  const MemoryMap::Mapping& mapping = *std::prev(mappings_before_address);
+  return mapping.range.End() > address ? &mapping : nullptr;
+}
+
 class SparseReverseIterator : public MemoryMap::Iterator {
  public:
   SparseReverseIterator(const std::vector<const MemoryMap::Mapping*>& mappings)
@@ -259,11 +335,13 @@ bool MemoryMap::Initialize(PtraceConnection* connection) {
   // or missed entirely. The kernel reads entries from this file into a page
   // sized buffer, so maps files larger than a page require multiple reads.
   // Attempt to reduce the time between reads by reading the entire file into a
-  // StringFile before attempting to parse it. If ParseMapsLine detects
+  // string before attempting to parse it. If ParseMapsLine detects
   // duplicate, overlapping, or out-of-order entries, it will trigger restarting
   // the read up to |attempts| times.
   int attempts = 3;
   do {
+    mappings_.clear();
+
     std::string contents;
     char path[32];
     snprintf(path, sizeof(path), "/proc/%d/maps", connection->GetProcessID());
@@ -271,12 +349,13 @@ bool MemoryMap::Initialize(PtraceConnection* connection) {
       return false;
     }
 
-    StringFile maps_file;
-    maps_file.SetString(contents);
-    DelimitedFileReader maps_file_reader(&maps_file);
+    // Nearly every line describes a mapping.
+    mappings_.reserve(std::count(contents.begin(), contents.end(), '\n'));
 
+    const char* input = contents.data();
+    const char* const end = input + contents.size();
     ParseResult result;
-    while ((result = ParseMapsLine(&maps_file_reader, &mappings_)) ==
+    while ((result = ParseMapsLine(&input, end, &mappings_)) ==
            ParseResult::kSuccess) {
     }
     if (result == ParseResult::kEndOfFile) {
@@ -297,12 +376,36 @@ bool MemoryMap::Initialize(PtraceConnection* connection) {
 const MemoryMap::Mapping* MemoryMap::FindMapping(LinuxVMAddress address) const {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
 
-  for (const auto& mapping : mappings_) {
-    if (mapping.range.Base() <= address && mapping.range.End() > address) {
-      return &mapping;
-    }
+  // Mappings are sorted by address and don’t overlap, so the only one that
+  // could contain address is the last one that starts at or before it.
+  return ContainingMapping(
+      mappings_,
+      std::upper_bound(
+          mappings_.begin(), mappings_.end(), address, StartsAfter),
+      address);
+}
+
+void MemoryMap::FindMappings(const std::vector<LinuxVMAddress>& addresses,
+                             std::vector<const Mapping*>* mappings) const {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  // Looking the addresses up in increasing order lets each search start where
+  // the previous one ended.
+  std::vector<size_t> order(addresses.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&addresses](size_t lhs, size_t rhs) {
+    return addresses[lhs] < addresses[rhs];
+  });
+
+  mappings->assign(addresses.size(), nullptr);
+  auto mappings_before_address = mappings_.cbegin();
+  for (size_t index : order) {
+    const LinuxVMAddress address = addresses[index];
+    mappings_before_address = std::upper_bound(
+        mappings_before_address, mappings_.cend(), address, StartsAfter);
+    (*mappings)[index] =
+        ContainingMapping(mappings_, mappings_before_address, address);
   }
-  return nullptr;
 }
 
 const MemoryMap::Mapping* MemoryMap::FindMappingWithName(
@@ -390,10 +493,11 @@ std::unique_ptr<MemoryMap::Iterator> MemoryMap::FindFilePossibleMmapStarts(
 
 std::unique_ptr<MemoryMap::Iterator> MemoryMap::ReverseIteratorFrom(
     const Mapping& target) const {
-  for (auto riter = mappings_.crbegin(); riter != mappings_.rend(); ++riter) {
-    if (riter->Equals(target)) {
-      return std::make_unique<FullReverseIterator>(riter, mappings_.rend());
-    }
+  auto next = std::upper_bound(
+      mappings_.begin(), mappings_.end(), target.range.Base(), StartsAfter);
+  if (next != mappings_.begin() && std::prev(next)->Equals(target)) {
+    return std::make_unique<FullReverseIterator>(
+        std::make_reverse_iterator(next), mappings_.rend());
   }
   return std::make_unique<FullReverseIterator>(mappings_.rend(),
                                                mappings_.rend());
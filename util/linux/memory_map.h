@@ -71,6 +71,20 @@ class MemoryMap {
   //!     to the lifetime of the MemoryMap object that it was obtained from.
   const Mapping* FindMapping(LinuxVMAddress address) const;
 
+  //! \brief Finds the Mapping containing each of several addresses.
+  //!
+  //! This is faster than calling FindMapping() for each address when there
+  //! are many addresses.
+  //!
+  //! \param[in] addresses The addresses to find, in any order.
+  //! \param[out] mappings Set to a vector with an element for each element of
+  //!     \a addresses, which is the Mapping containing that address or
+  //!     `nullptr` if no match is found. The caller does not take ownership of
+  //!     these objects. They are scoped to the lifetime of the MemoryMap
+  //!     object that they were obtained from.
+  void FindMappings(const std::vector<LinuxVMAddress>& addresses,
+                    std::vector<const Mapping*>* mappings) const;
+
   //! \return The Mapping with the lowest base address whose name is \a name or
   //!     `nullptr` if no match is found. The caller does not take ownership of
   //!     this object. It is scoped to the lifetime of the MemoryMap object that
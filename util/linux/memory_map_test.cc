@@ -16,11 +16,21 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
 #include "base/files/file_path.h"
+#include "base/logging.h"
+#include "base/macros.h"
 #include "base/strings/stringprintf.h"
 #include "build/build_config.h"
 #include "gtest/gtest.h"
@@ -30,12 +40,15 @@
 #include "test/multiprocess.h"
 #include "test/scoped_temp_dir.h"
 #include "third_party/lss/lss.h"
+#include "util/file/delimited_file_reader.h"
 #include "util/file/file_io.h"
 #include "util/file/scoped_remove_file.h"
+#include "util/file/string_file.h"
 #include "util/linux/direct_ptrace_connection.h"
 #include "util/misc/clock.h"
 #include "util/misc/from_pointer_cast.h"
 #include "util/posix/scoped_mmap.h"
+#include "util/stdlib/string_number_conversion.h"
 
 namespace crashpad {
 namespace test {
@@ -661,6 +674,455 @@ TEST(MemoryMap, FindFilePossibleMmapStarts_MultipleStarts) {
 #endif
 }
 
+// Serves synthetic maps files instead of the process’ own. Each read returns
+// the next of the given files, and the last one is repeated.
+class SyntheticMapsConnection : public FakePtraceConnection {
+ public:
+  explicit SyntheticMapsConnection(const std::vector<std::string>& maps_files)
+      : FakePtraceConnection(), maps_files_(maps_files), reads_(0) {}
+
+  ~SyntheticMapsConnection() {}
+
+  size_t Reads() const { return reads_; }
+
+  // PtraceConnection:
+
+  bool ReadFileContents(const base::FilePath& path,
+                        std::string* contents) override {
+    if (path.BaseName().value() != "maps") {
+      return FakePtraceConnection::ReadFileContents(path, contents);
+    }
+    *contents = maps_files_[std::min(reads_++, maps_files_.size() - 1)];
+    return true;
+  }
+
+ private:
+  std::vector<std::string> maps_files_;
+  size_t reads_;
+
+  DISALLOW_COPY_AND_ASSIGN(SyntheticMapsConnection);
+};
+
+constexpr LinuxVMAddress kSyntheticBase = 0x10000000;
+constexpr LinuxVMSize kSyntheticStride = 0x10000;
+
+// The size of synthetic mapping index, which starts at kSyntheticBase + index *
+// kSyntheticStride. Every mapping is followed by a gap.
+LinuxVMSize SyntheticSize(size_t index) {
+  return 0x1000 * (1 + index % 4);
+}
+
+// Returns a maps file with count mappings, alternating between file and
+// anonymous mappings.
+std::string SyntheticMaps(size_t count) {
+  std::string maps;
+  for (size_t index = 0; index < count; ++index) {
+    const LinuxVMAddress start = kSyntheticBase + index * kSyntheticStride;
+    const LinuxVMAddress end = start + SyntheticSize(index);
+    if (index % 2 == 0) {
+      maps += base::StringPrintf("%" PRIx64 "-%" PRIx64
+                                 " r-xp 00000000 08:01 %zu"
+                                 "                 /lib/libsynthetic%zu.so\n",
+                                 start,
+                                 end,
+                                 index + 1,
+                                 index);
+    } else {
+      maps += base::StringPrintf(
+          "%" PRIx64 "-%" PRIx64 " rw-p 00000000 00:00 0 \n", start, end);
+    }
+  }
+  return maps;
+}
+
+TEST(MemoryMap, FindMappingSynthetic) {
+  constexpr size_t kNumMappings = 1000;
+  SyntheticMapsConnection connection({SyntheticMaps(kNumMappings)});
+  ASSERT_TRUE(connection.Initialize(getpid()));
+
+  MemoryMap map;
+  ASSERT_TRUE(map.Initialize(&connection));
+
+  std::vector<LinuxVMAddress> addresses;
+  std::vector<const MemoryMap::Mapping*> expected;
+  addresses.push_back(0);
+  expected.push_back(nullptr);
+  addresses.push_back(kSyntheticBase - 1);
+  expected.push_back(nullptr);
+  for (size_t index = 0; index < kNumMappings; ++index) {
+    const LinuxVMAddress start = kSyntheticBase + index * kSyntheticStride;
+    const LinuxVMAddress end = start + SyntheticSize(index);
+
+    const MemoryMap::Mapping* mapping = map.FindMapping(start);
+    ASSERT_TRUE(mapping);
+    EXPECT_EQ(mapping->range.Base(), start);
+    EXPECT_EQ(mapping->range.End(), end);
+    EXPECT_EQ(mapping->executable, index % 2 == 0);
+    EXPECT_EQ(map.FindMapping(end - 1), mapping);
+    EXPECT_FALSE(map.FindMapping(end));
+
+    auto iterator = map.ReverseIteratorFrom(*mapping);
+    EXPECT_EQ(iterator->Count(), index + 1);
+    EXPECT_EQ(iterator->Next(), mapping);
+
+    addresses.push_back(end);
+    expected.push_back(nullptr);
+    addresses.push_back(end - 1);
+    expected.push_back(mapping);
+    addresses.push_back(start);
+    expected.push_back(mapping);
+  }
+  addresses.push_back(std::numeric_limits<LinuxVMAddress>::max());
+  expected.push_back(nullptr);
+
+  // Addresses are found regardless of their order, including duplicates.
+  addresses.push_back(kSyntheticBase);
+  expected.push_back(expected[2 + 2]);
+  std::vector<const MemoryMap::Mapping*> mappings;
+  map.FindMappings(addresses, &mappings);
+  EXPECT_EQ(mappings, expected);
+
+  std::reverse(addresses.begin(), addresses.end());
+  std::reverse(expected.begin(), expected.end());
+  map.FindMappings(addresses, &mappings);
+  EXPECT_EQ(mappings, expected);
+
+  map.FindMappings(std::vector<LinuxVMAddress>(), &mappings);
+  EXPECT_TRUE(mappings.empty());
+}
+
+TEST(MemoryMap, RetryAfterOutOfOrderMaps) {
+  // A maps file read while the process is running may contain entries out of
+  // order. They’re discarded when the file is read again.
+  std::string out_of_order = SyntheticMaps(4);
+  out_of_order += SyntheticMaps(2);
+  SyntheticMapsConnection connection({out_of_order, SyntheticMaps(4)});
+  ASSERT_TRUE(connection.Initialize(getpid()));
+
+  MemoryMap map;
+  ASSERT_TRUE(map.Initialize(&connection));
+  EXPECT_EQ(connection.Reads(), 2u);
+
+  for (size_t index = 0; index < 4; ++index) {
+    const MemoryMap::Mapping* mapping =
+        map.FindMapping(kSyntheticBase + index * kSyntheticStride);
+    ASSERT_TRUE(mapping);
+    EXPECT_EQ(map.ReverseIteratorFrom(*mapping)->Count(), index + 1);
+  }
+}
+
+// The DelimitedFileReader-based parser that MemoryMap used to use, which the
+// current parser must agree with. Returns true on success.
+bool ReferenceParseMaps(const std::string& contents,
+                        std::vector<MemoryMap::Mapping>* mappings) {
+  StringFile maps_file;
+  maps_file.SetString(contents);
+  DelimitedFileReader maps_file_reader(&maps_file);
+
+  auto hex_string_to_number = [](const std::string& string, auto* number) {
+    return StringToNumber("0x" + string, number);
+  };
+
+  while (true) {
+    std::string field;
+    LinuxVMAddress start_address;
+    switch (maps_file_reader.GetDelim('-', &field)) {
+      case DelimitedFileReader::Result::kError:
+        return false;
+      case DelimitedFileReader::Result::kEndOfFile:
+        return true;
+      case DelimitedFileReader::Result::kSuccess:
+        field.pop_back();
+        if (!hex_string_to_number(field, &start_address)) {
+          return false;
+        }
+        if (!mappings->empty() &&
+            start_address < mappings->back().range.End()) {
+          return false;
+        }
+    }
+
+    LinuxVMAddress end_address;
+    if (maps_file_reader.GetDelim(' ', &field) !=
+            DelimitedFileReader::Result::kSuccess ||
+        (field.pop_back(), !hex_string_to_number(field, &end_address))) {
+      return false;
+    }
+    if (end_address < start_address) {
+      return false;
+    }
+    if (end_address == start_address) {
+      std::string rest_of_line;
+      if (maps_file_reader.GetLine(&rest_of_line) !=
+          DelimitedFileReader::Result::kSuccess) {
+        return false;
+      }
+      continue;
+    }
+
+    MemoryMap::Mapping mapping;
+    mapping.range.SetRange(sizeof(void*) == 8,
+                           start_address,
+                           end_address - start_address);
+
+    if (maps_file_reader.GetDelim(' ', &field) !=
+            DelimitedFileReader::Result::kSuccess ||
+        (field.pop_back(), field.size() != 4)) {
+      return false;
+    }
+    auto set_field = [](char actual_c,
+                        bool* outval,
+                        const char* true_chars,
+                        const char* false_chars) {
+      if (strchr(true_chars, actual_c)) {
+        *outval = true;
+      } else if (strchr(false_chars, actual_c)) {
+        *outval = false;
+      } else {
+        return false;
+      }
+      return true;
+    };
+    if (!set_field(field[0], &mapping.readable, "r", "-") ||
+        !set_field(field[1], &mapping.writable, "w", "-") ||
+        !set_field(field[2], &mapping.executable, "x", "-") ||
+        !set_field(field[3], &mapping.shareable, "sS", "p")) {
+      return false;
+    }
+
+    if (maps_file_reader.GetDelim(' ', &field) !=
+            DelimitedFileReader::Result::kSuccess ||
+        (field.pop_back(), !hex_string_to_number(field, &mapping.offset))) {
+      return false;
+    }
+
+    uint32_t major;
+    if (maps_file_reader.GetDelim(':', &field) !=
+            DelimitedFileReader::Result::kSuccess ||
+        (field.pop_back(), field.size()) < 2 ||
+        !hex_string_to_number(field, &major)) {
+      return false;
+    }
+
+    uint32_t minor;
+    if (maps_file_reader.GetDelim(' ', &field) !=
+            DelimitedFileReader::Result::kSuccess ||
+        (field.pop_back(), field.size()) < 2 ||
+        !hex_string_to_number(field, &minor)) {
+      return false;
+    }
+
+    mapping.device = makedev(major, minor);
+
+    if (maps_file_reader.GetDelim(' ', &field) !=
+            DelimitedFileReader::Result::kSuccess ||
+        (field.pop_back(), !StringToNumber(field, &mapping.inode))) {
+      return false;
+    }
+
+    if (maps_file_reader.GetDelim('\n', &field) !=
+        DelimitedFileReader::Result::kSuccess) {
+      return false;
+    }
+    if (field.back() != '\n') {
+      return false;
+    }
+    field.pop_back();
+
+    mappings->push_back(mapping);
+
+    size_t path_start = field.find_first_not_of(' ');
+    if (path_start != std::string::npos) {
+      mappings->back().name = field.substr(path_start);
+    }
+  }
+}
+
+void ExpectParserMatchesReference(const std::string& contents) {
+  SCOPED_TRACE(contents);
+
+  std::vector<MemoryMap::Mapping> expected;
+  const bool expected_success = ReferenceParseMaps(contents, &expected);
+
+  SyntheticMapsConnection connection({contents});
+  ASSERT_TRUE(connection.Initialize(getpid()));
+  MemoryMap map;
+  ASSERT_EQ(map.Initialize(&connection), expected_success);
+  if (!expected_success || expected.empty()) {
+    return;
+  }
+
+  const MemoryMap::Mapping* last =
+      map.FindMapping(expected.back().range.Base());
+  ASSERT_TRUE(last);
+  auto iterator = map.ReverseIteratorFrom(*last);
+  ASSERT_EQ(iterator->Count(), expected.size());
+  for (auto expected_mapping = expected.rbegin();
+       expected_mapping != expected.rend();
+       ++expected_mapping) {
+    EXPECT_TRUE(iterator->Next()->Equals(*expected_mapping));
+  }
+}
+
+constexpr char kValidMaps[] =
+    "00400000-0040b000 r-xp 00000000 08:01 1234       /bin/cat\n"
+    "0060a000-0060b000 rw-p 0000a000 fd:00 1234       /bin/cat\n"
+    "0060b000-0060b000 ---p 00000000 00:00 0 \n"
+    "7F0000000000-7f0000021000 rw-s 00001000 103:2a 99999 /dev/shm/a b \n"
+    "7f0000021000-7f0000022000 ---p 7FFFFFFFFFFFFFFF 00:00 0 \n"
+    "7ffc00000000-7ffc00021000 rw-p 00000000 00:00 0  [stack]\n"
+    "ffffffffff600000-ffffffffff601000 --xp 00000000 00:00 0 [vsyscall]\n";
+
+TEST(MemoryMap, ParserMatchesReference) {
+  std::string self_maps;
+  ASSERT_TRUE(LoggingReadEntireFile(base::FilePath("/proc/self/maps"),
+                                    &self_maps));
+
+  const std::string cases[] = {
+      "",
+      self_maps,
+      SyntheticMaps(1000),
+      kValidMaps,
+      std::string(kValidMaps) + kValidMaps,
+      "00400000-0040b000 r-xp 00000000 08:01 1234 /bin/cat",
+      "00400000-0040b000 r-xp 00000000 08:01 1234 /bin/cat\n\n",
+      "00400000-0040b000 r-xp 00000000 8:01 1234 /bin/cat\n",
+      "00400000-0040b000 r-xp 00000000 08:1 1234 /bin/cat\n",
+      "00400000-0040b000 r-xp 00000000 08:01 1234\n",
+      "00400000-0040b000 r-xp 00000000 08:01 0x4d2 /bin/cat\n",
+      "00400000-0040b000 r-xp 00000000 08:01 02322 /bin/cat\n",
+      "00400000-0040b000 r-xp 00000000 08:01 +1234 /bin/cat\n",
+      "00400000-0040b000 r-xp 00000000 08:01 -1234 /bin/cat\n",
+      "00400000-0040b000 r-xp 00000000 08:01 18446744073709551616 /bin/cat\n",
+      "00400000-0040b000 r-xp 8000000000000000 08:01 1234 /bin/cat\n",
+      "00400000-0040b000 r-xp 00000000 100000000:01 1234 /bin/cat\n",
+      "00400000-10000000000000000 r-xp 00000000 08:01 1234 /bin/cat\n",
+      "0040b000-00400000 r-xp 00000000 08:01 1234 /bin/cat\n",
+      "00400000-0040b000 rwxq 00000000 08:01 1234 /bin/cat\n",
+      "00400000-0040b000 r-x 00000000 08:01 1234 /bin/cat\n",
+      "00400000-0040b000  r-xp 00000000 08:01 1234 /bin/cat\n",
+      "0x400000-0040b000 r-xp 00000000 08:01 1234 /bin/cat\n",
+      "-0040b000 r-xp 00000000 08:01 1234 /bin/cat\n",
+      "00400000-0040b000 r-xp 00000000 08:01 1234 /bin/cat\n"
+      "00400000-0040b000 r-xp 00000000 08:01 1234 /bin/cat\n",
+      "00400000-00400000 \n",
+      "00400000-00400000 ",
+  };
+  for (const std::string& contents : cases) {
+    ExpectParserMatchesReference(contents);
+  }
+}
+
+TEST(MemoryMap, ParserMatchesReferenceMutated) {
+  // Replace a few characters of a valid maps file at a time with characters
+  // that are significant to the parsers.
+  static constexpr char kReplacements[] = "0189afAFxX+- :\nrwps";
+  std::mt19937 random;
+  const std::string valid(kValidMaps);
+  for (int iteration = 0; iteration < 2000; ++iteration) {
+    std::string contents = valid;
+    const int mutations = 1 + random() % 3;
+    for (int mutation = 0; mutation < mutations; ++mutation) {
+      contents[random() % contents.size()] =
+          kReplacements[random() % strlen(kReplacements)];
+    }
+    ASSERT_NO_FATAL_FAILURE(ExpectParserMatchesReference(contents));
+  }
+}
+
+// Finds the mapping containing address by examining each mapping in turn,
+// starting from last.
+const MemoryMap::Mapping* LinearFindMapping(const MemoryMap& map,
+                                            const MemoryMap::Mapping& last,
+                                            LinuxVMAddress address) {
+  auto iterator = map.ReverseIteratorFrom(last);
+  while (const MemoryMap::Mapping* mapping = iterator->Next()) {
+    if (mapping->range.ContainsValue(address)) {
+      return mapping;
+    }
+  }
+  return nullptr;
+}
+
+TEST(MemoryMap, DISABLED_FindMappingBenchmark) {
+  constexpr size_t kNumLookups = 10000;
+  constexpr size_t kNumLinearLookups = 1000;
+  for (size_t num_mappings : {1000, 10000, 100000}) {
+    SyntheticMapsConnection connection({SyntheticMaps(num_mappings)});
+    ASSERT_TRUE(connection.Initialize(getpid()));
+
+    MemoryMap map;
+    uint64_t start = ClockMonotonicNanoseconds();
+    ASSERT_TRUE(map.Initialize(&connection));
+    const uint64_t initialize_time = ClockMonotonicNanoseconds() - start;
+
+    std::mt19937_64 random;
+    std::vector<LinuxVMAddress> addresses(kNumLookups);
+    for (LinuxVMAddress& address : addresses) {
+      address = kSyntheticBase + random() % (num_mappings * kSyntheticStride);
+    }
+
+    const MemoryMap::Mapping* last = map.FindMapping(
+        kSyntheticBase + (num_mappings - 1) * kSyntheticStride);
+    ASSERT_TRUE(last);
+    start = ClockMonotonicNanoseconds();
+    for (size_t index = 0; index < kNumLinearLookups; ++index) {
+      EXPECT_EQ(LinearFindMapping(map, *last, addresses[index]),
+                map.FindMapping(addresses[index]));
+    }
+    const uint64_t linear_time =
+        (ClockMonotonicNanoseconds() - start) / kNumLinearLookups;
+
+    start = ClockMonotonicNanoseconds();
+    size_t found = 0;
+    for (LinuxVMAddress address : addresses) {
+      found += map.FindMapping(address) != nullptr;
+    }
+    const uint64_t find_time =
+        (ClockMonotonicNanoseconds() - start) / kNumLookups;
+
+    start = ClockMonotonicNanoseconds();
+    std::vector<const MemoryMap::Mapping*> mappings;
+    map.FindMappings(addresses, &mappings);
+    const uint64_t batch_time =
+        (ClockMonotonicNanoseconds() - start) / kNumLookups;
+    EXPECT_EQ(static_cast<size_t>(
+                  std::count_if(mappings.begin(),
+                                mappings.end(),
+                                [](const MemoryMap::Mapping* mapping) {
+                                  return mapping != nullptr;
+                                })),
+              found);
+
+    LOG(INFO) << num_mappings << " mappings: Initialize " << initialize_time
+              << " ns, per address: linear search " << linear_time
+              << " ns, FindMapping " << find_time << " ns, FindMappings "
+              << batch_time << " ns";
+  }
+}
+
+TEST(MemoryMap, DISABLED_ParseBenchmark) {
+  for (size_t num_mappings : {1000, 10000, 100000}) {
+    const std::string contents = SyntheticMaps(num_mappings);
+
+    uint64_t start = ClockMonotonicNanoseconds();
+    std::vector<MemoryMap::Mapping> mappings;
+    ASSERT_TRUE(ReferenceParseMaps(contents, &mappings));
+    const uint64_t reference_time = ClockMonotonicNanoseconds() - start;
+
+    SyntheticMapsConnection connection({contents});
+    ASSERT_TRUE(connection.Initialize(getpid()));
+    MemoryMap map;
+    start = ClockMonotonicNanoseconds();
+    ASSERT_TRUE(map.Initialize(&connection));
+    const uint64_t time = ClockMonotonicNanoseconds() - start;
+
+    LOG(INFO) << num_mappings << " mappings, " << contents.size()
+              << " bytes: DelimitedFileReader " << reference_time
+              << " ns, Initialize " << time << " ns";
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace crashpad
@@ -17,6 +17,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <syscall.h>
 #include <unistd.h>
 
@@ -24,6 +25,7 @@
 
 #include "base/logging.h"
 #include "base/posix/eintr_wrapper.h"
+#include "util/linux/socket.h"
 #include "util/misc/memory_sanitizer.h"
 
 namespace crashpad {
@@ -52,6 +54,8 @@ size_t FormatPID(char* buffer, pid_t pid) {
 
 }  // namespace
 
+constexpr char PtraceBroker::kVersionQueryPath[];
+
 PtraceBroker::PtraceBroker(int sock, pid_t pid, bool is_64_bit)
     : ptracer_(is_64_bit, /* can_log= */ false),
       file_root_(file_root_buffer_),
@@ -59,6 +63,8 @@ PtraceBroker::PtraceBroker(int sock, pid_t pid, bool is_64_bit)
       attach_count_(0),
       attach_capacity_(0),
       memory_file_(),
+      shared_memory_(nullptr),
+      shared_memory_size_(0),
       sock_(sock),
       memory_pid_(pid),
       tried_opening_mem_file_(false) {
@@ -90,6 +96,7 @@ void PtraceBroker::SetFileRoot(const char* new_root) {
 int PtraceBroker::Run() {
   int result = RunImpl();
   ReleaseAttachments();
+  ReleaseSharedMemory();
   return result;
 }
 
@@ -123,7 +130,8 @@ int PtraceBroker::RunImpl() {
       return errno;
     }
 
-    if (request.version != Request::kVersion) {
+    if (request.version < Request::kMinimumVersion ||
+        request.version > Request::kVersion) {
       return EINVAL;
     }
 
@@ -224,6 +232,63 @@ int PtraceBroker::RunImpl() {
         continue;
       }
 
+      case Request::kTypeReadMemoryMultiple: {
+        if (request.version < Request::kVersionReadMemoryMultiple ||
+            request.ranges.count > kMaxMemoryRanges) {
+          return EINVAL;
+        }
+
+        MemoryRange ranges[kMaxMemoryRanges];
+        const size_t count = static_cast<size_t>(request.ranges.count);
+        if (!ReadFileExactly(sock_, ranges, count * sizeof(ranges[0]))) {
+          return errno;
+        }
+
+        for (size_t index = 0; index < count; ++index) {
+          int result =
+              SendMemory(request.tid, ranges[index].base, ranges[index].size);
+          if (result != 0) {
+            return result;
+          }
+        }
+        continue;
+      }
+
+      case Request::kTypeShareMemory: {
+        if (request.version < Request::kVersionSharedMemory) {
+          return EINVAL;
+        }
+
+        int result = ShareMemory();
+        if (result != 0) {
+          return result;
+        }
+        continue;
+      }
+
+      case Request::kTypeReadMemoryShared: {
+        if (request.version < Request::kVersionSharedMemory ||
+            request.shared_ranges.count > kMaxMemoryRanges) {
+          return EINVAL;
+        }
+
+        MemoryRange ranges[kMaxMemoryRanges];
+        const size_t count = static_cast<size_t>(request.shared_ranges.count);
+        if (!ReadFileExactly(sock_, ranges, count * sizeof(ranges[0]))) {
+          return errno;
+        }
+
+        int result = ReadMemoryShared(request.tid,
+                                      ranges,
+                                      count,
+                                      request.shared_ranges.buffer_offset,
+                                      request.shared_ranges.buffer_size);
+        if (result != 0) {
+          return result;
+        }
+        continue;
+      }
+
       case Request::kTypeListDirectory: {
         ScopedFileHandle handle;
         int result = ReceiveAndOpenFilePath(request.path.path_length,
@@ -293,6 +358,22 @@ int PtraceBroker::SendFileContents(FileHandle handle) {
   return 0;
 }
 
+int PtraceBroker::SendVersion() {
+  int result = SendOpenResult(kOpenResultSuccess);
+  if (result != 0) {
+    return result;
+  }
+
+  const uint16_t version = Request::kVersion;
+  int32_t rv = sizeof(version);
+  int32_t end_of_file = 0;
+  return WriteFile(sock_, &rv, sizeof(rv)) &&
+                 WriteFile(sock_, &version, sizeof(version)) &&
+                 WriteFile(sock_, &end_of_file, sizeof(end_of_file))
+             ? 0
+             : errno;
+}
+
 void PtraceBroker::TryOpeningMemFile() {
   if (tried_opening_mem_file_) {
     return;
@@ -321,39 +402,177 @@ int PtraceBroker::SendMemory(pid_t pid, VMAddress address, VMSize size) {
   }
 
   TryOpeningMemFile();
-  auto read_memory = [this, pid](VMAddress address, size_t size, char* buffer) {
-    return this->memory_file_.is_valid()
-               ? HANDLE_EINTR(
-                     pread64(this->memory_file_.get(), buffer, size, address))
-               : this->ptracer_.ReadUpTo(pid, address, size, buffer);
-  };
 
-  char buffer[4096];
+  // Each message is sent with a single write.
+  struct {
+    int32_t bytes_read;
+    char data[4096];
+  } message;
+  bool sent_data = false;
   while (size > 0) {
-    size_t to_read = std::min(size, VMSize{sizeof(buffer)});
+    size_t to_read = std::min(size, VMSize{sizeof(message.data)});
 
-    int32_t bytes_read = read_memory(address, to_read, buffer);
+    message.bytes_read = ReadMemoryUpTo(pid, address, to_read, message.data);
 
-    if (bytes_read < 0) {
-      return SendReadError(static_cast<ReadError>(errno));
+    if (message.bytes_read < 0) {
+      if (!sent_data) {
+        return SendReadError(static_cast<ReadError>(errno));
+      }
+
+      // The region was partially readable. Report the end of the readable
+      // data, as a short read, instead of an error.
+      message.bytes_read = 0;
     }
 
-    if (!WriteFile(sock_, &bytes_read, sizeof(bytes_read))) {
+    if (!WriteFile(sock_,
+                   &message,
+                   sizeof(message.bytes_read) + message.bytes_read)) {
       return errno;
     }
 
-    if (bytes_read == 0) {
+    if (message.bytes_read == 0) {
       return 0;
     }
+    sent_data = true;
+
+    size -= message.bytes_read;
+    address += message.bytes_read;
+  }
+  return 0;
+}
+
+ssize_t PtraceBroker::ReadMemoryUpTo(pid_t pid,
+                                     VMAddress address,
+                                     size_t size,
+                                     char* buffer) {
+  return memory_file_.is_valid()
+             ? HANDLE_EINTR(pread64(memory_file_.get(), buffer, size, address))
+             : ptracer_.ReadUpTo(pid, address, size, buffer);
+}
 
-    if (!WriteFile(sock_, buffer, bytes_read)) {
+int PtraceBroker::ShareMemory() {
+  ReleaseSharedMemory();
+
+  ShareMemoryResponse response = {};
+  response.success = ExceptionHandlerProtocol::kBoolFalse;
+
+  // The region is sealed so that its size can’t change while the client has
+  // it mapped.
+  ScopedFileHandle memfd(
+      memfd_create("crashpad_ptrace_broker", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+  if (memfd.is_valid() &&
+      HANDLE_EINTR(ftruncate(memfd.get(), kSharedMemorySize)) == 0 &&
+      fcntl(memfd.get(),
+            F_ADD_SEALS,
+            F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == 0) {
+    void* mapping = mmap(nullptr,
+                         kSharedMemorySize,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED,
+                         memfd.get(),
+                         0);
+    if (mapping != MAP_FAILED) {
+      shared_memory_ = static_cast<char*>(mapping);
+      shared_memory_size_ = kSharedMemorySize;
+      response.size = kSharedMemorySize;
+      response.success = ExceptionHandlerProtocol::kBoolTrue;
+    }
+  }
+
+  if (response.success == ExceptionHandlerProtocol::kBoolFalse) {
+    ExceptionHandlerProtocol::Errno error = errno;
+    if (!WriteFile(sock_, &response, sizeof(response))) {
       return errno;
     }
+    return SendError(error);
+  }
 
-    size -= bytes_read;
-    address += bytes_read;
+  int fd = memfd.get();
+  return UnixCredentialSocket::SendMsg(
+      sock_, &response, sizeof(response), &fd, 1);
+}
+
+void PtraceBroker::ReleaseSharedMemory() {
+  if (shared_memory_) {
+    munmap(shared_memory_, shared_memory_size_);
+    shared_memory_ = nullptr;
+    shared_memory_size_ = 0;
   }
-  return 0;
+}
+
+int PtraceBroker::ReadMemoryShared(pid_t pid,
+                                   const MemoryRange* ranges,
+                                   size_t count,
+                                   VMSize buffer_offset,
+                                   VMSize buffer_size) {
+  if (!shared_memory_ || buffer_offset > shared_memory_size_ ||
+      buffer_size > shared_memory_size_ - buffer_offset) {
+    return EINVAL;
+  }
+
+  VMSize total_size = 0;
+  for (size_t index = 0; index < count; ++index) {
+    if (ranges[index].size > buffer_size - total_size) {
+      return EINVAL;
+    }
+    total_size += ranges[index].size;
+  }
+
+  const bool access_denied = memory_pid_ >= 0 && pid != memory_pid_;
+  if (!access_denied) {
+    TryOpeningMemFile();
+  }
+
+  // The responses for all of the ranges are sent with a single write.
+  struct {
+    int32_t bytes_read;
+    ReadError error;
+  } responses[kMaxMemoryRanges];
+  size_t response_size = 0;
+
+  char* buffer = shared_memory_ + buffer_offset;
+  for (size_t index = 0; index < count; ++index) {
+    const MemoryRange& range = ranges[index];
+    size_t total_read = 0;
+    int32_t error = 0;
+    if (access_denied) {
+      error = kReadErrorAccessDenied;
+    } else {
+      while (total_read < range.size) {
+        ssize_t bytes_read = ReadMemoryUpTo(pid,
+                                            range.base + total_read,
+                                            range.size - total_read,
+                                            buffer + total_read);
+        if (bytes_read < 0) {
+          if (total_read == 0) {
+            error = errno;
+          }
+          break;
+        }
+        if (bytes_read == 0) {
+          break;
+        }
+        total_read += bytes_read;
+      }
+    }
+
+    char* response = reinterpret_cast<char*>(responses) + response_size;
+    if (error != 0) {
+      int32_t bytes_read = -1;
+      ReadError read_error = static_cast<ReadError>(error);
+      memcpy(response, &bytes_read, sizeof(bytes_read));
+      memcpy(response + sizeof(bytes_read), &read_error, sizeof(read_error));
+      response_size += sizeof(bytes_read) + sizeof(read_error);
+    } else {
+      int32_t bytes_read = static_cast<int32_t>(total_read);
+      memcpy(response, &bytes_read, sizeof(bytes_read));
+      response_size += sizeof(bytes_read);
+    }
+
+    buffer += range.size;
+  }
+
+  return WriteFile(sock_, responses, response_size) ? 0 : errno;
 }
 
 #if defined(MEMORY_SANITIZER)
@@ -398,6 +617,11 @@ int PtraceBroker::ReceiveAndOpenFilePath(VMSize path_length,
   }
   path[path_length] = '\0';
 
+  if (!is_directory && path_length == strlen(kVersionQueryPath) &&
+      memcmp(path, kVersionQueryPath, path_length) == 0) {
+    return SendVersion();
+  }
+
   if (strncmp(path, file_root_, strlen(file_root_)) != 0) {
     return SendOpenResult(kOpenResultAccessDenied);
   }
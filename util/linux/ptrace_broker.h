@@ -40,10 +40,24 @@ class PtraceBroker {
 #pragma pack(push, 1)
   //! \brief A request sent to a PtraceBroker from a PtraceClient.
   struct Request {
-    static constexpr uint16_t kVersion = 1;
+    //! \brief The newest version of Request that a PtraceBroker will serve.
+    static constexpr uint16_t kVersion = 3;
+
+    //! \brief The oldest version of Request that a PtraceBroker will serve.
+    static constexpr uint16_t kMinimumVersion = 1;
+
+    //! \brief The version that introduced kTypeReadMemoryMultiple.
+    static constexpr uint16_t kVersionReadMemoryMultiple = 2;
+
+    //! \brief The version that introduced kTypeShareMemory and
+    //!     kTypeReadMemoryShared.
+    static constexpr uint16_t kVersionSharedMemory = 3;
 
     //! \brief The version number for this Request.
-    uint16_t version = kVersion;
+    //!
+    //! Each request is sent with the version that introduced its type, so
+    //! that a broker predating a newer type continues to serve the older ones.
+    uint16_t version = kMinimumVersion;
 
     //! \brief The type of request to serve.
     enum Type : uint16_t {
@@ -65,6 +79,8 @@ class PtraceBroker {
       //!     a series of messages. Each message begins with an int32_t
       //!     indicating the number of bytes read, 0 for end-of-file, or -1 for
       //!     errors, followed by a ReadError. On success the bytes read follow.
+      //!     An error encountered after some bytes have been returned is
+      //!     reported as end-of-file.
       kTypeReadMemory,
 
       //! \brief Read a file's contents. The data is returned in a series of
@@ -87,11 +103,37 @@ class PtraceBroker {
 
       //! \brief Causes the broker to return from Run(), detaching all attached
       //!     threads. Does not respond.
-      kTypeExit
+      kTypeExit,
+
+      //! \brief Reads several memory regions from the attached process. The
+      //!     request is followed by #ranges.count MemoryRange structures. The
+      //!     data for each region is returned in turn, in the same form as for
+      //!     kTypeReadMemory. Requires version kVersionReadMemoryMultiple.
+      kTypeReadMemoryMultiple,
+
+      //! \brief Creates a shared memory region for use with
+      //!     kTypeReadMemoryShared. Responds with a ShareMemoryResponse, sent
+      //!     with the region’s memfd attached via `SCM_RIGHTS` on success. If
+      //!     an error occurs, ShareMemoryResponse::success is set to kBoolFalse
+      //!     and is followed by an Errno. Requires version
+      //!     kVersionSharedMemory.
+      kTypeShareMemory,
+
+      //! \brief Reads several memory regions from the attached process into
+      //!     the shared memory region created by kTypeShareMemory. The request
+      //!     is followed by #shared_ranges.count MemoryRange structures. The
+      //!     data for the regions is placed consecutively in the shared memory
+      //!     region, starting at #shared_ranges.buffer_offset. For each region,
+      //!     the response is an int32_t indicating the number of bytes read,
+      //!     which is less than the region’s size if the end of the readable
+      //!     data was reached, or -1 for errors, followed by a ReadError.
+      //!     Requires version kVersionSharedMemory.
+      kTypeReadMemoryShared,
     } type;
 
     //! \brief The thread ID associated with this request. Valid for kTypeAttach,
-    //!     kTypeGetThreadInfo, and kTypeReadMemory.
+    //!     kTypeGetThreadInfo, kTypeReadMemory, kTypeReadMemoryMultiple, and
+    //!     kTypeReadMemoryShared.
     pid_t tid;
 
     union {
@@ -105,6 +147,31 @@ class PtraceBroker {
         VMSize size;
       } iov;
 
+      //! \brief Specifies the number of memory regions to read for a
+      //!     kTypeReadMemoryMultiple request.
+      struct {
+        //! \brief The number of MemoryRange structures that follow the
+        //!     request. This must not exceed kMaxMemoryRanges.
+        VMSize count;
+      } ranges;
+
+      //! \brief Specifies the memory regions to read and where to place their
+      //!     data for a kTypeReadMemoryShared request.
+      struct {
+        //! \brief The number of MemoryRange structures that follow the
+        //!     request. This must not exceed kMaxMemoryRanges.
+        VMSize count;
+
+        //! \brief The offset in the shared memory region at which to place the
+        //!     data.
+        VMSize buffer_offset;
+
+        //! \brief The size of the part of the shared memory region that may
+        //!     be used. The sizes of the regions to read must not sum to more
+        //!     than this.
+        VMSize buffer_size;
+      } shared_ranges;
+
       //! \brief Specifies the file path to read for a kTypeReadFile request.
       struct {
         //! \brief The number of bytes in #path. The path should not include a
@@ -117,6 +184,33 @@ class PtraceBroker {
     };
   };
 
+  //! \brief A memory region to read, sent following a Request with type
+  //!     kTypeReadMemoryMultiple.
+  struct MemoryRange {
+    //! \brief The base address of the memory region.
+    VMAddress base;
+
+    //! \brief The size of the memory region.
+    VMSize size;
+  };
+
+  //! \brief The maximum number of MemoryRange structures that may follow a
+  //!     Request with type kTypeReadMemoryMultiple.
+  static constexpr size_t kMaxMemoryRanges = 64;
+
+  //! \brief The size of the shared memory region created for a Request with
+  //!     type kTypeShareMemory.
+  static constexpr size_t kSharedMemorySize = 2 * 1024 * 1024;
+
+  //! \brief A path that a PtraceClient may send with a kTypeReadFile request
+  //!     to learn the newest version of Request that the broker serves.
+  //!
+  //! The path lies outside of every file root, so a broker that predates this
+  //! query responds with kOpenResultAccessDenied and continues to serve
+  //! requests. Other brokers respond with kOpenResultSuccess, followed by
+  //! file contents consisting of their Request::kVersion as a `uint16_t`.
+  static constexpr char kVersionQueryPath[] = "crashpad:version";
+
   //! \brief A result used in operations that accept paths.
   //!
   //! Positive values of this enum are reserved for sending errno values.
@@ -148,6 +242,16 @@ class PtraceBroker {
     //! \brief Specifies the success or failure of this call.
     ExceptionHandlerProtocol::Bool success;
   };
+
+  //! \brief The response sent for a Request with type kTypeShareMemory.
+  struct ShareMemoryResponse {
+    //! \brief The size of the shared memory region. Only valid if #success is
+    //!     kBoolTrue.
+    VMSize size;
+
+    //! \brief Specifies the success or failure of this call.
+    ExceptionHandlerProtocol::Bool success;
+  };
 #pragma pack(pop)
 
   //! \brief Constructs this object.
@@ -201,8 +305,20 @@ class PtraceBroker {
   int SendOpenResult(OpenResult result);
   int SendFileContents(FileHandle handle);
   int SendDirectory(FileHandle handle);
+  int SendVersion();
   void TryOpeningMemFile();
   int SendMemory(pid_t pid, VMAddress address, VMSize size);
+  int ShareMemory();
+  void ReleaseSharedMemory();
+  int ReadMemoryShared(pid_t pid,
+                       const MemoryRange* ranges,
+                       size_t count,
+                       VMSize buffer_offset,
+                       VMSize buffer_size);
+  ssize_t ReadMemoryUpTo(pid_t pid,
+                         VMAddress address,
+                         size_t size,
+                         char* buffer);
   int ReceiveAndOpenFilePath(VMSize path_length,
                              bool is_directory,
                              ScopedFileHandle* handle);
@@ -214,6 +330,8 @@ class PtraceBroker {
   size_t attach_count_;
   size_t attach_capacity_;
   ScopedFileHandle memory_file_;
+  char* shared_memory_;
+  size_t shared_memory_size_;
   int sock_;
   pid_t memory_pid_;
   bool tried_opening_mem_file_;
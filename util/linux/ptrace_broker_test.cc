@@ -14,13 +14,20 @@
 
 #include "util/linux/ptrace_broker.h"
 
+#include <errno.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "base/logging.h"
+#include "base/stl_util.h"
 #include "build/build_config.h"
 #include "gtest/gtest.h"
 #include "test/filesystem.h"
@@ -29,7 +36,10 @@
 #include "test/scoped_temp_dir.h"
 #include "util/file/file_io.h"
 #include "util/linux/ptrace_client.h"
+#include "util/misc/clock.h"
+#include "util/misc/from_pointer_cast.h"
 #include "util/posix/scoped_mmap.h"
+#include "util/process/process_memory_linux.h"
 #include "util/synchronization/semaphore.h"
 #include "util/thread/thread.h"
 
@@ -102,9 +112,118 @@ class BlockOnReadThread : public ScopedTimeoutThread {
   DISALLOW_COPY_AND_ASSIGN(BlockOnReadThread);
 };
 
+// Serves requests as a broker that predates request versioning would: it
+// serves only version 1 requests of the original types, and stops serving on
+// anything else. Memory is read from this process, and memory at or beyond
+// readable_end is treated as unreadable.
+class OldBrokerThread : public ScopedTimeoutThread {
+ public:
+  OldBrokerThread(int sock, VMAddress readable_end)
+      : ScopedTimeoutThread(),
+        sock_(sock),
+        readable_end_(readable_end),
+        rejected_request_(false) {}
+
+  ~OldBrokerThread() {}
+
+  bool rejected_request() const { return rejected_request_; }
+
+ private:
+  void ThreadMain() override {
+    Serve();
+    ScopedTimeoutThread::ThreadMain();
+  }
+
+  void Serve() {
+    while (true) {
+      PtraceBroker::Request request = {};
+      if (!LoggingReadFileExactly(sock_, &request, sizeof(request))) {
+        return;
+      }
+
+      if (request.version != 1) {
+        rejected_request_ = true;
+        return;
+      }
+
+      switch (request.type) {
+        case PtraceBroker::Request::kTypeAttach: {
+          ExceptionHandlerProtocol::Bool success =
+              ExceptionHandlerProtocol::kBoolTrue;
+          ASSERT_TRUE(LoggingWriteFile(sock_, &success, sizeof(success)));
+          continue;
+        }
+
+        case PtraceBroker::Request::kTypeIs64Bit: {
+#if defined(ARCH_CPU_64_BITS)
+          ExceptionHandlerProtocol::Bool is_64_bit =
+              ExceptionHandlerProtocol::kBoolTrue;
+#else
+          ExceptionHandlerProtocol::Bool is_64_bit =
+              ExceptionHandlerProtocol::kBoolFalse;
+#endif
+          ASSERT_TRUE(LoggingWriteFile(sock_, &is_64_bit, sizeof(is_64_bit)));
+          continue;
+        }
+
+        case PtraceBroker::Request::kTypeReadFile: {
+          std::string path(request.path.path_length, '\0');
+          ASSERT_TRUE(LoggingReadFileExactly(sock_, &path[0], path.size()));
+          PtraceBroker::OpenResult result =
+              PtraceBroker::kOpenResultAccessDenied;
+          ASSERT_TRUE(LoggingWriteFile(sock_, &result, sizeof(result)));
+          continue;
+        }
+
+        case PtraceBroker::Request::kTypeReadMemory: {
+          // Like the original broker, data is sent in chunks until all of it
+          // has been sent, and an error is sent for any chunk that can’t be
+          // read, even after some data has been sent.
+          VMAddress address = request.iov.base;
+          VMSize size = request.iov.size;
+          while (size > 0) {
+            if (address >= readable_end_) {
+              int32_t error = -1;
+              PtraceBroker::ReadError read_error =
+                  static_cast<PtraceBroker::ReadError>(EIO);
+              ASSERT_TRUE(LoggingWriteFile(sock_, &error, sizeof(error)));
+              ASSERT_TRUE(
+                  LoggingWriteFile(sock_, &read_error, sizeof(read_error)));
+              break;
+            }
+
+            int32_t bytes_read = static_cast<int32_t>(
+                std::min({size, readable_end_ - address, VMSize{4096}}));
+            ASSERT_TRUE(
+                LoggingWriteFile(sock_, &bytes_read, sizeof(bytes_read)));
+            ASSERT_TRUE(LoggingWriteFile(
+                sock_, reinterpret_cast<const void*>(address), bytes_read));
+            address += bytes_read;
+            size -= bytes_read;
+          }
+          continue;
+        }
+
+        case PtraceBroker::Request::kTypeExit:
+          return;
+
+        default:
+          rejected_request_ = true;
+          return;
+      }
+    }
+  }
+
+  int sock_;
+  VMAddress readable_end_;
+  bool rejected_request_;
+
+  DISALLOW_COPY_AND_ASSIGN(OldBrokerThread);
+};
+
 class SameBitnessTest : public Multiprocess {
  public:
-  SameBitnessTest() : Multiprocess(), mapping_() {}
+  SameBitnessTest() : Multiprocess(), mapping_(), large_mapping_() {}
   ~SameBitnessTest() {}
 
  protected:
@@ -124,10 +243,25 @@ class SameBitnessTest : public Multiprocess {
     for (size_t index = 0; index < mapping_.len(); ++index) {
       buffer[index] = index % 256;
     }
+
+    // Larger than the shared memory region, so that reads through it must be
+    // split.
+    ASSERT_TRUE(large_mapping_.ResetMmap(nullptr,
+                                         PtraceBroker::kSharedMemorySize +
+                                             page_size * 5,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANON,
+                                         -1,
+                                         0));
+    auto large_buffer = large_mapping_.addr_as<char*>();
+    for (size_t index = 0; index < large_mapping_.len(); ++index) {
+      large_buffer[index] = index % 253;
+    }
   }
 
  private:
   void BrokerTests(bool set_broker_pid,
+                   bool try_shared_memory,
                    LinuxVMAddress child1_tls,
                    LinuxVMAddress child2_tls,
                    pid_t child2_tid,
@@ -151,8 +285,10 @@ class SameBitnessTest : public Multiprocess {
     broker_thread.Start();
 
     PtraceClient client;
-    ASSERT_TRUE(client.Initialize(
-        client_sock.get(), ChildPID(), /* try_direct_memory= */ false));
+    ASSERT_TRUE(client.Initialize(client_sock.get(),
+                                  ChildPID(),
+                                  /* try_direct_memory= */ false,
+                                  try_shared_memory));
 
     EXPECT_EQ(client.GetProcessID(), ChildPID());
 
@@ -204,6 +340,75 @@ class SameBitnessTest : public Multiprocess {
                               sizeof(unmapped),
                               &unmapped));
 
+    // Read more regions than fit in the messages that may be in flight at
+    // once, followed by a region that is partially readable and one that is
+    // unreadable.
+    constexpr size_t kRegionCount = PtraceBroker::kMaxMemoryRanges * 5 + 3;
+    std::vector<ProcessMemory::ReadRequest> requests(kRegionCount + 2);
+    std::vector<char> multiple_buffer(kRegionCount * 16 + 32);
+    for (size_t index = 0; index < kRegionCount; ++index) {
+      requests[index].address = mapping_.addr_as<VMAddress>() +
+                                (index * 97) % (mapping_.len() - 16);
+      requests[index].size = index % 17;
+      requests[index].buffer = &multiple_buffer[index * 16];
+    }
+    requests[kRegionCount].address =
+        mapping_.addr_as<VMAddress>() + mapping_.len() - 8;
+    requests[kRegionCount].size = 16;
+    requests[kRegionCount].buffer = &multiple_buffer[kRegionCount * 16];
+    requests[kRegionCount + 1].address =
+        mapping_.addr_as<VMAddress>() + mapping_.len();
+    requests[kRegionCount + 1].size = 16;
+    requests[kRegionCount + 1].buffer =
+        &multiple_buffer[kRegionCount * 16 + 16];
+
+    EXPECT_FALSE(memory->ReadMultiple(requests.data(), requests.size()));
+    for (size_t index = 0; index < kRegionCount; ++index) {
+      const ProcessMemory::ReadRequest& request = requests[index];
+      ASSERT_TRUE(request.succeeded) << index;
+      EXPECT_EQ(memcmp(request.buffer,
+                       expected_buffer +
+                           (request.address - mapping_.addr_as<VMAddress>()),
+                       request.size),
+                0);
+    }
+    EXPECT_FALSE(requests[kRegionCount].succeeded);
+    EXPECT_FALSE(requests[kRegionCount + 1].succeeded);
+
+    // The connection is still usable.
+    ASSERT_TRUE(memory->Read(mapping_.addr_as<VMAddress>() + mapping_.len() - 1,
+                             sizeof(last),
+                             &last));
+    EXPECT_EQ(last, expected_buffer[mapping_.len() - 1]);
+
+    // Regions larger than the shared memory region.
+    auto expected_large_buffer = large_mapping_.addr_as<char*>();
+    std::vector<char> large_buffer(large_mapping_.len());
+    ASSERT_TRUE(memory->Read(large_mapping_.addr_as<VMAddress>(),
+                             large_buffer.size(),
+                             large_buffer.data()));
+    EXPECT_EQ(
+        memcmp(large_buffer.data(), expected_large_buffer, large_buffer.size()),
+        0);
+
+    std::fill(large_buffer.begin(), large_buffer.end(), 0);
+    const size_t first_size = large_buffer.size() - 100;
+    ProcessMemory::ReadRequest large_requests[] = {
+        {large_mapping_.addr_as<VMAddress>(),
+         first_size,
+         large_buffer.data(),
+         false},
+        {large_mapping_.addr_as<VMAddress>() + first_size,
+         100,
+         &large_buffer[first_size],
+         false},
+    };
+    ASSERT_TRUE(
+        memory->ReadMultiple(large_requests, base::size(large_requests)));
+    EXPECT_EQ(
+        memcmp(large_buffer.data(), expected_large_buffer, large_buffer.size()),
+        0);
+
     std::string file_root = file_dir.value() + '/';
     broker.SetFileRoot(file_root.c_str());
 
@@ -247,20 +452,25 @@ class SameBitnessTest : public Multiprocess {
                                    expected_file_contents.size()));
     }
 
-    BrokerTests(true,
-                child1_tls,
-                child2_tls,
-                child2_tid,
-                temp_dir.path(),
-                file_path,
-                expected_file_contents);
-    BrokerTests(false,
-                child1_tls,
-                child2_tls,
-                child2_tid,
-                temp_dir.path(),
-                file_path,
-                expected_file_contents);
+    for (bool try_shared_memory : {false, true}) {
+      SCOPED_TRACE(try_shared_memory ? "shared memory" : "socket");
+      BrokerTests(true,
+                  try_shared_memory,
+                  child1_tls,
+                  child2_tls,
+                  child2_tid,
+                  temp_dir.path(),
+                  file_path,
+                  expected_file_contents);
+      BrokerTests(false,
+                  try_shared_memory,
+                  child1_tls,
+                  child2_tls,
+                  child2_tid,
+                  temp_dir.path(),
+                  file_path,
+                  expected_file_contents);
+    }
   }
 
   void MultiprocessChild() override {
@@ -274,6 +484,7 @@ class SameBitnessTest : public Multiprocess {
   }
 
   ScopedMmap mapping_;
+  ScopedMmap large_mapping_;
 
   DISALLOW_COPY_AND_ASSIGN(SameBitnessTest);
 };
@@ -285,6 +496,170 @@ TEST(PtraceBroker, SameBitness) {
 
 // TODO(jperaza): Test against a process with different bitness.
 
+// Reads through a broker that predates kVersionReadMemoryMultiple.
+TEST(PtraceBroker, OldBroker) {
+  int socks[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socks), 0);
+  ScopedFileHandle broker_sock(socks[0]);
+  ScopedFileHandle client_sock(socks[1]);
+
+  std::vector<char> data(3 * 4096);
+  for (size_t index = 0; index < data.size(); ++index) {
+    data[index] = static_cast<char>(index * 7);
+  }
+
+  OldBrokerThread broker_thread(
+      broker_sock.get(),
+      FromPointerCast<VMAddress>(data.data()) + data.size());
+  broker_thread.Start();
+
+  {
+    PtraceClient client;
+    ASSERT_TRUE(client.Initialize(client_sock.get(),
+                                  getpid(),
+                                  /* try_direct_memory= */ false));
+
+    static constexpr size_t kOffsets[] = {0, 100, 5000, 8000};
+    static constexpr size_t kSize = 64;
+    char buffers[base::size(kOffsets)][kSize];
+    ProcessMemory::ReadRequest requests[base::size(kOffsets)];
+    for (size_t index = 0; index < base::size(kOffsets); ++index) {
+      requests[index].address =
+          FromPointerCast<VMAddress>(&data[kOffsets[index]]);
+      requests[index].size = kSize;
+      requests[index].buffer = buffers[index];
+    }
+    ASSERT_TRUE(
+        client.Memory()->ReadMultiple(requests, base::size(requests)));
+    for (size_t index = 0; index < base::size(kOffsets); ++index) {
+      EXPECT_EQ(memcmp(buffers[index], &data[kOffsets[index]], kSize), 0)
+          << index;
+    }
+
+    // A small read near the end of readable memory must not be extended into
+    // the unreadable memory beyond it, which this broker would fail.
+    char end_buffer[8];
+    const size_t end_offset = data.size() - 2 * sizeof(end_buffer);
+    ASSERT_TRUE(client.Memory()->Read(
+        FromPointerCast<VMAddress>(&data[end_offset]),
+        sizeof(end_buffer),
+        end_buffer));
+    EXPECT_EQ(memcmp(end_buffer, &data[end_offset], sizeof(end_buffer)), 0);
+  }
+
+  EXPECT_FALSE(broker_thread.rejected_request());
+}
+
+// Compares the time taken to read many small, scattered memory regions through
+// a broker one at a time and in batches, over the socket and through shared
+// memory, and directly. Run with --gtest_also_run_disabled_tests.
+class ReadBenchmarkTest : public Multiprocess {
+ public:
+  ReadBenchmarkTest() : Multiprocess(), mapping_() {}
+  ~ReadBenchmarkTest() {}
+
+ protected:
+  void PreFork() override {
+    ASSERT_NO_FATAL_FAILURE(Multiprocess::PreFork());
+
+    ASSERT_TRUE(mapping_.ResetMmap(nullptr,
+                                   kRegionCount * kRegionStride,
+                                   PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANON,
+                                   -1,
+                                   0));
+    auto buffer = mapping_.addr_as<char*>();
+    for (size_t index = 0; index < mapping_.len(); ++index) {
+      buffer[index] = index % 251;
+    }
+  }
+
+ private:
+  static constexpr size_t kRegionCount = 2048;
+  static constexpr size_t kRegionSize = 256;
+  static constexpr size_t kRegionStride = 32768;
+  static constexpr int kIterations = 10;
+
+  static uint64_t TimeReads(const ProcessMemory* memory,
+                            bool batched,
+                            std::vector<ProcessMemory::ReadRequest>* requests) {
+    uint64_t start = ClockMonotonicNanoseconds();
+    for (int iteration = 0; iteration < kIterations; ++iteration) {
+      if (batched) {
+        EXPECT_TRUE(memory->ReadMultiple(requests->data(), requests->size()));
+      } else {
+        for (const ProcessMemory::ReadRequest& request : *requests) {
+          EXPECT_TRUE(
+              memory->Read(request.address, request.size, request.buffer));
+        }
+      }
+    }
+    return (ClockMonotonicNanoseconds() - start) / kIterations;
+  }
+
+  void TimeBrokeredReads(bool try_shared_memory,
+                         std::vector<ProcessMemory::ReadRequest>* requests) {
+    int socks[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socks), 0);
+    ScopedFileHandle broker_sock(socks[0]);
+    ScopedFileHandle client_sock(socks[1]);
+
+#if defined(ARCH_CPU_64_BITS)
+    constexpr bool am_64_bit = true;
+#else
+    constexpr bool am_64_bit = false;
+#endif  // ARCH_CPU_64_BITS
+
+    PtraceBroker broker(broker_sock.get(), ChildPID(), am_64_bit);
+    RunBrokerThread broker_thread(&broker);
+    broker_thread.Start();
+
+    PtraceClient client;
+    ASSERT_TRUE(client.Initialize(client_sock.get(),
+                                  ChildPID(),
+                                  /* try_direct_memory= */ false,
+                                  try_shared_memory));
+
+    const char* transport = try_shared_memory ? "shared memory" : "socket";
+    LOG(INFO) << "brokered, " << transport << ", one request per region: "
+              << TimeReads(client.Memory(), false, requests) << " ns";
+    LOG(INFO) << "brokered, " << transport << ", batched: "
+              << TimeReads(client.Memory(), true, requests) << " ns";
+  }
+
+  void MultiprocessParent() override {
+    std::vector<char> buffer(kRegionCount * kRegionSize);
+    std::vector<ProcessMemory::ReadRequest> requests(kRegionCount);
+    for (size_t index = 0; index < kRegionCount; ++index) {
+      requests[index].address =
+          mapping_.addr_as<VMAddress>() + index * kRegionStride;
+      requests[index].size = kRegionSize;
+      requests[index].buffer = &buffer[index * kRegionSize];
+    }
+
+    TimeBrokeredReads(false, &requests);
+    TimeBrokeredReads(true, &requests);
+
+    ProcessMemoryLinux direct_memory;
+    ASSERT_TRUE(direct_memory.Initialize(ChildPID()));
+    LOG(INFO) << "direct, one read per region: "
+              << TimeReads(&direct_memory, false, &requests) << " ns";
+    LOG(INFO) << "direct, batched: "
+              << TimeReads(&direct_memory, true, &requests) << " ns";
+  }
+
+  void MultiprocessChild() override { CheckedReadFileAtEOF(ReadPipeHandle()); }
+
+  ScopedMmap mapping_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadBenchmarkTest);
+};
+
+TEST(PtraceBroker, DISABLED_ReadBenchmark) {
+  ReadBenchmarkTest test;
+  test.Run();
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace crashpad
@@ -15,9 +15,13 @@
 #include "util/linux/ptrace_client.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+#include <algorithm>
 #include <string>
 
 #include "base/logging.h"
@@ -25,6 +29,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "util/file/file_io.h"
 #include "util/linux/ptrace_broker.h"
+#include "util/linux/socket.h"
 #include "util/process/process_memory_linux.h"
 
 namespace crashpad {
@@ -62,27 +67,6 @@ bool ReceiveAndLogReadError(int sock, const std::string& operation) {
   }
 }
 
-bool AttachImpl(int sock, pid_t tid) {
-  PtraceBroker::Request request = {};
-  request.type = PtraceBroker::Request::kTypeAttach;
-  request.tid = tid;
-  if (!LoggingWriteFile(sock, &request, sizeof(request))) {
-    return false;
-  }
-
-  ExceptionHandlerProtocol::Bool success;
-  if (!LoggingReadFileExactly(sock, &success, sizeof(success))) {
-    return false;
-  }
-
-  if (success != ExceptionHandlerProtocol::kBoolTrue) {
-    ReceiveAndLogError(sock, "PtraceBroker Attach");
-    return false;
-  }
-
-  return true;
-}
-
 struct Dirent64 {
   ino64_t d_ino;
   off64_t d_off;
@@ -130,25 +114,33 @@ void ReadDentsAsThreadIDs(char* buffer,
 PtraceClient::PtraceClient()
     : PtraceConnection(),
       memory_(),
+      shared_memory_(),
       sock_(kInvalidFileHandle),
       pid_(-1),
+      broker_version_(PtraceBroker::Request::kMinimumVersion),
       is_64_bit_(false),
+      broken_(false),
       initialized_() {}
 
 PtraceClient::~PtraceClient() {
-  if (sock_ != kInvalidFileHandle) {
+  // A broken connection may be part way through a message, which the broker
+  // would misinterpret. It exits once the socket is closed instead.
+  if (sock_ != kInvalidFileHandle && !broken_) {
     PtraceBroker::Request request = {};
     request.type = PtraceBroker::Request::kTypeExit;
     LoggingWriteFile(sock_, &request, sizeof(request));
   }
 }
 
-bool PtraceClient::Initialize(int sock, pid_t pid, bool try_direct_memory) {
+bool PtraceClient::Initialize(int sock,
+                              pid_t pid,
+                              bool try_direct_memory,
+                              bool try_shared_memory) {
   INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
   sock_ = sock;
   pid_ = pid;
 
-  if (!AttachImpl(sock_, pid_)) {
+  if (!AttachImpl(pid_)) {
     return false;
   }
 
@@ -156,7 +148,7 @@ bool PtraceClient::Initialize(int sock, pid_t pid, bool try_direct_memory) {
   request.type = PtraceBroker::Request::kTypeIs64Bit;
   request.tid = pid_;
 
-  if (!LoggingWriteFile(sock_, &request, sizeof(request))) {
+  if (!SendRequest(&request, sizeof(request))) {
     return false;
   }
 
@@ -173,13 +165,130 @@ bool PtraceClient::Initialize(int sock, pid_t pid, bool try_direct_memory) {
     }
   }
   if (!memory_) {
+    if (!QueryBrokerVersion()) {
+      return false;
+    }
+
     memory_ = std::make_unique<BrokeredMemory>(this);
+    if (try_shared_memory &&
+        broker_version_ >= PtraceBroker::Request::kVersionSharedMemory &&
+        !InitializeSharedMemory()) {
+      LOG(WARNING) << "PtraceBroker shared memory unavailable, using socket";
+    }
   }
 
   INITIALIZATION_STATE_SET_VALID(initialized_);
   return true;
 }
 
+bool PtraceClient::QueryBrokerVersion() {
+  PtraceBroker::Request request = {};
+  request.type = PtraceBroker::Request::kTypeReadFile;
+  request.path.path_length = strlen(PtraceBroker::kVersionQueryPath);
+  if (!SendRequest(&request, sizeof(request)) ||
+      !LoggingWriteFile(sock_,
+                        PtraceBroker::kVersionQueryPath,
+                        request.path.path_length)) {
+    return false;
+  }
+
+  PtraceBroker::OpenResult result;
+  if (!LoggingReadFileExactly(sock_, &result, sizeof(result))) {
+    return false;
+  }
+
+  // A broker that predates the query serves only the original request types.
+  if (result == PtraceBroker::kOpenResultAccessDenied) {
+    broker_version_ = PtraceBroker::Request::kMinimumVersion;
+    return true;
+  }
+
+  if (result != PtraceBroker::kOpenResultSuccess) {
+    LOG(ERROR) << "PtraceBroker version query: unexpected result " << result;
+    return false;
+  }
+
+  std::string contents;
+  if (!ReceiveFileContents(&contents)) {
+    return false;
+  }
+
+  uint16_t version;
+  if (contents.size() != sizeof(version)) {
+    LOG(ERROR) << "PtraceBroker version query: unexpected size "
+               << contents.size();
+    return false;
+  }
+  memcpy(&version, contents.data(), sizeof(version));
+
+  if (version < PtraceBroker::Request::kMinimumVersion) {
+    LOG(ERROR) << "PtraceBroker version query: invalid version " << version;
+    return false;
+  }
+  broker_version_ = version < PtraceBroker::Request::kVersion
+                        ? version
+                        : PtraceBroker::Request::kVersion;
+  return true;
+}
+
+bool PtraceClient::InitializeSharedMemory() {
+  PtraceBroker::Request request = {};
+  request.version = PtraceBroker::Request::kVersionSharedMemory;
+  request.type = PtraceBroker::Request::kTypeShareMemory;
+  if (!SendRequest(&request, sizeof(request))) {
+    return false;
+  }
+
+  PtraceBroker::ShareMemoryResponse response;
+  std::vector<ScopedFileHandle> fds;
+  if (!UnixCredentialSocket::RecvMsg(
+          sock_, &response, sizeof(response), nullptr, &fds)) {
+    return false;
+  }
+
+  if (response.success != ExceptionHandlerProtocol::kBoolTrue) {
+    ReceiveAndLogError(sock_, "PtraceBroker ShareMemory");
+    return false;
+  }
+
+  if (fds.size() != 1) {
+    LOG(ERROR) << "PtraceBroker ShareMemory: unexpected fd count "
+               << fds.size();
+    return false;
+  }
+
+  // The region must be sealed against shrinking so that the broker can’t cause
+  // a SIGBUS in this process by truncating it, and against growing so that its
+  // size remains consistent with the broker’s view of it.
+  const int seals = fcntl(fds[0].get(), F_GET_SEALS);
+  if (seals < 0) {
+    PLOG(ERROR) << "fcntl";
+    return false;
+  }
+  if ((seals & (F_SEAL_SHRINK | F_SEAL_GROW)) !=
+      (F_SEAL_SHRINK | F_SEAL_GROW)) {
+    LOG(ERROR) << "PtraceBroker ShareMemory: region not sealed";
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fds[0].get(), &st) != 0) {
+    PLOG(ERROR) << "fstat";
+    return false;
+  }
+  if (response.size < 2 || response.size > static_cast<VMSize>(st.st_size)) {
+    LOG(ERROR) << "PtraceBroker ShareMemory: invalid size " << response.size;
+    return false;
+  }
+
+  return shared_memory_.ResetMmap(nullptr,
+                                  static_cast<size_t>(response.size),
+                                  PROT_READ,
+                                  MAP_SHARED,
+                                  fds[0].get(),
+                                  0);
+}
+
 pid_t PtraceClient::GetProcessID() {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
   return pid_;
@@ -187,7 +296,7 @@ pid_t PtraceClient::GetProcessID() {
 
 bool PtraceClient::Attach(pid_t tid) {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
-  return AttachImpl(sock_, tid);
+  return AttachImpl(tid);
 }
 
 bool PtraceClient::Is64Bit() {
@@ -201,7 +310,7 @@ bool PtraceClient::GetThreadInfo(pid_t tid, ThreadInfo* info) {
   PtraceBroker::Request request = {};
   request.type = PtraceBroker::Request::kTypeGetThreadInfo;
   request.tid = tid;
-  if (!LoggingWriteFile(sock_, &request, sizeof(request))) {
+  if (!SendRequest(&request, sizeof(request))) {
     return false;
   }
 
@@ -227,35 +336,12 @@ bool PtraceClient::ReadFileContents(const base::FilePath& path,
   request.type = PtraceBroker::Request::kTypeReadFile;
   request.path.path_length = path.value().size();
 
-  if (!LoggingWriteFile(sock_, &request, sizeof(request)) ||
+  if (!SendRequest(&request, sizeof(request)) ||
       !SendFilePath(path.value().c_str(), request.path.path_length)) {
     return false;
   }
 
-  std::string local_contents;
-  int32_t read_result;
-  do {
-    if (!LoggingReadFileExactly(sock_, &read_result, sizeof(read_result))) {
-      return false;
-    }
-
-    if (read_result < 0) {
-      ReceiveAndLogReadError(sock_, "ReadFileContents");
-      return false;
-    }
-
-    if (read_result > 0) {
-      size_t old_length = local_contents.size();
-      local_contents.resize(old_length + read_result);
-      if (!LoggingReadFileExactly(
-              sock_, &local_contents[old_length], read_result)) {
-        return false;
-      }
-    }
-  } while (read_result > 0);
-
-  contents->swap(local_contents);
-  return true;
+  return ReceiveFileContents(contents);
 }
 
 ProcessMemory* PtraceClient::Memory() {
@@ -278,7 +364,7 @@ bool PtraceClient::Threads(std::vector<pid_t>* threads) {
   request.type = PtraceBroker::Request::kTypeListDirectory;
   request.path.path_length = strlen(path);
 
-  if (!LoggingWriteFile(sock_, &request, sizeof(request)) ||
+  if (!SendRequest(&request, sizeof(request)) ||
       !SendFilePath(path, request.path.path_length)) {
     return false;
   }
@@ -309,21 +395,66 @@ bool PtraceClient::Threads(std::vector<pid_t>* threads) {
 }
 
 PtraceClient::BrokeredMemory::BrokeredMemory(PtraceClient* client)
-    : ProcessMemory(), client_(client) {}
+    : ProcessMemory(),
+      client_(client),
+      read_ahead_(),
+      read_ahead_address_(0),
+      read_ahead_size_(0) {}
 
 PtraceClient::BrokeredMemory::~BrokeredMemory() = default;
 
 ssize_t PtraceClient::BrokeredMemory::ReadUpTo(VMAddress address,
                                                size_t size,
                                                void* buffer) const {
-  return client_->ReadUpTo(address, size, buffer);
+  if (size >= kReadAheadSize ||
+      client_->broker_version_ <
+          PtraceBroker::Request::kVersionReadMemoryMultiple) {
+    return client_->ReadUpTo(address, size, buffer);
+  }
+
+  if (address < read_ahead_address_ ||
+      address - read_ahead_address_ >= read_ahead_size_) {
+    if (!read_ahead_) {
+      read_ahead_.reset(new char[kReadAheadSize]);
+    }
+
+    // Since kVersionReadMemoryMultiple, the broker reports an error only if
+    // nothing at all could be read, so reading ahead can’t cause a read that
+    // would otherwise succeed to fail.
+    read_ahead_size_ = 0;
+    ssize_t bytes_read =
+        client_->ReadUpTo(address, kReadAheadSize, read_ahead_.get());
+    if (bytes_read <= 0) {
+      return bytes_read;
+    }
+    read_ahead_address_ = address;
+    read_ahead_size_ = bytes_read;
+  }
+
+  const size_t offset = static_cast<size_t>(address - read_ahead_address_);
+  const size_t copy_size = std::min(size, read_ahead_size_ - offset);
+  memcpy(buffer, &read_ahead_[offset], copy_size);
+  return copy_size;
+}
+
+void PtraceClient::BrokeredMemory::ReadMultipleImpl(ReadRequest* requests,
+                                                    size_t count) const {
+  if (client_->broker_version_ <
+      PtraceBroker::Request::kVersionReadMemoryMultiple) {
+    ProcessMemory::ReadMultipleImpl(requests, count);
+    return;
+  }
+  client_->ReadMemoryMultiple(requests, count);
 }
 
 ssize_t PtraceClient::ReadUpTo(VMAddress address,
                                size_t size,
                                void* buffer) const {
   INITIALIZATION_STATE_DCHECK_VALID(initialized_);
-  char* buffer_c = reinterpret_cast<char*>(buffer);
+
+  if (shared_memory_.is_valid()) {
+    return ReadUpToShared(address, size, static_cast<char*>(buffer));
+  }
 
   PtraceBroker::Request request = {};
   request.type = PtraceBroker::Request::kTypeReadMemory;
@@ -331,36 +462,384 @@ ssize_t PtraceClient::ReadUpTo(VMAddress address,
   request.iov.base = address;
   request.iov.size = size;
 
-  if (!LoggingWriteFile(sock_, &request, sizeof(request))) {
-    return false;
+  if (!SendRequest(&request, sizeof(request))) {
+    return -1;
   }
 
-  ssize_t total_read = 0;
-  while (size > 0) {
+  ssize_t total_read;
+  if (!ReceiveMemory(size, reinterpret_cast<char*>(buffer), &total_read)) {
+    return -1;
+  }
+  return total_read;
+}
+
+ssize_t PtraceClient::ReadUpToShared(VMAddress address,
+                                     size_t size,
+                                     char* buffer) const {
+  size_t total_read = 0;
+  while (total_read < size) {
+    const size_t piece_size = std::min(size - total_read, shared_memory_.len());
+
+    PtraceBroker::Request request = {};
+    request.version = PtraceBroker::Request::kVersionSharedMemory;
+    request.type = PtraceBroker::Request::kTypeReadMemoryShared;
+    request.tid = pid_;
+    request.shared_ranges.count = 1;
+    request.shared_ranges.buffer_offset = 0;
+    request.shared_ranges.buffer_size = shared_memory_.len();
+
+    PtraceBroker::MemoryRange range;
+    range.base = address + total_read;
+    range.size = piece_size;
+
+    char message[sizeof(request) + sizeof(range)];
+    memcpy(message, &request, sizeof(request));
+    memcpy(message + sizeof(request), &range, sizeof(range));
+    if (!SendRequest(message, sizeof(message))) {
+      return -1;
+    }
+
     int32_t bytes_read;
     if (!LoggingReadFileExactly(sock_, &bytes_read, sizeof(bytes_read))) {
+      broken_ = true;
       return -1;
     }
 
     if (bytes_read < 0) {
-      ReceiveAndLogReadError(sock_, "PtraceBroker ReadMemory");
+      if (!ReceiveAndLogReadError(sock_, "PtraceBroker ReadMemory")) {
+        broken_ = true;
+        return -1;
+      }
+      return total_read > 0 ? total_read : -1;
+    }
+
+    if (static_cast<size_t>(bytes_read) > piece_size) {
+      LOG(ERROR) << "PtraceBroker ReadMemory: too much data";
+      broken_ = true;
       return -1;
     }
 
+    memcpy(buffer + total_read, shared_memory_.addr(), bytes_read);
+    total_read += bytes_read;
+    if (static_cast<size_t>(bytes_read) < piece_size) {
+      break;
+    }
+  }
+  return total_read;
+}
+
+void PtraceClient::ReadMemoryMultiple(ProcessMemory::ReadRequest* requests,
+                                      size_t count) const {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  if (shared_memory_.is_valid()) {
+    ReadMemoryMultipleShared(requests, count);
+    return;
+  }
+
+  // Requests are sent in messages of up to kMaxMemoryRanges ranges, and up to
+  // kMaxMessagesInFlight messages are sent before their responses are received
+  // so that the broker doesn’t wait for the next message while this process is
+  // receiving data. Messages are small, so this can’t fill the socket buffer
+  // and block while the broker is blocked sending a response.
+  static constexpr size_t kMaxMessagesInFlight = 4;
+  static constexpr size_t kMaxRangesInFlight =
+      PtraceBroker::kMaxMemoryRanges * kMaxMessagesInFlight;
+
+  size_t sent_count = 0;
+  for (size_t index = 0; index < count; ++index) {
+    while (sent_count < count && sent_count - index < kMaxRangesInFlight) {
+      const size_t message_count =
+          std::min(count - sent_count, PtraceBroker::kMaxMemoryRanges);
+
+      // The request and its ranges are sent with a single write.
+      PtraceBroker::Request request = {};
+      request.version = PtraceBroker::Request::kVersionReadMemoryMultiple;
+      request.type = PtraceBroker::Request::kTypeReadMemoryMultiple;
+      request.tid = pid_;
+      request.ranges.count = message_count;
+
+      char message[sizeof(request) + sizeof(PtraceBroker::MemoryRange) *
+                                         PtraceBroker::kMaxMemoryRanges];
+      memcpy(message, &request, sizeof(request));
+      size_t message_size = sizeof(request);
+      for (size_t range_index = 0; range_index < message_count;
+           ++range_index) {
+        const ProcessMemory::ReadRequest& read_request =
+            requests[sent_count + range_index];
+        PtraceBroker::MemoryRange range;
+        range.base = read_request.address;
+        range.size = read_request.size;
+        memcpy(message + message_size, &range, sizeof(range));
+        message_size += sizeof(range);
+      }
+
+      // Responses to earlier messages are still pending, so a failure here
+      // leaves the connection unusable.
+      if (!SendRequest(message, message_size)) {
+        broken_ = true;
+        return;
+      }
+      sent_count += message_count;
+    }
+
+    // ReceiveMemory() marks the connection broken if it fails, so the
+    // responses that remain pending needn’t be drained.
+    ProcessMemory::ReadRequest& read_request = requests[index];
+    ssize_t total_read;
+    if (!ReceiveMemory(read_request.size,
+                       static_cast<char*>(read_request.buffer),
+                       &total_read)) {
+      return;
+    }
+
+    if (total_read >= 0 &&
+        static_cast<size_t>(total_read) < read_request.size) {
+      LOG(ERROR) << "short read";
+    }
+    read_request.succeeded =
+        total_read >= 0 && static_cast<size_t>(total_read) == read_request.size;
+  }
+}
+
+void PtraceClient::ReadMemoryMultipleShared(
+    ProcessMemory::ReadRequest* requests,
+    size_t count) const {
+  // The shared memory region is split in two halves, and messages alternate
+  // between them. Requests larger than a half are split into several pieces.
+  // A message is sent only once the data for the message that last used the
+  // same half has been copied out, so two messages may be in flight, letting
+  // the broker fill one half while this process copies from the other.
+  const size_t half_size = shared_memory_.len() / 2;
+
+  struct Piece {
+    size_t request_index;
+    size_t offset;
+    size_t size;
+  };
+  struct Message {
+    Piece pieces[PtraceBroker::kMaxMemoryRanges];
+    size_t piece_count;
+  };
+  Message messages[2];
+
+  size_t sent_count = 0;
+  size_t received_count = 0;
+  size_t request_index = 0;
+  size_t request_offset = 0;
+  while (true) {
+    while (sent_count - received_count < base::size(messages) &&
+           request_index < count) {
+      const size_t half = sent_count % base::size(messages);
+      Message& message = messages[half];
+      message.piece_count = 0;
+
+      PtraceBroker::Request request = {};
+      request.version = PtraceBroker::Request::kVersionSharedMemory;
+      request.type = PtraceBroker::Request::kTypeReadMemoryShared;
+      request.tid = pid_;
+      request.shared_ranges.buffer_offset = half * half_size;
+      request.shared_ranges.buffer_size = half_size;
+
+      // The request and its ranges are sent with a single write.
+      char buffer[sizeof(request) + sizeof(PtraceBroker::MemoryRange) *
+                                        PtraceBroker::kMaxMemoryRanges];
+      size_t buffer_size = sizeof(request);
+      size_t data_size = 0;
+      while (request_index < count &&
+             message.piece_count < PtraceBroker::kMaxMemoryRanges &&
+             data_size < half_size) {
+        ProcessMemory::ReadRequest& read_request = requests[request_index];
+        if (request_offset == 0) {
+          read_request.succeeded = true;
+        }
+
+        const size_t piece_size =
+            std::min(read_request.size - request_offset, half_size - data_size);
+        if (piece_size > 0) {
+          Piece& piece = message.pieces[message.piece_count++];
+          piece.request_index = request_index;
+          piece.offset = request_offset;
+          piece.size = piece_size;
+
+          PtraceBroker::MemoryRange range;
+          range.base = read_request.address + request_offset;
+          range.size = piece_size;
+          memcpy(buffer + buffer_size, &range, sizeof(range));
+          buffer_size += sizeof(range);
+          data_size += piece_size;
+          request_offset += piece_size;
+        }
+
+        if (request_offset == read_request.size) {
+          ++request_index;
+          request_offset = 0;
+        }
+      }
+
+      if (message.piece_count == 0) {
+        break;
+      }
+
+      request.shared_ranges.count = message.piece_count;
+      memcpy(buffer, &request, sizeof(request));
+      if (!SendRequest(buffer, buffer_size)) {
+        for (size_t index = message.pieces[0].request_index; index < count;
+             ++index) {
+          requests[index].succeeded = false;
+        }
+        broken_ = true;
+        return;
+      }
+      ++sent_count;
+    }
+
+    if (received_count == sent_count) {
+      return;
+    }
+
+    const size_t half = received_count % base::size(messages);
+    const Message& message = messages[half];
+    const char* data = shared_memory_.addr_as<const char*>() + half * half_size;
+    for (size_t piece_index = 0; piece_index < message.piece_count;
+         ++piece_index) {
+      const Piece& piece = message.pieces[piece_index];
+      ProcessMemory::ReadRequest& read_request =
+          requests[piece.request_index];
+
+      int32_t bytes_read;
+      bool received =
+          LoggingReadFileExactly(sock_, &bytes_read, sizeof(bytes_read));
+      if (received && bytes_read < 0) {
+        received = ReceiveAndLogReadError(sock_, "PtraceBroker ReadMemory");
+        read_request.succeeded = false;
+      } else if (received && static_cast<size_t>(bytes_read) > piece.size) {
+        LOG(ERROR) << "PtraceBroker ReadMemory: too much data";
+        received = false;
+      } else if (received) {
+        memcpy(static_cast<char*>(read_request.buffer) + piece.offset,
+               data,
+               bytes_read);
+        if (static_cast<size_t>(bytes_read) < piece.size &&
+            read_request.succeeded) {
+          LOG(ERROR) << "short read";
+          read_request.succeeded = false;
+        }
+      }
+
+      if (!received) {
+        for (size_t index = piece.request_index; index < count; ++index) {
+          requests[index].succeeded = false;
+        }
+        broken_ = true;
+        return;
+      }
+      data += piece.size;
+    }
+    ++received_count;
+  }
+}
+
+bool PtraceClient::ReceiveMemory(size_t size,
+                                 char* buffer,
+                                 ssize_t* total_read) const {
+  if (!ReceiveMemoryImpl(size, buffer, total_read)) {
+    broken_ = true;
+    return false;
+  }
+  return true;
+}
+
+bool PtraceClient::ReceiveMemoryImpl(size_t size,
+                                     char* buffer,
+                                     ssize_t* total_read) const {
+  *total_read = 0;
+  while (size > 0) {
+    int32_t bytes_read;
+    if (!LoggingReadFileExactly(sock_, &bytes_read, sizeof(bytes_read))) {
+      return false;
+    }
+
+    if (bytes_read < 0) {
+      *total_read = -1;
+      return ReceiveAndLogReadError(sock_, "PtraceBroker ReadMemory");
+    }
+
     if (bytes_read == 0) {
-      return total_read;
+      return true;
     }
 
-    if (!LoggingReadFileExactly(sock_, buffer_c, bytes_read)) {
-      return -1;
+    if (static_cast<size_t>(bytes_read) > size) {
+      LOG(ERROR) << "PtraceBroker ReadMemory: too much data";
+      return false;
+    }
+
+    if (!LoggingReadFileExactly(sock_, buffer, bytes_read)) {
+      return false;
     }
 
     size -= bytes_read;
-    buffer_c += bytes_read;
-    total_read += bytes_read;
+    buffer += bytes_read;
+    *total_read += bytes_read;
   }
 
-  return total_read;
+  return true;
+}
+
+bool PtraceClient::AttachImpl(pid_t tid) {
+  PtraceBroker::Request request = {};
+  request.type = PtraceBroker::Request::kTypeAttach;
+  request.tid = tid;
+  if (!SendRequest(&request, sizeof(request))) {
+    return false;
+  }
+
+  ExceptionHandlerProtocol::Bool success;
+  if (!LoggingReadFileExactly(sock_, &success, sizeof(success))) {
+    return false;
+  }
+
+  if (success != ExceptionHandlerProtocol::kBoolTrue) {
+    ReceiveAndLogError(sock_, "PtraceBroker Attach");
+    return false;
+  }
+
+  return true;
+}
+
+bool PtraceClient::ReceiveFileContents(std::string* contents) {
+  std::string local_contents;
+  int32_t read_result;
+  do {
+    if (!LoggingReadFileExactly(sock_, &read_result, sizeof(read_result))) {
+      return false;
+    }
+
+    if (read_result < 0) {
+      ReceiveAndLogReadError(sock_, "ReadFileContents");
+      return false;
+    }
+
+    if (read_result > 0) {
+      size_t old_length = local_contents.size();
+      local_contents.resize(old_length + read_result);
+      if (!LoggingReadFileExactly(
+              sock_, &local_contents[old_length], read_result)) {
+        return false;
+      }
+    }
+  } while (read_result > 0);
+
+  contents->swap(local_contents);
+  return true;
+}
+
+bool PtraceClient::SendRequest(const void* message, size_t size) const {
+  if (broken_) {
+    LOG(ERROR) << "PtraceBroker connection broken";
+    return false;
+  }
+  return LoggingWriteFile(sock_, message, size);
 }
 
 bool PtraceClient::SendFilePath(const char* path, size_t length) {
@@ -15,14 +15,17 @@
 #ifndef CRASHPAD_UTIL_LINUX_PTRACE_CLIENT_H_
 #define CRASHPAD_UTIL_LINUX_PTRACE_CLIENT_H_
 
+#include <stdint.h>
 #include <sys/types.h>
 
 #include <memory>
+#include <string>
 
 #include "base/macros.h"
 #include "util/linux/ptrace_connection.h"
 #include "util/misc/address_types.h"
 #include "util/misc/initialization_state_dcheck.h"
+#include "util/posix/scoped_mmap.h"
 #include "util/process/process_memory.h"
 
 namespace crashpad {
@@ -49,8 +52,15 @@ class PtraceClient : public PtraceConnection {
   //! \param[in] try_direct_memory If `true` the client will attempt to support
   //!     memory reading operations by directly acessing the target process'
   //!     /proc/[pid]/mem file.
+  //! \param[in] try_shared_memory If `true` and memory is read through the
+  //!     broker, the client will attempt to have the broker place memory in a
+  //!     region of shared memory instead of sending it over \a sock. If the
+  //!     broker can’t create the region, memory is sent over \a sock.
   //! \return `true` on success. `false` on failure with a message logged.
-  bool Initialize(int sock, pid_t pid, bool try_direct_memory = true);
+  bool Initialize(int sock,
+                  pid_t pid,
+                  bool try_direct_memory = true,
+                  bool try_shared_memory = true);
 
   // PtraceConnection:
 
@@ -64,6 +74,12 @@ class PtraceClient : public PtraceConnection {
   bool Threads(std::vector<pid_t>* threads) override;
 
  private:
+  // Reads memory through the broker. Small reads are served from a read-ahead
+  // buffer, refilled with kReadAheadSize bytes starting at the requested
+  // address whenever a read falls outside of it, so that a run of small
+  // sequential reads costs a single round trip to the broker. Brokers older
+  // than kVersionReadMemoryMultiple fail a read that crosses into unreadable
+  // memory, so reads through them aren’t extended.
   class BrokeredMemory : public ProcessMemory {
    public:
     explicit BrokeredMemory(PtraceClient* client);
@@ -72,20 +88,56 @@ class PtraceClient : public PtraceConnection {
     ssize_t ReadUpTo(VMAddress address,
                      size_t size,
                      void* buffer) const override;
+    void ReadMultipleImpl(ReadRequest* requests, size_t count) const override;
 
    private:
+    static constexpr size_t kReadAheadSize = 4096;
+
     PtraceClient* client_;
+    mutable std::unique_ptr<char[]> read_ahead_;
+    mutable VMAddress read_ahead_address_;
+    mutable size_t read_ahead_size_;
 
     DISALLOW_COPY_AND_ASSIGN(BrokeredMemory);
   };
 
+  bool AttachImpl(pid_t tid);
+
+  // Sets broker_version_ to the newest version of PtraceBroker::Request that
+  // both the broker and this client serve.
+  bool QueryBrokerVersion();
+  bool InitializeSharedMemory();
   ssize_t ReadUpTo(VMAddress address, size_t size, void* buffer) const;
+  ssize_t ReadUpToShared(VMAddress address, size_t size, char* buffer) const;
+  void ReadMemoryMultiple(ProcessMemory::ReadRequest* requests,
+                          size_t count) const;
+  void ReadMemoryMultipleShared(ProcessMemory::ReadRequest* requests,
+                                size_t count) const;
+
+  // Receives a response to a kTypeReadMemory request, or the response for one
+  // range of a kTypeReadMemoryMultiple request. If this fails, the connection
+  // is marked broken.
+  bool ReceiveMemory(size_t size, char* buffer, ssize_t* total_read) const;
+  bool ReceiveMemoryImpl(size_t size, char* buffer, ssize_t* total_read) const;
+
+  bool ReceiveFileContents(std::string* contents);
+
+  // Sends a request, unless the connection is broken.
+  bool SendRequest(const void* message, size_t size) const;
   bool SendFilePath(const char* path, size_t length);
 
   std::unique_ptr<ProcessMemory> memory_;
+  ScopedMmap shared_memory_;
   int sock_;
   pid_t pid_;
+  uint16_t broker_version_;
   bool is_64_bit_;
+
+  // Set when a failure leaves responses unread, or a message part way
+  // through, so that requests and responses can no longer be matched. All
+  // further requests fail.
+  mutable bool broken_;
+
   InitializationStateDcheck initialized_;
 
   DISALLOW_COPY_AND_ASSIGN(PtraceClient);
@@ -38,8 +38,16 @@ class ScopedPtraceAttach {
   //!      process with process ID \a pid, and blocks until the target process
   //!      has stopped by calling `waitpid()`.
   //!
+  //! \param[in] pid The process ID of the process to attach to.
+  //! \param[in] seize Whether to attach with `PTRACE_SEIZE` and stop the
+  //!     target with `PTRACE_INTERRUPT`, rather than with `PTRACE_ATTACH`,
+  //!     which sends the target `SIGSTOP`. Stopping each thread of a process
+  //!     with `SIGSTOP` takes time quadratic in its number of threads. If
+  //!     `PTRACE_SEIZE` fails, `PTRACE_ATTACH` is used. This should only be
+  //!     `true` in processes not subject to a seccomp policy, which may kill
+  //!     the process with `SIGSYS` for making a `PTRACE_SEIZE` request.
   //! \return `true` on success. `false` on failure, with a message logged.
-  bool ResetAttach(pid_t pid);
+  bool ResetAttach(pid_t pid, bool seize = false);
 
  private:
   pid_t pid_;
@@ -50,7 +50,7 @@ class AttachTest : public Multiprocess {
 
 class AttachToChildTest : public AttachTest {
  public:
-  AttachToChildTest() : AttachTest() {}
+  explicit AttachToChildTest(bool seize) : AttachTest(), seize_(seize) {}
   ~AttachToChildTest() {}
 
  private:
@@ -65,7 +65,7 @@ class AttachToChildTest : public AttachTest {
     EXPECT_EQ(errno, ESRCH) << ErrnoMessage("ptrace");
 
     ScopedPtraceAttach attachment;
-    ASSERT_EQ(attachment.ResetAttach(pid), true);
+    ASSERT_EQ(attachment.ResetAttach(pid, seize_), true);
     EXPECT_EQ(ptrace(PTRACE_PEEKDATA, pid, &kWord, nullptr), kWord)
         << ErrnoMessage("ptrace");
     attachment.Reset();
@@ -83,11 +83,18 @@ class AttachToChildTest : public AttachTest {
     CheckedReadFileAtEOF(ReadPipeHandle());
   }
 
+  bool seize_;
+
   DISALLOW_COPY_AND_ASSIGN(AttachToChildTest);
 };
 
 TEST(ScopedPtraceAttach, AttachChild) {
-  AttachToChildTest test;
+  AttachToChildTest test(/* seize= */ false);
+  test.Run();
+}
+
+TEST(ScopedPtraceAttach, AttachChildSeize) {
+  AttachToChildTest test(/* seize= */ true);
   test.Run();
 }
 
@@ -173,7 +173,7 @@ bool UnixCredentialSocket::RecvMsg(int fd,
   // configured with SO_PASSCRED or when all sending sockets have been closed.
   // In the latter case, res == 0. This case is also indistinguishable from an
   // empty message sent to a recv socket which hasn't set SO_PASSCRED.
-  if (!local_creds) {
+  if (creds && !local_creds) {
     LOG_IF(ERROR, res != 0) << "missing credentials";
     return false;
   }
@@ -183,7 +183,9 @@ bool UnixCredentialSocket::RecvMsg(int fd,
     return false;
   }
 
-  *creds = *local_creds;
+  if (creds) {
+    *creds = *local_creds;
+  }
   if (fds) {
     fds->swap(local_fds);
   }
@@ -68,12 +68,13 @@ class UnixCredentialSocket {
   //!
   //! This function is intended to be used with `AF_UNIX` family sockets. Up to
   //! `kMaxSendRecvMsgFDs` file descriptors may be received (via `SCM_RIGHTS`).
-  //! The socket must have `SO_PASSCRED` set.
+  //! The socket must have `SO_PASSCRED` set if \a creds is not `nullptr`.
   //!
   //! \param[in] fd The file descriptor to receive the message on.
   //! \param[out] buf The buffer to fill with the message.
   //! \param[in] buf_size The size of the message.
-  //! \param[out] creds The credentials of the sender.
+  //! \param[out] creds The credentials of the sender. Optional. If `nullptr`,
+  //!     the message is not required to carry credentials.
   //! \param[out] fds The recieved file descriptors. Optional. If `nullptr`, all
   //!     received file descriptors will be closed.
   //! \return `true` on success. Otherwise, `false`, with a message logged. No
@@ -14,16 +14,31 @@
 
 #include "util/net/http_body.h"
 
+#include <stdio.h>
 #include <string.h>
 
 #include <algorithm>
 #include <limits>
 
 #include "base/logging.h"
+#include "base/numerics/safe_conversions.h"
 #include "util/misc/implicit_cast.h"
 
 namespace crashpad {
 
+bool HTTPBodyStream::GetDirectData(DirectData* direct) {
+  return false;
+}
+
+bool HTTPBodyStream::SkipDirectData(size_t size) {
+  NOTREACHED();
+  return false;
+}
+
+bool HTTPBodyStream::Reset() {
+  return false;
+}
+
 StringHTTPBodyStream::StringHTTPBodyStream(const std::string& string)
     : HTTPBodyStream(), string_(string), bytes_read_() {
 }
@@ -46,8 +61,37 @@ FileOperationResult StringHTTPBodyStream::GetBytesBuffer(uint8_t* buffer,
   return num_bytes_returned;
 }
 
+bool StringHTTPBodyStream::GetDirectData(DirectData* direct) {
+  direct->data = reinterpret_cast<const uint8_t*>(string_.data()) + bytes_read_;
+  direct->file = kInvalidFileHandle;
+  direct->offset = 0;
+  direct->size = string_.length() - bytes_read_;
+  return true;
+}
+
+bool StringHTTPBodyStream::SkipDirectData(size_t size) {
+  DCHECK_LE(size, string_.length() - bytes_read_);
+  bytes_read_ += size;
+  return true;
+}
+
+bool StringHTTPBodyStream::Reset() {
+  bytes_read_ = 0;
+  return true;
+}
+
 FileReaderHTTPBodyStream::FileReaderHTTPBodyStream(FileReaderInterface* reader)
-    : HTTPBodyStream(), reader_(reader), reached_eof_(false) {
+    : FileReaderHTTPBodyStream(reader, kInvalidFileHandle) {}
+
+FileReaderHTTPBodyStream::FileReaderHTTPBodyStream(FileReaderInterface* reader,
+                                                   FileHandle file)
+    : HTTPBodyStream(),
+      reader_(reader),
+      file_(file),
+      file_size_(-1),
+      start_offset_(-1),
+      start_offset_recorded_(false),
+      reached_eof_(false) {
   DCHECK(reader_);
 }
 
@@ -59,6 +103,8 @@ FileOperationResult FileReaderHTTPBodyStream::GetBytesBuffer(uint8_t* buffer,
     return 0;
   }
 
+  RecordStartOffset();
+
   FileOperationResult rv = reader_->Read(buffer, max_len);
   if (rv == 0) {
     reached_eof_ = true;
@@ -66,6 +112,57 @@ FileOperationResult FileReaderHTTPBodyStream::GetBytesBuffer(uint8_t* buffer,
   return rv;
 }
 
+bool FileReaderHTTPBodyStream::GetDirectData(DirectData* direct) {
+  if (file_ == kInvalidFileHandle) {
+    return false;
+  }
+
+  RecordStartOffset();
+  FileOffset offset = reader_->SeekGet();
+  if (offset < 0) {
+    return false;
+  }
+
+  // The file is not expected to change size while it is being sent, so its
+  // size is only obtained once.
+  if (file_size_ < 0) {
+    file_size_ = LoggingFileSizeByHandle(file_);
+    if (file_size_ < 0) {
+      return false;
+    }
+  }
+
+  direct->data = nullptr;
+  direct->file = file_;
+  direct->offset = offset;
+  direct->size = base::saturated_cast<size_t>(
+      std::max(file_size_ - offset, FileOffset{0}));
+  return true;
+}
+
+bool FileReaderHTTPBodyStream::SkipDirectData(size_t size) {
+  return reader_->Seek(base::checked_cast<FileOffset>(size), SEEK_CUR) >= 0;
+}
+
+bool FileReaderHTTPBodyStream::Reset() {
+  if (!start_offset_recorded_) {
+    // Nothing has been read yet.
+    return true;
+  }
+  if (start_offset_ < 0 || !reader_->SeekSet(start_offset_)) {
+    return false;
+  }
+  reached_eof_ = false;
+  return true;
+}
+
+void FileReaderHTTPBodyStream::RecordStartOffset() {
+  if (!start_offset_recorded_) {
+    start_offset_ = reader_->SeekGet();
+    start_offset_recorded_ = true;
+  }
+}
+
 CompositeHTTPBodyStream::CompositeHTTPBodyStream(
     const CompositeHTTPBodyStream::PartsList& parts)
     : HTTPBodyStream(), parts_(parts), current_part_(parts_.begin()) {
@@ -100,4 +197,37 @@ FileOperationResult CompositeHTTPBodyStream::GetBytesBuffer(uint8_t* buffer,
   return bytes_copied;
 }
 
+bool CompositeHTTPBodyStream::GetDirectData(DirectData* direct) {
+  while (current_part_ != parts_.end()) {
+    if (!(*current_part_)->GetDirectData(direct)) {
+      return false;
+    }
+    if (direct->size > 0) {
+      return true;
+    }
+    ++current_part_;
+  }
+
+  direct->data = nullptr;
+  direct->file = kInvalidFileHandle;
+  direct->offset = 0;
+  direct->size = 0;
+  return true;
+}
+
+bool CompositeHTTPBodyStream::SkipDirectData(size_t size) {
+  DCHECK(current_part_ != parts_.end());
+  return (*current_part_)->SkipDirectData(size);
+}
+
+bool CompositeHTTPBodyStream::Reset() {
+  for (auto& part : parts_) {
+    if (!part->Reset()) {
+      return false;
+    }
+  }
+  current_part_ = parts_.begin();
+  return true;
+}
+
 }  // namespace crashpad
@@ -46,6 +46,53 @@ class HTTPBodyStream {
   virtual FileOperationResult GetBytesBuffer(uint8_t* buffer,
                                              size_t max_len) = 0;
 
+  //! \brief A description of data at a stream’s current position that can be
+  //!     sent from where it is stored, without being copied into a buffer.
+  struct DirectData {
+    //! \brief The data, if it is in memory, or `nullptr` if it is in #file.
+    //!
+    //! Data in memory remains valid, even after SkipDirectData() advances past
+    //! it, until the stream is destroyed.
+    const uint8_t* data;
+
+    //! \brief The file holding the data, if #data is `nullptr`.
+    FileHandle file;
+
+    //! \brief The offset of the data in #file.
+    FileOffset offset;
+
+    //! \brief The number of bytes available. `0` at the end of the stream.
+    size_t size;
+  };
+
+  //! \brief Describes the data at the stream’s current position, if it can be
+  //!     sent from where it is stored.
+  //!
+  //! A caller that sends data described by this method must then call
+  //! SkipDirectData() to advance the stream past it. Calls to this method may
+  //! be mixed with calls to GetBytesBuffer().
+  //!
+  //! \param[out] direct The data at the stream’s current position.
+  //!
+  //! \return `true` with \a direct set if the data can be sent directly.
+  //!     `false` if it must be obtained with GetBytesBuffer(), which is what
+  //!     the default implementation returns.
+  virtual bool GetDirectData(DirectData* direct);
+
+  //! \brief Advances the stream past \a size bytes of the data most recently
+  //!     described by GetDirectData().
+  //!
+  //! \return `true` on success, `false` on failure with a message logged.
+  virtual bool SkipDirectData(size_t size);
+
+  //! \brief Returns the stream to its start, so that its data can be sent
+  //!     again, as when a request is retried on another connection.
+  //!
+  //! \return `true` on success. `false` if the stream can’t be returned to its
+  //!     start, which is what the default implementation returns, or on
+  //!     failure with a message logged.
+  virtual bool Reset();
+
  protected:
   HTTPBodyStream() {}
 };
@@ -63,6 +110,9 @@ class StringHTTPBodyStream : public HTTPBodyStream {
 
   // HTTPBodyStream:
   FileOperationResult GetBytesBuffer(uint8_t* buffer, size_t max_len) override;
+  bool GetDirectData(DirectData* direct) override;
+  bool SkipDirectData(size_t size) override;
+  bool Reset() override;
 
  private:
   std::string string_;
@@ -81,13 +131,37 @@ class FileReaderHTTPBodyStream : public HTTPBodyStream {
   //!     will read.
   explicit FileReaderHTTPBodyStream(FileReaderInterface* reader);
 
+  //! \brief Creates a stream for reading from a FileReaderInterface, whose
+  //!     data may also be sent directly from the file that it reads.
+  //!
+  //! \param[in] reader A FileReaderInterface from which this HTTPBodyStream
+  //!     will read.
+  //! \param[in] file The file that \a reader reads from, whose position is
+  //!     tracked through \a reader. If this is kInvalidFileHandle, this
+  //!     constructor is equivalent to the other one.
+  FileReaderHTTPBodyStream(FileReaderInterface* reader, FileHandle file);
+
   ~FileReaderHTTPBodyStream() override;
 
   // HTTPBodyStream:
   FileOperationResult GetBytesBuffer(uint8_t* buffer, size_t max_len) override;
+  bool GetDirectData(DirectData* direct) override;
+  bool SkipDirectData(size_t size) override;
+  bool Reset() override;
 
  private:
+  // Records the reader’s position as the start of the stream, if it hasn’t
+  // been recorded already.
+  void RecordStartOffset();
+
   FileReaderInterface* reader_;  // weak
+  FileHandle file_;  // weak
+  FileOffset file_size_;
+
+  // The reader’s position when the stream was first read, or -1 if it hasn’t
+  // been read yet or the position couldn’t be determined.
+  FileOffset start_offset_;
+  bool start_offset_recorded_;
   bool reached_eof_;
 
   DISALLOW_COPY_AND_ASSIGN(FileReaderHTTPBodyStream);
@@ -111,6 +185,9 @@ class CompositeHTTPBodyStream : public HTTPBodyStream {
 
   // HTTPBodyStream:
   FileOperationResult GetBytesBuffer(uint8_t* buffer, size_t max_len) override;
+  bool GetDirectData(DirectData* direct) override;
+  bool SkipDirectData(size_t size) override;
+  bool Reset() override;
 
  private:
   PartsList parts_;
@@ -0,0 +1,78 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/net/http_body_bandwidth_limited.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "util/misc/clock.h"
+
+namespace crashpad {
+
+namespace {
+
+constexpr uint64_t kNanosecondsPerSecond = 1000000000;
+
+}  // namespace
+
+BandwidthLimiter::BandwidthLimiter(uint64_t bytes_per_second)
+    : bytes_per_second_(bytes_per_second), lock_(), next_time_ns_(0) {
+  DCHECK_NE(bytes_per_second_, 0u);
+}
+
+BandwidthLimiter::~BandwidthLimiter() {}
+
+void BandwidthLimiter::Wait(size_t bytes) {
+  const uint64_t now_ns = ClockMonotonicNanoseconds();
+
+  // Each caller is given the time at which the previous caller’s data will
+  // have been sent at the permitted rate, and the time after that is reserved
+  // for its own data.
+  uint64_t send_time_ns;
+  {
+    base::AutoLock lock_owner(lock_);
+    send_time_ns = std::max(next_time_ns_, now_ns);
+    next_time_ns_ =
+        send_time_ns + bytes * kNanosecondsPerSecond / bytes_per_second_;
+  }
+
+  if (send_time_ns > now_ns) {
+    SleepNanoseconds(send_time_ns - now_ns);
+  }
+}
+
+BandwidthLimitedHTTPBodyStream::BandwidthLimitedHTTPBodyStream(
+    std::unique_ptr<HTTPBodyStream> source,
+    BandwidthLimiter* limiter)
+    : HTTPBodyStream(), source_(std::move(source)), limiter_(limiter) {}
+
+BandwidthLimitedHTTPBodyStream::~BandwidthLimitedHTTPBodyStream() {}
+
+FileOperationResult BandwidthLimitedHTTPBodyStream::GetBytesBuffer(
+    uint8_t* buffer,
+    size_t max_len) {
+  FileOperationResult bytes_read = source_->GetBytesBuffer(buffer, max_len);
+  if (bytes_read > 0) {
+    limiter_->Wait(bytes_read);
+  }
+  return bytes_read;
+}
+
+bool BandwidthLimitedHTTPBodyStream::Reset() {
+  return source_->Reset();
+}
+
+}  // namespace crashpad
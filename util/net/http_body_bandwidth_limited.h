@@ -0,0 +1,79 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_UTIL_NET_HTTP_BODY_BANDWIDTH_LIMITED_H_
+#define CRASHPAD_UTIL_NET_HTTP_BODY_BANDWIDTH_LIMITED_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <memory>
+
+#include "base/macros.h"
+#include "base/synchronization/lock.h"
+#include "util/file/file_io.h"
+#include "util/net/http_body.h"
+
+namespace crashpad {
+
+//! \brief Paces data so that it is produced no faster than a fixed rate on
+//!     average.
+//!
+//! One object may be shared by several BandwidthLimitedHTTPBodyStream objects,
+//! possibly on different threads, to limit their combined rate.
+class BandwidthLimiter {
+ public:
+  //! \param[in] bytes_per_second The maximum average rate. Must be nonzero.
+  explicit BandwidthLimiter(uint64_t bytes_per_second);
+  ~BandwidthLimiter();
+
+  //! \brief Blocks until \a bytes more bytes may be sent without exceeding the
+  //!     rate given to the constructor.
+  //!
+  //! This method may be called from any thread.
+  void Wait(size_t bytes);
+
+ private:
+  const uint64_t bytes_per_second_;
+  base::Lock lock_;
+  uint64_t next_time_ns_;  // Guarded by lock_.
+
+  DISALLOW_COPY_AND_ASSIGN(BandwidthLimiter);
+};
+
+//! \brief An implementation of HTTPBodyStream that passes through another
+//!     HTTPBodyStream no faster than a BandwidthLimiter allows.
+class BandwidthLimitedHTTPBodyStream : public HTTPBodyStream {
+ public:
+  //! \param[in] source The stream to read from.
+  //! \param[in] limiter The limiter to pace reads with. Weak.
+  BandwidthLimitedHTTPBodyStream(std::unique_ptr<HTTPBodyStream> source,
+                                 BandwidthLimiter* limiter);
+
+  ~BandwidthLimitedHTTPBodyStream() override;
+
+  // HTTPBodyStream:
+  FileOperationResult GetBytesBuffer(uint8_t* buffer, size_t max_len) override;
+  bool Reset() override;
+
+ private:
+  std::unique_ptr<HTTPBodyStream> source_;
+  BandwidthLimiter* limiter_;  // weak
+
+  DISALLOW_COPY_AND_ASSIGN(BandwidthLimitedHTTPBodyStream);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_UTIL_NET_HTTP_BODY_BANDWIDTH_LIMITED_H_
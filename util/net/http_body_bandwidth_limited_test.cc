@@ -0,0 +1,112 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/net/http_body_bandwidth_limited.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "util/misc/clock.h"
+#include "util/net/http_body.h"
+#include "util/net/http_body_test_util.h"
+#include "util/thread/thread.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+constexpr uint64_t kNanosecondsPerSecond = 1000000000;
+
+TEST(BandwidthLimitedHTTPBodyStream, PassesThroughData) {
+  std::string string;
+  for (size_t index = 0; index < 10000; ++index) {
+    string.push_back(static_cast<char>(index % 251));
+  }
+
+  BandwidthLimiter limiter(1024 * 1024 * 1024);
+  BandwidthLimitedHTTPBodyStream stream(
+      std::make_unique<StringHTTPBodyStream>(string), &limiter);
+  EXPECT_EQ(ReadStreamToString(&stream, 333), string);
+
+  uint8_t buffer[16];
+  EXPECT_EQ(stream.GetBytesBuffer(buffer, sizeof(buffer)), 0);
+}
+
+TEST(BandwidthLimitedHTTPBodyStream, LimitsRate) {
+  constexpr uint64_t kBytesPerSecond = 64 * 1024;
+  constexpr size_t kBufferSize = 4096;
+  const std::string string(32 * 1024, 'x');
+
+  BandwidthLimiter limiter(kBytesPerSecond);
+  BandwidthLimitedHTTPBodyStream stream(
+      std::make_unique<StringHTTPBodyStream>(string), &limiter);
+
+  const uint64_t start_ns = ClockMonotonicNanoseconds();
+  EXPECT_EQ(ReadStreamToString(&stream, kBufferSize), string);
+  const uint64_t elapsed_ns = ClockMonotonicNanoseconds() - start_ns;
+
+  // The last buffer is returned without waiting for the time it takes to send.
+  EXPECT_GE(elapsed_ns,
+            (string.size() - kBufferSize) * kNanosecondsPerSecond /
+                kBytesPerSecond);
+}
+
+class ReaderThread : public Thread {
+ public:
+  ReaderThread(const std::string& string, BandwidthLimiter* limiter)
+      : Thread(),
+        stream_(std::make_unique<StringHTTPBodyStream>(string), limiter),
+        result_() {}
+  ~ReaderThread() override {}
+
+  const std::string& result() const { return result_; }
+
+ private:
+  void ThreadMain() override { result_ = ReadStreamToString(&stream_, 4096); }
+
+  BandwidthLimitedHTTPBodyStream stream_;
+  std::string result_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReaderThread);
+};
+
+TEST(BandwidthLimitedHTTPBodyStream, SharedLimiter) {
+  constexpr uint64_t kBytesPerSecond = 64 * 1024;
+  const std::string string(16 * 1024, 'x');
+
+  // Two streams sharing a limiter take as long as one stream with all of their
+  // data would.
+  BandwidthLimiter limiter(kBytesPerSecond);
+  ReaderThread threads[] = {{string, &limiter}, {string, &limiter}};
+
+  const uint64_t start_ns = ClockMonotonicNanoseconds();
+  for (ReaderThread& thread : threads) {
+    thread.Start();
+  }
+  for (ReaderThread& thread : threads) {
+    thread.Join();
+    EXPECT_EQ(thread.result(), string);
+  }
+  const uint64_t elapsed_ns = ClockMonotonicNanoseconds() - start_ns;
+
+  EXPECT_GE(elapsed_ns,
+            (string.size() * 2 - 2 * 4096) * kNanosecondsPerSecond /
+                kBytesPerSecond);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
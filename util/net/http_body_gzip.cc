@@ -14,6 +14,9 @@
 
 #include "util/net/http_body_gzip.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <utility>
 
 #include "base/logging.h"
@@ -23,9 +26,258 @@
 
 namespace crashpad {
 
+namespace {
+
+// The default value for zlib’s internal DEF_MEM_LEVEL. This is the value that
+// deflateInit() would use, but it’s not exported from zlib.
+constexpr int kZlibDefaultMemoryLevel = 8;
+
+// The header of data written by GzipPrecompress(), followed by raw deflate
+// data.
+struct PrecompressedHeader {
+  // kPrecompressedMagic.
+  uint32_t magic;
+
+  // kPrecompressedVersion.
+  uint32_t version;
+
+  // The length of the uncompressed data.
+  uint64_t uncompressed_size;
+
+  // The CRC-32 of the uncompressed data.
+  uint32_t crc;
+
+  uint32_t reserved;
+};
+
+// "CPgz", in little-endian byte order.
+constexpr uint32_t kPrecompressedMagic = 0x7a675043;
+constexpr uint32_t kPrecompressedVersion = 1;
+
+// Initializes zlib to produce raw deflate data, without a zlib or gzip
+// wrapper.
+bool RawDeflateInit(z_stream* zlib, int level, int window_bits) {
+  zlib->zalloc = Z_NULL;
+  zlib->zfree = Z_NULL;
+  zlib->opaque = Z_NULL;
+
+  int zr = deflateInit2(zlib,
+                        level,
+                        Z_DEFLATED,
+                        -window_bits,
+                        kZlibDefaultMemoryLevel,
+                        Z_DEFAULT_STRATEGY);
+  if (zr != Z_OK) {
+    LOG(ERROR) << "deflateInit2: " << ZlibErrorString(zr);
+    return false;
+  }
+  return true;
+}
+
+void AppendLittleEndian32(uint32_t value, std::string* string) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    string->push_back(static_cast<char>((value >> shift) & 0xff));
+  }
+}
+
+// Compresses source into destination with zlib, which must already be
+// initialized, ending with a sync flush rather than a final block.
+bool PrecompressWithZlib(FileReaderInterface* source,
+                         FileWriterInterface* destination,
+                         z_stream* zlib,
+                         PrecompressedHeader* header) {
+  uint8_t input[4096];
+  uint8_t output[4096];
+  uLong crc = crc32(0, Z_NULL, 0);
+  int flush = Z_NO_FLUSH;
+  do {
+    if (zlib->avail_in == 0 && flush == Z_NO_FLUSH) {
+      FileOperationResult input_bytes = source->Read(input, sizeof(input));
+      if (input_bytes < 0) {
+        return false;
+      }
+      if (input_bytes == 0) {
+        flush = Z_SYNC_FLUSH;
+      }
+      crc = crc32(crc, input, base::checked_cast<uInt>(input_bytes));
+      header->uncompressed_size += input_bytes;
+      zlib->next_in = input;
+      zlib->avail_in = base::checked_cast<uInt>(input_bytes);
+    }
+
+    zlib->next_out = output;
+    zlib->avail_out = sizeof(output);
+    int zr = deflate(zlib, flush);
+    if (zr != Z_OK && zr != Z_BUF_ERROR) {
+      LOG(ERROR) << "deflate: " << ZlibErrorString(zr);
+      return false;
+    }
+
+    if (!destination->Write(output, sizeof(output) - zlib->avail_out)) {
+      return false;
+    }
+
+    // A flush is complete once it leaves some of the output buffer unused.
+  } while (flush == Z_NO_FLUSH || zlib->avail_out == 0);
+
+  header->crc = static_cast<uint32_t>(crc);
+  return true;
+}
+
+}  // namespace
+
+bool GzipPrecompress(FileReaderInterface* source,
+                     FileWriterInterface* destination,
+                     int level,
+                     int window_bits) {
+  FileOffset header_offset = destination->SeekGet();
+  if (header_offset < 0) {
+    return false;
+  }
+
+  PrecompressedHeader header = {};
+  if (!destination->Write(&header, sizeof(header))) {
+    return false;
+  }
+
+  z_stream zlib = {};
+  if (!RawDeflateInit(&zlib, level, window_bits)) {
+    return false;
+  }
+  bool compressed = PrecompressWithZlib(source, destination, &zlib, &header);
+
+  // Because the deflate data is deliberately left without a final block,
+  // deflateEnd() reports Z_DATA_ERROR on success.
+  int zr = deflateEnd(&zlib);
+  if (!compressed) {
+    return false;
+  }
+  if (zr != Z_OK && zr != Z_DATA_ERROR) {
+    LOG(ERROR) << "deflateEnd: " << ZlibErrorString(zr);
+    return false;
+  }
+
+  header.magic = kPrecompressedMagic;
+  header.version = kPrecompressedVersion;
+  return destination->SeekSet(header_offset) &&
+         destination->Write(&header, sizeof(header)) &&
+         destination->Seek(0, SEEK_END) >= 0;
+}
+
+bool IsGzipPrecompressed(FileReaderInterface* source) {
+  FileOffset offset = source->SeekGet();
+  if (offset < 0) {
+    return false;
+  }
+
+  PrecompressedHeader header;
+  FileOperationResult bytes_read = source->Read(&header, sizeof(header));
+  if (!source->SeekSet(offset)) {
+    return false;
+  }
+  return bytes_read == sizeof(header) && header.magic == kPrecompressedMagic &&
+         header.version == kPrecompressedVersion;
+}
+
+bool GzipPrecompressedInflate(FileReaderInterface* source,
+                              FileWriterInterface* destination) {
+  PrecompressedHeader header;
+  if (!source->ReadExactly(&header, sizeof(header))) {
+    return false;
+  }
+  if (header.magic != kPrecompressedMagic ||
+      header.version != kPrecompressedVersion) {
+    LOG(ERROR) << "invalid precompressed data";
+    return false;
+  }
+
+  z_stream zlib = {};
+  int zr = inflateInit2(&zlib, -GzipHTTPBodyStream::kDefaultWindowBits);
+  if (zr != Z_OK) {
+    LOG(ERROR) << "inflateInit2: " << ZlibErrorString(zr);
+    return false;
+  }
+
+  // The deflate data has no final block, so inflate() never reports the end of
+  // the stream. It ends when the input does.
+  uint8_t input[4096];
+  uint8_t output[4096];
+  uLong crc = crc32(0, Z_NULL, 0);
+  uint64_t uncompressed_size = 0;
+  bool input_eof = false;
+  bool inflated = true;
+  while (inflated) {
+    if (zlib.avail_in == 0 && !input_eof) {
+      FileOperationResult input_bytes = source->Read(input, sizeof(input));
+      if (input_bytes < 0) {
+        inflated = false;
+        break;
+      }
+      input_eof = input_bytes == 0;
+      zlib.next_in = input;
+      zlib.avail_in = base::checked_cast<uInt>(input_bytes);
+    }
+
+    zlib.next_out = output;
+    zlib.avail_out = sizeof(output);
+    zr = inflate(&zlib, Z_NO_FLUSH);
+    if (zr != Z_OK && zr != Z_BUF_ERROR) {
+      LOG(ERROR) << "inflate: " << ZlibErrorString(zr);
+      inflated = false;
+      break;
+    }
+
+    const size_t output_bytes = sizeof(output) - zlib.avail_out;
+    crc = crc32(crc, output, base::checked_cast<uInt>(output_bytes));
+    uncompressed_size += output_bytes;
+    if (!destination->Write(output, output_bytes)) {
+      inflated = false;
+      break;
+    }
+
+    if (input_eof && zlib.avail_in == 0 && zlib.avail_out != 0) {
+      break;
+    }
+  }
+
+  inflateEnd(&zlib);
+  if (!inflated) {
+    return false;
+  }
+
+  if (uncompressed_size != header.uncompressed_size ||
+      static_cast<uint32_t>(crc) != header.crc) {
+    LOG(ERROR) << "precompressed data is corrupt";
+    return false;
+  }
+  return true;
+}
+
 GzipHTTPBodyStream::GzipHTTPBodyStream(std::unique_ptr<HTTPBodyStream> source)
+    : GzipHTTPBodyStream(std::move(source), kDefaultLevel, kDefaultWindowBits) {
+}
+
+GzipHTTPBodyStream::GzipHTTPBodyStream(std::unique_ptr<HTTPBodyStream> source,
+                                       int level,
+                                       int window_bits)
+    : GzipHTTPBodyStream(std::vector<Source>(), level, window_bits) {
+  sources_.push_back({std::move(source), nullptr});
+}
+
+GzipHTTPBodyStream::GzipHTTPBodyStream(std::vector<Source> sources,
+                                       int level,
+                                       int window_bits)
     : input_(),
-      source_(std::move(source)),
+      sources_(std::move(sources)),
+      precompressed_offsets_(),
+      pending_output_(),
+      pending_output_offset_(0),
+      source_index_(0),
+      uncompressed_size_(0),
+      crc_(0),
+      level_(level),
+      window_bits_(window_bits),
+      splicing_(false),
       z_stream_(new z_stream()),
       state_(State::kUninitialized) {}
 
@@ -41,65 +293,183 @@ FileOperationResult GzipHTTPBodyStream::GetBytesBuffer(uint8_t* buffer,
     return -1;
   }
 
-  if (state_ == State::kFinished) {
-    return 0;
-  }
-
   if (state_ == State::kUninitialized) {
-    z_stream_->zalloc = Z_NULL;
-    z_stream_->zfree = Z_NULL;
-    z_stream_->opaque = Z_NULL;
-
-    // The default values for zlib’s internal MAX_WBITS and DEF_MEM_LEVEL. These
-    // are the values that deflateInit() would use, but they’re not exported
-    // from zlib. deflateInit2() is used instead of deflateInit() to get the
-    // gzip wrapper.
-    constexpr int kZlibMaxWindowBits = 15;
-    constexpr int kZlibDefaultMemoryLevel = 8;
-
-    int zr = deflateInit2(z_stream_.get(),
-                          Z_DEFAULT_COMPRESSION,
-                          Z_DEFLATED,
-                          ZlibWindowBitsWithGzipWrapper(kZlibMaxWindowBits),
-                          kZlibDefaultMemoryLevel,
-                          Z_DEFAULT_STRATEGY);
-    if (zr != Z_OK) {
-      LOG(ERROR) << "deflateInit2: " << ZlibErrorString(zr);
+    if (precompressed_offsets_.empty()) {
+      precompressed_offsets_.reserve(sources_.size());
+      for (const Source& source : sources_) {
+        precompressed_offsets_.push_back(
+            source.stream ? -1 : source.precompressed->SeekGet());
+      }
+    }
+
+    if (!RawDeflateInit(z_stream_.get(), level_, window_bits_)) {
       state_ = State::kError;
       return -1;
     }
 
-    state_ = State::kOperating;
+    // A gzip header per RFC 1952 with no optional fields, no modification
+    // time, and an unknown operating system.
+    static constexpr char kGzipHeader[] = {
+        '\37', '\213', Z_DEFLATED, 0, 0, 0, 0, 0, 0, '\377'};
+    pending_output_.assign(kGzipHeader, sizeof(kGzipHeader));
+    crc_ = static_cast<uint32_t>(crc32(0, Z_NULL, 0));
+
+    state_ = sources_.empty() ? State::kInputEOF : State::kOperating;
   }
 
+  size_t bytes_produced = 0;
+  while (bytes_produced < max_len) {
+    if (pending_output_offset_ < pending_output_.size()) {
+      size_t copy_size =
+          std::min(max_len - bytes_produced,
+                   pending_output_.size() - pending_output_offset_);
+      memcpy(buffer + bytes_produced,
+             &pending_output_[pending_output_offset_],
+             copy_size);
+      pending_output_offset_ += copy_size;
+      bytes_produced += copy_size;
+      continue;
+    }
+
+    if (state_ == State::kFinished) {
+      break;
+    }
+
+    FileOperationResult deflated_bytes =
+        Deflate(buffer + bytes_produced, max_len - bytes_produced);
+    if (deflated_bytes < 0) {
+      return -1;
+    }
+    bytes_produced += deflated_bytes;
+  }
+
+  return bytes_produced;
+}
+
+FileOperationResult GzipHTTPBodyStream::Deflate(uint8_t* buffer,
+                                                size_t max_len) {
+  DCHECK_EQ(pending_output_offset_, pending_output_.size());
+  pending_output_.clear();
+  pending_output_offset_ = 0;
+
   z_stream_->next_out = buffer;
   z_stream_->avail_out = base::saturated_cast<uInt>(max_len);
 
   while (state_ != State::kFinished && z_stream_->avail_out > 0) {
-    if (state_ != State::kInputEOF && z_stream_->avail_in == 0) {
+    if (state_ == State::kInputEOF) {
+      int zr = deflate(z_stream_.get(), Z_FINISH);
+      if (zr == Z_STREAM_END) {
+        AppendLittleEndian32(crc_, &pending_output_);
+        AppendLittleEndian32(static_cast<uint32_t>(uncompressed_size_),
+                             &pending_output_);
+        Done(State::kFinished);
+        if (state_ == State::kError) {
+          return -1;
+        }
+        break;
+      }
+      if (zr != Z_OK) {
+        LOG(ERROR) << "deflate: " << ZlibErrorString(zr);
+        Done(State::kError);
+        return -1;
+      }
+      continue;
+    }
+
+    Source& source = sources_[source_index_];
+    if (!source.stream) {
+      if (!splicing_) {
+        // End the deflate data produced so far on a byte boundary, so that the
+        // precompressed data can follow it. This goes through pending_output_
+        // because zlib may emit repeated flush markers when flushing into a
+        // small buffer.
+        Bytef* const next_out = z_stream_->next_out;
+        const uInt avail_out = z_stream_->avail_out;
+        uint8_t flush_output[4096];
+        do {
+          z_stream_->next_out = flush_output;
+          z_stream_->avail_out = sizeof(flush_output);
+          int zr = deflate(z_stream_.get(), Z_SYNC_FLUSH);
+          if (zr != Z_OK && zr != Z_BUF_ERROR) {
+            LOG(ERROR) << "deflate: " << ZlibErrorString(zr);
+            Done(State::kError);
+            return -1;
+          }
+          pending_output_.append(
+              reinterpret_cast<char*>(flush_output),
+              sizeof(flush_output) - z_stream_->avail_out);
+        } while (z_stream_->avail_out == 0);
+        z_stream_->next_out = next_out;
+        z_stream_->avail_out = avail_out;
+
+        PrecompressedHeader header;
+        if (!source.precompressed->ReadExactly(&header, sizeof(header))) {
+          Done(State::kError);
+          return -1;
+        }
+        if (header.magic != kPrecompressedMagic ||
+            header.version != kPrecompressedVersion) {
+          LOG(ERROR) << "invalid precompressed data";
+          Done(State::kError);
+          return -1;
+        }
+
+        crc_ = static_cast<uint32_t>(
+            crc32_combine(crc_,
+                          header.crc,
+                          base::checked_cast<z_off_t>(
+                              header.uncompressed_size)));
+        uncompressed_size_ += header.uncompressed_size;
+        splicing_ = true;
+
+        // The flushed data in pending_output_ must be returned first.
+        break;
+      }
+
+      FileOperationResult bytes_read = source.precompressed->Read(
+          z_stream_->next_out, z_stream_->avail_out);
+      if (bytes_read < 0) {
+        Done(State::kError);
+        return -1;
+      }
+      if (bytes_read == 0) {
+        int zr = deflateReset(z_stream_.get());
+        if (zr != Z_OK) {
+          LOG(ERROR) << "deflateReset: " << ZlibErrorString(zr);
+          Done(State::kError);
+          return -1;
+        }
+        splicing_ = false;
+        NextSource();
+        continue;
+      }
+      z_stream_->next_out += bytes_read;
+      z_stream_->avail_out -= base::checked_cast<uInt>(bytes_read);
+      continue;
+    }
+
+    if (z_stream_->avail_in == 0) {
       FileOperationResult input_bytes =
-          source_->GetBytesBuffer(input_, sizeof(input_));
+          source.stream->GetBytesBuffer(input_, sizeof(input_));
       if (input_bytes == -1) {
         Done(State::kError);
         return -1;
       }
 
       if (input_bytes == 0) {
-        state_ = State::kInputEOF;
+        NextSource();
+        continue;
       }
 
+      crc_ = static_cast<uint32_t>(
+          crc32(crc_, input_, base::checked_cast<uInt>(input_bytes)));
+      uncompressed_size_ += input_bytes;
       z_stream_->next_in = input_;
       z_stream_->avail_in = base::checked_cast<uInt>(input_bytes);
     }
 
-    int zr = deflate(z_stream_.get(),
-                     state_ == State::kInputEOF ? Z_FINISH : Z_NO_FLUSH);
-    if (state_ == State::kInputEOF && zr == Z_STREAM_END) {
-      Done(State::kFinished);
-      if (state_ == State::kError) {
-        return -1;
-      }
-    } else if (zr != Z_OK) {
+    int zr = deflate(z_stream_.get(), Z_NO_FLUSH);
+    if (zr != Z_OK) {
       LOG(ERROR) << "deflate: " << ZlibErrorString(zr);
       Done(State::kError);
       return -1;
@@ -110,6 +480,46 @@ FileOperationResult GzipHTTPBodyStream::GetBytesBuffer(uint8_t* buffer,
   return max_len - z_stream_->avail_out;
 }
 
+bool GzipHTTPBodyStream::Reset() {
+  if (state_ == State::kOperating || state_ == State::kInputEOF) {
+    // The compressed data is being discarded, so deflateEnd()’s complaint that
+    // it was incomplete doesn’t matter.
+    deflateEnd(z_stream_.get());
+  }
+  state_ = State::kUninitialized;
+
+  for (size_t index = 0; index < sources_.size(); ++index) {
+    Source& source = sources_[index];
+    if (source.stream) {
+      if (!source.stream->Reset()) {
+        state_ = State::kError;
+        return false;
+      }
+    } else if (index < precompressed_offsets_.size() &&
+               (precompressed_offsets_[index] < 0 ||
+                !source.precompressed->SeekSet(
+                    precompressed_offsets_[index]))) {
+      state_ = State::kError;
+      return false;
+    }
+  }
+
+  *z_stream_ = z_stream();
+  pending_output_.clear();
+  pending_output_offset_ = 0;
+  source_index_ = 0;
+  uncompressed_size_ = 0;
+  crc_ = 0;
+  splicing_ = false;
+  return true;
+}
+
+void GzipHTTPBodyStream::NextSource() {
+  if (++source_index_ == sources_.size()) {
+    state_ = State::kInputEOF;
+  }
+}
+
 void GzipHTTPBodyStream::Done(State state) {
   DCHECK(state_ == State::kOperating || state_ == State::kInputEOF) << state_;
   DCHECK(state == State::kFinished || state == State::kError) << state;
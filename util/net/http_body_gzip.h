@@ -19,9 +19,13 @@
 #include <sys/types.h>
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "base/macros.h"
 #include "util/file/file_io.h"
+#include "util/file/file_reader.h"
+#include "util/file/file_writer.h"
 #include "util/net/http_body.h"
 
 extern "C" {
@@ -30,16 +34,106 @@ typedef struct z_stream_s z_stream;
 
 namespace crashpad {
 
+//! \brief Compresses data in advance, so that a GzipHTTPBodyStream can include
+//!     it in its output without compressing it again.
+//!
+//! The compressed form holds a short header, recording the length and CRC-32
+//! of the uncompressed data, followed by raw `deflate` data that ends on a
+//! byte boundary without a final block.
+//!
+//! \param[in] source The data to compress, read from its current position to
+//!     its end.
+//! \param[in] destination The compressed data is written here.
+//! \param[in] level The `zlib` compression level, from `0` to `9`, or
+//!     GzipHTTPBodyStream::kDefaultLevel.
+//! \param[in] window_bits The base-2 logarithm of the `zlib` window size,
+//!     from `9` to `15`.
+//!
+//! \return `true` on success, `false` on failure with a message logged.
+bool GzipPrecompress(FileReaderInterface* source,
+                     FileWriterInterface* destination,
+                     int level,
+                     int window_bits);
+
+//! \brief Determines whether data was compressed by GzipPrecompress().
+//!
+//! \param[in] source The data to examine, read from its current position. The
+//!     position is restored before returning.
+//!
+//! \return `true` if \a source holds the header written by GzipPrecompress(),
+//!     `false` if it doesn’t or if it couldn’t be read, with a message logged
+//!     in the latter case.
+bool IsGzipPrecompressed(FileReaderInterface* source);
+
+//! \brief Decompresses data compressed by GzipPrecompress().
+//!
+//! The length and CRC-32 of the decompressed data are checked against those
+//! recorded when it was compressed.
+//!
+//! \param[in] source The compressed data, read from its current position to
+//!     its end.
+//! \param[in] destination The decompressed data is written here.
+//!
+//! \return `true` on success, `false` on failure with a message logged.
+bool GzipPrecompressedInflate(FileReaderInterface* source,
+                              FileWriterInterface* destination);
+
 //! \brief An implementation of HTTPBodyStream that `gzip`-compresses another
 //!     HTTPBodyStream.
 class GzipHTTPBodyStream : public HTTPBodyStream {
  public:
+  //! \brief The default `zlib` compression level.
+  static constexpr int kDefaultLevel = -1;
+
+  //! \brief The default base-2 logarithm of the `zlib` window size, which is
+  //!     also the largest allowed.
+  static constexpr int kDefaultWindowBits = 15;
+
+  //! \brief A portion of the data to compress.
+  struct Source {
+    //! \brief Uncompressed data, or `nullptr` if #precompressed is used.
+    std::unique_ptr<HTTPBodyStream> stream;
+
+    //! \brief Data compressed in advance by GzipPrecompress(), positioned at
+    //!     its start, which is used if #stream is `nullptr`. Weak.
+    //!
+    //! The compressed data is included in the output as-is, so the level and
+    //! window size that it was compressed with are used for it regardless of
+    //! those given to the GzipHTTPBodyStream.
+    FileReaderInterface* precompressed;
+  };
+
+  //! \brief Compresses \a source with the default level and window size.
   explicit GzipHTTPBodyStream(std::unique_ptr<HTTPBodyStream> source);
 
+  //! \brief Compresses \a source.
+  //!
+  //! \param[in] source The data to compress.
+  //! \param[in] level The `zlib` compression level, from `0` to `9`, or
+  //!     kDefaultLevel.
+  //! \param[in] window_bits The base-2 logarithm of the `zlib` window size,
+  //!     from `9` to `15`.
+  GzipHTTPBodyStream(std::unique_ptr<HTTPBodyStream> source,
+                     int level,
+                     int window_bits);
+
+  //! \brief Compresses the data of \a sources, in order, into a single `gzip`
+  //!     member.
+  //!
+  //! \param[in] sources The data to compress. Uncompressed data is compressed
+  //!     with \a level and \a window_bits. Data compressed in advance is
+  //!     copied into the output without being compressed again.
+  //! \param[in] level The `zlib` compression level, from `0` to `9`, or
+  //!     kDefaultLevel.
+  //! \param[in] window_bits The base-2 logarithm of the `zlib` window size,
+  //!     from `9` to `15`.
+  GzipHTTPBodyStream(std::vector<Source> sources, int level, int window_bits);
+
   ~GzipHTTPBodyStream() override;
 
   // HTTPBodyStream:
   FileOperationResult GetBytesBuffer(uint8_t* buffer, size_t max_len) override;
+  bool Reset() override;
 
  private:
   enum State : int {
@@ -50,12 +144,43 @@ class GzipHTTPBodyStream : public HTTPBodyStream {
     kError,
   };
 
+  // Produces up to max_len bytes of raw deflate data into buffer, moving on
+  // from one source to the next as each is exhausted. Returns the number of
+  // bytes produced, or -1 on failure with a message logged.
+  FileOperationResult Deflate(uint8_t* buffer, size_t max_len);
+
+  // Advances source_index_ to the next source, or transitions state_ to
+  // State::kInputEOF if there are no more.
+  void NextSource();
+
   // Calls deflateEnd() and transitions state_ to state. If deflateEnd() fails,
   // logs a message and transitions state_ to State::kError.
   void Done(State state);
 
   uint8_t input_[4096];
-  std::unique_ptr<HTTPBodyStream> source_;
+  std::vector<Source> sources_;
+
+  // The position of each precompressed source when compression began, so that
+  // Reset() can return to it. Entries for uncompressed sources are unused.
+  std::vector<FileOffset> precompressed_offsets_;
+
+  // The gzip header and trailer, which are produced outside of zlib so that
+  // precompressed data can be accounted for in the trailer.
+  std::string pending_output_;
+  size_t pending_output_offset_;
+
+  size_t source_index_;
+  uint64_t uncompressed_size_;
+  uint32_t crc_;
+  int level_;
+  int window_bits_;
+
+  // Whether the precompressed source at source_index_ is being copied. Before
+  // it is, the deflate data produced so far is flushed to a byte boundary, and
+  // after it is, the deflate stream is reset so that subsequent data does not
+  // refer back past it.
+  bool splicing_;
+
   std::unique_ptr<z_stream> z_stream_;
   State state_;
 
@@ -20,12 +20,14 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/macros.h"
 #include "base/rand_util.h"
 #include "base/numerics/safe_conversions.h"
 #include "gtest/gtest.h"
 #include "third_party/zlib/zlib_crashpad.h"
+#include "util/file/string_file.h"
 #include "util/misc/zlib.h"
 #include "util/net/http_body.h"
 
@@ -173,6 +175,209 @@ TEST(GzipHTTPBodyStream, ManyBytes_Random) {
   TestGzipDeflateInflate(base::RandBytesAsString(kManyBytes));
 }
 
+// Reads all of stream, max_len bytes at a time.
+std::string ReadStream(HTTPBodyStream* stream, size_t max_len) {
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[max_len]);
+  std::string string;
+  FileOperationResult bytes;
+  while ((bytes = stream->GetBytesBuffer(buf.get(), max_len)) > 0) {
+    string.append(reinterpret_cast<char*>(buf.get()), bytes);
+  }
+  EXPECT_EQ(bytes, 0);
+  return string;
+}
+
+TEST(GzipHTTPBodyStream, LevelAndWindowBits) {
+  const std::string string = MakeString(kManyBytes);
+
+  for (int level : {0, 1, GzipHTTPBodyStream::kDefaultLevel, 9}) {
+    size_t small_window_size = 0;
+    for (int window_bits : {9, GzipHTTPBodyStream::kDefaultWindowBits}) {
+      SCOPED_TRACE(::testing::Message() << "level " << level
+                                        << ", window_bits " << window_bits);
+      GzipHTTPBodyStream gzip_stream(
+          std::make_unique<StringHTTPBodyStream>(string), level, window_bits);
+      std::string compressed = ReadStream(&gzip_stream, 4096);
+      if (level == 0) {
+        EXPECT_GT(compressed.size(), string.size());
+      } else if (window_bits == 9) {
+        small_window_size = compressed.size();
+      } else {
+        // MakeString() repeats at intervals too long for a small window to
+        // find.
+        EXPECT_LT(compressed.size(), small_window_size / 2);
+      }
+
+      std::string decompressed;
+      ASSERT_NO_FATAL_FAILURE(
+          GzipInflate(compressed, &decompressed, string.size()));
+      EXPECT_EQ(decompressed, string);
+    }
+  }
+}
+
+TEST(GzipHTTPBodyStream, InvalidLevel) {
+  GzipHTTPBodyStream gzip_stream(
+      std::make_unique<StringHTTPBodyStream>("data"), 10, 15);
+  uint8_t buf[64];
+  EXPECT_EQ(gzip_stream.GetBytesBuffer(buf, sizeof(buf)), -1);
+}
+
+TEST(GzipHTTPBodyStream, Precompressed) {
+  const std::string prefix = MakeString(kFourKBytes);
+  const std::string precompressed_data = base::RandBytesAsString(kManyBytes);
+  const std::string compressible_data(kManyBytes, 'c');
+  const std::string suffix = "suffix";
+
+  StringFile uncompressed_file;
+  uncompressed_file.SetString(precompressed_data);
+  StringFile precompressed_file;
+  ASSERT_TRUE(GzipPrecompress(&uncompressed_file, &precompressed_file, 1, 15));
+  StringFile compressible_file;
+  compressible_file.SetString(compressible_data);
+  StringFile compressible_precompressed_file;
+  ASSERT_TRUE(GzipPrecompress(&compressible_file,
+                              &compressible_precompressed_file,
+                              GzipHTTPBodyStream::kDefaultLevel,
+                              9));
+  EXPECT_LT(compressible_precompressed_file.string().size(), kFourKBytes);
+
+  // Small reads make the flushes before the precompressed data span several
+  // calls.
+  for (size_t max_len : {size_t{1}, size_t{7}, size_t{32 * 1024}}) {
+    SCOPED_TRACE(::testing::Message() << "max_len " << max_len);
+    ASSERT_TRUE(precompressed_file.SeekSet(0));
+    ASSERT_TRUE(compressible_precompressed_file.SeekSet(0));
+
+    std::vector<GzipHTTPBodyStream::Source> sources;
+    sources.push_back(
+        {std::make_unique<StringHTTPBodyStream>(prefix), nullptr});
+    sources.push_back({nullptr, &precompressed_file});
+    sources.push_back({nullptr, &compressible_precompressed_file});
+    sources.push_back(
+        {std::make_unique<StringHTTPBodyStream>(prefix), nullptr});
+    sources.push_back(
+        {std::make_unique<StringHTTPBodyStream>(suffix), nullptr});
+    GzipHTTPBodyStream gzip_stream(std::move(sources),
+                                   GzipHTTPBodyStream::kDefaultLevel,
+                                   GzipHTTPBodyStream::kDefaultWindowBits);
+    std::string compressed = ReadStream(&gzip_stream, max_len);
+
+    const std::string expected =
+        prefix + precompressed_data + compressible_data + prefix + suffix;
+    std::string decompressed;
+    ASSERT_NO_FATAL_FAILURE(
+        GzipInflate(compressed, &decompressed, expected.size()));
+    EXPECT_EQ(decompressed, expected);
+  }
+}
+
+TEST(GzipHTTPBodyStream, Reset) {
+  const std::string prefix = MakeString(kFourKBytes);
+  const std::string precompressed_data = base::RandBytesAsString(kManyBytes);
+
+  StringFile uncompressed_file;
+  uncompressed_file.SetString(precompressed_data);
+  StringFile precompressed_file;
+  ASSERT_TRUE(GzipPrecompress(&uncompressed_file,
+                              &precompressed_file,
+                              GzipHTTPBodyStream::kDefaultLevel,
+                              GzipHTTPBodyStream::kDefaultWindowBits));
+  ASSERT_TRUE(precompressed_file.SeekSet(0));
+
+  std::vector<GzipHTTPBodyStream::Source> sources;
+  sources.push_back({std::make_unique<StringHTTPBodyStream>(prefix), nullptr});
+  sources.push_back({nullptr, &precompressed_file});
+  GzipHTTPBodyStream gzip_stream(std::move(sources),
+                                 GzipHTTPBodyStream::kDefaultLevel,
+                                 GzipHTTPBodyStream::kDefaultWindowBits);
+  const std::string compressed = ReadStream(&gzip_stream, 4096);
+
+  // Resetting the stream, whether at its end or partway through, reproduces
+  // the same output.
+  ASSERT_TRUE(gzip_stream.Reset());
+  uint8_t buf[16];
+  ASSERT_EQ(gzip_stream.GetBytesBuffer(buf, sizeof(buf)),
+            static_cast<FileOperationResult>(sizeof(buf)));
+  ASSERT_TRUE(gzip_stream.Reset());
+  EXPECT_EQ(ReadStream(&gzip_stream, 4096), compressed);
+  ASSERT_TRUE(gzip_stream.Reset());
+  EXPECT_EQ(ReadStream(&gzip_stream, 4096), compressed);
+
+  const std::string expected = prefix + precompressed_data;
+  std::string decompressed;
+  ASSERT_NO_FATAL_FAILURE(
+      GzipInflate(compressed, &decompressed, expected.size()));
+  EXPECT_EQ(decompressed, expected);
+}
+
+TEST(GzipHTTPBodyStream, OnlyPrecompressed) {
+  StringFile uncompressed_file;
+  StringFile precompressed_file;
+  ASSERT_TRUE(GzipPrecompress(&uncompressed_file,
+                              &precompressed_file,
+                              GzipHTTPBodyStream::kDefaultLevel,
+                              GzipHTTPBodyStream::kDefaultWindowBits));
+  ASSERT_TRUE(precompressed_file.SeekSet(0));
+
+  std::vector<GzipHTTPBodyStream::Source> sources;
+  sources.push_back({nullptr, &precompressed_file});
+  GzipHTTPBodyStream gzip_stream(std::move(sources),
+                                 GzipHTTPBodyStream::kDefaultLevel,
+                                 GzipHTTPBodyStream::kDefaultWindowBits);
+  std::string compressed = ReadStream(&gzip_stream, 4096);
+
+  std::string decompressed;
+  ASSERT_NO_FATAL_FAILURE(GzipInflate(compressed, &decompressed, 1));
+  EXPECT_TRUE(decompressed.empty());
+}
+
+TEST(GzipHTTPBodyStream, InvalidPrecompressed) {
+  StringFile precompressed_file;
+  precompressed_file.SetString(std::string(64, 'x'));
+
+  std::vector<GzipHTTPBodyStream::Source> sources;
+  sources.push_back({nullptr, &precompressed_file});
+  GzipHTTPBodyStream gzip_stream(std::move(sources),
+                                 GzipHTTPBodyStream::kDefaultLevel,
+                                 GzipHTTPBodyStream::kDefaultWindowBits);
+  uint8_t buf[4096];
+  EXPECT_EQ(gzip_stream.GetBytesBuffer(buf, sizeof(buf)), -1);
+}
+
+TEST(GzipHTTPBodyStream, PrecompressedInflate) {
+  for (size_t size : {size_t{0}, size_t{1}, size_t{100 * 1024}}) {
+    SCOPED_TRACE(size);
+    const std::string data = MakeString(size);
+    StringFile data_file;
+    data_file.SetString(data);
+    StringFile precompressed_file;
+    ASSERT_TRUE(GzipPrecompress(&data_file,
+                                &precompressed_file,
+                                GzipHTTPBodyStream::kDefaultLevel,
+                                GzipHTTPBodyStream::kDefaultWindowBits));
+
+    ASSERT_TRUE(precompressed_file.SeekSet(0));
+    EXPECT_TRUE(IsGzipPrecompressed(&precompressed_file));
+    EXPECT_EQ(precompressed_file.SeekGet(), 0);
+    EXPECT_FALSE(IsGzipPrecompressed(&data_file));
+
+    StringFile inflated_file;
+    ASSERT_TRUE(GzipPrecompressedInflate(&precompressed_file, &inflated_file));
+    EXPECT_EQ(inflated_file.string(), data);
+
+    // Corruption is detected by the CRC-32 check if not by zlib.
+    if (size > 0) {
+      std::string corrupt = precompressed_file.string();
+      corrupt[corrupt.size() / 2 + 12] ^= 1;
+      precompressed_file.SetString(corrupt);
+      inflated_file.Reset();
+      EXPECT_FALSE(
+          GzipPrecompressedInflate(&precompressed_file, &inflated_file));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace crashpad
@@ -16,6 +16,9 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <memory>
+
 #include "gtest/gtest.h"
 #include "test/test_paths.h"
 #include "util/misc/implicit_cast.h"
@@ -59,6 +62,27 @@ TEST(StringHTTPBodyStream, SmallString) {
   EXPECT_EQ(stream.GetBytesBuffer(buf, sizeof(buf)), 0);
 }
 
+TEST(StringHTTPBodyStream, DirectData) {
+  std::string string("Hello, world");
+  StringHTTPBodyStream stream(string);
+
+  uint8_t buf[5];
+  EXPECT_EQ(stream.GetBytesBuffer(buf, sizeof(buf)), 5);
+
+  HTTPBodyStream::DirectData direct;
+  ASSERT_TRUE(stream.GetDirectData(&direct));
+  ASSERT_NE(direct.data, nullptr);
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(direct.data),
+                        direct.size),
+            ", world");
+
+  ASSERT_TRUE(stream.SkipDirectData(2));
+  EXPECT_EQ(ReadStreamToString(&stream, 32), "world");
+
+  ASSERT_TRUE(stream.GetDirectData(&direct));
+  EXPECT_EQ(direct.size, 0u);
+}
+
 TEST(StringHTTPBodyStream, MultipleReads) {
   uint8_t buf[2];
   memset(buf, '!', sizeof(buf));
@@ -148,6 +172,36 @@ TEST(FileReaderHTTPBodyStream, ReadBinaryFile) {
   ExpectBufferSet(buf, '!', sizeof(buf));
 }
 
+TEST(FileReaderHTTPBodyStream, DirectData) {
+  base::FilePath path = TestPaths::TestDataRoot().Append(
+      FILE_PATH_LITERAL("util/net/testdata/ascii_http_body.txt"));
+
+  FileReader reader;
+  ASSERT_TRUE(reader.Open(path));
+
+  HTTPBodyStream::DirectData direct;
+  {
+    FileReaderHTTPBodyStream stream(&reader);
+    EXPECT_FALSE(stream.GetDirectData(&direct));
+  }
+
+  FileReaderHTTPBodyStream stream(&reader, reader.file_handle());
+  uint8_t buf[5];
+  EXPECT_EQ(stream.GetBytesBuffer(buf, sizeof(buf)), 5);
+
+  ASSERT_TRUE(stream.GetDirectData(&direct));
+  EXPECT_EQ(direct.data, nullptr);
+  EXPECT_EQ(direct.file, reader.file_handle());
+  EXPECT_EQ(direct.offset, 5);
+  EXPECT_EQ(direct.size, 11u);
+
+  ASSERT_TRUE(stream.SkipDirectData(5));
+  EXPECT_EQ(ReadStreamToString(&stream, 32), "test.\n");
+
+  ASSERT_TRUE(stream.GetDirectData(&direct));
+  EXPECT_EQ(direct.size, 0u);
+}
+
 TEST(CompositeHTTPBodyStream, TwoEmptyStrings) {
   std::vector<HTTPBodyStream*> parts;
   parts.push_back(new StringHTTPBodyStream(std::string()));
@@ -165,6 +219,70 @@ class CompositeHTTPBodyStreamBufferSize
     : public testing::TestWithParam<size_t> {
 };
 
+// Reads stream, using direct data where it is available and reading file data
+// described by it with a separate reader of the same file.
+std::string ReadStreamDirectToString(HTTPBodyStream* stream,
+                                     const base::FilePath& path,
+                                     size_t buffer_size) {
+  FileReader file_reader;
+  EXPECT_TRUE(file_reader.Open(path));
+
+  std::string string;
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[buffer_size]);
+  while (true) {
+    HTTPBodyStream::DirectData direct;
+    if (!stream->GetDirectData(&direct)) {
+      FileOperationResult bytes =
+          stream->GetBytesBuffer(buf.get(), buffer_size);
+      EXPECT_GE(bytes, 0);
+      if (bytes <= 0) {
+        break;
+      }
+      string.append(reinterpret_cast<char*>(buf.get()), bytes);
+      continue;
+    }
+    if (direct.size == 0) {
+      break;
+    }
+
+    size_t size = std::min(direct.size, buffer_size);
+    if (direct.data) {
+      string.append(reinterpret_cast<const char*>(direct.data), size);
+    } else {
+      EXPECT_TRUE(file_reader.SeekSet(direct.offset));
+      std::string file_data(size, '\0');
+      EXPECT_TRUE(file_reader.ReadExactly(&file_data[0], size));
+      string.append(file_data);
+    }
+    EXPECT_TRUE(stream->SkipDirectData(size));
+  }
+  return string;
+}
+
+TEST_P(CompositeHTTPBodyStreamBufferSize, DirectData) {
+  base::FilePath path = TestPaths::TestDataRoot().Append(
+      FILE_PATH_LITERAL("util/net/testdata/ascii_http_body.txt"));
+  FileReader direct_reader;
+  ASSERT_TRUE(direct_reader.Open(path));
+  FileReader reader;
+  ASSERT_TRUE(reader.Open(path));
+
+  std::vector<HTTPBodyStream*> parts;
+  parts.push_back(new StringHTTPBodyStream("Hello! "));
+  parts.push_back(new StringHTTPBodyStream(std::string()));
+  parts.push_back(new FileReaderHTTPBodyStream(&direct_reader,
+                                               direct_reader.file_handle()));
+  parts.push_back(new StringHTTPBodyStream(" and "));
+
+  // This part can only be read with GetBytesBuffer().
+  parts.push_back(new FileReaderHTTPBodyStream(&reader));
+  parts.push_back(new StringHTTPBodyStream(" Goodbye :)"));
+
+  CompositeHTTPBodyStream stream(parts);
+  EXPECT_EQ(ReadStreamDirectToString(&stream, path, GetParam()),
+            "Hello! This is a test.\n and This is a test.\n Goodbye :)");
+}
+
 TEST_P(CompositeHTTPBodyStreamBufferSize, ThreeStringParts) {
   std::string string1("crashpad");
   std::string string2("test");
@@ -207,6 +325,31 @@ TEST_P(CompositeHTTPBodyStreamBufferSize, StringsAndFile) {
   EXPECT_EQ(actual_string, expected_string);
 }
 
+TEST_P(CompositeHTTPBodyStreamBufferSize, Reset) {
+  base::FilePath path = TestPaths::TestDataRoot().Append(
+      FILE_PATH_LITERAL("util/net/testdata/ascii_http_body.txt"));
+  FileReader direct_reader;
+  ASSERT_TRUE(direct_reader.Open(path));
+  FileReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  ASSERT_TRUE(reader.SeekSet(5));
+
+  std::vector<HTTPBodyStream*> parts;
+  parts.push_back(new StringHTTPBodyStream("Hello! "));
+  parts.push_back(new FileReaderHTTPBodyStream(&direct_reader,
+                                               direct_reader.file_handle()));
+  parts.push_back(new FileReaderHTTPBodyStream(&reader));
+
+  // A file is sent again from where it was first read, not from its start.
+  CompositeHTTPBodyStream stream(parts);
+  const std::string expected = "Hello! This is a test.\nis a test.\n";
+  EXPECT_EQ(ReadStreamDirectToString(&stream, path, GetParam()), expected);
+  ASSERT_TRUE(stream.Reset());
+  EXPECT_EQ(ReadStreamToString(&stream, GetParam()), expected);
+  ASSERT_TRUE(stream.Reset());
+  EXPECT_EQ(ReadStreamDirectToString(&stream, path, GetParam()), expected);
+}
+
 INSTANTIATE_TEST_SUITE_P(VariableBufferSize,
                          CompositeHTTPBodyStreamBufferSize,
                          testing::Values(1, 2, 9, 16, 31, 128, 1024));
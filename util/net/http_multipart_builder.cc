@@ -14,9 +14,12 @@
 
 #include "util/net/http_multipart_builder.h"
 
+#include <inttypes.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
@@ -96,6 +99,35 @@ std::string GetFormDataBoundary(const std::string& boundary,
       EncodeMIMEField(name).c_str());
 }
 
+// Returns a form-data part holding value at name.
+std::string GetFormDataPart(const std::string& boundary,
+                            const std::string& name,
+                            const std::string& value) {
+  std::string field = GetFormDataBoundary(boundary, name);
+  field += kBoundaryCRLF;
+  field += value;
+  field += kCRLF;
+  return field;
+}
+
+// Returns the headers of a file attachment part, after which the file’s
+// contents and a CRLF are appended.
+std::string GetFileAttachmentHeader(const std::string& boundary,
+                                    const std::string& name,
+                                    const std::string& filename,
+                                    const std::string& content_type) {
+  std::string header = GetFormDataBoundary(boundary, name);
+  header += base::StringPrintf("; filename=\"%s\"%s",
+      filename.c_str(), kCRLF);
+  header += base::StringPrintf("Content-Type: %s%s",
+      content_type.c_str(), kBoundaryCRLF);
+  return header;
+}
+
+std::string GetFinalBoundary(const std::string& boundary) {
+  return "--" + boundary + "--" + kCRLF;
+}
+
 void AssertSafeMIMEType(const std::string& string) {
   for (size_t i = 0; i < string.length(); ++i) {
     char c = string[i];
@@ -116,6 +148,8 @@ HTTPMultipartBuilder::HTTPMultipartBuilder()
     : boundary_(GenerateBoundaryString()),
       form_data_(),
       file_attachments_(),
+      gzip_level_(GzipHTTPBodyStream::kDefaultLevel),
+      gzip_window_bits_(GzipHTTPBodyStream::kDefaultWindowBits),
       gzip_enabled_(false) {}
 
 HTTPMultipartBuilder::~HTTPMultipartBuilder() {
@@ -125,6 +159,11 @@ void HTTPMultipartBuilder::SetGzipEnabled(bool gzip_enabled) {
   gzip_enabled_ = gzip_enabled;
 }
 
+void HTTPMultipartBuilder::SetGzipCompression(int level, int window_bits) {
+  gzip_level_ = level;
+  gzip_window_bits_ = window_bits;
+}
+
 void HTTPMultipartBuilder::SetFormData(const std::string& key,
                                        const std::string& value) {
   EraseKey(key);
@@ -136,20 +175,27 @@ void HTTPMultipartBuilder::SetFileAttachment(
     const std::string& upload_file_name,
     FileReaderInterface* reader,
     const std::string& content_type) {
-  EraseKey(upload_file_name);
+  SetFileAttachmentWithFile(
+      key, upload_file_name, reader, kInvalidFileHandle, content_type);
+}
 
-  FileAttachment attachment;
-  attachment.filename = EncodeMIMEField(upload_file_name);
-  attachment.reader = reader;
+void HTTPMultipartBuilder::SetFileAttachment(
+    const std::string& key,
+    const std::string& upload_file_name,
+    FileReader* reader,
+    const std::string& content_type) {
+  SetFileAttachmentWithFile(
+      key, upload_file_name, reader, reader->file_handle(), content_type);
+}
 
-  if (content_type.empty()) {
-    attachment.content_type = "application/octet-stream";
-  } else {
-    AssertSafeMIMEType(content_type);
-    attachment.content_type = content_type;
+void HTTPMultipartBuilder::SetPrecompressedFileAttachment(
+    const std::string& key,
+    FileReaderInterface* precompressed_reader) {
+  auto it = file_attachments_.find(key);
+  DCHECK(it != file_attachments_.end());
+  if (it != file_attachments_.end()) {
+    it->second.precompressed_reader = precompressed_reader;
   }
-
-  file_attachments_[key] = attachment;
 }
 
 std::unique_ptr<HTTPBodyStream> HTTPMultipartBuilder::GetBodyStream() {
@@ -158,35 +204,43 @@ std::unique_ptr<HTTPBodyStream> HTTPMultipartBuilder::GetBodyStream() {
   // this memory.
   std::vector<HTTPBodyStream*> streams;
 
+  // When compressing, the parts are gathered into runs separated by
+  // precompressed attachments, each of which is a source for the
+  // GzipHTTPBodyStream.
+  std::vector<GzipHTTPBodyStream::Source> gzip_sources;
+
   for (const auto& pair : form_data_) {
-    std::string field = GetFormDataBoundary(boundary_, pair.first);
-    field += kBoundaryCRLF;
-    field += pair.second;
-    field += kCRLF;
-    streams.push_back(new StringHTTPBodyStream(field));
+    streams.push_back(new StringHTTPBodyStream(
+        GetFormDataPart(boundary_, pair.first, pair.second)));
   }
 
   for (const auto& pair : file_attachments_) {
     const FileAttachment& attachment = pair.second;
-    std::string header = GetFormDataBoundary(boundary_, pair.first);
-    header += base::StringPrintf("; filename=\"%s\"%s",
-        attachment.filename.c_str(), kCRLF);
-    header += base::StringPrintf("Content-Type: %s%s",
-        attachment.content_type.c_str(), kBoundaryCRLF);
-
-    streams.push_back(new StringHTTPBodyStream(header));
-    streams.push_back(new FileReaderHTTPBodyStream(attachment.reader));
+    streams.push_back(new StringHTTPBodyStream(
+        GetFileAttachmentHeader(boundary_,
+                                pair.first,
+                                attachment.filename,
+                                attachment.content_type)));
+    if (gzip_enabled_ && attachment.precompressed_reader) {
+      gzip_sources.push_back(
+          {std::make_unique<CompositeHTTPBodyStream>(streams), nullptr});
+      gzip_sources.push_back({nullptr, attachment.precompressed_reader});
+      streams.clear();
+    } else {
+      streams.push_back(
+          new FileReaderHTTPBodyStream(attachment.reader, attachment.file));
+    }
     streams.push_back(new StringHTTPBodyStream(kCRLF));
   }
 
-  streams.push_back(
-      new StringHTTPBodyStream("--"  + boundary_ + "--" + kCRLF));
+  streams.push_back(new StringHTTPBodyStream(GetFinalBoundary(boundary_)));
 
   auto composite =
       std::unique_ptr<HTTPBodyStream>(new CompositeHTTPBodyStream(streams));
   if (gzip_enabled_) {
-    return std::unique_ptr<HTTPBodyStream>(
-        new GzipHTTPBodyStream(std::move(composite)));
+    gzip_sources.push_back({std::move(composite), nullptr});
+    return std::unique_ptr<HTTPBodyStream>(new GzipHTTPBodyStream(
+        std::move(gzip_sources), gzip_level_, gzip_window_bits_));
   }
   return composite;
 }
@@ -199,7 +253,71 @@ void HTTPMultipartBuilder::PopulateContentHeaders(
 
   if (gzip_enabled_) {
     (*http_headers)[kContentEncoding] = "gzip";
+    return;
+  }
+
+  // A known length allows the body to be sent without chunked encoding, and
+  // so allows file attachments to be sent directly from their files.
+  uint64_t content_length;
+  if (GetContentLength(&content_length)) {
+    (*http_headers)[kContentLength] =
+        base::StringPrintf("%" PRIu64, content_length);
+  }
+}
+
+void HTTPMultipartBuilder::SetFileAttachmentWithFile(
+    const std::string& key,
+    const std::string& upload_file_name,
+    FileReaderInterface* reader,
+    FileHandle file,
+    const std::string& content_type) {
+  EraseKey(upload_file_name);
+
+  FileAttachment attachment;
+  attachment.filename = EncodeMIMEField(upload_file_name);
+  attachment.reader = reader;
+  attachment.file = file;
+  attachment.precompressed_reader = nullptr;
+
+  if (content_type.empty()) {
+    attachment.content_type = "application/octet-stream";
+  } else {
+    AssertSafeMIMEType(content_type);
+    attachment.content_type = content_type;
+  }
+
+  file_attachments_[key] = attachment;
+}
+
+bool HTTPMultipartBuilder::GetContentLength(uint64_t* content_length) const {
+  uint64_t length = 0;
+  for (const auto& pair : form_data_) {
+    length += GetFormDataPart(boundary_, pair.first, pair.second).size();
   }
+
+  for (const auto& pair : file_attachments_) {
+    const FileAttachment& attachment = pair.second;
+    FileOffset start = attachment.reader->SeekGet();
+    if (start < 0) {
+      return false;
+    }
+    FileOffset end = attachment.reader->Seek(0, SEEK_END);
+    if (end < 0 || !attachment.reader->SeekSet(start)) {
+      return false;
+    }
+
+    length += GetFileAttachmentHeader(boundary_,
+                                      pair.first,
+                                      attachment.filename,
+                                      attachment.content_type)
+                  .size();
+    length += std::max(end - start, FileOffset{0});
+    length += strlen(kCRLF);
+  }
+
+  length += GetFinalBoundary(boundary_).size();
+  *content_length = length;
+  return true;
 }
 
 void HTTPMultipartBuilder::EraseKey(const std::string& key) {
@@ -15,11 +15,14 @@
 #ifndef CRASHPAD_UTIL_NET_HTTP_MULTIPART_BUILDER_H_
 #define CRASHPAD_UTIL_NET_HTTP_MULTIPART_BUILDER_H_
 
+#include <stdint.h>
+
 #include <map>
 #include <memory>
 #include <string>
 
 #include "base/macros.h"
+#include "util/file/file_io.h"
 #include "util/file/file_reader.h"
 #include "util/net/http_headers.h"
 
@@ -43,6 +46,15 @@ class HTTPMultipartBuilder {
   //! PopulateContentHeaders() will contain `Content-Encoding: gzip`.
   void SetGzipEnabled(bool gzip_enabled);
 
+  //! \brief Sets the parameters used for `gzip` compression, when it is
+  //!     enabled.
+  //!
+  //! \param[in] level The `zlib` compression level, from `0` to `9`, or
+  //!     GzipHTTPBodyStream::kDefaultLevel.
+  //! \param[in] window_bits The base-2 logarithm of the `zlib` window size,
+  //!     from `9` to `15`.
+  void SetGzipCompression(int level, int window_bits);
+
   //! \brief Sets a `Content-Disposition: form-data` key-value pair.
   //!
   //! \param[in] key The key of the form data, specified as the `name` in the
@@ -68,6 +80,34 @@ class HTTPMultipartBuilder {
                          FileReaderInterface* reader,
                          const std::string& content_type);
 
+  //! \brief Specifies the contents of the file read by \a reader to be
+  //!     uploaded as multipart data, available at `name` of \a
+  //!     upload_file_name.
+  //!
+  //! This behaves like the FileReaderInterface overload, except that when the
+  //! body is not `gzip`-compressed, transports that support it may send the
+  //! contents directly from the file that \a reader reads, without copying
+  //! them through a buffer.
+  void SetFileAttachment(const std::string& key,
+                         const std::string& upload_file_name,
+                         FileReader* reader,
+                         const std::string& content_type);
+
+  //! \brief Provides the contents of a file attachment compressed in advance
+  //!     by GzipPrecompress().
+  //!
+  //! When `gzip` compression is enabled, the data read from \a
+  //! precompressed_reader is used for the attachment instead of compressing the
+  //! contents read from the attachment’s own reader again.
+  //!
+  //! \param[in] key The key of a file attachment previously set by
+  //!     SetFileAttachment().
+  //! \param[in] precompressed_reader A FileReaderInterface positioned at the
+  //!     start of the precompressed data.
+  void SetPrecompressedFileAttachment(
+      const std::string& key,
+      FileReaderInterface* precompressed_reader);
+
   //! \brief Generates the HTTPBodyStream for the data currently supplied to
   //!     the builder.
   //!
@@ -77,7 +117,9 @@ class HTTPMultipartBuilder {
   //! \brief Adds the appropriate content headers to \a http_headers.
   //!
   //! Any headers that this method adds will replace existing headers by the
-  //! same name in \a http_headers.
+  //! same name in \a http_headers. When `gzip` compression is not enabled and
+  //! the size of every file attachment can be determined, this includes
+  //! `Content-Length`, which must be set before the body stream is read.
   void PopulateContentHeaders(HTTPHeaders* http_headers) const;
 
  private:
@@ -85,8 +127,20 @@ class HTTPMultipartBuilder {
     std::string filename;
     std::string content_type;
     FileReaderInterface* reader;
+    FileHandle file;
+    FileReaderInterface* precompressed_reader;
   };
 
+  void SetFileAttachmentWithFile(const std::string& key,
+                                 const std::string& upload_file_name,
+                                 FileReaderInterface* reader,
+                                 FileHandle file,
+                                 const std::string& content_type);
+
+  // Computes the length of the uncompressed body, returning false if the size
+  // of any file attachment can’t be determined.
+  bool GetContentLength(uint64_t* content_length) const;
+
   // Removes elements from both data maps at the specified |key|, to ensure
   // uniqueness across the entire HTTP body.
   void EraseKey(const std::string& key);
@@ -94,6 +148,8 @@ class HTTPMultipartBuilder {
   std::string boundary_;
   std::map<std::string, std::string> form_data_;
   std::map<std::string, FileAttachment> file_attachments_;
+  int gzip_level_;
+  int gzip_window_bits_;
   bool gzip_enabled_;
 
   DISALLOW_COPY_AND_ASSIGN(HTTPMultipartBuilder);
@@ -16,12 +16,22 @@
 
 #include <sys/types.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "base/format_macros.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/rand_util.h"
+#include "base/strings/stringprintf.h"
 #include "gtest/gtest.h"
 #include "test/gtest_death.h"
 #include "test/test_paths.h"
+#include "third_party/zlib/zlib_crashpad.h"
+#include "util/file/string_file.h"
+#include "util/misc/zlib.h"
 #include "util/net/http_body.h"
+#include "util/net/http_body_gzip.h"
 #include "util/net/http_body_test_util.h"
 
 namespace crashpad {
@@ -278,6 +288,99 @@ TEST(HTTPMultipartBuilder, SharedFormDataAndAttachmentKeyNamespace) {
   EXPECT_EQ(lines_it, lines.end());
 }
 
+// Decompresses gzip-compressed data.
+std::string GzipInflate(const std::string& compressed) {
+  z_stream zlib = {};
+  int zr = inflateInit2(&zlib, ZlibWindowBitsWithGzipWrapper(0));
+  EXPECT_EQ(zr, Z_OK) << "inflateInit2: " << ZlibErrorString(zr);
+
+  zlib.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(&compressed[0]));
+  zlib.avail_in = base::checked_cast<uInt>(compressed.size());
+
+  std::string decompressed;
+  do {
+    uint8_t buf[4096];
+    zlib.next_out = buf;
+    zlib.avail_out = sizeof(buf);
+    zr = inflate(&zlib, Z_NO_FLUSH);
+    decompressed.append(reinterpret_cast<char*>(buf),
+                        sizeof(buf) - zlib.avail_out);
+  } while (zr == Z_OK);
+  EXPECT_EQ(zr, Z_STREAM_END) << "inflate: " << ZlibErrorString(zr);
+
+  zr = inflateEnd(&zlib);
+  EXPECT_EQ(zr, Z_OK) << "inflateEnd: " << ZlibErrorString(zr);
+  return decompressed;
+}
+
+TEST(HTTPMultipartBuilder, ContentLength) {
+  base::FilePath ascii_http_body_path = TestPaths::TestDataRoot().Append(
+      FILE_PATH_LITERAL("util/net/testdata/ascii_http_body.txt"));
+  FileReader reader;
+  ASSERT_TRUE(reader.Open(ascii_http_body_path));
+  StringFile string_file;
+  string_file.SetString(std::string(1000, 's'));
+
+  HTTPMultipartBuilder builder;
+  builder.SetFormData("key", "value");
+  builder.SetFileAttachment("file", "file.txt", &reader, "text/plain");
+  builder.SetFileAttachment("string", "string.dat", &string_file, "");
+
+  HTTPHeaders headers;
+  builder.PopulateContentHeaders(&headers);
+  ASSERT_EQ(headers.count(kContentLength), 1u);
+  EXPECT_EQ(headers.count(kContentEncoding), 0u);
+
+  std::unique_ptr<HTTPBodyStream> body(builder.GetBodyStream());
+  ASSERT_TRUE(body.get());
+  std::string contents = ReadStreamToString(body.get());
+  EXPECT_EQ(headers[kContentLength],
+            base::StringPrintf("%" PRIuS, contents.size()));
+
+  HTTPMultipartBuilder gzip_builder;
+  gzip_builder.SetGzipEnabled(true);
+  HTTPHeaders gzip_headers;
+  gzip_builder.PopulateContentHeaders(&gzip_headers);
+  EXPECT_EQ(gzip_headers.count(kContentLength), 0u);
+  EXPECT_EQ(gzip_headers[kContentEncoding], "gzip");
+}
+
+TEST(HTTPMultipartBuilder, PrecompressedFileAttachment) {
+  const std::string attachment_data = base::RandBytesAsString(100000);
+  StringFile attachment_file;
+  attachment_file.SetString(attachment_data);
+  StringFile precompressed_file;
+  ASSERT_TRUE(GzipPrecompress(&attachment_file, &precompressed_file, 1, 15));
+  ASSERT_TRUE(attachment_file.SeekSet(0));
+  ASSERT_TRUE(precompressed_file.SeekSet(0));
+
+  StringFile other_file;
+  other_file.SetString("other");
+
+  HTTPMultipartBuilder builder;
+  builder.SetFormData("key", "value");
+  builder.SetFileAttachment("attachment", "a.dmp", &attachment_file, "");
+  builder.SetPrecompressedFileAttachment("attachment", &precompressed_file);
+  builder.SetFileAttachment("other", "other.txt", &other_file, "text/plain");
+  builder.SetGzipEnabled(true);
+  builder.SetGzipCompression(9, 12);
+
+  std::unique_ptr<HTTPBodyStream> gzip_body(builder.GetBodyStream());
+  ASSERT_TRUE(gzip_body.get());
+  std::string gzip_contents = GzipInflate(ReadStreamToString(gzip_body.get()));
+
+  // The precompressed data was used, and the attachment wasn’t read.
+  EXPECT_EQ(attachment_file.SeekGet(), 0);
+
+  ASSERT_TRUE(other_file.SeekSet(0));
+  builder.SetGzipEnabled(false);
+  std::unique_ptr<HTTPBodyStream> body(builder.GetBodyStream());
+  ASSERT_TRUE(body.get());
+  std::string contents = ReadStreamToString(body.get());
+  EXPECT_NE(contents.find(attachment_data), std::string::npos);
+  EXPECT_EQ(gzip_contents, contents);
+}
+
 TEST(HTTPMultipartBuilderDeathTest, AssertUnsafeMIMEType) {
   HTTPMultipartBuilder builder;
   FileReader reader;
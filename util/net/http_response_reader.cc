@@ -0,0 +1,332 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/net/http_response_reader.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+
+namespace crashpad {
+
+namespace {
+
+// The size of the receive buffer. A status line or header line must fit in it.
+constexpr size_t kBufferSize = 16 * 1024;
+
+bool EqualsCaseInsensitive(const std::string& left, const char* right) {
+  const size_t right_length = strlen(right);
+  if (left.size() != right_length) {
+    return false;
+  }
+  for (size_t index = 0; index < right_length; ++index) {
+    if (tolower(static_cast<unsigned char>(left[index])) !=
+        tolower(static_cast<unsigned char>(right[index]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Removes leading and trailing spaces and tabs from value.
+std::string TrimWhitespace(const std::string& value) {
+  const size_t begin = value.find_first_not_of(" \t");
+  if (begin == std::string::npos) {
+    return std::string();
+  }
+  const size_t end = value.find_last_not_of(" \t");
+  return value.substr(begin, end - begin + 1);
+}
+
+bool ParseChunkSize(const std::string& line, size_t* size) {
+  // Chunk extensions, following a semicolon, are ignored.
+  const std::string hex = TrimWhitespace(line.substr(0, line.find(';')));
+  if (hex.empty()) {
+    return false;
+  }
+
+  size_t result = 0;
+  for (char c : hex) {
+    unsigned int digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    if (result > (std::numeric_limits<size_t>::max() >> 4)) {
+      return false;
+    }
+    result = (result << 4) | digit;
+  }
+
+  *size = result;
+  return true;
+}
+
+}  // namespace
+
+HTTPResponseReader::Response::Response()
+    : status(0), headers(), body(), keep_alive(false) {}
+
+HTTPResponseReader::Response::~Response() {}
+
+HTTPResponseReader::HTTPResponseReader(Source* source)
+    : source_(source),
+      buffer_(new char[kBufferSize]),
+      buffer_start_(0),
+      buffer_end_(0),
+      received_response_data_(false) {}
+
+HTTPResponseReader::~HTTPResponseReader() {}
+
+bool HTTPResponseReader::ReadResponse(Response* response) {
+  response->headers.clear();
+  response->body.clear();
+  response->keep_alive = false;
+  received_response_data_ = HasBufferedData();
+
+  bool http11;
+  do {
+    response->headers.clear();
+    if (!ReadStatusLine(&response->status, &http11) ||
+        !ReadHeaders(&response->headers)) {
+      return false;
+    }
+  } while (response->status >= 100 && response->status < 200);
+
+  std::string connection;
+  const bool server_keeps_alive =
+      http11 && !(FindHeader(response->headers, "Connection", &connection) &&
+                  EqualsCaseInsensitive(connection, "close"));
+
+  // These responses never have a body, whatever their headers say.
+  if (response->status == 204 || response->status == 304) {
+    response->keep_alive = server_keeps_alive;
+    return true;
+  }
+
+  std::string value;
+  if (FindHeader(response->headers, "Transfer-Encoding", &value) &&
+      EqualsCaseInsensitive(value, "chunked")) {
+    if (!ReadChunkedBody(&response->body)) {
+      return false;
+    }
+    response->keep_alive = server_keeps_alive;
+    return true;
+  }
+
+  if (FindHeader(response->headers, "Content-Length", &value)) {
+    size_t content_length;
+    if (!base::StringToSizeT(value, &content_length)) {
+      LOG(ERROR) << "invalid Content-Length";
+      return false;
+    }
+    if (!ReadExactly(content_length, &response->body)) {
+      return false;
+    }
+    response->keep_alive = server_keeps_alive;
+    return true;
+  }
+
+  return ReadToEOF(&response->body);
+}
+
+// static
+bool HTTPResponseReader::FindHeader(const HTTPHeaders& headers,
+                                    const char* name,
+                                    std::string* value) {
+  for (const auto& header : headers) {
+    if (EqualsCaseInsensitive(header.first, name)) {
+      *value = header.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HTTPResponseReader::ReadLine(std::string* line) {
+  size_t search_start = buffer_start_;
+  for (;;) {
+    const char* begin = buffer_.get() + buffer_start_;
+    const char* search = buffer_.get() + search_start;
+    const char* end = buffer_.get() + buffer_end_;
+    const char* newline = std::find(search, end, '\n');
+    if (newline != end) {
+      const char* line_end = newline;
+      if (line_end != begin && line_end[-1] == '\r') {
+        --line_end;
+      }
+      line->assign(begin, line_end);
+      buffer_start_ = newline + 1 - buffer_.get();
+      return true;
+    }
+
+    if (buffer_start_ == 0 && buffer_end_ == kBufferSize) {
+      LOG(ERROR) << "line too long";
+      return false;
+    }
+
+    // Fill() moves the unconsumed data to the start of the buffer.
+    search_start = buffer_end_ - buffer_start_;
+    FileOperationResult bytes_read = Fill();
+    if (bytes_read <= 0) {
+      if (bytes_read == 0) {
+        LOG(ERROR) << "unexpected end of response";
+      }
+      return false;
+    }
+  }
+}
+
+bool HTTPResponseReader::ReadExactly(size_t size, std::string* data) {
+  if (size > kMaxBodySize - data->size()) {
+    LOG(ERROR) << "response body too large";
+    return false;
+  }
+
+  const size_t buffered = std::min(size, buffer_end_ - buffer_start_);
+  data->append(buffer_.get() + buffer_start_, buffered);
+  buffer_start_ += buffered;
+
+  // Anything more is read directly into data, rather than through the buffer.
+  size_t offset = data->size();
+  data->resize(offset + size - buffered);
+  while (offset < data->size()) {
+    FileOperationResult bytes_read =
+        source_->ReadUpTo(&(*data)[offset], data->size() - offset);
+    if (bytes_read <= 0) {
+      if (bytes_read == 0) {
+        LOG(ERROR) << "unexpected end of response";
+      }
+      return false;
+    }
+    offset += bytes_read;
+  }
+  return true;
+}
+
+bool HTTPResponseReader::ReadToEOF(std::string* data) {
+  data->append(buffer_.get() + buffer_start_, buffer_end_ - buffer_start_);
+  buffer_start_ = buffer_end_ = 0;
+
+  FileOperationResult bytes_read;
+  while ((bytes_read = source_->ReadUpTo(buffer_.get(), kBufferSize)) > 0) {
+    if (static_cast<size_t>(bytes_read) > kMaxBodySize - data->size()) {
+      LOG(ERROR) << "response body too large";
+      return false;
+    }
+    data->append(buffer_.get(), bytes_read);
+  }
+  return bytes_read == 0;
+}
+
+bool HTTPResponseReader::ReadStatusLine(unsigned int* status, bool* http11) {
+  std::string line;
+  if (!ReadLine(&line)) {
+    return false;
+  }
+
+  // “HTTP/1.x ddd”, optionally followed by a space and a reason phrase.
+  static constexpr char kHTTP10[] = "HTTP/1.0 ";
+  static constexpr char kHTTP11[] = "HTTP/1.1 ";
+  constexpr size_t kVersionLength = sizeof(kHTTP10) - 1;
+  *http11 = line.compare(0, kVersionLength, kHTTP11) == 0;
+  if ((!*http11 && line.compare(0, kVersionLength, kHTTP10) != 0) ||
+      line.size() < kVersionLength + 3 ||
+      (line.size() > kVersionLength + 3 && line[kVersionLength + 3] != ' ') ||
+      !base::StringToUint(line.substr(kVersionLength, 3), status)) {
+    LOG(ERROR) << "invalid status line";
+    return false;
+  }
+
+  return true;
+}
+
+bool HTTPResponseReader::ReadHeaders(HTTPHeaders* headers) {
+  for (;;) {
+    std::string line;
+    if (!ReadLine(&line)) {
+      return false;
+    }
+
+    if (line.empty()) {
+      return true;
+    }
+
+    const size_t colon = line.find(':');
+    if (colon == 0 || colon == std::string::npos) {
+      LOG(ERROR) << "invalid header";
+      return false;
+    }
+    (*headers)[line.substr(0, colon)] = TrimWhitespace(line.substr(colon + 1));
+  }
+}
+
+bool HTTPResponseReader::ReadChunkedBody(std::string* body) {
+  for (;;) {
+    std::string line;
+    if (!ReadLine(&line)) {
+      return false;
+    }
+
+    size_t chunk_size;
+    if (!ParseChunkSize(line, &chunk_size)) {
+      LOG(ERROR) << "invalid chunk size";
+      return false;
+    }
+
+    if (chunk_size == 0) {
+      // Any trailer fields are discarded.
+      HTTPHeaders trailers;
+      return ReadHeaders(&trailers);
+    }
+
+    if (!ReadExactly(chunk_size, body) || !ReadLine(&line)) {
+      return false;
+    }
+    if (!line.empty()) {
+      LOG(ERROR) << "invalid chunk";
+      return false;
+    }
+  }
+}
+
+FileOperationResult HTTPResponseReader::Fill() {
+  if (buffer_start_ != 0) {
+    memmove(buffer_.get(),
+            buffer_.get() + buffer_start_,
+            buffer_end_ - buffer_start_);
+    buffer_end_ -= buffer_start_;
+    buffer_start_ = 0;
+  }
+
+  FileOperationResult bytes_read =
+      source_->ReadUpTo(buffer_.get() + buffer_end_, kBufferSize - buffer_end_);
+  if (bytes_read > 0) {
+    buffer_end_ += bytes_read;
+    received_response_data_ = true;
+  }
+  return bytes_read;
+}
+
+}  // namespace crashpad
@@ -0,0 +1,145 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_UTIL_NET_HTTP_RESPONSE_READER_H_
+#define CRASHPAD_UTIL_NET_HTTP_RESPONSE_READER_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+#include "base/macros.h"
+#include "util/file/file_io.h"
+#include "util/net/http_headers.h"
+
+namespace crashpad {
+
+//! \brief Reads HTTP/1.0 and HTTP/1.1 responses from a connection.
+//!
+//! Data is received into a buffer, from which the status line, headers, and
+//! body are parsed, so that a small number of reads from the connection serves
+//! each response. Bodies delimited by `Content-Length`, by chunked transfer
+//! encoding, or by the end of the connection are supported.
+//!
+//! Data received beyond the end of one response is kept for the next call to
+//! ReadResponse(), so several responses may be read in turn from a kept-alive
+//! connection, including responses to pipelined requests.
+class HTTPResponseReader {
+ public:
+  //! \brief The connection that responses are read from.
+  class Source {
+   public:
+    virtual ~Source() {}
+
+    //! \brief Reads up to \a size bytes into \a data.
+    //!
+    //! \return The number of bytes read, `0` at the end of the connection, or
+    //!     `-1` on failure with a message logged.
+    virtual FileOperationResult ReadUpTo(void* data, size_t size) = 0;
+  };
+
+  //! \brief The largest response body that ReadResponse() will accept.
+  //!
+  //! A response whose body is larger, by its `Content-Length`, its chunk
+  //! sizes, or the data received before the end of the connection, fails
+  //! before the body is read.
+  static constexpr size_t kMaxBodySize = 16 * 1024 * 1024;
+
+  //! \brief A response read by ReadResponse().
+  struct Response {
+    Response();
+    ~Response();
+
+    //! \brief The status code, such as `200`.
+    unsigned int status;
+
+    //! \brief The response headers, named as the server sent them.
+    HTTPHeaders headers;
+
+    //! \brief The response body, without any transfer encoding.
+    std::string body;
+
+    //! \brief Whether the connection may be used for another request. This is
+    //!     `true` for an HTTP/1.1 response that doesn’t close the connection
+    //!     and whose body wasn’t delimited by the end of the connection.
+    bool keep_alive;
+  };
+
+  //! \param[in] source The connection to read from. Weak.
+  explicit HTTPResponseReader(Source* source);
+  ~HTTPResponseReader();
+
+  //! \brief Reads the next complete response.
+  //!
+  //! Interim (`1xx`) responses are skipped.
+  //!
+  //! \param[out] response The response that was read.
+  //!
+  //! \return `true` on success, `false` on failure with a message logged. After
+  //!     a failure, no further responses can be read.
+  bool ReadResponse(Response* response);
+
+  //! \return `true` if data has been received beyond the end of the last
+  //!     response read.
+  bool HasBufferedData() const { return buffer_start_ != buffer_end_; }
+
+  //! \return `true` if any part of a response was received during the last
+  //!     call to ReadResponse(), even if it then failed.
+  bool ReceivedResponseData() const { return received_response_data_; }
+
+  //! \brief Finds a header by name, ignoring case as HTTP does.
+  //!
+  //! \param[in] headers The headers to search.
+  //! \param[in] name The name of the header to find.
+  //! \param[out] value The value of the header, if found.
+  //!
+  //! \return `true` if the header was found.
+  static bool FindHeader(const HTTPHeaders& headers,
+                         const char* name,
+                         std::string* value);
+
+ private:
+  // Reads a line, not including its terminating CRLF or LF, into line.
+  bool ReadLine(std::string* line);
+
+  // Reads exactly size bytes, appending them to data, unless data would then
+  // be larger than kMaxBodySize.
+  bool ReadExactly(size_t size, std::string* data);
+
+  // Reads until the end of the connection, appending the data to data, unless
+  // data would then be larger than kMaxBodySize.
+  bool ReadToEOF(std::string* data);
+
+  bool ReadStatusLine(unsigned int* status, bool* http11);
+  bool ReadHeaders(HTTPHeaders* headers);
+  bool ReadChunkedBody(std::string* body);
+
+  // Reads more data into the buffer, moving any unconsumed data to the start
+  // of the buffer first. Returns the number of bytes read, 0 at the end of the
+  // connection, or -1 on failure with a message logged.
+  FileOperationResult Fill();
+
+  Source* source_;  // weak
+  std::unique_ptr<char[]> buffer_;
+  size_t buffer_start_;
+  size_t buffer_end_;
+  bool received_response_data_;
+
+  DISALLOW_COPY_AND_ASSIGN(HTTPResponseReader);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_UTIL_NET_HTTP_RESPONSE_READER_H_
@@ -0,0 +1,262 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/net/http_response_reader.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "base/strings/stringprintf.h"
+#include "gtest/gtest.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+// A connection that delivers a fixed string, at most max_read_size bytes at a
+// time.
+class StringSource : public HTTPResponseReader::Source {
+ public:
+  StringSource(const std::string& data, size_t max_read_size)
+      : data_(data), offset_(0), max_read_size_(max_read_size), reads_(0) {}
+
+  ~StringSource() override {}
+
+  size_t Reads() const { return reads_; }
+
+  // HTTPResponseReader::Source:
+  FileOperationResult ReadUpTo(void* data, size_t size) override {
+    ++reads_;
+    size = std::min(std::min(size, max_read_size_), data_.size() - offset_);
+    memcpy(data, data_.data() + offset_, size);
+    offset_ += size;
+    return size;
+  }
+
+ private:
+  std::string data_;
+  size_t offset_;
+  size_t max_read_size_;
+  size_t reads_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringSource);
+};
+
+// The largest read size, and one that splits lines and bodies across reads.
+constexpr size_t kReadSizes[] = {1 << 20, 3};
+
+TEST(HTTPResponseReader, ContentLength) {
+  for (size_t read_size : kReadSizes) {
+    SCOPED_TRACE(read_size);
+    StringSource source(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "content-length:  5 \r\n"
+        "\r\n"
+        "hello",
+        read_size);
+    HTTPResponseReader reader(&source);
+
+    HTTPResponseReader::Response response;
+    ASSERT_TRUE(reader.ReadResponse(&response));
+    EXPECT_EQ(response.status, 200u);
+    EXPECT_EQ(response.headers["Content-Type"], "text/plain");
+    EXPECT_EQ(response.headers["content-length"], "5");
+    EXPECT_EQ(response.body, "hello");
+    EXPECT_TRUE(response.keep_alive);
+    EXPECT_FALSE(reader.HasBufferedData());
+  }
+}
+
+TEST(HTTPResponseReader, Chunked) {
+  for (size_t read_size : kReadSizes) {
+    SCOPED_TRACE(read_size);
+    StringSource source(
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: Chunked\r\n"
+        "\r\n"
+        "5\r\nhello\r\n"
+        "1;name=value\r\n,\r\n"
+        "A\r\n 012345678\r\n"
+        "0\r\n"
+        "Trailer: value\r\n"
+        "\r\n",
+        read_size);
+    HTTPResponseReader reader(&source);
+
+    HTTPResponseReader::Response response;
+    ASSERT_TRUE(reader.ReadResponse(&response));
+    EXPECT_EQ(response.status, 200u);
+    EXPECT_EQ(response.body, "hello, 012345678");
+    EXPECT_TRUE(response.keep_alive);
+    EXPECT_FALSE(reader.HasBufferedData());
+  }
+}
+
+TEST(HTTPResponseReader, BodyToEndOfConnection) {
+  for (size_t read_size : kReadSizes) {
+    SCOPED_TRACE(read_size);
+    StringSource source(
+        "HTTP/1.0 200 OK\n"
+        "\n"
+        "all of the rest",
+        read_size);
+    HTTPResponseReader reader(&source);
+
+    HTTPResponseReader::Response response;
+    ASSERT_TRUE(reader.ReadResponse(&response));
+    EXPECT_EQ(response.status, 200u);
+    EXPECT_EQ(response.body, "all of the rest");
+    EXPECT_FALSE(response.keep_alive);
+  }
+}
+
+TEST(HTTPResponseReader, Pipelined) {
+  for (size_t read_size : kReadSizes) {
+    SCOPED_TRACE(read_size);
+    StringSource source(
+        "HTTP/1.1 100 Continue\r\n"
+        "\r\n"
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "first"
+        "HTTP/1.1 204 No Content\r\n"
+        "\r\n"
+        "HTTP/1.1 500 Internal Server Error\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5\r\nthird\r\n0\r\n\r\n"
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 0\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        read_size);
+    HTTPResponseReader reader(&source);
+
+    HTTPResponseReader::Response response;
+    ASSERT_TRUE(reader.ReadResponse(&response));
+    EXPECT_EQ(response.status, 200u);
+    EXPECT_EQ(response.body, "first");
+    EXPECT_TRUE(response.keep_alive);
+
+    ASSERT_TRUE(reader.ReadResponse(&response));
+    EXPECT_EQ(response.status, 204u);
+    EXPECT_EQ(response.body, "");
+    EXPECT_TRUE(response.keep_alive);
+
+    ASSERT_TRUE(reader.ReadResponse(&response));
+    EXPECT_EQ(response.status, 500u);
+    EXPECT_EQ(response.body, "third");
+    EXPECT_TRUE(response.keep_alive);
+
+    ASSERT_TRUE(reader.ReadResponse(&response));
+    EXPECT_EQ(response.status, 200u);
+    EXPECT_EQ(response.body, "");
+    EXPECT_FALSE(response.keep_alive);
+    EXPECT_FALSE(reader.HasBufferedData());
+
+    EXPECT_FALSE(reader.ReadResponse(&response));
+  }
+}
+
+TEST(HTTPResponseReader, FewReads) {
+  const std::string body(100000, 'x');
+  std::string data =
+      "HTTP/1.1 200 OK\r\n"
+      "Date: Mon, 01 Jun 2020 00:00:00 GMT\r\n"
+      "Server: test\r\n"
+      "Content-Type: text/plain\r\n"
+      "Content-Length: 100000\r\n"
+      "\r\n" +
+      body;
+  StringSource source(data, data.size());
+  HTTPResponseReader reader(&source);
+
+  HTTPResponseReader::Response response;
+  ASSERT_TRUE(reader.ReadResponse(&response));
+  EXPECT_EQ(response.body, body);
+
+  // One read for the headers and the start of the body, and one for the rest
+  // of the body, which is read directly rather than through the buffer.
+  EXPECT_EQ(source.Reads(), 2u);
+}
+
+TEST(HTTPResponseReader, Invalid) {
+  static constexpr const char* kResponses[] = {
+      "",
+      "HTTP/1.1 200 OK\r\n",
+      "HTTP/2 200 OK\r\n\r\n",
+      "HTTP/1.1 2000 OK\r\n\r\n",
+      "HTTP/1.1 abc OK\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nno colon\r\n\r\n",
+      "HTTP/1.1 200 OK\r\n: empty name\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nContent-Length: x\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nshort",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nx\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhelloX\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n",
+  };
+  for (const char* data : kResponses) {
+    SCOPED_TRACE(data);
+    StringSource source(data, 1 << 20);
+    HTTPResponseReader reader(&source);
+
+    HTTPResponseReader::Response response;
+    EXPECT_FALSE(reader.ReadResponse(&response));
+  }
+}
+
+TEST(HTTPResponseReader, BodyTooLarge) {
+  constexpr size_t kMaxBodySize = HTTPResponseReader::kMaxBodySize;
+  const std::string body(kMaxBodySize + 1, 'x');
+  const std::string chunk_size =
+      base::StringPrintf("%zx", kMaxBodySize / 2 + 1);
+  const std::string kResponses[] = {
+      // Nothing is received beyond the headers, so these fail without waiting
+      // for a body that will never arrive.
+      base::StringPrintf("HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n",
+                         kMaxBodySize + 1),
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "fffffffffffffff\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n" + chunk_size +
+          "\r\n" + body.substr(0, kMaxBodySize / 2 + 1) + "\r\n" + chunk_size +
+          "\r\n",
+      "HTTP/1.0 200 OK\r\n\r\n" + body,
+  };
+  for (const std::string& data : kResponses) {
+    SCOPED_TRACE(data.substr(0, 80));
+    StringSource source(data, 1 << 20);
+    HTTPResponseReader reader(&source);
+
+    HTTPResponseReader::Response response;
+    EXPECT_FALSE(reader.ReadResponse(&response));
+  }
+}
+
+TEST(HTTPResponseReader, LineTooLong) {
+  StringSource source("HTTP/1.1 200 OK\r\nLong: " + std::string(65536, 'x') +
+                          "\r\n\r\n",
+                      1 << 20);
+  HTTPResponseReader reader(&source);
+
+  HTTPResponseReader::Response response;
+  EXPECT_FALSE(reader.ReadResponse(&response));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
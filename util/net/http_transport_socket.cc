@@ -14,11 +14,23 @@
 
 #include "util/net/http_transport.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/macros.h"
@@ -28,11 +40,18 @@
 #include "base/stl_util.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
 #include "util/file/file_io.h"
+#include "util/file/file_writer.h"
+#include "util/misc/clock.h"
 #include "util/net/http_body.h"
+#include "util/net/http_response_reader.h"
 #include "util/net/url.h"
 #include "util/stdlib/string_number_conversion.h"
-#include "util/string/split_string.h"
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <sys/sendfile.h>
+#endif
 
 #if defined(CRASHPAD_USE_BORINGSSL)
 #include <openssl/ssl.h>
@@ -44,6 +63,14 @@ namespace {
 
 constexpr const char kCRLFTerminator[] = "\r\n";
 
+// The longest that a connection will be kept idle for reuse. Servers close idle
+// connections on their own schedule, but a connection that has been idle for a
+// short time is less likely to be closed just as a new request is sent on it.
+constexpr uint64_t kMaxConnectionIdleNanoseconds = 15 * 1000000000ull;
+
+// The maximum number of idle connections to keep for reuse.
+constexpr size_t kMaxIdleConnections = 8;
+
 class HTTPTransportSocket final : public HTTPTransport {
  public:
   HTTPTransportSocket() = default;
@@ -61,13 +88,16 @@ struct ScopedAddrinfoTraits {
 };
 using ScopedAddrinfo = base::ScopedGeneric<addrinfo*, ScopedAddrinfoTraits>;
 
-class Stream {
+class Stream : public HTTPResponseReader::Source {
  public:
-  virtual ~Stream() = default;
+  ~Stream() override = default;
 
   virtual bool LoggingWrite(const void* data, size_t size) = 0;
-  virtual bool LoggingRead(void* data, size_t size) = 0;
-  virtual bool LoggingReadToEOF(std::string* contents) = 0;
+
+  // Returns the socket that data may be written to directly, bypassing this
+  // object, or -1 if data must be written with LoggingWrite(), as it must be
+  // when it is encrypted.
+  virtual int DirectWriteSocket() const { return -1; }
 };
 
 class FdStream : public Stream {
@@ -78,12 +108,14 @@ class FdStream : public Stream {
     return LoggingWriteFile(fd_, data, size);
   }
 
-  bool LoggingRead(void* data, size_t size) override {
-    return LoggingReadFileExactly(fd_, data, size);
-  }
+  int DirectWriteSocket() const override { return fd_; }
 
-  bool LoggingReadToEOF(std::string* result) override {
-    return crashpad::LoggingReadToEOF(fd_, result);
+  FileOperationResult ReadUpTo(void* data, size_t size) override {
+    FileOperationResult rv = ReadFile(fd_, data, size);
+    if (rv < 0) {
+      PLOG(ERROR) << "read";
+    }
+    return rv;
   }
 
  private:
@@ -93,13 +125,58 @@ class FdStream : public Stream {
 };
 
 #if defined(CRASHPAD_USE_BORINGSSL)
-class SSLStream : public Stream {
+// An SSL_CTX with its trust store loaded, along with the most recent session
+// established with each server so that later connections can resume it instead
+// of performing a full handshake. Loading the trust store is expensive, so one
+// SSLContext is kept for each root certificate path for the life of the
+// process.
+class SSLContext {
  public:
-  SSLStream() = default;
+  // Returns the SSLContext for root_cert_path, creating it if necessary, or
+  // nullptr on failure with a message logged.
+  static SSLContext* Get(const base::FilePath& root_cert_path) {
+    static base::Lock* lock = new base::Lock();
+    static auto* contexts =
+        new std::map<base::FilePath::StringType, std::unique_ptr<SSLContext>>();
+
+    base::AutoLock lock_owner(*lock);
+    auto iterator = contexts->find(root_cert_path.value());
+    if (iterator != contexts->end()) {
+      return iterator->second.get();
+    }
+
+    std::unique_ptr<SSLContext> context(new SSLContext());
+    if (!context->Initialize(root_cert_path)) {
+      return nullptr;
+    }
+    return contexts->insert(std::make_pair(root_cert_path.value(),
+                                           std::move(context)))
+        .first->second.get();
+  }
 
-  bool Initialize(const base::FilePath& root_cert_path,
-                  int sock,
-                  const std::string& hostname) {
+  SSL_CTX* ctx() const { return ctx_.get(); }
+
+  // Prepares ssl to resume the most recent session with hostname, if there is
+  // one.
+  void ResumeSession(SSL* ssl, const std::string& hostname) {
+    base::AutoLock lock_owner(lock_);
+    auto iterator = sessions_.find(hostname);
+    if (iterator != sessions_.end()) {
+      SSL_set_session(ssl, iterator->second.get());
+    }
+  }
+
+ private:
+  struct ScopedSSLSessionTraits {
+    static SSL_SESSION* InvalidValue() { return nullptr; }
+    static void Free(SSL_SESSION* session) { SSL_SESSION_free(session); }
+  };
+  using ScopedSSLSession =
+      base::ScopedGeneric<SSL_SESSION*, ScopedSSLSessionTraits>;
+
+  SSLContext() : ctx_(), lock_(), sessions_() {}
+
+  bool Initialize(const base::FilePath& root_cert_path) {
     SSL_library_init();
 
     ctx_.reset(SSL_CTX_new(TLS_method()));
@@ -140,7 +217,53 @@ class SSLStream : public Stream {
 #endif
     }
 
-    ssl_.reset(SSL_new(ctx_.get()));
+    // Sessions are remembered by NewSession() rather than by OpenSSL’s internal
+    // cache, which doesn’t look up sessions for clients. With TLS 1.3, a
+    // resumable session is only available once the server has sent a ticket
+    // after the handshake, so it can’t simply be taken from a connection after
+    // SSL_connect() returns.
+    SSL_CTX_set_session_cache_mode(
+        ctx_.get(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_set_app_data(ctx_.get(), this);
+    SSL_CTX_sess_set_new_cb(ctx_.get(), NewSession);
+
+    return true;
+  }
+
+  static int NewSession(SSL* ssl, SSL_SESSION* session) {
+    const char* hostname = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (!hostname) {
+      return 0;
+    }
+
+    SSLContext* self =
+        static_cast<SSLContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    base::AutoLock lock_owner(self->lock_);
+    self->sessions_[hostname].reset(session);
+
+    // Returning 1 takes ownership of session.
+    return 1;
+  }
+
+  struct ScopedSSLCTXTraits {
+    static SSL_CTX* InvalidValue() { return nullptr; }
+    static void Free(SSL_CTX* ctx) { SSL_CTX_free(ctx); }
+  };
+  using ScopedSSLCTX = base::ScopedGeneric<SSL_CTX*, ScopedSSLCTXTraits>;
+
+  ScopedSSLCTX ctx_;
+  base::Lock lock_;
+  std::map<std::string, ScopedSSLSession> sessions_;  // guarded by lock_
+
+  DISALLOW_COPY_AND_ASSIGN(SSLContext);
+};
+
+class SSLStream : public Stream {
+ public:
+  SSLStream() = default;
+
+  bool Initialize(SSLContext* context, int sock, const std::string& hostname) {
+    ssl_.reset(SSL_new(context->ctx()));
     if (!ssl_.is_valid()) {
       LOG(ERROR) << "SSL_new";
       return false;
@@ -160,6 +283,8 @@ class SSLStream : public Stream {
       return false;
     }
 
+    context->ResumeSession(ssl_.get(), hostname);
+
     if (SSL_connect(ssl_.get()) <= 0) {
       LOG(ERROR) << "SSL_connect";
       return false;
@@ -169,36 +294,23 @@ class SSLStream : public Stream {
   }
 
   bool LoggingWrite(const void* data, size_t size) override {
-    return SSL_write(ssl_.get(), data, size) != 0;
-  }
-
-  bool LoggingRead(void* data, size_t size) override {
-    return SSL_read(ssl_.get(), data, size) != 0;
+    if (SSL_write(ssl_.get(), data, size) <= 0) {
+      LOG(ERROR) << "SSL_write";
+      return false;
+    }
+    return true;
   }
 
-  bool LoggingReadToEOF(std::string* contents) override {
-    contents->clear();
-    char buffer[4096];
-    FileOperationResult rv;
-    while ((rv = SSL_read(ssl_.get(), buffer, sizeof(buffer))) > 0) {
-      DCHECK_LE(static_cast<size_t>(rv), sizeof(buffer));
-      contents->append(buffer, rv);
-    }
+  FileOperationResult ReadUpTo(void* data, size_t size) override {
+    int rv = SSL_read(ssl_.get(), data, size);
     if (rv < 0) {
       LOG(ERROR) << "SSL_read";
-      contents->clear();
-      return false;
+      return -1;
     }
-    return true;
+    return rv;
   }
 
  private:
-  struct ScopedSSLCTXTraits {
-    static SSL_CTX* InvalidValue() { return nullptr; }
-    static void Free(SSL_CTX* ctx) { SSL_CTX_free(ctx); }
-  };
-  using ScopedSSLCTX = base::ScopedGeneric<SSL_CTX*, ScopedSSLCTXTraits>;
-
   struct ScopedSSLTraits {
     static SSL* InvalidValue() { return nullptr; }
     static void Free(SSL* ssl) {
@@ -208,7 +320,6 @@ class SSLStream : public Stream {
   };
   using ScopedSSL = base::ScopedGeneric<SSL*, ScopedSSLTraits>;
 
-  ScopedSSLCTX ctx_;
   ScopedSSL ssl_;
 
   DISALLOW_COPY_AND_ASSIGN(SSLStream);
@@ -282,6 +393,64 @@ class ScopedSetNonblocking {
   DISALLOW_COPY_AND_ASSIGN(ScopedSetNonblocking);
 };
 
+#if !defined(OS_FUCHSIA)
+// Blocks SIGPIPE on the calling thread for the lifetime of the object. A
+// server may close a connection at any time, including a kept-alive one just
+// as it is reused, and writing to it must then fail with EPIPE rather than
+// raising SIGPIPE, which would terminate the process. This covers every way
+// that data is written to a connection, including writev(), sendfile(), and
+// TLS, which writes through its own BIO. A SIGPIPE raised while blocked is
+// consumed before it is unblocked, unless one was already pending.
+class ScopedBlockSIGPIPE {
+ public:
+  ScopedBlockSIGPIPE() : old_mask_(), consume_(false), blocked_(false) {
+    sigset_t pending;
+    consume_ = sigpending(&pending) == 0 && !sigismember(&pending, SIGPIPE);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGPIPE);
+    int err = pthread_sigmask(SIG_BLOCK, &mask, &old_mask_);
+    if (err != 0) {
+      errno = err;
+      PLOG(ERROR) << "pthread_sigmask";
+      return;
+    }
+    blocked_ = true;
+  }
+
+  ~ScopedBlockSIGPIPE() {
+    if (!blocked_) {
+      return;
+    }
+
+    if (consume_) {
+      sigset_t pending;
+      if (sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE)) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGPIPE);
+        const timespec timeout = {};
+        HANDLE_EINTR(sigtimedwait(&mask, nullptr, &timeout));
+      }
+    }
+
+    int err = pthread_sigmask(SIG_SETMASK, &old_mask_, nullptr);
+    if (err != 0) {
+      errno = err;
+      PLOG(ERROR) << "pthread_sigmask";
+    }
+  }
+
+ private:
+  sigset_t old_mask_;
+  bool consume_;
+  bool blocked_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedBlockSIGPIPE);
+};
+#endif  // !OS_FUCHSIA
+
 base::ScopedFD CreateSocket(const std::string& hostname,
                             const std::string& port) {
   addrinfo hints = {};
@@ -304,6 +473,19 @@ base::ScopedFD CreateSocket(const std::string& hostname,
       continue;
     }
 
+    // Requests are written in large pieces, so Nagle’s algorithm would only
+    // delay the end of each one, waiting for a delayed acknowledgement of the
+    // previous piece. That stalls every request after the first on a
+    // kept-alive connection.
+    int nodelay = 1;
+    if (setsockopt(result.get(),
+                   IPPROTO_TCP,
+                   TCP_NODELAY,
+                   &nodelay,
+                   sizeof(nodelay)) != 0) {
+      PLOG(WARNING) << "setsockopt";
+    }
+
     {
       // Set socket to non-blocking to avoid hanging for a long time if the
       // network is down.
@@ -326,42 +508,314 @@ base::ScopedFD CreateSocket(const std::string& hostname,
   return base::ScopedFD();
 }
 
+// A connection to a server, which may be used for further requests if the
+// server keeps it alive.
+class Connection {
+ public:
+  Connection(base::ScopedFD sock, std::unique_ptr<Stream> stream)
+      : sock_(std::move(sock)),
+        stream_(std::move(stream)),
+        reader_(stream_.get()) {}
+
+  Stream* stream() const { return stream_.get(); }
+  HTTPResponseReader* reader() { return &reader_; }
+
+  // Returns true if the connection appears to still be open. Nothing is
+  // expected from the server between requests, so a readable socket means that
+  // the server has closed the connection or can’t be trusted to use it
+  // correctly.
+  bool IsOpen() const {
+    pollfd pollfds;
+    pollfds.fd = sock_.get();
+    pollfds.events = POLLIN | POLLPRI;
+    int ret = HANDLE_EINTR(poll(&pollfds, 1, 0));
+    if (ret < 0) {
+      PLOG(ERROR) << "poll";
+      return false;
+    }
+    return ret == 0;
+  }
+
+ private:
+  base::ScopedFD sock_;
+
+  // This is declared after sock_ so that it is destroyed first, allowing a TLS
+  // connection to be shut down before the socket is closed.
+  std::unique_ptr<Stream> stream_;
+
+  // Data received beyond the end of a response stays here, so the reader is
+  // kept for as long as the connection is.
+  HTTPResponseReader reader_;
+
+  DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+// Idle connections that servers have agreed to keep alive, so that a later
+// request to the same server can avoid connecting and, for HTTPS, a handshake.
+// An HTTPTransport is created for each request, so one pool is shared by the
+// process. This class is thread-safe.
+class ConnectionPool {
+ public:
+  static ConnectionPool* Get() {
+    static ConnectionPool* pool = new ConnectionPool();
+    return pool;
+  }
+
+  // Returns an open idle connection identified by key, or nullptr if there is
+  // none.
+  std::unique_ptr<Connection> Take(const std::string& key) {
+    std::vector<std::unique_ptr<Connection>> closed_connections;
+    std::unique_ptr<Connection> connection;
+    {
+      base::AutoLock lock_owner(lock_);
+      RemoveExpiredLocked(&closed_connections);
+      for (auto iterator = idle_connections_.rbegin();
+           iterator != idle_connections_.rend();
+           ++iterator) {
+        if (iterator->key == key) {
+          connection = std::move(iterator->connection);
+          idle_connections_.erase(std::next(iterator).base());
+          break;
+        }
+      }
+    }
+
+    if (connection && !connection->IsOpen()) {
+      connection.reset();
+    }
+    return connection;
+  }
+
+  // Keeps connection, identified by key, for reuse by a later request.
+  void Put(const std::string& key, std::unique_ptr<Connection> connection) {
+    std::vector<std::unique_ptr<Connection>> closed_connections;
+    base::AutoLock lock_owner(lock_);
+    RemoveExpiredLocked(&closed_connections);
+    if (idle_connections_.size() >= kMaxIdleConnections) {
+      closed_connections.push_back(
+          std::move(idle_connections_.front().connection));
+      idle_connections_.erase(idle_connections_.begin());
+    }
+    idle_connections_.push_back(
+        {key, std::move(connection), ClockMonotonicNanoseconds()});
+  }
+
+ private:
+  struct IdleConnection {
+    std::string key;
+    std::unique_ptr<Connection> connection;
+    uint64_t idle_since_ns;
+  };
+
+  ConnectionPool() : lock_(), idle_connections_() {}
+
+  // Moves connections that have been idle for too long to closed_connections,
+  // so that they can be closed without holding lock_.
+  void RemoveExpiredLocked(
+      std::vector<std::unique_ptr<Connection>>* closed_connections) {
+    lock_.AssertAcquired();
+    const uint64_t now_ns = ClockMonotonicNanoseconds();
+    auto first_unexpired = idle_connections_.begin();
+    while (first_unexpired != idle_connections_.end() &&
+           now_ns - first_unexpired->idle_since_ns >
+               kMaxConnectionIdleNanoseconds) {
+      closed_connections->push_back(std::move(first_unexpired->connection));
+      ++first_unexpired;
+    }
+    idle_connections_.erase(idle_connections_.begin(), first_unexpired);
+  }
+
+  base::Lock lock_;
+
+  // Guarded by lock_, and ordered from least to most recently used.
+  std::vector<IdleConnection> idle_connections_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConnectionPool);
+};
+
+std::unique_ptr<Connection> Connect(const std::string& scheme,
+                                    const std::string& hostname,
+                                    const std::string& port,
+                                    const base::FilePath& root_cert_path) {
+  base::ScopedFD sock(CreateSocket(hostname, port));
+  if (!sock.is_valid()) {
+    return nullptr;
+  }
+
+#if defined(CRASHPAD_USE_BORINGSSL)
+  std::unique_ptr<Stream> stream;
+  if (scheme == "https") {
+    SSLContext* context = SSLContext::Get(root_cert_path);
+    if (!context) {
+      return nullptr;
+    }
+
+    auto ssl_stream = std::make_unique<SSLStream>();
+    if (!ssl_stream->Initialize(context, sock.get(), hostname)) {
+      LOG(ERROR) << "SSLStream Initialize";
+      return nullptr;
+    }
+    stream = std::move(ssl_stream);
+  } else {
+    stream = std::make_unique<FdStream>(sock.get());
+  }
+#else  // CRASHPAD_USE_BORINGSSL
+  std::unique_ptr<Stream> stream(std::make_unique<FdStream>(sock.get()));
+#endif  // CRASHPAD_USE_BORINGSSL
+
+  return std::make_unique<Connection>(std::move(sock), std::move(stream));
+}
+
+// Sends size bytes at offset in file to sock.
+bool SendFileData(int sock, FileHandle file, FileOffset offset, size_t size) {
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  off_t file_offset = offset;
+  while (size > 0) {
+    ssize_t sent = HANDLE_EINTR(sendfile(sock, file, &file_offset, size));
+    if (sent < 0) {
+      PLOG(ERROR) << "sendfile";
+      return false;
+    }
+    if (sent == 0) {
+      LOG(ERROR) << "sendfile: unexpected end of file";
+      return false;
+    }
+    size -= sent;
+  }
+  return true;
+#else
+  uint8_t buf[32 * 1024];
+  while (size > 0) {
+    ssize_t bytes_read = HANDLE_EINTR(
+        pread(file, buf, std::min(size, sizeof(buf)), offset));
+    if (bytes_read < 0) {
+      PLOG(ERROR) << "pread";
+      return false;
+    }
+    if (bytes_read == 0) {
+      LOG(ERROR) << "pread: unexpected end of file";
+      return false;
+    }
+    if (!LoggingWriteFile(sock, buf, bytes_read)) {
+      return false;
+    }
+    offset += bytes_read;
+    size -= bytes_read;
+  }
+  return true;
+#endif
+}
+
+// Writes request_head followed by body_stream to sock without chunked
+// encoding. Data that body_stream holds in memory is gathered and written with
+// writev(), and data in files is sent with sendfile(), so neither is copied
+// into a buffer here. Data that body_stream can only copy out is written a
+// block at a time.
+bool WriteRequestDirect(int sock,
+                        const std::string& request_head,
+                        HTTPBodyStream* body_stream) {
+  WeakFileHandleFileWriter writer(sock);
+  std::vector<WritableIoVec> iovecs;
+  iovecs.push_back({request_head.data(), request_head.size()});
+
+  auto flush_iovecs = [&writer, &iovecs]() {
+    if (iovecs.empty()) {
+      return true;
+    }
+    bool written = writer.WriteIoVec(&iovecs);
+    iovecs.clear();
+    return written;
+  };
+
+  while (true) {
+    HTTPBodyStream::DirectData direct;
+    if (!body_stream->GetDirectData(&direct)) {
+      if (!flush_iovecs()) {
+        return false;
+      }
+
+      uint8_t buf[32 * 1024];
+      FileOperationResult data_bytes =
+          body_stream->GetBytesBuffer(buf, sizeof(buf));
+      if (data_bytes < 0) {
+        return false;
+      }
+      if (data_bytes == 0) {
+        return true;
+      }
+      if (!LoggingWriteFile(sock, buf, data_bytes)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (direct.size == 0) {
+      break;
+    }
+
+    if (direct.data) {
+      // The data remains valid after the stream is advanced past it, so
+      // several pieces can be written together.
+      iovecs.push_back({direct.data, direct.size});
+      if (!body_stream->SkipDirectData(direct.size)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (!flush_iovecs() ||
+        !SendFileData(sock, direct.file, direct.offset, direct.size) ||
+        !body_stream->SkipDirectData(direct.size)) {
+      return false;
+    }
+  }
+
+  return flush_iovecs();
+}
+
 bool WriteRequest(Stream* stream,
                   const std::string& method,
                   const std::string& resource,
+                  const std::string& host,
                   const HTTPHeaders& headers,
                   HTTPBodyStream* body_stream) {
-  std::string request_line = base::StringPrintf(
-      "%s %s HTTP/1.0\r\n", method.c_str(), resource.c_str());
-  if (!stream->LoggingWrite(request_line.data(), request_line.size()))
-    return false;
+  // The request line and headers are written together so that they don’t
+  // straggle across several packets on a connection with Nagle’s algorithm
+  // disabled.
+  std::string request_head = base::StringPrintf(
+      "%s %s HTTP/1.1\r\n", method.c_str(), resource.c_str());
+
+  // HTTP/1.1 requires a Host header.
+  std::string unused_value;
+  if (!HTTPResponseReader::FindHeader(headers, "Host", &unused_value)) {
+    request_head += base::StringPrintf("Host: %s\r\n", host.c_str());
+  }
 
   // Write headers, and determine if Content-Length has been specified.
   bool chunked = true;
   size_t content_length = 0;
   for (const auto& header : headers) {
-    std::string header_str = base::StringPrintf(
+    request_head += base::StringPrintf(
         "%s: %s\r\n", header.first.c_str(), header.second.c_str());
     if (header.first == kContentLength) {
       chunked = !base::StringToSizeT(header.second, &content_length);
       DCHECK(!chunked);
     }
-
-    if (!stream->LoggingWrite(header_str.data(), header_str.size()))
-      return false;
   }
 
   // If no Content-Length, then encode as chunked, so add that header too.
   if (chunked) {
-    static constexpr const char kTransferEncodingChunked[] =
-        "Transfer-Encoding: chunked\r\n";
-    if (!stream->LoggingWrite(kTransferEncodingChunked,
-                              strlen(kTransferEncodingChunked))) {
-      return false;
-    }
+    request_head += "Transfer-Encoding: chunked\r\n";
+  }
+
+  request_head += kCRLFTerminator;
+
+  const int direct_write_socket = stream->DirectWriteSocket();
+  if (!chunked && direct_write_socket >= 0) {
+    return WriteRequestDirect(direct_write_socket, request_head, body_stream);
   }
 
-  if (!stream->LoggingWrite(kCRLFTerminator, strlen(kCRLFTerminator))) {
+  if (!stream->LoggingWrite(request_head.data(), request_head.size())) {
     return false;
   }
 
@@ -436,111 +890,6 @@ bool WriteRequest(Stream* stream,
   return true;
 }
 
-bool ReadLine(Stream* stream, std::string* line) {
-  line->clear();
-  for (;;) {
-    char byte;
-    if (!stream->LoggingRead(&byte, 1)) {
-      return false;
-    }
-
-    line->append(&byte, 1);
-    if (byte == '\n')
-      return true;
-  }
-}
-
-bool StartsWith(const std::string& str, const char* with, size_t len) {
-  return str.compare(0, len, with) == 0;
-}
-
-bool ReadResponseLine(Stream* stream) {
-  std::string response_line;
-  if (!ReadLine(stream, &response_line)) {
-    LOG(ERROR) << "ReadLine";
-    return false;
-  }
-  static constexpr const char kHttp10[] = "HTTP/1.0 ";
-  static constexpr const char kHttp11[] = "HTTP/1.1 ";
-  if (!(StartsWith(response_line, kHttp10, strlen(kHttp10)) ||
-        StartsWith(response_line, kHttp11, strlen(kHttp11))) ||
-      response_line.size() < strlen(kHttp10) + 3 ||
-      response_line.at(strlen(kHttp10) + 3) != ' ') {
-    return false;
-  }
-  unsigned int http_status = 0;
-  return base::StringToUint(response_line.substr(strlen(kHttp10), 3),
-                            &http_status) &&
-         http_status >= 200 && http_status <= 203;
-}
-
-bool ReadResponseHeaders(Stream* stream, HTTPHeaders* headers) {
-  for (;;) {
-    std::string line;
-    if (!ReadLine(stream, &line)) {
-      return false;
-    }
-
-    if (line == kCRLFTerminator) {
-      return true;
-    }
-
-    std::string left, right;
-    if (!SplitStringFirst(line, ':', &left, &right)) {
-      LOG(ERROR) << "SplitStringFirst";
-      return false;
-    }
-    DCHECK_EQ(right[right.size() - 1], '\n');
-    DCHECK_EQ(right[right.size() - 2], '\r');
-    DCHECK_EQ(right[0], ' ');
-    DCHECK_NE(right[1], ' ');
-    right = right.substr(1, right.size() - 3);
-    (*headers)[left] = right;
-  }
-}
-
-bool ReadContentChunked(Stream* stream, std::string* body) {
-  // TODO(scottmg): https://crashpad.chromium.org/bug/196.
-  LOG(ERROR) << "TODO(scottmg): chunked response read";
-  return false;
-}
-
-bool ReadResponse(Stream* stream, std::string* response_body) {
-  response_body->clear();
-
-  if (!ReadResponseLine(stream)) {
-    return false;
-  }
-
-  HTTPHeaders response_headers;
-  if (!ReadResponseHeaders(stream, &response_headers)) {
-    return false;
-  }
-
-  auto it = response_headers.find("Content-Length");
-  size_t len = 0;
-  if (it != response_headers.end()) {
-    if (!base::StringToSizeT(it->second, &len)) {
-      LOG(ERROR) << "invalid Content-Length";
-      return false;
-    }
-  }
-
-  if (len) {
-    response_body->resize(len, 0);
-    return stream->LoggingRead(&(*response_body)[0], len);
-  }
-
-  it = response_headers.find("Transfer-Encoding");
-  bool chunked = false;
-  if (it != response_headers.end() && it->second == "chunked") {
-    chunked = true;
-  }
-
-  return chunked ? ReadContentChunked(stream, response_body)
-                 : stream->LoggingReadToEOF(response_body);
-}
-
 bool HTTPTransportSocket::ExecuteSynchronously(std::string* response_body) {
   std::string scheme, hostname, port, resource;
   if (!CrackURL(url(), &scheme, &hostname, &port, &resource)) {
@@ -552,37 +901,77 @@ bool HTTPTransportSocket::ExecuteSynchronously(std::string* response_body) {
                           << "'";
 #endif
 
-  base::ScopedFD sock(CreateSocket(hostname, port));
-  if (!sock.is_valid()) {
-    return false;
-  }
+  // Connections are only shared by requests that would have set them up
+  // identically.
+  const std::string connection_key =
+      base::StringPrintf("%s://%s:%s %s",
+                         scheme.c_str(),
+                         hostname.c_str(),
+                         port.c_str(),
+                         root_ca_certificate_path().value().c_str());
+
+#if !defined(OS_FUCHSIA)
+  // This is declared before the connection so that it remains in effect while
+  // the connection is shut down, which may also write to it.
+  ScopedBlockSIGPIPE block_sigpipe;
+#endif  // !OS_FUCHSIA
+
+  const bool default_port = (scheme == "http" && port == "80") ||
+                            (scheme == "https" && port == "443");
+  const std::string host = default_port ? hostname : hostname + ":" + port;
+
+  // A server may close an idle connection just as it is reused. If a request on
+  // a reused connection fails before any of the response arrives, the server
+  // can’t have acted on it, so it is sent once more on a new connection.
+  ConnectionPool* pool = ConnectionPool::Get();
+  std::unique_ptr<Connection> connection(pool->Take(connection_key));
+  bool reused = connection != nullptr;
+  HTTPResponseReader::Response response;
+  while (true) {
+    if (!connection) {
+      connection = Connect(scheme, hostname, port, root_ca_certificate_path());
+      if (!connection) {
+        return false;
+      }
+    }
 
-#if defined(CRASHPAD_USE_BORINGSSL)
-  std::unique_ptr<Stream> stream;
-  if (scheme == "https") {
-    auto ssl_stream = std::make_unique<SSLStream>();
-    if (!ssl_stream->Initialize(
-            root_ca_certificate_path(), sock.get(), hostname)) {
-      LOG(ERROR) << "SSLStream Initialize";
+    const bool written = WriteRequest(connection->stream(),
+                                      method(),
+                                      resource,
+                                      host,
+                                      headers(),
+                                      body_stream());
+    if (written && connection->reader()->ReadResponse(&response)) {
+      break;
+    }
+
+    if (!reused ||
+        (written && connection->reader()->ReceivedResponseData()) ||
+        !body_stream()->Reset()) {
       return false;
     }
-    stream = std::move(ssl_stream);
-  } else {
-    stream = std::make_unique<FdStream>(sock.get());
+    LOG(WARNING) << "retrying on a new connection";
+    connection.reset();
+    reused = false;
   }
-#else  // CRASHPAD_USE_BORINGSSL
-  std::unique_ptr<Stream> stream(std::make_unique<FdStream>(sock.get()));
-#endif  // CRASHPAD_USE_BORINGSSL
 
-  if (!WriteRequest(
-          stream.get(), method(), resource, headers(), body_stream())) {
-    return false;
+  // Only one request is sent at a time, so anything already received beyond
+  // the response is unexpected.
+  if (response.keep_alive && !connection->reader()->HasBufferedData()) {
+    pool->Put(connection_key, std::move(connection));
   }
 
-  if (!ReadResponse(stream.get(), response_body)) {
+  if (response.status < 200 || response.status > 203) {
+    LOG(ERROR) << "HTTP status " << response.status;
+    if (response_body) {
+      response_body->clear();
+    }
     return false;
   }
 
+  if (response_body) {
+    response_body->swap(response.body);
+  }
   return true;
 }
 
@@ -0,0 +1,497 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/scoped_file.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/rand_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "gtest/gtest.h"
+#include "test/errors.h"
+#include "test/scoped_temp_dir.h"
+#include "util/file/file_io.h"
+#include "util/file/file_reader.h"
+#include "util/file/file_writer.h"
+#include "util/misc/clock.h"
+#include "util/net/http_body.h"
+#include "util/net/http_headers.h"
+#include "util/net/http_multipart_builder.h"
+#include "util/net/http_transport.h"
+#include "util/thread/thread.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+constexpr char kResponseBody[] = "response";
+
+// A minimal HTTP/1.1 server that serves one connection at a time and counts
+// the connections that it accepts. It closes each connection after a fixed
+// number of requests, either saying so in the last response or, like a server
+// that closes idle connections, without warning. It may instead wait for one
+// more request on the connection and close it without responding, as a server
+// closing an idle connection might just as the connection is reused.
+class KeepAliveTestServer final : public Thread {
+ public:
+  KeepAliveTestServer(size_t requests_per_connection, bool announce_close)
+      : Thread(),
+        listen_sock_(),
+        lock_(),
+        requests_per_connection_(requests_per_connection),
+        announce_close_(announce_close),
+        drop_extra_request_(false),
+        port_(0),
+        active_sock_(-1),
+        stopping_(false),
+        connections_(0),
+        requests_(0),
+        last_request_() {}
+
+  ~KeepAliveTestServer() override {}
+
+  // Closes each connection when the request following its last one arrives,
+  // without reading that request’s body or responding to it. Must be called
+  // before StartServer().
+  void set_drop_extra_request(bool drop_extra_request) {
+    drop_extra_request_ = drop_extra_request;
+  }
+
+  bool StartServer() {
+    listen_sock_.reset(socket(AF_INET, SOCK_STREAM, 0));
+    if (!listen_sock_.is_valid()) {
+      PLOG(ERROR) << "socket";
+      return false;
+    }
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(address);
+    if (bind(listen_sock_.get(),
+             reinterpret_cast<sockaddr*>(&address),
+             address_length) != 0 ||
+        listen(listen_sock_.get(), 1) != 0 ||
+        getsockname(listen_sock_.get(),
+                    reinterpret_cast<sockaddr*>(&address),
+                    &address_length) != 0) {
+      PLOG(ERROR) << "bind";
+      return false;
+    }
+    port_ = ntohs(address.sin_port);
+
+    Start();
+    return true;
+  }
+
+  void StopServer() {
+    {
+      base::AutoLock lock_owner(lock_);
+      stopping_ = true;
+      if (active_sock_ >= 0) {
+        shutdown(active_sock_, SHUT_RDWR);
+      }
+    }
+    shutdown(listen_sock_.get(), SHUT_RDWR);
+    Join();
+  }
+
+  std::string URL() const {
+    return base::StringPrintf("http://127.0.0.1:%d/upload", port_);
+  }
+
+  int port() const { return port_; }
+
+  size_t Connections() {
+    base::AutoLock lock_owner(lock_);
+    return connections_;
+  }
+
+  size_t Requests() {
+    base::AutoLock lock_owner(lock_);
+    return requests_;
+  }
+
+  std::string LastRequest() {
+    base::AutoLock lock_owner(lock_);
+    return last_request_;
+  }
+
+ private:
+  // Thread:
+  void ThreadMain() override {
+    for (;;) {
+      base::ScopedFD sock(
+          HANDLE_EINTR(accept(listen_sock_.get(), nullptr, nullptr)));
+      if (!sock.is_valid()) {
+        return;
+      }
+
+      {
+        base::AutoLock lock_owner(lock_);
+        if (stopping_) {
+          return;
+        }
+        active_sock_ = sock.get();
+        ++connections_;
+      }
+
+      ServeConnection(sock.get());
+
+      base::AutoLock lock_owner(lock_);
+      active_sock_ = -1;
+    }
+  }
+
+  void ServeConnection(int sock) {
+    std::string buffer;
+    for (size_t request_index = 0; request_index < requests_per_connection_;
+         ++request_index) {
+      std::string request;
+      if (!ReadRequest(sock, &buffer, &request)) {
+        return;
+      }
+
+      {
+        base::AutoLock lock_owner(lock_);
+        ++requests_;
+        last_request_ = request;
+      }
+
+      std::string response = base::StringPrintf(
+          "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n", strlen(kResponseBody));
+      if (announce_close_ && request_index + 1 == requests_per_connection_) {
+        response += "Connection: close\r\n";
+      }
+      response += "\r\n";
+      response += kResponseBody;
+      if (!LoggingWriteFile(sock, response.data(), response.size())) {
+        return;
+      }
+    }
+
+    if (drop_extra_request_) {
+      // Closing the connection with the request body unread resets it.
+      while (buffer.find("\r\n\r\n") == std::string::npos) {
+        if (!ReadMore(sock, &buffer)) {
+          return;
+        }
+      }
+    }
+  }
+
+  // Reads a request with a Content-Length body from sock into request.
+  // buffer holds data read from sock that hasn’t been consumed yet.
+  bool ReadRequest(int sock, std::string* buffer, std::string* request) {
+    size_t headers_end;
+    while ((headers_end = buffer->find("\r\n\r\n")) == std::string::npos) {
+      if (!ReadMore(sock, buffer)) {
+        return false;
+      }
+    }
+    headers_end += 4;
+
+    size_t content_length = 0;
+    static constexpr char kContentLengthHeader[] = "\r\nContent-Length: ";
+    size_t content_length_start = buffer->find(kContentLengthHeader);
+    if (content_length_start < headers_end) {
+      content_length = strtoul(
+          buffer->c_str() + content_length_start + strlen(kContentLengthHeader),
+          nullptr,
+          10);
+    }
+
+    while (buffer->size() < headers_end + content_length) {
+      if (!ReadMore(sock, buffer)) {
+        return false;
+      }
+    }
+
+    request->assign(*buffer, 0, headers_end + content_length);
+    buffer->erase(0, headers_end + content_length);
+    return true;
+  }
+
+  bool ReadMore(int sock, std::string* buffer) {
+    char data[4096];
+    FileOperationResult bytes_read = ReadFile(sock, data, sizeof(data));
+    if (bytes_read <= 0) {
+      return false;
+    }
+    buffer->append(data, bytes_read);
+    return true;
+  }
+
+  base::ScopedFD listen_sock_;
+  base::Lock lock_;
+  const size_t requests_per_connection_;
+  const bool announce_close_;
+  bool drop_extra_request_;
+  int port_;
+
+  // These are guarded by lock_.
+  int active_sock_;
+  bool stopping_;
+  size_t connections_;
+  size_t requests_;
+  std::string last_request_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeepAliveTestServer);
+};
+
+bool UploadBody(const std::string& url,
+                const std::string& body,
+                std::string* response_body) {
+  std::unique_ptr<HTTPTransport> transport(HTTPTransport::Create());
+  transport->SetURL(url);
+  transport->SetHeader(kContentLength,
+                       base::StringPrintf("%zu", body.size()));
+  transport->SetBodyStream(std::make_unique<StringHTTPBodyStream>(body));
+  return transport->ExecuteSynchronously(response_body);
+}
+
+bool Upload(const std::string& url, std::string* response_body) {
+  return UploadBody(url, "request", response_body);
+}
+
+TEST(HTTPTransportSocket, ReusesConnection) {
+  KeepAliveTestServer server(100, true);
+  ASSERT_TRUE(server.StartServer());
+
+  for (size_t index = 0; index < 5; ++index) {
+    std::string response_body;
+    EXPECT_TRUE(Upload(server.URL(), &response_body));
+    EXPECT_EQ(response_body, kResponseBody);
+  }
+
+  EXPECT_EQ(server.Requests(), 5u);
+  EXPECT_EQ(server.Connections(), 1u);
+
+  const std::string request = server.LastRequest();
+  EXPECT_EQ(request.find("POST /upload HTTP/1.1\r\n"), 0u);
+  EXPECT_NE(request.find(base::StringPrintf("\r\nHost: 127.0.0.1:%d\r\n",
+                                            server.port())),
+            std::string::npos);
+
+  server.StopServer();
+}
+
+TEST(HTTPTransportSocket, ConnectionClose) {
+  KeepAliveTestServer server(2, true);
+  ASSERT_TRUE(server.StartServer());
+
+  for (size_t index = 0; index < 5; ++index) {
+    std::string response_body;
+    EXPECT_TRUE(Upload(server.URL(), &response_body));
+    EXPECT_EQ(response_body, kResponseBody);
+  }
+
+  EXPECT_EQ(server.Requests(), 5u);
+  EXPECT_EQ(server.Connections(), 3u);
+
+  server.StopServer();
+}
+
+TEST(HTTPTransportSocket, ServerClosesIdleConnection) {
+  KeepAliveTestServer server(1, false);
+  ASSERT_TRUE(server.StartServer());
+
+  for (size_t index = 0; index < 3; ++index) {
+    std::string response_body;
+    EXPECT_TRUE(Upload(server.URL(), &response_body));
+    EXPECT_EQ(response_body, kResponseBody);
+
+    // Give the server’s close time to reach the client, as it would for a
+    // connection that had been idle.
+    SleepNanoseconds(100000000);
+  }
+
+  EXPECT_EQ(server.Requests(), 3u);
+  EXPECT_EQ(server.Connections(), 3u);
+
+  server.StopServer();
+}
+
+TEST(HTTPTransportSocket, RetriesDroppedRequest) {
+  KeepAliveTestServer server(1, false);
+  server.set_drop_extra_request(true);
+  ASSERT_TRUE(server.StartServer());
+
+  // The body is large enough that the server resets each reused connection
+  // while the request is still being written to it.
+  const std::string body(8 * 1024 * 1024, 'x');
+  for (size_t index = 0; index < 3; ++index) {
+    std::string response_body;
+    EXPECT_TRUE(UploadBody(server.URL(), body, &response_body));
+    EXPECT_EQ(response_body, kResponseBody);
+  }
+
+  EXPECT_EQ(server.Requests(), 3u);
+  EXPECT_EQ(server.Connections(), 3u);
+
+  server.StopServer();
+}
+
+TEST(HTTPTransportSocket, MultipartBodyFromFile) {
+  KeepAliveTestServer server(100, true);
+  ASSERT_TRUE(server.StartServer());
+
+  ScopedTempDir temp_dir;
+  base::FilePath path = temp_dir.path().Append(FILE_PATH_LITERAL("file"));
+  const std::string file_data = base::RandBytesAsString(200000);
+  {
+    FileWriter writer;
+    ASSERT_TRUE(writer.Open(
+        path, FileWriteMode::kCreateOrFail, FilePermissions::kOwnerOnly));
+    ASSERT_TRUE(writer.Write(file_data.data(), file_data.size()));
+  }
+
+  for (size_t index = 0; index < 2; ++index) {
+    FileReader reader;
+    ASSERT_TRUE(reader.Open(path));
+
+    // The file data is sent directly from the file, between parts that are
+    // sent from memory.
+    HTTPMultipartBuilder builder;
+    builder.SetFormData("key", "value");
+    builder.SetFileAttachment("file", "file.dat", &reader, "");
+
+    std::unique_ptr<HTTPTransport> transport(HTTPTransport::Create());
+    transport->SetURL(server.URL());
+    HTTPHeaders headers;
+    builder.PopulateContentHeaders(&headers);
+    for (const auto& header : headers) {
+      transport->SetHeader(header.first, header.second);
+    }
+    transport->SetBodyStream(builder.GetBodyStream());
+
+    std::string response_body;
+    ASSERT_TRUE(transport->ExecuteSynchronously(&response_body));
+    EXPECT_EQ(response_body, kResponseBody);
+
+    const std::string request = server.LastRequest();
+    const size_t body_start = request.find("\r\n\r\n") + 4;
+    EXPECT_EQ(base::StringPrintf("%zu", request.size() - body_start),
+              headers[kContentLength]);
+    EXPECT_NE(request.find("name=\"key\"\r\n\r\nvalue\r\n"),
+              std::string::npos);
+    EXPECT_NE(request.find("\r\n\r\n" + file_data + "\r\n--"),
+              std::string::npos);
+  }
+
+  EXPECT_EQ(server.Requests(), 2u);
+  EXPECT_EQ(server.Connections(), 1u);
+
+  server.StopServer();
+}
+
+// Runs in a child process traced by the parent, and stops itself around a
+// series of uploads so that the parent can count the system calls that they
+// make.
+void UploadChild(const std::string& url, size_t upload_count) {
+  // The first upload establishes the connection that the rest reuse.
+  std::string response_body;
+  if (!Upload(url, &response_body)) {
+    _exit(1);
+  }
+
+  if (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0) {
+    _exit(1);
+  }
+  raise(SIGSTOP);
+
+  // The cost of stopping, to be subtracted from the measurement.
+  raise(SIGSTOP);
+
+  for (size_t index = 0; index < upload_count; ++index) {
+    if (!Upload(url, &response_body)) {
+      _exit(1);
+    }
+  }
+  raise(SIGSTOP);
+
+  _exit(0);
+}
+
+TEST(HTTPTransportSocket, DISABLED_UploadSyscallsBenchmark) {
+  constexpr size_t kUploadCount = 100;
+
+  KeepAliveTestServer server(kUploadCount + 1, true);
+  ASSERT_TRUE(server.StartServer());
+
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0) << ErrnoMessage("fork");
+  if (pid == 0) {
+    UploadChild(server.URL(), kUploadCount);
+  }
+
+  int status;
+  ASSERT_EQ(HANDLE_EINTR(waitpid(pid, &status, 0)), pid)
+      << ErrnoMessage("waitpid");
+  ASSERT_TRUE(WIFSTOPPED(status));
+  ASSERT_EQ(WSTOPSIG(status), SIGSTOP);
+  ASSERT_EQ(ptrace(PTRACE_SETOPTIONS,
+                   pid,
+                   nullptr,
+                   PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL),
+            0)
+      << ErrnoMessage("ptrace");
+
+  // Each system call stops the child once on entry and once on exit.
+  std::vector<size_t> syscall_counts;
+  size_t syscall_stops = 0;
+  while (true) {
+    ASSERT_EQ(ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr), 0)
+        << ErrnoMessage("ptrace");
+    ASSERT_EQ(HANDLE_EINTR(waitpid(pid, &status, 0)), pid)
+        << ErrnoMessage("waitpid");
+    if (!WIFSTOPPED(status)) {
+      break;
+    }
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+      ++syscall_stops;
+    } else if (WSTOPSIG(status) == SIGSTOP) {
+      syscall_counts.push_back((syscall_stops + 1) / 2);
+      syscall_stops = 0;
+    }
+  }
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  ASSERT_EQ(syscall_counts.size(), 2u);
+
+  const size_t upload_syscalls = syscall_counts[1] - syscall_counts[0];
+  LOG(INFO) << kUploadCount << " uploads on one connection: "
+            << upload_syscalls << " system calls, "
+            << static_cast<double>(upload_syscalls) / kUploadCount
+            << " per upload";
+
+  server.StopServer();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
@@ -49,6 +49,28 @@ bool ProcessMemory::Read(VMAddress address, VMSize size, void* buffer) const {
   return true;
 }
 
+bool ProcessMemory::ReadMultiple(ReadRequest* requests, size_t count) const {
+  for (size_t index = 0; index < count; ++index) {
+    requests[index].succeeded = false;
+  }
+
+  ReadMultipleImpl(requests, count);
+
+  bool succeeded = true;
+  for (size_t index = 0; index < count; ++index) {
+    succeeded &= requests[index].succeeded;
+  }
+  return succeeded;
+}
+
+void ProcessMemory::ReadMultipleImpl(ReadRequest* requests,
+                                     size_t count) const {
+  for (size_t index = 0; index < count; ++index) {
+    ReadRequest& request = requests[index];
+    request.succeeded = Read(request.address, request.size, request.buffer);
+  }
+}
+
 bool ProcessMemory::ReadCStringInternal(VMAddress address,
                                         bool has_size,
                                         VMSize size,
@@ -34,6 +34,24 @@ namespace crashpad {
 //! Implementations are platform-specific.
 class ProcessMemory {
  public:
+  //! \brief A memory region to be copied by ReadMultiple().
+  struct ReadRequest {
+    //! \brief The address, in the target process’ address space, of the
+    //!     memory region to copy.
+    VMAddress address;
+
+    //! \brief The size, in bytes, of the memory region to copy.
+    size_t size;
+
+    //! \brief The buffer into which the region will be copied. This must be at
+    //!     least \a size bytes.
+    void* buffer;
+
+    //! \brief Set by ReadMultiple() to `true` if the entire region was copied
+    //!     into \a buffer, and `false` otherwise.
+    bool succeeded;
+  };
+
   //! \brief Copies memory from the target process into a caller-provided buffer
   //!     in the current process.
   //!
@@ -48,6 +66,20 @@ class ProcessMemory {
   //!     failure, with a message logged.
   bool Read(VMAddress address, VMSize size, void* buffer) const;
 
+  //! \brief Copies several memory regions from the target process into
+  //!     caller-provided buffers in the current process.
+  //!
+  //! The result is the same as calling Read() for each request in turn, but
+  //! implementations may copy many regions with a single system call.
+  //!
+  //! \param[in,out] requests The regions to copy. The `succeeded` field of each
+  //!     request is set to indicate whether that region was copied.
+  //! \param[in] count The number of elements in \a requests.
+  //!
+  //! \return `true` if every region was copied. `false` if any region could
+  //!     not be copied, with a message logged.
+  bool ReadMultiple(ReadRequest* requests, size_t count) const;
+
   //! \brief Reads a `NUL`-terminated C string from the target process into a
   //!     string in the current process.
   //!
@@ -89,6 +121,16 @@ class ProcessMemory {
  protected:
   ProcessMemory() = default;
 
+  //! \brief Copies several memory regions from the target process, setting
+  //!     the `succeeded` field of each request.
+  //!
+  //! The default implementation calls Read() for each request. Implementations
+  //! that can copy several regions at once should override this.
+  //!
+  //! \param[in,out] requests The regions to copy.
+  //! \param[in] count The number of elements in \a requests.
+  virtual void ReadMultipleImpl(ReadRequest* requests, size_t count) const;
+
  private:
   //! \brief Copies memory from the target process into a caller-provided buffer
   //!     in the current process, up to a maximum number of bytes.
@@ -127,7 +169,10 @@ class ProcessMemory {
                                    VMSize size,
                                    std::string* string) const;
 
-  // Allow ProcessMemorySanitized to call ReadUpTo.
+  // Allow ProcessMemoryCaching, ProcessMemoryPrefetched, and
+  // ProcessMemorySanitized to call ReadUpTo and ReadMultipleImpl.
+  friend class ProcessMemoryCaching;
+  friend class ProcessMemoryPrefetched;
   friend class ProcessMemorySanitized;
 };
 
@@ -0,0 +1,193 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/process/process_memory_caching.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/process/process_metrics.h"
+
+namespace crashpad {
+
+ProcessMemoryCaching::ProcessMemoryCaching()
+    : ProcessMemory(),
+      memory_(nullptr),
+      block_size_(0),
+      page_size_(0),
+      max_blocks_(0),
+      blocks_(),
+      block_order_(),
+      stats_(),
+      initialized_() {}
+
+ProcessMemoryCaching::~ProcessMemoryCaching() {}
+
+bool ProcessMemoryCaching::Initialize(const ProcessMemory* memory,
+                                      size_t block_size,
+                                      size_t capacity) {
+  INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
+
+  page_size_ = base::GetPageSize();
+  if (block_size == 0) {
+    block_size = page_size_;
+  }
+  if ((block_size & (block_size - 1)) != 0 || block_size % page_size_ != 0) {
+    LOG(ERROR) << "invalid block size " << block_size;
+    return false;
+  }
+
+  memory_ = memory;
+  block_size_ = block_size;
+  max_blocks_ = std::max(capacity / block_size_, size_t{1});
+
+  INITIALIZATION_STATE_SET_VALID(initialized_);
+  return true;
+}
+
+void ProcessMemoryCaching::Clear() {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  blocks_.clear();
+  block_order_.clear();
+}
+
+const ProcessMemoryCaching::Stats& ProcessMemoryCaching::GetStats() const {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  return stats_;
+}
+
+ssize_t ProcessMemoryCaching::ReadUpTo(VMAddress address,
+                                       size_t size,
+                                       void* buffer) const {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  if (size > block_size_) {
+    ++stats_.uncached_reads;
+    ++stats_.underlying_reads;
+    return memory_->ReadUpTo(address, size, buffer);
+  }
+
+  const VMAddress block_address = address & ~VMAddress{block_size_ - 1};
+  const size_t offset = static_cast<size_t>(address - block_address);
+
+  bool read_failed;
+  const Block* block = GetBlock(block_address, &read_failed);
+  if (read_failed && offset < page_size_) {
+    // The page containing address is unreadable, and the failure was logged
+    // when the block was fetched.
+    return -1;
+  }
+
+  if (!block || offset >= block->valid_size) {
+    // The block was only partially readable and doesn’t cover address. Read
+    // directly so that the result and any error are reported exactly as the
+    // underlying memory object would report them.
+    ++stats_.underlying_reads;
+    return memory_->ReadUpTo(address, size, buffer);
+  }
+
+  const size_t copy_size = std::min(size, block->valid_size - offset);
+  memcpy(buffer, &block->data[offset], copy_size);
+  return copy_size;
+}
+
+void ProcessMemoryCaching::ReadMultipleImpl(ReadRequest* requests,
+                                            size_t count) const {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  // Requests that can be served entirely from cached blocks are. The rest are
+  // passed to the underlying memory object together, without fetching blocks,
+  // because batched requests are generally not read more than once.
+  std::vector<ReadRequest> uncached_requests;
+  std::vector<size_t> uncached_indices;
+  for (size_t index = 0; index < count; ++index) {
+    ReadRequest& request = requests[index];
+    if (request.size <= block_size_ &&
+        IsCached(request.address, request.size)) {
+      request.succeeded = Read(request.address, request.size, request.buffer);
+    } else {
+      uncached_requests.push_back(request);
+      uncached_indices.push_back(index);
+    }
+  }
+
+  if (uncached_requests.empty()) {
+    return;
+  }
+
+  stats_.uncached_reads += uncached_requests.size();
+  ++stats_.underlying_reads;
+  memory_->ReadMultipleImpl(&uncached_requests[0], uncached_requests.size());
+  for (size_t index = 0; index < uncached_requests.size(); ++index) {
+    requests[uncached_indices[index]].succeeded =
+        uncached_requests[index].succeeded;
+  }
+}
+
+bool ProcessMemoryCaching::IsCached(VMAddress address, size_t size) const {
+  const VMAddress end = address + size;
+  for (VMAddress block_address = address & ~VMAddress{block_size_ - 1};
+       block_address < end;
+       block_address += block_size_) {
+    auto iterator = blocks_.find(block_address);
+    if (iterator == blocks_.end() ||
+        iterator->second.valid_size < std::min(end - block_address,
+                                               VMAddress{block_size_})) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const ProcessMemoryCaching::Block* ProcessMemoryCaching::GetBlock(
+    VMAddress block_address,
+    bool* read_failed) const {
+  *read_failed = false;
+
+  auto iterator = blocks_.find(block_address);
+  if (iterator != blocks_.end()) {
+    ++stats_.hits;
+    return &iterator->second;
+  }
+
+  ++stats_.misses;
+
+  // A short read means that the rest of the block is unreadable. The block is
+  // read only once so that the unreadable part doesn’t log an error unless
+  // it’s actually requested.
+  Block block;
+  block.data.reset(new uint8_t[block_size_]);
+  ++stats_.underlying_reads;
+  ssize_t bytes_read =
+      memory_->ReadUpTo(block_address, block_size_, block.data.get());
+  if (bytes_read <= 0) {
+    *read_failed = bytes_read < 0;
+    return nullptr;
+  }
+  block.valid_size = bytes_read;
+
+  while (blocks_.size() >= max_blocks_) {
+    blocks_.erase(block_order_.front());
+    block_order_.pop_front();
+  }
+
+  block_order_.push_back(block_address);
+  return &blocks_.insert(std::make_pair(block_address, std::move(block)))
+              .first->second;
+}
+
+}  // namespace crashpad
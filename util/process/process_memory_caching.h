@@ -0,0 +1,137 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_UTIL_PROCESS_PROCESS_MEMORY_CACHING_H_
+#define CRASHPAD_UTIL_PROCESS_PROCESS_MEMORY_CACHING_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/macros.h"
+#include "util/misc/address_types.h"
+#include "util/misc/initialization_state_dcheck.h"
+#include "util/process/process_memory.h"
+
+namespace crashpad {
+
+//! \brief Caches aligned blocks of another process’ memory to serve repeated
+//!     small reads without going back to the underlying ProcessMemory.
+//!
+//! Reads no larger than the block size are satisfied from a cached copy of
+//! the aligned block containing the requested address, fetching the block
+//! from the underlying ProcessMemory the first time it is needed. Larger reads
+//! are passed directly to the underlying ProcessMemory and are not cached.
+//! ReadMultiple() serves requests that are already cached and passes the rest
+//! to the underlying ProcessMemory in a single batch, without caching them.
+//!
+//! The cache is never invalidated on its own, so it must only be used while
+//! the target process is suspended, such as for the duration of a single
+//! snapshot. Call Clear() to discard cached data.
+//!
+//! This class is not thread-safe.
+class ProcessMemoryCaching final : public ProcessMemory {
+ public:
+  //! \brief Counters describing the effectiveness of the cache.
+  struct Stats {
+    //! \brief The number of reads issued to the underlying ProcessMemory.
+    //!
+    //! For ProcessMemoryLinux, each of these is a system call. A batch of
+    //! requests from ReadMultiple() is counted once.
+    uint64_t underlying_reads;
+
+    //! \brief The number of reads served from an already-cached block.
+    uint64_t hits;
+
+    //! \brief The number of reads that required a block to be fetched.
+    uint64_t misses;
+
+    //! \brief The number of reads passed directly to the underlying
+    //!     ProcessMemory, either because they were too large to be cached or
+    //!     because they were part of a ReadMultiple() batch.
+    uint64_t uncached_reads;
+  };
+
+  //! \brief The default maximum amount of memory, in bytes, that will be held
+  //!     in cached blocks.
+  static constexpr size_t kDefaultCapacity = 4 * 1024 * 1024;
+
+  ProcessMemoryCaching();
+  ~ProcessMemoryCaching();
+
+  //! \brief Initializes this object to cache reads from \a memory.
+  //!
+  //! This method must be called successfully prior to calling any other method
+  //! in this class.
+  //!
+  //! \param[in] memory The memory object to read from. Weak.
+  //! \param[in] block_size The size and alignment of cached blocks. This must
+  //!     be a power of 2 and a multiple of the page size. If `0`, the page
+  //!     size is used.
+  //! \param[in] capacity The maximum number of bytes to hold in cached blocks.
+  //!     When adding a block would exceed this, the oldest blocks are
+  //!     discarded.
+  //!
+  //! \return `true` on success, `false` on failure with a message logged.
+  bool Initialize(const ProcessMemory* memory,
+                  size_t block_size = 0,
+                  size_t capacity = kDefaultCapacity);
+
+  //! \brief Discards all cached blocks.
+  //!
+  //! Counters returned by GetStats() are not reset.
+  void Clear();
+
+  //! \brief Returns counters describing how reads have been served.
+  const Stats& GetStats() const;
+
+ private:
+  struct Block {
+    std::unique_ptr<uint8_t[]> data;
+
+    // The number of bytes at the start of data that were read successfully.
+    size_t valid_size;
+  };
+
+  ssize_t ReadUpTo(VMAddress address, size_t size, void* buffer) const override;
+  void ReadMultipleImpl(ReadRequest* requests, size_t count) const override;
+
+  // Returns true if every byte in [address, address + size) is in a cached
+  // block.
+  bool IsCached(VMAddress address, size_t size) const;
+
+  // Returns the cached block at block_address, fetching it if necessary.
+  // Returns nullptr if no part of the block could be read, setting read_failed
+  // if the underlying memory object reported an error.
+  const Block* GetBlock(VMAddress block_address, bool* read_failed) const;
+
+  const ProcessMemory* memory_;  // weak
+  size_t block_size_;
+  size_t page_size_;
+  size_t max_blocks_;
+  mutable std::map<VMAddress, Block> blocks_;
+  mutable std::deque<VMAddress> block_order_;
+  mutable Stats stats_;
+  InitializationStateDcheck initialized_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProcessMemoryCaching);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_UTIL_PROCESS_PROCESS_MEMORY_CACHING_H_
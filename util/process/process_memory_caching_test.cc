@@ -0,0 +1,241 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/process/process_memory_caching.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/process/process_metrics.h"
+#include "base/stl_util.h"
+#include "gtest/gtest.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+// A ProcessMemory backed by a local buffer, of which only a prefix is readable.
+// Like /proc/pid/mem, a read that starts in the readable prefix and extends
+// past it is short, and a read that starts beyond it fails.
+class FakeProcessMemory : public ProcessMemory {
+ public:
+  FakeProcessMemory(VMAddress base, size_t size, size_t readable_size)
+      : ProcessMemory(),
+        data_(size),
+        base_(base),
+        readable_size_(readable_size),
+        reads_(0) {
+    for (size_t index = 0; index < size; ++index) {
+      data_[index] = static_cast<uint8_t>(index % 255 + 1);
+    }
+  }
+
+  ~FakeProcessMemory() {}
+
+  uint8_t* Data() { return data_.data(); }
+  VMAddress Base() const { return base_; }
+  size_t Reads() const { return reads_; }
+
+ private:
+  ssize_t ReadUpTo(VMAddress address,
+                   size_t size,
+                   void* buffer) const override {
+    ++reads_;
+    if (address < base_ || address >= base_ + readable_size_) {
+      LOG(ERROR) << "unreadable";
+      return -1;
+    }
+    size_t offset = address - base_;
+    size_t copy_size = std::min(size, readable_size_ - offset);
+    memcpy(buffer, &data_[offset], copy_size);
+    return copy_size;
+  }
+
+  std::vector<uint8_t> data_;
+  VMAddress base_;
+  size_t readable_size_;
+  mutable size_t reads_;
+
+  DISALLOW_COPY_AND_ASSIGN(FakeProcessMemory);
+};
+
+TEST(ProcessMemoryCaching, RepeatedReadsAreCached) {
+  const size_t page_size = base::GetPageSize();
+  FakeProcessMemory memory(page_size * 16, page_size * 4, page_size * 4);
+
+  ProcessMemoryCaching cache;
+  ASSERT_TRUE(cache.Initialize(&memory));
+
+  uint8_t buffer[64];
+  for (size_t iteration = 0; iteration < 10; ++iteration) {
+    for (size_t offset = 0; offset < page_size * 4; offset += page_size / 4) {
+      ASSERT_TRUE(
+          cache.Read(memory.Base() + offset, sizeof(buffer), buffer));
+      EXPECT_EQ(memcmp(buffer, memory.Data() + offset, sizeof(buffer)), 0);
+    }
+  }
+
+  const ProcessMemoryCaching::Stats& stats = cache.GetStats();
+  EXPECT_EQ(stats.misses, 4u);
+  EXPECT_EQ(stats.hits, 10u * 16u - 4u);
+  EXPECT_EQ(stats.uncached_reads, 0u);
+  EXPECT_EQ(stats.underlying_reads, 4u);
+  EXPECT_EQ(memory.Reads(), 4u);
+}
+
+TEST(ProcessMemoryCaching, ReadsSpanningBlocks) {
+  const size_t page_size = base::GetPageSize();
+  FakeProcessMemory memory(page_size * 16, page_size * 4, page_size * 4);
+
+  ProcessMemoryCaching cache;
+  ASSERT_TRUE(cache.Initialize(&memory));
+
+  std::vector<uint8_t> buffer(page_size);
+  VMAddress address = memory.Base() + page_size / 2;
+  ASSERT_TRUE(cache.Read(address, buffer.size(), buffer.data()));
+  EXPECT_EQ(memcmp(buffer.data(), memory.Data() + page_size / 2, page_size),
+            0);
+  EXPECT_EQ(cache.GetStats().misses, 2u);
+
+  std::string string;
+  memory.Data()[page_size * 2 + 10] = '\0';
+  ASSERT_TRUE(cache.ReadCString(address, &string));
+  EXPECT_EQ(string.size(), page_size * 3 / 2 + 10);
+  EXPECT_EQ(cache.GetStats().misses, 3u);
+}
+
+TEST(ProcessMemoryCaching, LargeReadsAreNotCached) {
+  const size_t page_size = base::GetPageSize();
+  FakeProcessMemory memory(page_size * 16, page_size * 4, page_size * 4);
+
+  ProcessMemoryCaching cache;
+  ASSERT_TRUE(cache.Initialize(&memory));
+
+  std::vector<uint8_t> buffer(page_size * 3);
+  ASSERT_TRUE(cache.Read(memory.Base(), buffer.size(), buffer.data()));
+  EXPECT_EQ(memcmp(buffer.data(), memory.Data(), buffer.size()), 0);
+
+  const ProcessMemoryCaching::Stats& stats = cache.GetStats();
+  EXPECT_EQ(stats.uncached_reads, 1u);
+  EXPECT_EQ(stats.misses, 0u);
+  EXPECT_EQ(stats.hits, 0u);
+}
+
+TEST(ProcessMemoryCaching, UnreadableMemory) {
+  const size_t page_size = base::GetPageSize();
+  FakeProcessMemory memory(page_size * 16, page_size * 4, page_size * 3 / 2);
+
+  ProcessMemoryCaching cache;
+  ASSERT_TRUE(cache.Initialize(&memory, page_size * 2));
+
+  uint8_t buffer[16];
+  EXPECT_TRUE(cache.Read(memory.Base() + page_size, sizeof(buffer), buffer));
+  EXPECT_EQ(memcmp(buffer, memory.Data() + page_size, sizeof(buffer)), 0);
+
+  // The end of the readable region.
+  EXPECT_TRUE(cache.Read(memory.Base() + page_size * 3 / 2 - sizeof(buffer),
+                         sizeof(buffer),
+                         buffer));
+  EXPECT_FALSE(cache.Read(memory.Base() + page_size * 3 / 2 - sizeof(buffer),
+                          sizeof(buffer) + 1,
+                          buffer));
+
+  // Past the readable part of a cached block.
+  EXPECT_FALSE(
+      cache.Read(memory.Base() + page_size * 3 / 2, sizeof(buffer), buffer));
+
+  // A block that is entirely unreadable.
+  EXPECT_FALSE(
+      cache.Read(memory.Base() + page_size * 2, sizeof(buffer), buffer));
+  EXPECT_FALSE(
+      cache.Read(memory.Base() + page_size * 3, sizeof(buffer), buffer));
+}
+
+TEST(ProcessMemoryCaching, ClearAndCapacity) {
+  const size_t page_size = base::GetPageSize();
+  FakeProcessMemory memory(page_size * 16, page_size * 4, page_size * 4);
+
+  ProcessMemoryCaching cache;
+  ASSERT_TRUE(cache.Initialize(&memory, 0, page_size * 2));
+
+  uint8_t value;
+  ASSERT_TRUE(cache.Read(memory.Base(), sizeof(value), &value));
+  EXPECT_EQ(value, memory.Data()[0]);
+
+  // Cached data is returned even after the underlying memory changes.
+  memory.Data()[0] = value + 1;
+  ASSERT_TRUE(cache.Read(memory.Base(), sizeof(value), &value));
+  EXPECT_NE(value, memory.Data()[0]);
+
+  cache.Clear();
+  ASSERT_TRUE(cache.Read(memory.Base(), sizeof(value), &value));
+  EXPECT_EQ(value, memory.Data()[0]);
+  EXPECT_EQ(cache.GetStats().misses, 2u);
+
+  // Only two blocks fit, so reading a third evicts the first.
+  ASSERT_TRUE(cache.Read(memory.Base() + page_size, sizeof(value), &value));
+  ASSERT_TRUE(
+      cache.Read(memory.Base() + page_size * 2, sizeof(value), &value));
+  ASSERT_TRUE(cache.Read(memory.Base(), sizeof(value), &value));
+  EXPECT_EQ(cache.GetStats().misses, 5u);
+}
+
+TEST(ProcessMemoryCaching, ReadMultiple) {
+  const size_t page_size = base::GetPageSize();
+  FakeProcessMemory memory(page_size * 16, page_size * 4, page_size * 4);
+
+  ProcessMemoryCaching cache;
+  ASSERT_TRUE(cache.Initialize(&memory));
+
+  uint8_t value;
+  ASSERT_TRUE(cache.Read(memory.Base(), sizeof(value), &value));
+
+  // The first request is served from the cached block. The others are passed
+  // to the underlying memory object without being cached.
+  std::vector<uint8_t> buffer(page_size * 3);
+  ProcessMemory::ReadRequest requests[] = {
+      {memory.Base() + 16, 16, &buffer[0], false},
+      {memory.Base() + page_size + 16, 16, &buffer[16], false},
+      {memory.Base() + page_size, page_size * 2, &buffer[page_size], false},
+  };
+  ASSERT_TRUE(cache.ReadMultiple(requests, base::size(requests)));
+  for (const ProcessMemory::ReadRequest& request : requests) {
+    EXPECT_TRUE(request.succeeded);
+    EXPECT_EQ(memcmp(request.buffer,
+                     memory.Data() + (request.address - memory.Base()),
+                     request.size),
+              0);
+  }
+
+  const ProcessMemoryCaching::Stats& stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.uncached_reads, 2u);
+  EXPECT_EQ(stats.underlying_reads, 2u);
+}
+
+TEST(ProcessMemoryCaching, InvalidBlockSize) {
+  FakeProcessMemory memory(0, 0, 0);
+
+  ProcessMemoryCaching cache;
+  EXPECT_FALSE(cache.Initialize(&memory, base::GetPageSize() + 1));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
@@ -14,19 +14,42 @@
 
 #include "util/process/process_memory_linux.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <limits>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/posix/eintr_wrapper.h"
 
 namespace crashpad {
 
+namespace {
+
+// The maximum number of regions passed to a single process_vm_readv() call.
+// The kernel rejects calls with more than UIO_MAXIOV (1024) iovecs.
+constexpr size_t kMaxIovecs = 1024;
+
+// process_vm_readv() is called through syscall() because older C libraries,
+// including Bionic prior to API level 23, don’t provide a wrapper.
+ssize_t ProcessVMReadv(pid_t pid,
+                       const iovec* local,
+                       size_t local_count,
+                       const iovec* remote,
+                       size_t remote_count) {
+  return syscall(
+      SYS_process_vm_readv, pid, local, local_count, remote, remote_count, 0);
+}
+
+}  // namespace
+
 ProcessMemoryLinux::ProcessMemoryLinux()
     : ProcessMemory(), mem_fd_(), pid_(-1), initialized_() {}
 
@@ -61,4 +84,57 @@ ssize_t ProcessMemoryLinux::ReadUpTo(VMAddress address,
   return bytes_read;
 }
 
+void ProcessMemoryLinux::ReadMultipleImpl(ReadRequest* requests,
+                                          size_t count) const {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  // process_vm_readv() copies the regions in order and stops at the first one
+  // that can’t be copied in full, so every region before that point succeeded.
+  // The region that stopped the copy is then read with Read() so that
+  // partially-readable regions and errors are handled exactly as Read() would
+  // handle them, and copying resumes with the region after it.
+  std::vector<iovec> local(std::min(count, kMaxIovecs));
+  std::vector<iovec> remote(local.size());
+  size_t index = 0;
+  while (index < count) {
+    const size_t batch_count = std::min(count - index, kMaxIovecs);
+    for (size_t batch_index = 0; batch_index < batch_count; ++batch_index) {
+      const ReadRequest& request = requests[index + batch_index];
+      local[batch_index].iov_base = request.buffer;
+      local[batch_index].iov_len = request.size;
+      remote[batch_index].iov_base =
+          reinterpret_cast<void*>(static_cast<uintptr_t>(request.address));
+      remote[batch_index].iov_len = request.size;
+    }
+
+    ssize_t bytes_read =
+        ProcessVMReadv(pid_, &local[0], batch_count, &remote[0], batch_count);
+    if (bytes_read < 0) {
+      if (errno == ENOSYS || errno == EPERM) {
+        // process_vm_readv() is unavailable or not permitted, but /proc/pid/mem
+        // may still be readable.
+        ProcessMemory::ReadMultipleImpl(requests + index, count - index);
+        return;
+      }
+      bytes_read = 0;
+    }
+
+    size_t bytes_remaining = bytes_read;
+    size_t batch_index = 0;
+    while (batch_index < batch_count &&
+           requests[index + batch_index].size <= bytes_remaining) {
+      requests[index + batch_index].succeeded = true;
+      bytes_remaining -= requests[index + batch_index].size;
+      ++batch_index;
+    }
+    index += batch_index;
+
+    if (batch_index < batch_count) {
+      ReadRequest& request = requests[index];
+      request.succeeded = Read(request.address, request.size, request.buffer);
+      ++index;
+    }
+  }
+}
+
 }  // namespace crashpad
@@ -46,6 +46,7 @@ class ProcessMemoryLinux final : public ProcessMemory {
 
  private:
   ssize_t ReadUpTo(VMAddress address, size_t size, void* buffer) const override;
+  void ReadMultipleImpl(ReadRequest* requests, size_t count) const override;
 
   base::ScopedFD mem_fd_;
   pid_t pid_;
@@ -0,0 +1,140 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/process/process_memory_prefetched.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace crashpad {
+
+ProcessMemoryPrefetched::ProcessMemoryPrefetched()
+    : ProcessMemory(), memory_(nullptr), regions_(), initialized_() {}
+
+ProcessMemoryPrefetched::~ProcessMemoryPrefetched() {}
+
+void ProcessMemoryPrefetched::Initialize(const ProcessMemory* memory) {
+  INITIALIZATION_STATE_SET_INITIALIZING(initialized_);
+  memory_ = memory;
+  INITIALIZATION_STATE_SET_VALID(initialized_);
+}
+
+bool ProcessMemoryPrefetched::Prefetch(VMAddress address, size_t size) {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  size_t available;
+  if (FindPrefetched(address, &available) && available >= size) {
+    return true;
+  }
+
+  std::vector<uint8_t> data(size);
+  size_t data_size = 0;
+  while (data_size < size) {
+    ssize_t bytes_read = memory_->ReadUpTo(
+        address + data_size, size - data_size, &data[data_size]);
+    if (bytes_read <= 0) {
+      break;
+    }
+    data_size += bytes_read;
+  }
+
+  if (data_size > 0) {
+    data.resize(data_size);
+    regions_[address] = std::move(data);
+  }
+  return data_size == size;
+}
+
+size_t ProcessMemoryPrefetched::PrefetchedSize() const {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+  size_t size = 0;
+  for (const auto& region : regions_) {
+    size += region.second.size();
+  }
+  return size;
+}
+
+ssize_t ProcessMemoryPrefetched::ReadUpTo(VMAddress address,
+                                          size_t size,
+                                          void* buffer) const {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  size_t available;
+  const uint8_t* data = FindPrefetched(address, &available);
+  if (!data) {
+    return memory_->ReadUpTo(address, size, buffer);
+  }
+
+  // A read that extends past the end of the region is short, and the caller
+  // reads the rest from the underlying memory object.
+  const size_t copy_size = std::min(size, available);
+  memcpy(buffer, data, copy_size);
+  return copy_size;
+}
+
+void ProcessMemoryPrefetched::ReadMultipleImpl(ReadRequest* requests,
+                                               size_t count) const {
+  INITIALIZATION_STATE_DCHECK_VALID(initialized_);
+
+  // Requests within a prefetched region are served locally. The rest are
+  // passed to the underlying memory object together.
+  std::vector<ReadRequest> remaining_requests;
+  std::vector<size_t> remaining_indices;
+  for (size_t index = 0; index < count; ++index) {
+    ReadRequest& request = requests[index];
+    size_t available;
+    const uint8_t* data = FindPrefetched(request.address, &available);
+    if (data && available >= request.size) {
+      memcpy(request.buffer, data, request.size);
+      request.succeeded = true;
+    } else {
+      remaining_requests.push_back(request);
+      remaining_indices.push_back(index);
+    }
+  }
+
+  if (remaining_requests.empty()) {
+    return;
+  }
+
+  memory_->ReadMultipleImpl(&remaining_requests[0], remaining_requests.size());
+  for (size_t index = 0; index < remaining_requests.size(); ++index) {
+    requests[remaining_indices[index]].succeeded =
+        remaining_requests[index].succeeded;
+  }
+}
+
+const uint8_t* ProcessMemoryPrefetched::FindPrefetched(
+    VMAddress address,
+    size_t* available) const {
+  // Only the region that starts closest to address is considered. If regions
+  // overlap, an address covered only by an earlier region is read from the
+  // underlying memory object instead, which is correct but slower.
+  auto region = regions_.upper_bound(address);
+  if (region == regions_.begin()) {
+    return nullptr;
+  }
+  --region;
+
+  const VMAddress offset = address - region->first;
+  if (offset >= region->second.size()) {
+    return nullptr;
+  }
+  *available = region->second.size() - static_cast<size_t>(offset);
+  return &region->second[static_cast<size_t>(offset)];
+}
+
+}  // namespace crashpad
@@ -0,0 +1,90 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_UTIL_PROCESS_PROCESS_MEMORY_PREFETCHED_H_
+#define CRASHPAD_UTIL_PROCESS_PROCESS_MEMORY_PREFETCHED_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <map>
+#include <vector>
+
+#include "base/macros.h"
+#include "util/misc/address_types.h"
+#include "util/misc/initialization_state_dcheck.h"
+#include "util/process/process_memory.h"
+
+namespace crashpad {
+
+//! \brief Serves reads of selected regions of another process’ memory from
+//!     local copies made in advance.
+//!
+//! Regions are copied from the underlying ProcessMemory by Prefetch(), each in
+//! as few reads as the underlying ProcessMemory allows. Later reads that fall
+//! within a prefetched region are served from the local copy, and all other
+//! reads are passed to the underlying ProcessMemory.
+//!
+//! Prefetched regions are never refreshed, so this must only be used while the
+//! target process is suspended.
+//!
+//! This class is not thread-safe.
+class ProcessMemoryPrefetched final : public ProcessMemory {
+ public:
+  ProcessMemoryPrefetched();
+  ~ProcessMemoryPrefetched();
+
+  //! \brief Initializes this object to read from \a memory.
+  //!
+  //! This method must be called prior to calling any other method in this
+  //! class.
+  //!
+  //! \param[in] memory The memory object to read from. Weak.
+  void Initialize(const ProcessMemory* memory);
+
+  //! \brief Copies a region of the underlying ProcessMemory so that later reads
+  //!     within it are served locally.
+  //!
+  //! If only a leading part of the region is readable, that part is kept. A
+  //! region that lies within an already-prefetched region is not read again.
+  //!
+  //! \param[in] address The address of the region.
+  //! \param[in] size The size of the region.
+  //! \return `true` if the entire region is available locally. `false` if only
+  //!     part or none of it could be read, with a message logged if the
+  //!     underlying ProcessMemory reported an error.
+  bool Prefetch(VMAddress address, size_t size);
+
+  //! \brief Returns the total size, in bytes, of the prefetched regions.
+  size_t PrefetchedSize() const;
+
+ private:
+  ssize_t ReadUpTo(VMAddress address, size_t size, void* buffer) const override;
+  void ReadMultipleImpl(ReadRequest* requests, size_t count) const override;
+
+  // Returns the local copy of the memory at address and sets available to the
+  // number of bytes in it from address to the end of its region, or returns
+  // nullptr if address isn’t in a prefetched region.
+  const uint8_t* FindPrefetched(VMAddress address, size_t* available) const;
+
+  const ProcessMemory* memory_;  // weak
+  std::map<VMAddress, std::vector<uint8_t>> regions_;
+  InitializationStateDcheck initialized_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProcessMemoryPrefetched);
+};
+
+}  // namespace crashpad
+
+#endif  // CRASHPAD_UTIL_PROCESS_PROCESS_MEMORY_PREFETCHED_H_
@@ -0,0 +1,187 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/process/process_memory_prefetched.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/stl_util.h"
+#include "gtest/gtest.h"
+
+namespace crashpad {
+namespace test {
+namespace {
+
+// A ProcessMemory backed by a local buffer, of which only a prefix is readable.
+// Like /proc/pid/mem, a read that starts in the readable prefix and extends
+// past it is short, and a read that starts beyond it fails.
+class FakeProcessMemory : public ProcessMemory {
+ public:
+  FakeProcessMemory(VMAddress base, size_t size, size_t readable_size)
+      : ProcessMemory(),
+        data_(size),
+        base_(base),
+        readable_size_(readable_size),
+        reads_(0) {
+    for (size_t index = 0; index < size; ++index) {
+      data_[index] = static_cast<uint8_t>(index % 255 + 1);
+    }
+  }
+
+  ~FakeProcessMemory() {}
+
+  uint8_t* Data() { return data_.data(); }
+  VMAddress Base() const { return base_; }
+  size_t Reads() const { return reads_; }
+
+ private:
+  ssize_t ReadUpTo(VMAddress address,
+                   size_t size,
+                   void* buffer) const override {
+    ++reads_;
+    if (address < base_ || address >= base_ + readable_size_) {
+      LOG(ERROR) << "unreadable";
+      return -1;
+    }
+    size_t offset = address - base_;
+    size_t copy_size = std::min(size, readable_size_ - offset);
+    memcpy(buffer, &data_[offset], copy_size);
+    return copy_size;
+  }
+
+  std::vector<uint8_t> data_;
+  VMAddress base_;
+  size_t readable_size_;
+  mutable size_t reads_;
+
+  DISALLOW_COPY_AND_ASSIGN(FakeProcessMemory);
+};
+
+TEST(ProcessMemoryPrefetched, PrefetchedReadsAreLocal) {
+  FakeProcessMemory memory(0x10000, 4096, 4096);
+
+  ProcessMemoryPrefetched prefetched;
+  prefetched.Initialize(&memory);
+  ASSERT_TRUE(prefetched.Prefetch(memory.Base() + 256, 1024));
+  EXPECT_EQ(memory.Reads(), 1u);
+  EXPECT_EQ(prefetched.PrefetchedSize(), 1024u);
+
+  uint8_t buffer[64];
+  for (size_t offset = 256; offset + sizeof(buffer) <= 1280; offset += 32) {
+    ASSERT_TRUE(
+        prefetched.Read(memory.Base() + offset, sizeof(buffer), buffer));
+    EXPECT_EQ(memcmp(buffer, memory.Data() + offset, sizeof(buffer)), 0);
+  }
+  EXPECT_EQ(memory.Reads(), 1u);
+
+  // A region within the prefetched region isn’t read again.
+  EXPECT_TRUE(prefetched.Prefetch(memory.Base() + 512, 256));
+  EXPECT_EQ(memory.Reads(), 1u);
+
+  // Reads outside of the region, and the part of a read that extends past
+  // it, go to the underlying memory object.
+  ASSERT_TRUE(prefetched.Read(memory.Base(), sizeof(buffer), buffer));
+  EXPECT_EQ(memcmp(buffer, memory.Data(), sizeof(buffer)), 0);
+  EXPECT_EQ(memory.Reads(), 2u);
+
+  ASSERT_TRUE(prefetched.Read(
+      memory.Base() + 1280 - sizeof(buffer) / 2, sizeof(buffer), buffer));
+  EXPECT_EQ(memcmp(buffer,
+                   memory.Data() + 1280 - sizeof(buffer) / 2,
+                   sizeof(buffer)),
+            0);
+  EXPECT_EQ(memory.Reads(), 3u);
+}
+
+TEST(ProcessMemoryPrefetched, Strings) {
+  FakeProcessMemory memory(0x10000, 4096, 4096);
+  memory.Data()[100] = '\0';
+  memory.Data()[300] = '\0';
+
+  ProcessMemoryPrefetched prefetched;
+  prefetched.Initialize(&memory);
+  ASSERT_TRUE(prefetched.Prefetch(memory.Base(), 200));
+  EXPECT_EQ(memory.Reads(), 1u);
+
+  std::string string;
+  ASSERT_TRUE(prefetched.ReadCString(memory.Base() + 10, &string));
+  EXPECT_EQ(string.size(), 90u);
+  EXPECT_EQ(memory.Reads(), 1u);
+
+  // A string that continues past the end of the region is completed from the
+  // underlying memory object.
+  ASSERT_TRUE(prefetched.ReadCString(memory.Base() + 150, &string));
+  EXPECT_EQ(string.size(), 150u);
+  EXPECT_EQ(memcmp(string.data(), memory.Data() + 150, string.size()), 0);
+  EXPECT_EQ(memory.Reads(), 2u);
+}
+
+TEST(ProcessMemoryPrefetched, UnreadableMemory) {
+  FakeProcessMemory memory(0x10000, 4096, 1024);
+
+  ProcessMemoryPrefetched prefetched;
+  prefetched.Initialize(&memory);
+
+  // Only the readable part of the region is kept.
+  EXPECT_FALSE(prefetched.Prefetch(memory.Base() + 512, 1024));
+  EXPECT_EQ(prefetched.PrefetchedSize(), 512u);
+
+  uint8_t buffer[16];
+  const size_t reads = memory.Reads();
+  EXPECT_TRUE(prefetched.Read(
+      memory.Base() + 1024 - sizeof(buffer), sizeof(buffer), buffer));
+  EXPECT_EQ(memory.Reads(), reads);
+  EXPECT_FALSE(prefetched.Read(
+      memory.Base() + 1024 - sizeof(buffer), sizeof(buffer) + 1, buffer));
+  EXPECT_FALSE(prefetched.Read(memory.Base() + 1024, sizeof(buffer), buffer));
+
+  // Nothing is kept for a region that is entirely unreadable.
+  EXPECT_FALSE(prefetched.Prefetch(memory.Base() + 2048, 1024));
+  EXPECT_EQ(prefetched.PrefetchedSize(), 512u);
+}
+
+TEST(ProcessMemoryPrefetched, ReadMultiple) {
+  FakeProcessMemory memory(0x10000, 4096, 4096);
+
+  ProcessMemoryPrefetched prefetched;
+  prefetched.Initialize(&memory);
+  ASSERT_TRUE(prefetched.Prefetch(memory.Base(), 1024));
+
+  // The first request is served from the prefetched region. The others are
+  // passed to the underlying memory object.
+  std::vector<uint8_t> buffer(3072);
+  ProcessMemory::ReadRequest requests[] = {
+      {memory.Base() + 16, 16, &buffer[0], false},
+      {memory.Base() + 1016, 16, &buffer[16], false},
+      {memory.Base() + 2048, 1024, &buffer[1024], false},
+  };
+  ASSERT_TRUE(prefetched.ReadMultiple(requests, base::size(requests)));
+  for (const ProcessMemory::ReadRequest& request : requests) {
+    EXPECT_TRUE(request.succeeded);
+    EXPECT_EQ(memcmp(request.buffer,
+                     memory.Data() + (request.address - memory.Base()),
+                     request.size),
+              0);
+  }
+  EXPECT_EQ(memory.Reads(), 3u);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace crashpad
@@ -76,6 +76,9 @@ class ProcessMemoryRange {
   //! \brief Returns the size of the range.
   VMSize Size() const { return range_.Size(); }
 
+  //! \brief Returns the memory reader that this object delegates to.
+  const ProcessMemory* Memory() const { return memory_; }
+
   //! \brief Shrinks the range to the new base and size.
   //!
   //! The new range must be contained within the existing range for this object.
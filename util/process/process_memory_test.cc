@@ -19,6 +19,7 @@
 #include <memory>
 
 #include "base/process/process_metrics.h"
+#include "base/stl_util.h"
 #include "build/build_config.h"
 #include "gtest/gtest.h"
 #include "test/errors.h"
@@ -197,6 +198,25 @@ class ReadTest : public MultiprocessAdaptor {
     ASSERT_TRUE(memory.Read(address + 2, 1, result.get()));
     EXPECT_EQ(result[0], 2);
     EXPECT_EQ(result[1], 'J');
+
+    // Ensure that several regions, including empty and unaligned ones, can be
+    // read at once.
+    memset(result.get(), '\0', region_size);
+    ProcessMemory::ReadRequest requests[4];
+    requests[0] = {address + page_size + 3, page_size - 3, &result[0], false};
+    requests[1] = {address, 0, &result[page_size], false};
+    requests[2] = {address + 1, 7, &result[page_size], false};
+    requests[3] = {address + 3 * page_size, page_size, &result[page_size + 7],
+                   false};
+    ASSERT_TRUE(memory.ReadMultiple(requests, base::size(requests)));
+    for (const ProcessMemory::ReadRequest& request : requests) {
+      EXPECT_TRUE(request.succeeded);
+      const char* request_buffer = static_cast<const char*>(request.buffer);
+      for (size_t i = 0; i < request.size; ++i) {
+        EXPECT_EQ(request_buffer[i],
+                  static_cast<char>((request.address - address + i) % 256));
+      }
+    }
   }
 
   DISALLOW_COPY_AND_ASSIGN(ReadTest);
@@ -413,6 +433,19 @@ class ReadUnmappedTest : public MultiprocessAdaptor {
         memory.Read(page_addr1, base::GetPageSize() * 2, result.get()));
     EXPECT_FALSE(memory.Read(page_addr2, base::GetPageSize(), result.get()));
     EXPECT_FALSE(memory.Read(page_addr2 - 1, 2, result.get()));
+
+    // Regions before and after an unreadable one are still read.
+    ProcessMemory::ReadRequest requests[] = {
+        {page_addr1, 16, &result[0], false},
+        {page_addr2 - 1, 2, &result[16], false},
+        {page_addr2 - 16, 16, &result[32], false},
+        {page_addr2, 16, &result[48], false},
+    };
+    EXPECT_FALSE(memory.ReadMultiple(requests, base::size(requests)));
+    EXPECT_TRUE(requests[0].succeeded);
+    EXPECT_FALSE(requests[1].succeeded);
+    EXPECT_TRUE(requests[2].succeeded);
+    EXPECT_FALSE(requests[3].succeeded);
   }
 
   DISALLOW_COPY_AND_ASSIGN(ReadUnmappedTest);
@@ -14,11 +14,20 @@
 
 #include "util/stream/base94_output_stream.h"
 
+#include <string.h>
+
 #include <algorithm>
 
 #include "base/check.h"
 #include "base/logging.h"
 #include "base/numerics/safe_conversions.h"
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_64)
+#include <emmintrin.h>
+#elif defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif
 
 namespace crashpad {
 
@@ -42,6 +51,63 @@ inline uint8_t DecodeByte(uint8_t byte) {
   return std::min(static_cast<uint8_t>(byte - '!'), static_cast<uint8_t>(94));
 }
 
+// The pair of symbols that encodes each value that two symbols can hold, low
+// digit first.
+struct SymbolPairTable {
+  uint8_t pairs[94 * 94][2];
+};
+
+constexpr SymbolPairTable MakeSymbolPairTable() {
+  SymbolPairTable table = {};
+  for (uint16_t value = 0; value < 94 * 94; ++value) {
+    table.pairs[value][0] = static_cast<uint8_t>(value % 94 + '!');
+    table.pairs[value][1] = static_cast<uint8_t>(value / 94 + '!');
+  }
+  return table;
+}
+
+constexpr SymbolPairTable kSymbolPairTable = MakeSymbolPairTable();
+
+inline bool IsSymbol(uint8_t byte) {
+  return byte >= '!' && byte <= '~';
+}
+
+// Returns the number of valid symbols at the start of the |size| bytes at
+// |data|.
+size_t CountLeadingSymbols(const uint8_t* data, size_t size) {
+  size_t index = 0;
+#if defined(ARCH_CPU_X86_64)
+  // SSE2 only compares signed bytes. Bytes above 0x7f are negative, so they
+  // fail the first comparison.
+  const __m128i below = _mm_set1_epi8('!' - 1);
+  const __m128i above = _mm_set1_epi8('~' + 1);
+  for (; index + 16 <= size; index += 16) {
+    const __m128i symbols =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+    const __m128i valid = _mm_and_si128(_mm_cmpgt_epi8(symbols, below),
+                                        _mm_cmplt_epi8(symbols, above));
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+      break;
+    }
+  }
+#elif defined(ARCH_CPU_ARM64)
+  const uint8x16_t first = vdupq_n_u8('!');
+  const uint8x16_t last = vdupq_n_u8('~');
+  for (; index + 16 <= size; index += 16) {
+    const uint8x16_t symbols = vld1q_u8(data + index);
+    const uint8x16_t valid =
+        vandq_u8(vcgeq_u8(symbols, first), vcleq_u8(symbols, last));
+    if (vminvq_u8(valid) != 0xff) {
+      break;
+    }
+  }
+#endif
+  while (index < size && IsSymbol(data[index])) {
+    ++index;
+  }
+  return index;
+}
+
 }  // namespace
 
 Base94OutputStream::Base94OutputStream(
@@ -49,13 +115,13 @@ Base94OutputStream::Base94OutputStream(
     std::unique_ptr<OutputStreamInterface> output_stream)
     : mode_(mode),
       output_stream_(std::move(output_stream)),
+      buffer_(kMaxBuffer),
+      buffer_size_(0),
       bit_buf_(0),
       bit_count_(0),
       symbol_buffer_(0),
       flush_needed_(false),
-      flushed_(false) {
-  buffer_.reserve(kMaxBuffer);
-}
+      flushed_(false) {}
 
 Base94OutputStream::~Base94OutputStream() {
   DCHECK(!flush_needed_);
@@ -78,70 +144,114 @@ bool Base94OutputStream::Flush() {
 }
 
 bool Base94OutputStream::Encode(const uint8_t* data, size_t size) {
-  const uint8_t* cur = data;
-  while (size--) {
-    bit_buf_ |= *(cur++) << bit_count_;
-    bit_count_ += 8;
-    if (bit_count_ < 14)
-      continue;
-
-    uint16_t block;
-    // Check if 13-bit or 14-bit data should be encoded.
-    if ((bit_buf_ & 0x1FFF) > kMaxValueOf14BitEncoding) {
-      block = bit_buf_ & 0x1FFF;
-      bit_buf_ >>= 13;
-      bit_count_ -= 13;
-    } else {
-      block = bit_buf_ & 0x3FFF;
-      bit_buf_ >>= 14;
-      bit_count_ -= 14;
+  const uint8_t* const end = data + size;
+  while (data != end) {
+    // Fill bit_buf_ with as many whole bytes as fit. Between calls, fewer than
+    // 14 bits are left over.
+#if defined(ARCH_CPU_LITTLE_ENDIAN)
+    if (end - data >= 8) {
+      // Bits loaded past bit_count_ are those of the bytes that follow, which
+      // are loaded again in the same place before they’re counted.
+      uint64_t bytes;
+      memcpy(&bytes, data, sizeof(bytes));
+      bit_buf_ |= bytes << bit_count_;
+      const size_t byte_count = (63 - bit_count_) / 8;
+      data += byte_count;
+      bit_count_ += byte_count * 8;
+    } else
+#endif  // ARCH_CPU_LITTLE_ENDIAN
+    {
+      while (bit_count_ <= 56 && data != end) {
+        bit_buf_ |= static_cast<uint64_t>(*data++) << bit_count_;
+        bit_count_ += 8;
+      }
     }
-    buffer_.push_back(EncodeByte(block % 94));
-    buffer_.push_back(EncodeByte(base::saturated_cast<uint8_t>(block / 94)));
 
-    if (buffer_.size() > kMaxBuffer - 2 && !WriteOutputStream())
-      return false;
+    while (bit_count_ >= 14) {
+      if (buffer_size_ > kMaxBuffer - 2 && !WriteOutputStream())
+        return false;
+
+      // Check if 13-bit or 14-bit data should be encoded.
+      uint16_t block = bit_buf_ & 0x1FFF;
+      size_t block_bits = 13;
+      if (block <= kMaxValueOf14BitEncoding) {
+        block = bit_buf_ & 0x3FFF;
+        block_bits = 14;
+      }
+      memcpy(&buffer_[buffer_size_], kSymbolPairTable.pairs[block], 2);
+      buffer_size_ += 2;
+      bit_buf_ >>= block_bits;
+      bit_count_ -= block_bits;
+    }
   }
   return WriteOutputStream();
 }
 
 bool Base94OutputStream::Decode(const uint8_t* data, size_t size) {
-  const uint8_t* cur = data;
-  while (size--) {
-    if (DecodeByte(*cur) == 94) {
+  const uint8_t* const end = data + size;
+  while (data != end) {
+    const size_t chunk_size =
+        std::min(static_cast<size_t>(end - data), kMaxBuffer);
+    const size_t symbol_count = CountLeadingSymbols(data, chunk_size);
+    if (!DecodeSymbols(data, symbol_count))
+      return false;
+    if (symbol_count != chunk_size) {
       LOG(ERROR) << "Decode: invalid input";
+      // Discard the partially-decoded byte so that Flush() doesn’t write it.
+      bit_buf_ = 0;
+      bit_count_ = 0;
+      symbol_buffer_ = 0;
       return false;
     }
-    if (symbol_buffer_ == 0) {
-      symbol_buffer_ = *cur;
-      cur++;
-      continue;
-    }
-    uint16_t v = DecodeByte(symbol_buffer_) + DecodeByte(*cur) * 94;
-    cur++;
-    symbol_buffer_ = 0;
-    bit_buf_ |= v << bit_count_;
-    bit_count_ += (v & 0x1FFF) > kMaxValueOf14BitEncoding ? 13 : 14;
-    while (bit_count_ > 7) {
-      buffer_.push_back(bit_buf_ & 0xff);
-      bit_buf_ >>= 8;
-      bit_count_ -= 8;
-    }
-    if (buffer_.size() > kMaxBuffer - 2) {
-      if (!WriteOutputStream())
-        return false;
-    }
+    data += chunk_size;
   }
   return WriteOutputStream();
 }
 
+bool Base94OutputStream::DecodeSymbols(const uint8_t* data, size_t size) {
+  const uint8_t* const end = data + size;
+  if (symbol_buffer_ != 0 && data != end) {
+    if (!DecodeSymbolPair(symbol_buffer_, *data++))
+      return false;
+    symbol_buffer_ = 0;
+  }
+  for (; end - data >= 2; data += 2) {
+    if (!DecodeSymbolPair(data[0], data[1]))
+      return false;
+  }
+  if (data != end)
+    symbol_buffer_ = *data;
+  return true;
+}
+
+inline bool Base94OutputStream::DecodeSymbolPair(uint8_t low, uint8_t high) {
+  if (buffer_size_ > kMaxBuffer - 2 && !WriteOutputStream())
+    return false;
+
+  const uint16_t v = (low - '!') + (high - '!') * 94;
+  bit_buf_ |= static_cast<uint64_t>(v) << bit_count_;
+  bit_count_ += (v & 0x1FFF) > kMaxValueOf14BitEncoding ? 13 : 14;
+
+  // Fewer than 8 bits were left over, so there are now one or two whole bytes.
+  // Both bytes are stored, and the second is overwritten if it isn’t whole.
+  buffer_[buffer_size_] = bit_buf_ & 0xff;
+  buffer_[buffer_size_ + 1] = (bit_buf_ >> 8) & 0xff;
+  const size_t byte_count = bit_count_ / 8;
+  buffer_size_ += byte_count;
+  bit_buf_ >>= byte_count * 8;
+  bit_count_ -= byte_count * 8;
+  return true;
+}
+
 bool Base94OutputStream::FinishEncoding() {
   if (bit_count_ == 0)
     return true;
   // Up to 13 bits data is left over.
-  buffer_.push_back(EncodeByte(bit_buf_ % 94));
-  if (bit_buf_ > 93 || bit_count_ > 8)
-    buffer_.push_back(EncodeByte(base::saturated_cast<uint8_t>(bit_buf_ / 94)));
+  buffer_[buffer_size_++] = EncodeByte(bit_buf_ % 94);
+  if (bit_buf_ > 93 || bit_count_ > 8) {
+    buffer_[buffer_size_++] =
+        EncodeByte(base::saturated_cast<uint8_t>(bit_buf_ / 94));
+  }
   bit_count_ = 0;
   bit_buf_ = 0;
   return WriteOutputStream();
@@ -154,8 +264,8 @@ bool Base94OutputStream::FinishDecoding() {
     DCHECK(!bit_buf_);
     return true;
   }
-  bit_buf_ |= DecodeByte(symbol_buffer_) << bit_count_;
-  buffer_.push_back(bit_buf_ & 0xff);
+  bit_buf_ |= static_cast<uint64_t>(DecodeByte(symbol_buffer_)) << bit_count_;
+  buffer_[buffer_size_++] = bit_buf_ & 0xff;
   bit_buf_ >>= 8;
   // The remaining bits are either encode padding or zeros from bit shift.
   DCHECK(!bit_buf_);
@@ -163,11 +273,11 @@ bool Base94OutputStream::FinishDecoding() {
 }
 
 bool Base94OutputStream::WriteOutputStream() {
-  if (buffer_.empty())
+  if (buffer_size_ == 0)
     return true;
 
-  bool result = output_stream_->Write(buffer_.data(), buffer_.size());
-  buffer_.clear();
+  bool result = output_stream_->Write(buffer_.data(), buffer_size_);
+  buffer_size_ = 0;
   return result;
 }
 
@@ -33,6 +33,10 @@ namespace crashpad {
 //! To maximize encoding efficiency, 14-bit data is encoded into two base94
 //! symbols if its low 13-bit is less than 644 ( = 94^2 - 2^13), otherwise
 //! 13-bit data is encoded.
+//!
+//! The encoder keeps up to 64 bits of input at a time and looks up each pair
+//! of symbols in a table. The decoder validates its input 16 symbols at a time
+//! where SSE2 or NEON is available.
 class Base94OutputStream : public OutputStreamInterface {
  public:
   //! \brief Whether this object is configured to encode or decode data.
@@ -56,6 +60,9 @@ class Base94OutputStream : public OutputStreamInterface {
  private:
   bool Encode(const uint8_t* data, size_t size);
   bool Decode(const uint8_t* data, size_t size);
+  // Decodes |size| symbols at |data|, all of which are known to be valid.
+  bool DecodeSymbols(const uint8_t* data, size_t size);
+  bool DecodeSymbolPair(uint8_t low, uint8_t high);
   bool FinishEncoding();
   bool FinishDecoding();
   // Write encoded/decoded data to |output_stream_| and empty the |buffer_|.
@@ -64,7 +71,9 @@ class Base94OutputStream : public OutputStreamInterface {
   Mode mode_;
   std::unique_ptr<OutputStreamInterface> output_stream_;
   std::vector<uint8_t> buffer_;
-  uint32_t bit_buf_;
+  // The number of bytes of |buffer_| in use.
+  size_t buffer_size_;
+  uint64_t bit_buf_;
   // The number of valid bit in bit_buf_.
   size_t bit_count_;
   char symbol_buffer_;
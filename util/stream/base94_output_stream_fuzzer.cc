@@ -0,0 +1,95 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "util/stream/base94_output_stream.h"
+#include "util/stream/base94_output_stream_test_util.h"
+
+using namespace crashpad;
+
+namespace {
+
+class VectorOutputStream : public OutputStreamInterface {
+ public:
+  explicit VectorOutputStream(std::vector<uint8_t>* data) : data_(data) {}
+
+  bool Write(const uint8_t* data, size_t size) override {
+    data_->insert(data_->end(), data, data + size);
+    return true;
+  }
+  bool Flush() override { return true; }
+
+ private:
+  std::vector<uint8_t>* data_;
+};
+
+// Writes the |size| bytes at |data| to a Base94OutputStream in |mode| in two
+// pieces, split at a point selected by |split_selector|, and returns what the
+// stream produced.
+std::vector<uint8_t> WriteInTwoPieces(Base94OutputStream::Mode mode,
+                                      uint8_t split_selector,
+                                      const uint8_t* data,
+                                      size_t size,
+                                      bool* result) {
+  std::vector<uint8_t> output;
+  Base94OutputStream stream(mode,
+                            std::make_unique<VectorOutputStream>(&output));
+  const size_t split = size * split_selector / 255;
+  *result = stream.Write(data, split) &&
+            stream.Write(data + split, size - split);
+  *result = stream.Flush() && *result;
+  return output;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+  // Swallow all logs to avoid spam.
+  logging::SetLogMessageHandler(
+      [](logging::LogSeverity, const char*, int, size_t, const std::string&) {
+        return true;
+      });
+  return 0;
+}
+
+// Compares Base94OutputStream’s encoding with the reference implementation,
+// and checks that decoding it reproduces the input.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size == 0)
+    return 0;
+
+  bool result;
+  std::vector<uint8_t> encoded = WriteInTwoPieces(
+      Base94OutputStream::Mode::kEncode, data[0], data + 1, size - 1, &result);
+  if (!result || encoded != test::ReferenceBase94Encode(data + 1, size - 1))
+    abort();
+
+  std::vector<uint8_t> decoded = WriteInTwoPieces(
+      Base94OutputStream::Mode::kDecode,
+      data[0],
+      encoded.data(),
+      encoded.size(),
+      &result);
+  if (!result || decoded != std::vector<uint8_t>(data + 1, data + size))
+    abort();
+
+  return 0;
+}
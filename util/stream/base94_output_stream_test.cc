@@ -19,11 +19,14 @@
 #include <algorithm>
 #include <sstream>
 
+#include "base/logging.h"
 #include "base/macros.h"
 #include "base/rand_util.h"
 #include "base/stl_util.h"
 #include "base/strings/stringprintf.h"
 #include "gtest/gtest.h"
+#include "util/misc/clock.h"
+#include "util/stream/base94_output_stream_test_util.h"
 #include "util/stream/test_output_stream.h"
 
 namespace crashpad {
@@ -285,6 +288,160 @@ TEST_F(Base94OutputStreamTest, Process7bitsInFinishDecoding) {
   VerifyRoundTrip(input);
 }
 
+// Writes |data| to a new Base94OutputStream in |mode| in pieces of random
+// sizes, and returns what the stream produced. Sets |*result| to the result of
+// the writes and the flush. If a write fails, returns what the stream produced
+// before the failure.
+std::vector<uint8_t> WriteInPieces(Base94OutputStream::Mode mode,
+                                   const std::vector<uint8_t>& data,
+                                   bool* result) {
+  auto output_stream = std::make_unique<TestOutputStream>();
+  TestOutputStream* test_output_stream = output_stream.get();
+  Base94OutputStream stream(mode, std::move(output_stream));
+
+  size_t index = 0;
+  while (index < data.size()) {
+    const size_t write_length =
+        std::min(static_cast<size_t>(base::RandInt(0, 100) < 90
+                                         ? base::RandInt(0, 64)
+                                         : base::RandInt(0, 4096 * 3)),
+                 data.size() - index);
+    if (!stream.Write(data.data() + index, write_length)) {
+      std::vector<uint8_t> written = test_output_stream->all_data();
+      stream.Flush();
+      *result = false;
+      return written;
+    }
+    index += write_length;
+  }
+  *result = stream.Flush();
+  return test_output_stream->all_data();
+}
+
+// Returns random data of a random length. Runs of all-zero and all-one bits
+// are mixed in so that both 13- and 14-bit blocks are encoded often.
+std::vector<uint8_t> BuildFuzzInput() {
+  std::vector<uint8_t> data(base::RandInt(0, 4096 * 4));
+  base::RandBytes(data.data(), data.size());
+  for (size_t index = 0; index < data.size();) {
+    const size_t run = std::min(static_cast<size_t>(base::RandInt(0, 64)),
+                                data.size() - index);
+    if (base::RandInt(0, 3) == 0) {
+      memset(&data[index], base::RandInt(0, 1) ? 0xff : 0, run);
+    }
+    index += run + base::RandInt(0, 256);
+  }
+  return data;
+}
+
+TEST(Base94OutputStreamDifferential, MatchesReference) {
+  for (size_t iteration = 0; iteration < 500; ++iteration) {
+    const std::vector<uint8_t> input = BuildFuzzInput();
+    SCOPED_TRACE(base::StringPrintf(
+        "iteration %zu, size %zu", iteration, input.size()));
+
+    const std::vector<uint8_t> expected_encoding =
+        ReferenceBase94Encode(input.data(), input.size());
+    bool result;
+    EXPECT_EQ(WriteInPieces(Base94OutputStream::Mode::kEncode, input, &result),
+              expected_encoding);
+    EXPECT_TRUE(result);
+
+    std::vector<uint8_t> expected_decoding;
+    ASSERT_TRUE(ReferenceBase94Decode(expected_encoding.data(),
+                                      expected_encoding.size(),
+                                      &expected_decoding));
+    EXPECT_EQ(expected_decoding, input);
+    EXPECT_EQ(WriteInPieces(Base94OutputStream::Mode::kDecode,
+                            expected_encoding,
+                            &result),
+              expected_decoding);
+    EXPECT_TRUE(result);
+  }
+}
+
+TEST(Base94OutputStreamDifferential, InvalidSymbols) {
+  static constexpr uint8_t kInvalidSymbols[] = {0, ' ', 0x7f, 0x80, 0xff};
+  for (size_t iteration = 0; iteration < 100; ++iteration) {
+    std::vector<uint8_t> input(base::RandInt(1, 4096 * 3));
+    for (uint8_t& symbol : input) {
+      symbol = static_cast<uint8_t>(base::RandInt('!', '~'));
+    }
+    const size_t invalid_index = base::RandInt(0, input.size() - 1);
+    input[invalid_index] = kInvalidSymbols[base::RandInt(
+        0, base::size(kInvalidSymbols) - 1)];
+    SCOPED_TRACE(base::StringPrintf("size %zu, invalid index %zu",
+                                    input.size(),
+                                    invalid_index));
+
+    std::vector<uint8_t> expected_decoding;
+    EXPECT_FALSE(ReferenceBase94Decode(
+        input.data(), input.size(), &expected_decoding));
+    bool result;
+    std::vector<uint8_t> decoded =
+        WriteInPieces(Base94OutputStream::Mode::kDecode, input, &result);
+    EXPECT_FALSE(result);
+
+    // Anything written before the error is correct.
+    ASSERT_LE(decoded.size(), expected_decoding.size());
+    EXPECT_TRUE(std::equal(
+        decoded.begin(), decoded.end(), expected_decoding.begin()));
+  }
+}
+
+class NullOutputStream : public OutputStreamInterface {
+ public:
+  NullOutputStream() {}
+  ~NullOutputStream() override {}
+
+  // OutputStreamInterface:
+  bool Write(const uint8_t* data, size_t size) override { return true; }
+  bool Flush() override { return true; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(NullOutputStream);
+};
+
+TEST(Base94OutputStreamDifferential, DISABLED_Benchmark) {
+  constexpr size_t kInputSize = 32 * 1024 * 1024;
+  std::vector<uint8_t> input(kInputSize);
+  base::RandBytes(input.data(), input.size());
+
+  const uint64_t reference_encode_start = ClockMonotonicNanoseconds();
+  const std::vector<uint8_t> encoded =
+      ReferenceBase94Encode(input.data(), input.size());
+  const uint64_t reference_decode_start = ClockMonotonicNanoseconds();
+  std::vector<uint8_t> decoded;
+  ASSERT_TRUE(
+      ReferenceBase94Decode(encoded.data(), encoded.size(), &decoded));
+  const uint64_t encode_start = ClockMonotonicNanoseconds();
+  {
+    Base94OutputStream encoder(Base94OutputStream::Mode::kEncode,
+                               std::make_unique<NullOutputStream>());
+    ASSERT_TRUE(encoder.Write(input.data(), input.size()));
+    ASSERT_TRUE(encoder.Flush());
+  }
+  const uint64_t decode_start = ClockMonotonicNanoseconds();
+  {
+    Base94OutputStream decoder(Base94OutputStream::Mode::kDecode,
+                               std::make_unique<NullOutputStream>());
+    ASSERT_TRUE(decoder.Write(encoded.data(), encoded.size()));
+    ASSERT_TRUE(decoder.Flush());
+  }
+  const uint64_t end = ClockMonotonicNanoseconds();
+
+  // Throughput is measured in megabytes of unencoded data per second.
+  const auto rate = [](uint64_t start, uint64_t end) {
+    return kInputSize / 1E6 / ((end - start) / 1E9);
+  };
+  LOG(INFO) << "reference encode: " << rate(reference_encode_start,
+                                            reference_decode_start)
+            << " MB/s, decode: " << rate(reference_decode_start, encode_start)
+            << " MB/s";
+  LOG(INFO) << "Base94OutputStream encode: " << rate(encode_start, decode_start)
+            << " MB/s, decode: " << rate(decode_start, end) << " MB/s";
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace crashpad
@@ -0,0 +1,88 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/stream/base94_output_stream_test_util.h"
+
+namespace crashpad {
+namespace test {
+
+namespace {
+
+constexpr uint16_t kMaxValueOf14BitEncoding = (94 * 94 - 1) & 0x1FFF;
+
+}  // namespace
+
+std::vector<uint8_t> ReferenceBase94Encode(const uint8_t* data, size_t size) {
+  std::vector<uint8_t> encoded;
+  uint32_t bit_buf = 0;
+  size_t bit_count = 0;
+  for (size_t index = 0; index < size; ++index) {
+    bit_buf |= data[index] << bit_count;
+    bit_count += 8;
+    if (bit_count < 14)
+      continue;
+
+    uint16_t block;
+    if ((bit_buf & 0x1FFF) > kMaxValueOf14BitEncoding) {
+      block = bit_buf & 0x1FFF;
+      bit_buf >>= 13;
+      bit_count -= 13;
+    } else {
+      block = bit_buf & 0x3FFF;
+      bit_buf >>= 14;
+      bit_count -= 14;
+    }
+    encoded.push_back(block % 94 + '!');
+    encoded.push_back(block / 94 + '!');
+  }
+
+  if (bit_count != 0) {
+    encoded.push_back(bit_buf % 94 + '!');
+    if (bit_buf > 93 || bit_count > 8)
+      encoded.push_back(bit_buf / 94 + '!');
+  }
+  return encoded;
+}
+
+bool ReferenceBase94Decode(const uint8_t* data,
+                           size_t size,
+                           std::vector<uint8_t>* decoded) {
+  decoded->clear();
+  uint32_t bit_buf = 0;
+  size_t bit_count = 0;
+  for (size_t index = 0; index < size; ++index) {
+    if (data[index] < '!' || data[index] > '~')
+      return false;
+    if (index % 2 == 0)
+      continue;
+
+    const uint16_t v = (data[index - 1] - '!') + (data[index] - '!') * 94;
+    bit_buf |= v << bit_count;
+    bit_count += (v & 0x1FFF) > kMaxValueOf14BitEncoding ? 13 : 14;
+    while (bit_count > 7) {
+      decoded->push_back(bit_buf & 0xff);
+      bit_buf >>= 8;
+      bit_count -= 8;
+    }
+  }
+
+  if (size % 2 != 0) {
+    bit_buf |= (data[size - 1] - '!') << bit_count;
+    decoded->push_back(bit_buf & 0xff);
+  }
+  return true;
+}
+
+}  // namespace test
+}  // namespace crashpad
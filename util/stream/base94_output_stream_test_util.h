@@ -0,0 +1,53 @@
+// Copyright 2020 The Crashpad Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CRASHPAD_UTIL_STREAM_BASE94_OUTPUT_STREAM_TEST_UTIL_H_
+#define CRASHPAD_UTIL_STREAM_BASE94_OUTPUT_STREAM_TEST_UTIL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace crashpad {
+namespace test {
+
+//! \brief Encodes data as Base94OutputStream does, one bit at a time.
+//!
+//! This is a straightforward implementation of the encoding, for comparison
+//! with Base94OutputStream.
+//!
+//! \param[in] data The data to encode.
+//! \param[in] size The number of bytes at \a data.
+//!
+//! \return The encoded symbols.
+std::vector<uint8_t> ReferenceBase94Encode(const uint8_t* data, size_t size);
+
+//! \brief Decodes data as Base94OutputStream does, one symbol at a time.
+//!
+//! \param[in] data The symbols to decode.
+//! \param[in] size The number of symbols at \a data.
+//! \param[out] decoded The decoded data. If a symbol is invalid, this is the
+//!     data decoded before it.
+//!
+//! \return `true` on success, or `false` if \a data contains a byte that is
+//!     not a valid symbol.
+bool ReferenceBase94Decode(const uint8_t* data,
+                           size_t size,
+                           std::vector<uint8_t>* decoded);
+
+}  // namespace test
+}  // namespace crashpad
+
+#endif  // CRASHPAD_UTIL_STREAM_BASE94_OUTPUT_STREAM_TEST_UTIL_H_
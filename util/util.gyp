@@ -50,6 +50,8 @@
         'file/filesystem_win.cc',
         'file/file_writer.cc',
         'file/file_writer.h',
+        'file/memory_file_reader.cc',
+        'file/memory_file_reader.h',
         'file/output_stream_file_writer.cc',
         'file/output_stream_file_writer.h',
         'file/scoped_remove_file.cc',
@@ -182,6 +184,8 @@
         'misc/zlib.h',
         'net/http_body.cc',
         'net/http_body.h',
+        'net/http_body_bandwidth_limited.cc',
+        'net/http_body_bandwidth_limited.h',
         'net/http_body_gzip.cc',
         'net/http_body_gzip.h',
         'net/http_headers.h',
@@ -222,11 +226,15 @@
         'process/process_id.h',
         'process/process_memory.cc',
         'process/process_memory.h',
+        'process/process_memory_caching.cc',
+        'process/process_memory_caching.h',
         'process/process_memory_linux.cc',
         'process/process_memory_linux.h',
         'process/process_memory_mac.cc',
         'process/process_memory_mac.h',
         'process/process_memory_native.h',
+        'process/process_memory_prefetched.cc',
+        'process/process_memory_prefetched.h',
         'process/process_memory_range.cc',
         'process/process_memory_range.h',
         'stdlib/aligned_allocator.cc',
@@ -418,6 +426,8 @@
         }],
         ['OS=="linux" or OS=="android"', {
           'sources': [
+            'net/http_response_reader.cc',
+            'net/http_response_reader.h',
             'net/http_transport_socket.cc',
             'process/process_memory_sanitized.cc',
             'process/process_memory_sanitized.h',
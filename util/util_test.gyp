@@ -41,6 +41,7 @@
         'file/file_io_test.cc',
         'file/file_reader_test.cc',
         'file/filesystem_test.cc',
+        'file/memory_file_reader_test.cc',
         'file/string_file_test.cc',
         'linux/auxiliary_vector_test.cc',
         'linux/memory_map_test.cc',
@@ -85,6 +86,7 @@
         'misc/reinterpret_bytes_test.cc',
         'misc/time_test.cc',
         'misc/uuid_test.cc',
+        'net/http_body_bandwidth_limited_test.cc',
         'net/http_body_gzip_test.cc',
         'net/http_body_test.cc',
         'net/http_body_test_util.cc',
@@ -100,7 +102,9 @@
         'posix/scoped_mmap_test.cc',
         'posix/signals_test.cc',
         'posix/symbolic_constants_posix_test.cc',
+        'process/process_memory_caching_test.cc',
         'process/process_memory_mac_test.cc',
+        'process/process_memory_prefetched_test.cc',
         'process/process_memory_range_test.cc',
         'process/process_memory_test.cc',
         'stdlib/aligned_allocator_test.cc',
@@ -156,6 +160,8 @@
         }],
         ['OS=="linux" or OS=="android"', {
           'sources': [
+            'net/http_response_reader_test.cc',
+            'net/http_transport_socket_test.cc',
             'process/process_memory_sanitized_test.cc',
           ],
         }],